@@ -837,6 +837,7 @@ void can::RemovePlayers()
 
 void can::CAN_rxtask(void *pvParameters)
   {
+  OvmsHeapTag heaptag(HEAPTAG_CAN);
   can *me = (can*)pvParameters;
   CAN_queue_msg_t msg;
 
@@ -45,6 +45,7 @@
 #include "pcp.h"
 #include <esp_err.h>
 #include "ovms_events.h"
+#include "ovms_pool.h"
 
 ////////////////////////////////////////////////////////////////////////
 // Constant ESP_QUEUED to indicate a 'queued' response
@@ -349,7 +350,7 @@ class canbus : public pcp, public InternalRamAllocated
 typedef std::map<QueueHandle_t, bool> CanListenerMap_t;
 
 
-class CanFrameCallbackEntry
+class CanFrameCallbackEntry : public OvmsPoolAllocated
   {
   public:
     CanFrameCallbackEntry(const char* caller, CanFrameCallback callback)
@@ -41,6 +41,7 @@ static const char *TAG = "canlog";
 #include "ovms_events.h"
 #include "ovms_peripherals.h"
 #include "metrics_standard.h"
+#include "ovms_pool.h"
 
 static const char *CAN_PARAM = "can";
 
@@ -392,7 +393,7 @@ canlog::~canlog()
         case CAN_LogInfo_Config:
         case CAN_LogInfo_Event:
         case CAN_LogInfo_Metric:
-          free(msg.text);
+          MyPools.Free(msg.text);
           break;
         default:
           break;
@@ -416,6 +417,7 @@ canlog::~canlog()
 
 void canlog::RxTask(void *context)
   {
+  OvmsHeapTag heaptag(HEAPTAG_CANLOG);
   canlog* me = (canlog*) context;
   CAN_log_message_t msg;
   while (1)
@@ -429,7 +431,7 @@ void canlog::RxTask(void *context)
         case CAN_LogInfo_Event:
         case CAN_LogInfo_Metric:
           me->OutputMsg(msg);
-          free(msg.text);
+          MyPools.Free(msg.text);
           break;
         default:
           me->OutputMsg(msg);
@@ -662,12 +664,12 @@ void canlog::LogInfo(canbus* bus, CAN_log_type_t type, const char* text)
     msg.type = type;
     gettimeofday(&msg.timestamp,NULL);
     msg.origin = bus;
-    msg.text = strdup(text);
+    msg.text = MyPools.strdup(text);
     m_msgcount++;
     if (xQueueSend(m_queue, &msg, 0) != pdTRUE)
       {
       m_dropcount++;
-      free(msg.text);
+      MyPools.Free(msg.text);
       }
     }
   else
@@ -124,6 +124,8 @@ void OvmsCanLogTcpClientInit::NetManStop(std::string event, void* data)
 
 static void tcMongooseHandler(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsNetProfile prof(NETPROF_CANLOG);
+  OvmsHeapTag heaptag(HEAPTAG_CANLOG);
   if (MyCanLogTcpClient)
     MyCanLogTcpClient->MongooseHandler(nc, ev, p);
   else if (ev == MG_EV_ACCEPT)
@@ -125,6 +125,7 @@ void OvmsCanLogTcpServerInit::NetManStop(std::string event, void* data)
 
 static void tsMongooseHandler(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsNetProfile prof(NETPROF_CANLOG);
   if (MyCanLogTcpServer)
     MyCanLogTcpServer->MongooseHandler(nc, ev, p);
   else if (ev == MG_EV_ACCEPT)
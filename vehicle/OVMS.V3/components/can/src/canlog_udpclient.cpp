@@ -110,6 +110,8 @@ void OvmsCanLogUdpClientInit::NetManStop(std::string event, void* data)
 
 static void tcMongooseHandler(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsNetProfile prof(NETPROF_CANLOG);
+  OvmsHeapTag heaptag(HEAPTAG_CANLOG);
   if (MyCanLogUdpClient)
     MyCanLogUdpClient->MongooseHandler(nc, ev, p);
   }
@@ -159,6 +159,7 @@ void OvmsCanLogUdpServerInit::NetManStop(std::string event, void* data)
 
 static void tsMongooseHandler(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsNetProfile prof(NETPROF_CANLOG);
   if (MyCanLogUdpServer)
     MyCanLogUdpServer->MongooseHandler(nc, ev, p);
   else if (ev == MG_EV_ACCEPT)
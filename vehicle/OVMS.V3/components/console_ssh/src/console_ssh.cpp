@@ -78,6 +78,7 @@ OvmsSSH MySSH __attribute__ ((init_priority (8300)));
 
 static void MongooseHandler(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsNetProfile prof(NETPROF_CONSOLE);
   MySSH.EventHandler(nc, ev, p);
   }
 
@@ -860,6 +861,7 @@ void ConsoleSSH::HandleDeviceEvent(void* pEvent)
           {
           fclose(m_file);
           m_file = NULL;
+          MyEvents.SignalEvent("system.vfs.file.changed", (void*)m_path.c_str(), m_path.size()+1);
           m_state = SINK_RESPONSE;
           wolfSSH_stream_send(m_ssh, (uint8_t*)"", 1);
           }
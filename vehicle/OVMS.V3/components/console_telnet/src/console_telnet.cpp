@@ -58,6 +58,7 @@ OvmsTelnet MyTelnet __attribute__ ((init_priority (8300)));
 
 static void MongooseHandler(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsNetProfile prof(NETPROF_CONSOLE);
   MyTelnet.EventHandler(nc, ev, p);
   }
 
@@ -41,6 +41,7 @@ static const char *TAG = "esp32wifi";
 #include "ovms_config.h"
 #include "ovms_peripherals.h"
 #include "ovms_events.h"
+#include "ovms_status.h"
 #include "metrics_standard.h"
 #if ESP_IDF_VERSION_MAJOR >= 4
 #include <esp_wifi_types.h>
@@ -337,6 +338,7 @@ esp32wifiInit::esp32wifiInit()
   cmd_wifi->RegisterCommand("scan", "Perform a wifi scan", wifi_scan, "[-j]\n-j = output in JSON format", 0, 1);
   cmd_wifi->RegisterCommand("status","Show wifi status",wifi_status);
   cmd_wifi->RegisterCommand("reconnect","Reconnect wifi client",wifi_reconnect);
+  MyStatus.RegisterCommand("wifi", TAG, 5000, cmd_wifi, "system.wifi.|network.wifi.");
 
   OvmsCommand* cmd_mode = cmd_wifi->RegisterCommand("mode","WIFI mode framework");
   cmd_mode->RegisterCommand("client","Connect to a WIFI network as a client",wifi_mode_client,
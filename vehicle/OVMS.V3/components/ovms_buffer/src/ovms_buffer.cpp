@@ -43,6 +43,7 @@ OvmsBuffer::OvmsBuffer(size_t size, void* userdata)
   m_tail = 0;
   m_size = size;
   m_used = 0;
+  m_linescan = 0;
   m_userdata = userdata;
   }
 
@@ -71,6 +72,7 @@ void OvmsBuffer::EmptyAll()
   m_head = 0;
   m_tail = 0;
   m_used = 0;
+  m_linescan = 0;
   }
 
 bool OvmsBuffer::Push(uint8_t byte)
@@ -88,13 +90,15 @@ bool OvmsBuffer::Push(uint8_t *byte, size_t count)
   {
   if ((m_size-m_used)<count) return false;
 
+  // Copy up to the end of the buffer, then wrap:
+  size_t n = m_size - m_head;
+  if (n > count) n = count;
+  memcpy(m_buffer+m_head, byte, n);
+  if (n < count)
+    memcpy(m_buffer, byte+n, count-n);
+  m_head += count;
+  if (m_head >= m_size) m_head -= m_size;
   m_used += count;
-  for (size_t k=0;k<count;k++)
-    {
-    // ESP_LOGI(TAG, "Push() %02x at %d",byte[k],m_head);
-    m_buffer[m_head++] = byte[k];
-    if (m_head >= m_size) m_head=0;
-    }
 
   return true;
   }
@@ -106,21 +110,15 @@ uint8_t OvmsBuffer::Pop()
   m_used--;
   uint8_t result = m_buffer[m_tail++];
   if (m_tail >= m_size) m_tail=0;
+  if (m_linescan) m_linescan--;
 
   return result;
   }
 
 size_t OvmsBuffer::Pop(size_t count, uint8_t *dest)
   {
-  size_t done = 0;
-
-  while ((m_used>0)&&(done < count))
-    {
-    m_used--;
-    dest[done++] = m_buffer[m_tail++];
-    if (m_tail >= m_size) m_tail=0;
-    }
-
+  size_t done = Peek(count, dest);
+  Consume(done);
   return done;
   }
 
@@ -133,16 +131,84 @@ uint8_t OvmsBuffer::Peek()
 
 size_t OvmsBuffer::Peek(size_t count, uint8_t *dest)
   {
-  size_t done = 0;
+  uint8_t *d1, *d2;
+  size_t n1, n2;
+  PeekSpans(&d1, &n1, &d2, &n2);
 
-  size_t tail = m_tail;
-  while ((done<m_used)&&(done<count))
+  if (count > m_used) count = m_used;
+  if (count <= n1)
+    {
+    memcpy(dest, d1, count);
+    }
+  else
     {
-    dest[done++] = m_buffer[tail++];
-    if (tail >= m_size) tail=0;
+    memcpy(dest, d1, n1);
+    memcpy(dest+n1, d2, count-n1);
     }
 
-  return done;
+  return count;
+  }
+
+/**
+ * PeekSpans: get the used space as up to two contiguous spans (tail to end
+ *  of buffer, start of buffer to head). Returns the total length.
+ */
+size_t OvmsBuffer::PeekSpans(uint8_t **data1, size_t *len1, uint8_t **data2, size_t *len2)
+  {
+  size_t n1 = m_size - m_tail;
+  if (n1 > m_used) n1 = m_used;
+  *data1 = m_buffer + m_tail;
+  *len1 = n1;
+  if (data2) *data2 = m_buffer;
+  if (len2) *len2 = m_used - n1;
+  return m_used;
+  }
+
+/**
+ * PeekSpan: get the first contiguous span of used space, returns its length
+ */
+size_t OvmsBuffer::PeekSpan(uint8_t **data)
+  {
+  size_t n;
+  PeekSpans(data, &n);
+  return n;
+  }
+
+/**
+ * Consume: drop count bytes from the tail (after reading them via PeekSpan)
+ */
+void OvmsBuffer::Consume(size_t count)
+  {
+  if (count > m_used) count = m_used;
+  m_tail += count;
+  if (m_tail >= m_size) m_tail -= m_size;
+  m_used -= count;
+  m_linescan = (m_linescan > count) ? m_linescan - count : 0;
+  if (m_used == 0)
+    {
+    // Maximize contiguous free space:
+    m_head = m_tail = 0;
+    }
+  }
+
+/**
+ * WriteSpan: get the first contiguous span of free space at the head,
+ *  returns its length. Fill it, then Commit() the bytes written.
+ */
+size_t OvmsBuffer::WriteSpan(uint8_t **data)
+  {
+  size_t n = (m_head >= m_tail && m_used < m_size) ? m_size - m_head : m_size - m_used;
+  if (n > m_size - m_used) n = m_size - m_used;
+  *data = m_buffer + m_head;
+  return n;
+  }
+
+void OvmsBuffer::Commit(size_t count)
+  {
+  if (count > m_size - m_used) count = m_size - m_used;
+  m_head += count;
+  if (m_head >= m_size) m_head -= m_size;
+  m_used += count;
   }
 
 void OvmsBuffer::Diagnostics()
@@ -152,24 +218,39 @@ void OvmsBuffer::Diagnostics()
     m_used,m_size,m_head,m_tail,hl);
   }
 
-int OvmsBuffer::HasLine()
+// Find first CR or LF in a span, returns offset or len if none:
+static size_t FindEol(const uint8_t* data, size_t len)
   {
-  size_t tail = m_tail;
+  const uint8_t* cr = (const uint8_t*) memchr(data, '\r', len);
+  if (cr) len = cr - data;
+  const uint8_t* lf = (const uint8_t*) memchr(data, '\n', len);
+  if (lf) len = lf - data;
+  return len;
+  }
 
+int OvmsBuffer::HasLine()
+  {
   if (m_used==0) return -1;
 
-  // ESP_LOGI(TAG, "HasLine() with tail at %d (%d used)",m_tail,m_used);
-  for (size_t done=0;done<m_used;done++)
+  // Continue scanning after the part already known to hold no CR/LF:
+  uint8_t *d1, *d2;
+  size_t n1, n2;
+  PeekSpans(&d1, &n1, &d2, &n2);
+  size_t pos = m_linescan;
+  if (pos < n1)
     {
-    // ESP_LOGI(TAG, "HasLine() at tail %d is %02x (%d done)",tail,m_buffer[tail],done);
-    if ((m_buffer[tail]=='\r')||(m_buffer[tail]=='\n'))
+    size_t k = FindEol(d1+pos, n1-pos);
+    if (k < n1-pos)
       {
-      // ESP_LOGI(TAG, "HasLine() found a CR/LF at tail %d (done=%d)",tail,done);
-      return done;
+      m_linescan = pos + k;
+      return m_linescan;
       }
-    tail++;
-    if (tail >= m_size) tail=0;
+    pos = n1;
     }
+  size_t k = FindEol(d2+(pos-n1), n2-(pos-n1));
+  m_linescan = pos + k;
+  if (k < n2-(pos-n1))
+    return m_linescan;
 
   // ESP_LOGI(TAG, "HasLine() didnt find a CR/LF");
   return -1;
@@ -180,13 +261,13 @@ std::string OvmsBuffer::ReadLine()
   int hl = HasLine();
   if (hl<0) return std::string("");
 
-  uint8_t result[hl+1];
-  Pop(hl, result);
+  std::string result(hl, '\0');
+  Pop(hl, (uint8_t*)&result[0]);
 
   if (Peek() == '\r') Pop();
   if (Peek() == '\n') Pop();
 
-  return std::string((char*)result,hl);
+  return result;
   }
 
 int OvmsBuffer::PollSocket(int sock, long timeoutms)
@@ -207,12 +288,12 @@ int OvmsBuffer::PollSocket(int sock, long timeoutms)
   // ESP_LOGI(TAG, "Polling Socket select result %d",result);
   if (result <= 0) return -1;
 
-  // We have some data ready to read
-  size_t avail = FreeSpace();
-  if (avail==0) return 0;
-  // ESP_LOGI(TAG,"Polling Socket allocating %d bytes",avail);
-  uint8_t *buf = new uint8_t[avail];
-  size_t n = read(sock, buf, avail);
+  // We have some data ready to read, read directly into the free space:
+  if (FreeSpace()==0) return 0;
+  if (m_used == 0) m_head = m_tail = 0;
+  uint8_t *buf;
+  size_t avail = WriteSpan(&buf);
+  ssize_t n = read(sock, buf, avail);
   // ESP_LOGI(TAG,"Polling Socket read %d bytes",n);
   // MyCommandApp.HexDump(TAG, "PollSocket", (const char*)buf, n);
   if (n == 0)
@@ -221,9 +302,8 @@ int OvmsBuffer::PollSocket(int sock, long timeoutms)
     }
   else if (n > 0)
     {
-    Push(buf,n);
+    Commit(n);
     }
-  delete [] buf;
   return n;
   }
 
@@ -55,6 +55,16 @@ class OvmsBuffer
     size_t Peek(size_t count, uint8_t *dest);
     void Diagnostics();
 
+  public:
+    // Zero copy access: the used space is at most two contiguous spans,
+    // the free space likewise. Read spans stay valid until consumed,
+    // write spans until committed or the buffer is emptied.
+    size_t PeekSpans(uint8_t **data1, size_t *len1, uint8_t **data2 = NULL, size_t *len2 = NULL);
+    size_t PeekSpan(uint8_t **data);
+    void Consume(size_t count);
+    size_t WriteSpan(uint8_t **data);
+    void Commit(size_t count);
+
   public:
     int HasLine();
     std::string ReadLine();
@@ -71,6 +81,7 @@ class OvmsBuffer
     int m_tail;
     size_t m_size;
     size_t m_used;
+    size_t m_linescan;      // Bytes from tail known to contain no CR/LF
   };
 
 #endif //#ifndef __OVMS_BUFFER_H__
@@ -32,6 +32,9 @@
 static const char *TAG = "gsm-mux";
 
 #include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include "esp_timer.h"
 #include "gsmmux.h"
 #include "ovms_cellular.h"
 
@@ -157,9 +160,13 @@ void GsmMuxChannel::ProcessFrame(uint8_t* frame, size_t length, size_t iframepos
     case ChanOpen:
       if (frame[1] == (GSM_UIH + GSM_PF))
         {
-        for (size_t k=iframepos;k<length;k++)
-          m_buffer.Push(frame[k]);
-        m_mux->m_modem->IncomingMuxData(this);
+        size_t n = length - iframepos;
+        if (n > m_buffer.FreeSpace()) n = m_buffer.FreeSpace(); // drop excess
+        m_buffer.Push(frame+iframepos, n);
+        if (m_mux->m_modem)
+          m_mux->m_modem->IncomingMuxData(this);
+        else
+          m_buffer.EmptyAll();
         }
       break;
     case ChanClosing:
@@ -274,54 +281,81 @@ uint32_t GsmMux::GoodFrameAge()
 
 void GsmMux::Process(OvmsBuffer* buf)
   {
-  while (buf->UsedSpace()>0)
+  // Parse the buffer content in place, span by span:
+  uint8_t* data;
+  size_t len;
+  while ((len = buf->PeekSpan(&data)) > 0)
     {
-    if (m_framepos == m_framesize)
+    buf->Consume(Process(data, len));
+    }
+  }
+
+size_t GsmMux::Process(const uint8_t* data, size_t len)
+  {
+  size_t pos = 0;
+  while (pos < len)
+    {
+    if (m_framepos == 0)
       {
-      // Overflow frame
-      ESP_LOGW(TAG, "Frame overflow (%d bytes)",m_framesize);
-      MyCommandApp.HexDump(TAG, "Frame head", (const char*)m_frame, 8*16);
-      m_framepos = 0;
-      m_framelen = 0;
-      m_framemorelen = false;
-      m_framingerrors++;
+      // Skip to start of frame:
+      const uint8_t* sof = (const uint8_t*)memchr(data+pos, GSM0_SOF, len-pos);
+      if (!sof) break;
+      pos = (sof - data) + 1;
+      m_frame[m_framepos++] = GSM0_SOF;
       continue;
       }
-    uint8_t b = buf->Pop();
-    if ((m_framepos == 0)&&(b != GSM0_SOF))
-      {
-      continue; // Skip to start of frame
-      }
-    if ((m_framepos == 1)&&(b == GSM0_SOF)) continue; // We found end of previous frame, so just skip it
-    // ESP_LOGI(TAG, "Got %02x at %d (length sofar = %d)",b,m_framepos,m_framelen);
-    m_frame[m_framepos++] = b;
-    if (m_framepos == 4)
+
+    if ((m_framepos < 4) || (m_framemorelen))
       {
-      // First byte of length field
-      m_framemorelen = !(b & GSM_EA);
-      m_framelen = (b>>1);
-      if (!m_framemorelen)
+      // Header: address, control & length field
+      uint8_t b = data[pos++];
+      if ((m_framepos == 1)&&(b == GSM0_SOF)) continue; // We found end of previous frame, so just skip it
+      // ESP_LOGI(TAG, "Got %02x at %d (length sofar = %d)",b,m_framepos,m_framelen);
+      m_frame[m_framepos++] = b;
+      if (m_framepos == 4)
         {
-        m_framelen += (m_framepos+2);
-        m_frameipos = m_framepos;
+        // First byte of length field
+        m_framemorelen = !(b & GSM_EA);
+        m_framelen = (b>>1);
+        if (!m_framemorelen)
+          {
+          m_framelen += (m_framepos+2);
+          m_frameipos = m_framepos;
+          }
+        else
+          {
+          m_framelen += (m_framepos+3);
+          m_frameipos = m_framepos+1;
+          }
+        // ESP_LOGI(TAG, "Frame length (first byte) = %d",m_framelen);
         }
-      else
+      else if (m_framepos == 5)
         {
-        m_framelen += (m_framepos+3);
-        m_frameipos = m_framepos+1;
+        // Second byte of length field
+        m_framelen += (b<<7);
+        m_framemorelen = false;
+        // ESP_LOGI(TAG, "Frame length (second byte) = %d",m_framelen);
         }
-      // ESP_LOGI(TAG, "Frame length (first byte) = %d",m_framelen);
-      }
-    if ((m_framepos == 5)&&(m_framemorelen))
-      {
-      // Second byte of length field
-      m_framelen += (b<<7);
-      m_framemorelen = false;
-      // ESP_LOGI(TAG, "Frame length (second byte) = %d",m_framelen);
+      if ((!m_framemorelen) && (m_framepos >= 4) && (m_framelen > m_framesize))
+        {
+        // Overflow frame
+        ESP_LOGW(TAG, "Frame overflow (%d > %d bytes)",m_framelen,m_framesize);
+        MyCommandApp.HexDump(TAG, "Frame head", (const char*)m_frame, m_framepos);
+        FrameError();
+        }
+      continue;
       }
+
+    // Payload, FCS & EOF: copy as a block
+    size_t n = m_framelen - m_framepos;
+    if (n > len - pos) n = len - pos;
+    memcpy(m_frame+m_framepos, data+pos, n);
+    m_framepos += n;
+    pos += n;
+
     if (m_framepos == m_framelen)
       {
-      if (b == GSM0_SOF)
+      if (m_frame[m_framelen-1] == GSM0_SOF)
         {
         // We have a complete frame...
         ProcessFrame();
@@ -334,13 +368,21 @@ void GsmMux::Process(OvmsBuffer* buf)
           channel, m_frame[1], m_frame[2], m_frame[m_framelen-2], m_framelen);
         MyCommandApp.HexDump(TAG, "Frame dump", (const char*)m_frame, m_framelen);
         // find next frame:
-        m_framepos = 0;
-        m_framelen = 0;
-        m_framemorelen = false;
-        m_framingerrors++;
+        FrameError();
         }
       }
     }
+
+  return len;
+  }
+
+void GsmMux::FrameError()
+  {
+  m_framepos = 0;
+  m_frameipos = 0;
+  m_framelen = 0;
+  m_framemorelen = false;
+  m_framingerrors++;
   }
 
 void GsmMux::ProcessFrame()
@@ -354,15 +396,11 @@ void GsmMux::ProcessFrame()
   if (fcs != m_frame[m_framelen-2])
     {
     ESP_LOGW(TAG, "FCS mismatch (%02x != %02x)",fcs,m_frame[m_framelen-2]);
-    m_framepos = 0;
-    m_frameipos = 0;
-    m_framelen = 0;
-    m_framingerrors++;
-    m_framemorelen = false;
+    FrameError();
     return;
     }
 
-  GsmMuxChannel* chan = m_channels[channel];
+  GsmMuxChannel* chan = ((size_t)channel < m_channels.size()) ? m_channels[channel] : NULL;
   if (chan)
     {
     m_lastgoodrxframe = monotonictime;
@@ -411,10 +449,7 @@ size_t GsmMux::tx(int channel, uint8_t* data, ssize_t size)
     buf[4] = (uint8_t)len; // Length: upper 7 bits
     ipos = 5;
     }
-  for (size_t k=0; k<size; k++)
-    {
-    buf[ipos+k] = data[k];
-    }
+  memcpy(buf+ipos, data, size);
   buf[ipos+size] = 0; // For FCS
   buf[ipos+size+1] = GSM0_SOF;
   txfcs(buf,ipos+size+2,ipos);
@@ -430,3 +465,107 @@ size_t GsmMux::tx(int channel, const char* data, ssize_t size)
   else
     return tx(channel, (uint8_t*)data,strlen(data));
   }
+
+/**
+ * gsmmux_benchmark: measure the receive path throughput (OvmsBuffer bulk
+ *  transfers & line scanning, mux frame parsing) using synthetic UIH frames
+ *  on a detached mux. The modem and its channels are not touched.
+ */
+void gsmmux_benchmark(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  int kbytes = (argc > 0) ? atoi(argv[0]) : 256;
+  int payload = (argc > 1) ? atoi(argv[1]) : 1500;
+  if (kbytes < 1) kbytes = 1;
+  if (payload < 1 || payload > 2000) payload = 1500;
+  size_t total = kbytes * 1024;
+
+  // Build a UIH frame of <payload> bytes on DLCI 1, text with line breaks:
+  size_t ipos = (payload < 128) ? 4 : 5;
+  size_t flen = ipos + payload + 2;
+  uint8_t* frame = new uint8_t[flen];
+  frame[0] = GSM0_SOF;
+  frame[1] = (1<<2)+GSM_EA;
+  frame[2] = GSM_UIH+GSM_PF;
+  if (ipos == 4)
+    {
+    frame[3] = (payload<<1) + GSM_EA;
+    }
+  else
+    {
+    frame[3] = (payload%128)<<1;
+    frame[4] = payload/128;
+    }
+  for (int k=0; k<payload; k++)
+    frame[ipos+k] = ((k % 64) == 63) ? '\n' : 'a' + (k % 26);
+  frame[flen-2] = 0xFF - gsm_fcs_add_block(FCS_INIT, frame+1, ipos-1);
+  frame[flen-1] = GSM0_SOF;
+
+  // Data is fed in UART driver sized pieces, same as the modem task reads:
+  OvmsBuffer rx(CONFIG_OVMS_HW_CELLULAR_MODEM_BUFFER_SIZE);
+  const size_t piece = 200;
+  uint8_t chunk[piece];
+  size_t done, n;
+  int64_t start;
+
+  // OvmsBuffer: push / pop throughput
+  start = esp_timer_get_time();
+  for (done = 0; done < total; )
+    {
+    for (size_t k = 0; k < flen; k += n, done += n)
+      {
+      n = std::min(piece, flen-k);
+      rx.Push(frame+k, n);
+      rx.Pop(n, chunk);
+      }
+    }
+  int64_t time_buffer = esp_timer_get_time() - start;
+
+  // OvmsBuffer: line scanning (data arriving in 64 byte UART chunks)
+  int lines = 0;
+  start = esp_timer_get_time();
+  for (done = 0; done < total; )
+    {
+    for (size_t k = ipos; k < flen-2; k += n, done += n)
+      {
+      n = std::min((size_t)64, flen-2-k);
+      if (!rx.Push(frame+k, n)) rx.EmptyAll();
+      while (rx.HasLine() >= 0)
+        {
+        rx.ReadLine();
+        lines++;
+        }
+      }
+    }
+  rx.EmptyAll();
+  int64_t time_lines = esp_timer_get_time() - start;
+
+  // Mux: frame parsing into a channel buffer
+  GsmMux mux(NULL, 1);
+  mux.m_channels.push_back(new GsmMuxChannel(&mux, 0, 8));
+  mux.m_channels.push_back(new GsmMuxChannel(&mux, 1, CONFIG_OVMS_HW_CELLULAR_MODEM_MUXCHANNEL_SIZE));
+  mux.m_channels[1]->m_state = GsmMuxChannel::ChanOpen;
+  int frames = 0;
+  start = esp_timer_get_time();
+  for (done = 0; done < total; frames++)
+    {
+    for (size_t k = 0; k < flen; k += n, done += n)
+      {
+      n = std::min(piece, flen-k);
+      rx.Push(frame+k, n);
+      mux.Process(&rx);
+      }
+    if ((frames & 63) == 63) vTaskDelay(1);
+    }
+  int64_t time_mux = esp_timer_get_time() - start;
+
+  writer->printf("%u bytes, %d byte frames\n", (unsigned)total, payload);
+  writer->printf("Buffer push/pop: %lld us = %.2f MB/s\n",
+    time_buffer, (float)total / (time_buffer ? time_buffer : 1));
+  writer->printf("Buffer lines   : %lld us = %.2f MB/s, %d lines\n",
+    time_lines, (float)total / (time_lines ? time_lines : 1), lines);
+  writer->printf("Mux parse      : %lld us = %.2f MB/s, %" PRIu32 "/%d frames ok, %" PRIu32 " errors\n",
+    time_mux, (float)total / (time_mux ? time_mux : 1),
+    mux.m_rxframecount, frames, mux.m_framingerrors);
+
+  delete [] frame;
+  }
@@ -35,6 +35,7 @@
 #include <unistd.h>
 #include "ovms.h"
 #include "ovms_buffer.h"
+#include "ovms_command.h"
 
 class modem; // Forward declared
 class GsmMux; // Forward declared
@@ -76,6 +77,7 @@ class GsmMux : public InternalRamAllocated
     void StartChannel(int channel);
     void StopChannel(int channel);
     void Process(OvmsBuffer* buf);
+    size_t Process(const uint8_t* data, size_t len);
     void ProcessFrame();
     size_t tx(int channel, uint8_t* data, ssize_t size);
     size_t tx(int channel, const char* data, ssize_t size = -1);
@@ -85,6 +87,7 @@ class GsmMux : public InternalRamAllocated
 
   protected:
     void txfcs(uint8_t* data, size_t size, size_t ipos = 4);
+    void FrameError();
 
   public:
     enum GsmMuxState
@@ -115,4 +118,6 @@ class GsmMux : public InternalRamAllocated
     std::vector<GsmMuxChannel*> m_channels;
   };
 
+extern void gsmmux_benchmark(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv);
+
 #endif //#ifndef __GSM_MUX__
@@ -39,6 +39,7 @@ static const char *TAG = "cellular";
 #include "metrics_standard.h"
 #include "ovms_config.h"
 #include "ovms_events.h"
+#include "ovms_status.h"
 #include "ovms_notify.h"
 #include "ovms_boot.h"
 #include "ovms_config.h"
@@ -105,6 +106,7 @@ static void MODEM_task(void *pvParameters)
 
 void modem::Task()
   {
+  OvmsHeapTag heaptag(HEAPTAG_CELLULAR);
   modem_or_uart_event_t event;
   uint8_t data[128];
 
@@ -1548,11 +1550,13 @@ void modem::IncomingMuxData(GsmMuxChannel* channel)
     {
     if (m_state1 == NetMode)
       {
-      uint8_t buf[32];
+      // Feed PPP directly from the channel buffer:
+      uint8_t* data;
       size_t n;
-      while ((m_ppp != NULL)&&(n = channel->m_buffer.Pop(sizeof(buf),buf)) > 0)
+      while ((m_ppp != NULL)&&(n = channel->m_buffer.PeekSpan(&data)) > 0)
         {
-        m_ppp->IncomingData(buf,n);
+        m_ppp->IncomingData(data,n);
+        channel->m_buffer.Consume(n);
         }
       }
     else
@@ -1893,6 +1897,7 @@ CellularModemInit::CellularModemInit()
   cmd_cellular->RegisterCommand("drivers","Show supported CELLULAR MODEM drivers",cellular_drivers, "", 0, 0);
   OvmsCommand* cmd_status = cmd_cellular->RegisterCommand("status","Show CELLULAR MODEM status",cellular_status, "[debug]", 0, 0, false);
   cmd_status->RegisterCommand("debug","Show extended CELLULAR MODEM status",cellular_status, "", 0, 0, false);
+  MyStatus.RegisterCommand("cellular", TAG, 5000, cmd_status, "system.modem.|network.modem.");
 
   OvmsCommand* cmd_setstate = cmd_cellular->RegisterCommand("setstate","CELLULAR MODEM state change framework");
   for (int x = modem::CheckPowerOff; x<=modem::PowerOffOn; x++)
@@ -1905,6 +1910,10 @@ CellularModemInit::CellularModemInit()
   cmd_gps->RegisterCommand("start", "Start GPS/GNSS", modem_gps_start);
   cmd_gps->RegisterCommand("stop", "Stop GPS/GNSS", modem_gps_stop);
 
+  OvmsCommand* cmd_test = MyCommandApp.RegisterCommand("test","Test framework");
+  cmd_test->RegisterCommand("gsmmux","Benchmark modem buffer & GSM mux receive path",gsmmux_benchmark,
+    "[<kbytes>=256] [<payload>=1500]", 0, 2);
+
   MyConfig.RegisterParam("modem", "Modem Configuration", true, true);
   // Our instances:
   //   'driver': Driver to use (default: auto)
@@ -33,6 +33,7 @@ static const char *TAG = "http";
 
 #include "ovms_http.h"
 #include "ovms_config.h"
+#include "ovms_utils.h"
 #include "metrics_standard.h"
 
 OvmsHttpClient::OvmsHttpClient()
@@ -61,6 +62,7 @@ bool OvmsHttpClient::Request(std::string url, const char* method)
   {
   m_bodysize = 0;
   m_responsecode = 0;
+  m_respheaders.clear();
 
   // First, split URL into server and path components
   if (url.compare(0, 7, "http://", 7) == 0)
@@ -111,7 +113,9 @@ bool OvmsHttpClient::Request(std::string url, const char* method)
   req.append(server);
   req.append("\r\nUser-Agent: ");
   req.append(get_user_agent());
-  req.append("\r\n\r\n");
+  req.append("\r\n");
+  req.append(m_reqheaders);
+  req.append("\r\n");
   if (Write(req.c_str(), req.length()) < 0)
     {
     ESP_LOGE(TAG, "Unable to write to server connection");
@@ -148,6 +152,16 @@ bool OvmsHttpClient::Request(std::string url, const char* method)
             m_responsecode = atoi(header.substr(space+1).c_str());
             }
           }
+        else
+          {
+          size_t colon = header.find(':');
+          if (colon != std::string::npos)
+            {
+            size_t start = header.find_first_not_of(" \t", colon+1);
+            m_respheaders[str_tolower(header.substr(0,colon))] =
+              (start == std::string::npos) ? std::string() : header.substr(start);
+            }
+          }
         k = m_buf->HasLine();
         }
       }
@@ -181,9 +195,9 @@ size_t OvmsHttpClient::BodyRead(void *buf, size_t nbyte)
   // char *x = (char*)buf;
   if ((m_buf == NULL)||(m_buf->UsedSpace() == 0))
     {
-    size_t n = Read(buf,nbyte);
+    ssize_t n = (ssize_t)Read(buf,nbyte);
     // ESP_EARLY_LOGI(TAG, "BodyRead got %d bytes direct (%02x %02x %02x %02x)",n,x[0],x[1],x[2],x[3]);
-    return n;
+    return (n < 0) ? 0 : n;   // read error (i.e. timeout) = end of body
     }
   else
     {
@@ -277,4 +291,24 @@ void OvmsHttpClient::Reset()
     }
   m_bodysize = 0;
   m_responsecode = 0;
+  m_respheaders.clear();
+  }
+
+void OvmsHttpClient::AddRequestHeader(const std::string& name, const std::string& value)
+  {
+  m_reqheaders.append(name);
+  m_reqheaders.append(": ");
+  m_reqheaders.append(value);
+  m_reqheaders.append("\r\n");
+  }
+
+void OvmsHttpClient::ClearRequestHeaders()
+  {
+  m_reqheaders.clear();
+  }
+
+std::string OvmsHttpClient::GetResponseHeader(const std::string& name)
+  {
+  auto it = m_respheaders.find(str_tolower(name));
+  return (it == m_respheaders.end()) ? std::string() : it->second;
   }
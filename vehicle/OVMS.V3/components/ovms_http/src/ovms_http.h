@@ -32,6 +32,7 @@
 #define __OVMS_HTTP_H__
 
 #include <string>
+#include <map>
 #include "ovms_net.h"
 #include "ovms_buffer.h"
 
@@ -55,10 +56,17 @@ class OvmsHttpClient : public OvmsNetTcpConnection
     std::string GetBodyAsString();
     void Reset();
 
+  public:
+    void AddRequestHeader(const std::string& name, const std::string& value);
+    void ClearRequestHeaders();
+    std::string GetResponseHeader(const std::string& name);
+
   protected:
     OvmsBuffer* m_buf;
     size_t m_bodysize;
     int m_responsecode;
+    std::string m_reqheaders;                         // Additional headers for the next Request()
+    std::map<std::string, std::string> m_respheaders; // Response headers, lower case names
   };
 
 #endif //#ifndef __OVMS_HTTP_H__
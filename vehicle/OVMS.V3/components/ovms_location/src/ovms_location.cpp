@@ -37,9 +37,13 @@ static const char *TAG = "location";
 #include "ovms_script.h"
 #include "ovms_notify.h"
 #include "ovms_command.h"
+#include "ovms_status.h"
 #include "vehicle.h"
 #include "metrics_standard.h"
+#include "esp_system.h"
+#include <esp_timer.h>
 #include <math.h>
+#include <algorithm>
 
 const char *LOCATIONS_PARAM = "locations";
 #define LOCATION_DEFRADIUS 100
@@ -47,6 +51,9 @@ const char *LOCATIONS_PARAM = "locations";
 #define LOCATION_R 6371
 #define LOCATION_TO_RAD (3.1415926536 / 180)
 
+#define LOCATION_GRID_ROWS  ((int)(180 / LOCATION_GRID_SIZE + 0.5))
+#define LOCATION_GRID_COLS  ((int)(360 / LOCATION_GRID_SIZE + 0.5))
+
 // Calculate haversine distance in meters
 double OvmsLocationDistance(double th1, double ph1, double th2, double ph2)
   {
@@ -132,22 +139,58 @@ ActionList::iterator ActionList::erase(iterator pos)
 OvmsLocation::OvmsLocation(const std::string& name)
   {
   m_name = name;
+  m_latitude = 0;
+  m_longitude = 0;
+  m_radius = LOCATION_DEFRADIUS;
   m_inlocation = false;
+  m_checkseq = 0;
+  UpdateBounds();
   }
 
 OvmsLocation::~OvmsLocation()
   {
   }
 
-bool OvmsLocation::IsInLocation(float latitude, float longitude)
+/**
+ * UpdateBounds: derive the bounding box from the center & radius
+ *  The box has a 1% + 1m margin to cover float rounding and the spherical
+ *  vs. equirectangular approximation. Boxes touching a pole or crossing the
+ *  antimeridian span the full longitude range.
+ */
+void OvmsLocation::UpdateBounds()
   {
-  // This should check if we are in the location
-  double dist = OvmsLocationDistance((double)latitude,(double)longitude,(double)m_latitude,(double)m_longitude);
-  std::string event;
+  double dlat = (m_radius * 1.01 + 1) / (LOCATION_R * 1000.0 * LOCATION_TO_RAD);
+  m_lat_min = m_latitude - dlat;
+  m_lat_max = m_latitude + dlat;
+  double coslat = cos(std::max(fabs(m_lat_min), fabs(m_lat_max)) * LOCATION_TO_RAD);
+  double dlon = (m_lat_min > -90 && m_lat_max < 90 && coslat > 0.01) ? dlat / coslat : 360;
+  if (m_longitude - dlon < -180 || m_longitude + dlon > 180)
+    {
+    m_lon_min = -180;
+    m_lon_max = 180;
+    }
+  else
+    {
+    m_lon_min = m_longitude - dlon;
+    m_lon_max = m_longitude + dlon;
+    }
+  }
 
+bool OvmsLocation::Contains(float latitude, float longitude)
+  {
+  if (!InBounds(latitude, longitude))
+    return false;
+  double dist = OvmsLocationDistance((double)latitude,(double)longitude,(double)m_latitude,(double)m_longitude);
   // ESP_LOGI(TAG, "Location %s is %0.1fm distant",m_name.c_str(),dist);
+  return (fabs(dist) <= m_radius);
+  }
 
-  if (fabs(dist) <= m_radius)
+bool OvmsLocation::IsInLocation(float latitude, float longitude)
+  {
+  std::string event;
+
+  // This should check if we are in the location
+  if (Contains(latitude, longitude))
     {
     // We are in the location
     if (!m_inlocation)
@@ -196,6 +239,7 @@ bool OvmsLocation::Parse(const std::string& value)
   int num = sscanf(p, "%f , %f %n%1c", &m_latitude, &m_longitude, &len, &next);
   if (num < 2)
     return false;
+  UpdateBounds();
   if (num < 3)
     return true;
   p += len;
@@ -204,6 +248,7 @@ bool OvmsLocation::Parse(const std::string& value)
     num = sscanf(p, ", %u %n%1c", &m_radius, &len, &next);
     if (num < 1)
       return false;
+    UpdateBounds();
     if (num < 2)
       return true;
     p += len;
@@ -341,6 +386,55 @@ void OvmsLocation::Render(std::string& buf)
     }
   }
 
+void OvmsLocationIndex::Clear()
+  {
+  m_cells.clear();
+  m_wide.clear();
+  m_size = 0;
+  }
+
+int OvmsLocationIndex::LatCell(float latitude)
+  {
+  int cell = floor((latitude + 90) / LOCATION_GRID_SIZE);
+  return std::min(std::max(cell, 0), LOCATION_GRID_ROWS-1);
+  }
+
+int OvmsLocationIndex::LonCell(float longitude)
+  {
+  int cell = floor((longitude + 180) / LOCATION_GRID_SIZE);
+  return std::min(std::max(cell, 0), LOCATION_GRID_COLS-1);
+  }
+
+uint32_t OvmsLocationIndex::CellKey(int lat_cell, int lon_cell)
+  {
+  return (uint32_t)lat_cell * LOCATION_GRID_COLS + lon_cell;
+  }
+
+void OvmsLocationIndex::Add(OvmsLocation* loc)
+  {
+  int lat0 = LatCell(loc->m_lat_min), lat1 = LatCell(loc->m_lat_max);
+  int lon0 = LonCell(loc->m_lon_min), lon1 = LonCell(loc->m_lon_max);
+  m_size++;
+  if ((lat1-lat0+1) * (lon1-lon0+1) > LOCATION_GRID_MAXCELLS)
+    {
+    m_wide.push_back(loc);
+    return;
+    }
+  for (int lat = lat0; lat <= lat1; lat++)
+    {
+    for (int lon = lon0; lon <= lon1; lon++)
+      m_cells[CellKey(lat, lon)].push_back(loc);
+    }
+  }
+
+const LocationList* OvmsLocationIndex::Lookup(float latitude, float longitude) const
+  {
+  auto it = m_cells.find(CellKey(LatCell(latitude), LonCell(longitude)));
+  if (it == m_cells.end())
+    return NULL;
+  return &it->second;
+  }
+
 void location_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   OvmsConfigParam* p = MyConfig.CachedParam(LOCATIONS_PARAM);
@@ -513,6 +607,13 @@ void location_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int ar
   n = MyLocations.m_locations.size();
   writer->printf("There %s %d location%s defined\n",
     n == 1 ? "is" : "are", n, n == 1 ? "" : "s");
+  if (verbosity > COMMAND_RESULT_MINIMAL && MyLocations.m_stat_updates)
+    {
+    writer->printf("Index: %d grid cells, %d wide locations, per update: %.1f candidates, %.1f distance checks\n",
+      (int)MyLocations.m_index.m_cells.size(), (int)MyLocations.m_index.m_wide.size(),
+      (float)MyLocations.m_stat_candidates / MyLocations.m_stat_updates,
+      (float)MyLocations.m_stat_exact / MyLocations.m_stat_updates);
+    }
 
   bool found = false;
   for (LocationMap::iterator it=MyLocations.m_locations.begin(); it!=MyLocations.m_locations.end(); ++it)
@@ -666,6 +767,90 @@ void location_all(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc,
   location_action(verbosity, writer, act, params);
   }
 
+/**
+ * location_benchmark: compare a full haversine scan against the grid index
+ *  using random locations & GPS fixes in a 100 x 100 km area around the
+ *  current position. The configured locations are not touched.
+ */
+void location_benchmark(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  int count = (argc > 0) ? atoi(argv[0]) : 1000;
+  int fixes = (argc > 1) ? atoi(argv[1]) : 100;
+  if (count < 1) count = 1;
+  if (fixes < 1) fixes = 1;
+
+  float clat = MyLocations.m_latitude, clon = MyLocations.m_longitude;
+  if (clat == 0 && clon == 0)
+    {
+    clat = 50.0;
+    clon = 8.0;
+    }
+  float dlat = 50000 / (LOCATION_R * 1000.0 * LOCATION_TO_RAD);
+  float dlon = dlat / cos(clat * LOCATION_TO_RAD);
+  auto rnd = []() -> float { return (float)esp_random() / UINT32_MAX * 2 - 1; };
+
+  std::vector<OvmsLocation*> locs;
+  OvmsLocationIndex index;
+  locs.reserve(count);
+  for (int i = 0; i < count; i++)
+    {
+    OvmsLocation* loc = new OvmsLocation(string_format("bench%d", i));
+    loc->m_latitude = clat + rnd() * dlat;
+    loc->m_longitude = clon + rnd() * dlon;
+    loc->m_radius = 50 + esp_random() % 450;
+    loc->UpdateBounds();
+    locs.push_back(loc);
+    }
+  int64_t time_start_us = esp_timer_get_time();
+  for (OvmsLocation* loc : locs)
+    index.Add(loc);
+  int64_t time_build = esp_timer_get_time() - time_start_us;
+
+  int64_t time_scan = 0, time_index = 0;
+  int hits_scan = 0, hits_index = 0, candidates = 0;
+  for (int i = 0; i < fixes; i++)
+    {
+    float lat = clat + rnd() * dlat;
+    float lon = clon + rnd() * dlon;
+
+    time_start_us = esp_timer_get_time();
+    for (OvmsLocation* loc : locs)
+      {
+      if (fabs(OvmsLocationDistance(lat, lon, loc->m_latitude, loc->m_longitude)) <= loc->m_radius)
+        hits_scan++;
+      }
+    time_scan += esp_timer_get_time() - time_start_us;
+
+    time_start_us = esp_timer_get_time();
+    const LocationList* cell = index.Lookup(lat, lon);
+    if (cell)
+      {
+      candidates += cell->size();
+      for (OvmsLocation* loc : *cell)
+        hits_index += loc->Contains(lat, lon);
+      }
+    candidates += index.m_wide.size();
+    for (OvmsLocation* loc : index.m_wide)
+      hits_index += loc->Contains(lat, lon);
+    time_index += esp_timer_get_time() - time_start_us;
+
+    // Don't starve other tasks of equal priority:
+    if ((i & 15) == 15) vTaskDelay(1);
+    }
+
+  writer->printf("%d locations, %d fixes, index built in %lld us: %d cells, %d wide\n",
+    count, fixes, time_build, (int)index.m_cells.size(), (int)index.m_wide.size());
+  writer->printf("Full scan: %lld us = %.1f us/fix, %d hits\n",
+    time_scan, (float)time_scan / fixes, hits_scan);
+  writer->printf("Indexed  : %lld us = %.1f us/fix, %d hits, %.1f candidates/fix\n",
+    time_index, (float)time_index / fixes, hits_index, (float)candidates / fixes);
+  if (hits_scan != hits_index)
+    writer->puts("ERROR: hit count mismatch");
+
+  for (OvmsLocation* loc : locs)
+    delete loc;
+  }
+
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
 
 static duk_ret_t DukOvmsLocationStatus(duk_context *ctx)
@@ -705,6 +890,10 @@ OvmsLocations::OvmsLocations()
   m_valet_distance = 0;
   m_valet_invalid = true;
   m_valet_last_alarm = 0;
+  m_checkseq = 0;
+  m_stat_updates = 0;
+  m_stat_candidates = 0;
+  m_stat_exact = 0;
 
   // Register our commands
   OvmsCommand* cmd_location = MyCommandApp.RegisterCommand("location","LOCATION framework", location_status, "", 0, 0, false);
@@ -713,6 +902,7 @@ OvmsLocations::OvmsLocations()
   cmd_location->RegisterCommand("radius","Set the radius of a location (defaults to user 'height' units)",location_radius, "<name> <radius> [<unit>]", 2, 3, true, location_radius_validate);
   cmd_location->RegisterCommand("rm","Remove a defined location",location_rm, "<name>", 1, 1, true, location_validate);
   cmd_location->RegisterCommand("status","Show location status",location_status);
+  MyStatus.RegisterCommand("location", TAG, 5000, cmd_location, "gps.|location.");
   OvmsCommand* cmd_action = cmd_location->RegisterCommand("action","Set an action for a location");
   OvmsCommand* cmd_enter = cmd_action->RegisterCommand("enter","Set an action upon entering a location", NULL, "<location> $L", 1, 1, true, location_validate);
   OvmsCommand* cmd_leave = cmd_action->RegisterCommand("leave","Set an action upon leaving a location", NULL, "<location> $L", 1, 1, true, location_validate);
@@ -744,6 +934,10 @@ OvmsLocations::OvmsLocations()
   rm_leave_homelink->RegisterCommand("3","Remove Homelink 3 signal",location_homelink);
   cmd_rm_leave->RegisterCommand("notify","Remove text notification",location_notify,"[<text>]", 0, INT_MAX);
 
+  OvmsCommand* cmd_test = MyCommandApp.RegisterCommand("test","Test framework");
+  cmd_test->RegisterCommand("locations","Benchmark location index vs. full scan",location_benchmark,
+    "[<locations>=1000] [<fixes>=100]", 0, 2);
+
   // Register our parameters
   MyConfig.RegisterParam(LOCATIONS_PARAM, "Geo Locations", true, true);
 
@@ -863,6 +1057,8 @@ void OvmsLocations::ReloadMap()
   OvmsConfigParam* p = MyConfig.CachedParam(LOCATIONS_PARAM);
   if (p == NULL) return;
 
+  OvmsRecMutexLock lock(&m_index_lock);
+
   // Forward search, updating existing locations
   for (ConfigParamMap::iterator it=p->m_map.begin(); it!=p->m_map.end(); ++it)
     {
@@ -908,17 +1104,60 @@ void OvmsLocations::ReloadMap()
       }
     }
 
+  RebuildIndex();
+
   if (m_gpsgood) UpdateLocations();
   }
 
+void OvmsLocations::RebuildIndex()
+  {
+  OvmsRecMutexLock lock(&m_index_lock);
+  m_index.Clear();
+  m_active.clear();
+  for (LocationMap::iterator it=m_locations.begin(); it!=m_locations.end(); ++it)
+    {
+    m_index.Add(it->second);
+    if (it->second->m_inlocation)
+      m_active.push_back(it->second);
+    }
+  ESP_LOGD(TAG, "RebuildIndex: %d locations, %d grid cells, %d wide",
+    m_index.m_size, (int)m_index.m_cells.size(), (int)m_index.m_wide.size());
+  }
+
+void OvmsLocations::CheckLocation(OvmsLocation* loc, uint32_t seq, LocationList& active)
+  {
+  if (loc->m_checkseq == seq) return;
+  loc->m_checkseq = seq;
+  m_stat_candidates++;
+  if (!loc->m_inlocation && !loc->InBounds(m_latitude, m_longitude)) return;
+  m_stat_exact++;
+  if (loc->IsInLocation(m_latitude, m_longitude))
+    active.push_back(loc);
+  }
+
 void OvmsLocations::UpdateLocations()
   {
   if ((m_latitude == 0) && (m_longitude == 0)) return;
 
-  for (LocationMap::iterator it=m_locations.begin(); it!=m_locations.end(); ++it)
+  OvmsRecMutexLock lock(&m_index_lock);
+  uint32_t seq = ++m_checkseq;
+  LocationList active;
+  m_stat_updates++;
+
+  // Check the active locations first, so leave events precede enter events,
+  // then the candidates from the grid cell and the wide locations:
+  for (OvmsLocation* loc : m_active)
+    CheckLocation(loc, seq, active);
+  const LocationList* cell = m_index.Lookup(m_latitude, m_longitude);
+  if (cell)
     {
-    it->second->IsInLocation(m_latitude,m_longitude);
+    for (OvmsLocation* loc : *cell)
+      CheckLocation(loc, seq, active);
     }
+  for (OvmsLocation* loc : m_index.m_wide)
+    CheckLocation(loc, seq, active);
+
+  m_active.swap(active);
   }
 
 void OvmsLocations::CheckTheft()
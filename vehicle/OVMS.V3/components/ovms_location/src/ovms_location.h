@@ -31,9 +31,17 @@
 #ifndef __LOCATION_H__
 #define __LOCATION_H__
 
+#include <map>
+#include <vector>
 #include "ovms_metrics.h"
 #include "ovms_utils.h"
 #include "ovms_command.h"
+#include "ovms_mutex.h"
+
+// Spatial index grid cell size in degrees (~5.5 km latitude):
+#define LOCATION_GRID_SIZE      0.05
+// Locations covering more cells than this are kept in the wide list:
+#define LOCATION_GRID_MAXCELLS  16
 
 enum LocationAction {
   INVALID = 0,
@@ -71,6 +79,13 @@ class OvmsLocation
 
   public:
     bool IsInLocation(float latitude, float longitude);
+    bool InBounds(float latitude, float longitude)
+      {
+      return latitude >= m_lat_min && latitude <= m_lat_max
+          && longitude >= m_lon_min && longitude <= m_lon_max;
+      }
+    bool Contains(float latitude, float longitude);
+    void UpdateBounds();
     bool Parse(const std::string& value);
     void Store(std::string& buf);
     void Render(std::string& buf);
@@ -83,9 +98,37 @@ class OvmsLocation
     int m_radius;
     bool m_inlocation;
     ActionList m_actions;
+
+  public:
+    float m_lat_min, m_lat_max;       // equirectangular bounding box
+    float m_lon_min, m_lon_max;
+    uint32_t m_checkseq;              // last UpdateLocations() run checked in
   };
 
 typedef NameMap<OvmsLocation*> LocationMap;
+typedef std::vector<OvmsLocation*> LocationList;
+
+/**
+ * OvmsLocationIndex: uniform lat/lon grid over the location bounding boxes.
+ *  A position lookup yields the locations registered in its grid cell plus
+ *  the "wide" locations (large radius, polar or crossing the antimeridian),
+ *  which then only need the bounding box & exact distance check.
+ */
+class OvmsLocationIndex
+  {
+  public:
+    void Clear();
+    void Add(OvmsLocation* loc);
+    const LocationList* Lookup(float latitude, float longitude) const;
+    static uint32_t CellKey(int lat_cell, int lon_cell);
+    static int LatCell(float latitude);
+    static int LonCell(float longitude);
+
+  public:
+    std::map<uint32_t, LocationList> m_cells;
+    LocationList m_wide;
+    int m_size = 0;
+  };
 
 class OvmsLocations
   {
@@ -118,9 +161,18 @@ class OvmsLocations
     OvmsRecMutex m_valet_lock;
 
     LocationMap m_locations;
+    OvmsLocationIndex m_index;
+    LocationList m_active;
+    OvmsRecMutex m_index_lock;
+    uint32_t m_checkseq;
+    uint32_t m_stat_updates;
+    uint32_t m_stat_candidates;
+    uint32_t m_stat_exact;
 
   public:
     void ReloadMap();
+    void RebuildIndex();
+    void CheckLocation(OvmsLocation* loc, uint32_t seq, LocationList& active);
     void UpdateLocations();
     void UpdateParkPosition();
     void CheckTheft();
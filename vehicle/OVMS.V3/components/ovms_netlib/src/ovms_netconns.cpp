@@ -40,6 +40,8 @@ static const char *TAG = "ovms-net";
 
 static void OvmsMongooseWrapperCallback(struct mg_connection *nc, int ev, void *ev_data)
   {
+  OvmsHeapTag heaptag(HEAPTAG_HTTP);
+  OvmsNetProfile prof(NETPROF_NETCLIENT);
   OvmsMongooseWrapper* me = (OvmsMongooseWrapper*)nc->user_data;
 
   if (me != NULL) me->Mongoose(nc, ev, ev_data);
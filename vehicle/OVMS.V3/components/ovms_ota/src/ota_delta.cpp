@@ -0,0 +1,242 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include <sdkconfig.h>
+#ifdef CONFIG_OVMS_SC_ZIP
+
+#include "ovms_log.h"
+static const char *TAG = "ota-delta";
+
+#include <string.h>
+#include "ovms_malloc.h"
+#include "ota_delta.h"
+
+static inline uint32_t get_le32(const uint8_t* p)
+  {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+OvmsDeltaPatch::OvmsDeltaPatch(OtaDeltaReadFn readold, OtaDeltaWriteFn writenew)
+  {
+  m_state = DS_Header;
+  m_readold = readold;
+  m_writenew = writenew;
+  memset(&m_header, 0, sizeof(m_header));
+  m_buflen = 0;
+  memset(&m_zs, 0, sizeof(m_zs));
+  m_zinit = false;
+  m_out = (uint8_t*) ExternalRamMalloc(OTA_DELTA_CHUNKSIZE);
+  m_old = (uint8_t*) ExternalRamMalloc(OTA_DELTA_CHUNKSIZE);
+  m_difflen = 0;
+  m_extralen = 0;
+  m_seek = 0;
+  m_oldpos = 0;
+  m_newpos = 0;
+  }
+
+OvmsDeltaPatch::~OvmsDeltaPatch()
+  {
+  if (m_zinit)
+    inflateEnd(&m_zs);
+  if (m_out) free(m_out);
+  if (m_old) free(m_old);
+  }
+
+bool OvmsDeltaPatch::Fail(const char* error)
+  {
+  if (m_state != DS_Error)
+    {
+    ESP_LOGE(TAG, "Patch failed at output offset %u: %s", (unsigned)m_newpos, error);
+    m_error = error;
+    m_state = DS_Error;
+    }
+  return false;
+  }
+
+bool OvmsDeltaPatch::ParseHeader()
+  {
+  if (memcmp(m_buf, OTA_DELTA_MAGIC, 8) != 0)
+    return Fail("not a delta patch");
+  m_header.oldsize = get_le32(m_buf + 8);
+  memcpy(m_header.oldsha, m_buf + 12, 32);
+  m_header.newsize = get_le32(m_buf + 44);
+  memcpy(m_header.newsha, m_buf + 48, 32);
+  if (!m_out || !m_old)
+    return Fail("out of memory");
+  if (inflateInit(&m_zs) != Z_OK)
+    return Fail("inflate init failed");
+  m_zinit = true;
+  m_buflen = 0;
+  m_state = DS_Control;
+  return true;
+  }
+
+/**
+ * Feed: process the next piece of the patch file
+ *  Returns false on errors (see GetError()), further calls will fail as well.
+ */
+bool OvmsDeltaPatch::Feed(const uint8_t* data, size_t len)
+  {
+  if (m_state == DS_Error)
+    return false;
+
+  if (m_state == DS_Header)
+    {
+    size_t n = OTA_DELTA_HEADERSIZE - m_buflen;
+    if (n > len) n = len;
+    memcpy(m_buf + m_buflen, data, n);
+    m_buflen += n;
+    data += n;
+    len -= n;
+    if (m_buflen < OTA_DELTA_HEADERSIZE)
+      return true;
+    if (!ParseHeader())
+      return false;
+    }
+
+  m_zs.next_in = (Bytef*) data;
+  m_zs.avail_in = len;
+  while (m_state != DS_End)
+    {
+    m_zs.next_out = m_out;
+    m_zs.avail_out = OTA_DELTA_CHUNKSIZE;
+    int zr = inflate(&m_zs, Z_NO_FLUSH);
+    if (zr != Z_OK && zr != Z_STREAM_END && zr != Z_BUF_ERROR)
+      return Fail("patch data corrupted");
+    size_t n = OTA_DELTA_CHUNKSIZE - m_zs.avail_out;
+    if (n > 0 && !Process(m_out, n))
+      return false;
+    if (zr == Z_STREAM_END)
+      {
+      if (m_state != DS_Control || m_buflen != 0)
+        return Fail("patch data truncated");
+      m_state = DS_End;
+      }
+    else if (m_zs.avail_in == 0 && n < OTA_DELTA_CHUNKSIZE)
+      break; // need more input
+    }
+  if (m_state == DS_End && m_zs.avail_in > 0)
+    return Fail("trailing data after patch end");
+
+  return (m_state != DS_Error);
+  }
+
+/**
+ * Process: apply inflated patch records
+ */
+bool OvmsDeltaPatch::Process(const uint8_t* data, size_t len)
+  {
+  while (len > 0)
+    {
+    switch (m_state)
+      {
+      case DS_Control:
+        {
+        size_t n = 12 - m_buflen;
+        if (n > len) n = len;
+        memcpy(m_buf + m_buflen, data, n);
+        m_buflen += n;
+        data += n;
+        len -= n;
+        if (m_buflen < 12)
+          break;
+        m_buflen = 0;
+        m_difflen = get_le32(m_buf);
+        m_extralen = get_le32(m_buf + 4);
+        m_seek = (int32_t) get_le32(m_buf + 8);
+        if (m_oldpos < 0 || m_oldpos + m_difflen > m_header.oldsize)
+          return Fail("diff exceeds base image");
+        if (m_newpos + m_difflen + m_extralen > m_header.newsize)
+          return Fail("output exceeds result image size");
+        m_state = DS_Diff;
+        }
+        // fall through
+      case DS_Diff:
+        while (m_difflen > 0 && len > 0)
+          {
+          size_t n = m_difflen;
+          if (n > len) n = len;
+          if (n > OTA_DELTA_CHUNKSIZE) n = OTA_DELTA_CHUNKSIZE;
+          if (!m_readold(m_oldpos, m_old, n))
+            return Fail("base image read failed");
+          for (size_t i = 0; i < n; i++)
+            m_old[i] += data[i];
+          if (!m_writenew(m_old, n))
+            return Fail("result image write failed");
+          m_oldpos += n;
+          m_newpos += n;
+          m_difflen -= n;
+          data += n;
+          len -= n;
+          }
+        if (m_difflen > 0)
+          break;
+        m_state = DS_Extra;
+        // fall through
+      case DS_Extra:
+        if (m_extralen > 0 && len > 0)
+          {
+          size_t n = m_extralen;
+          if (n > len) n = len;
+          if (!m_writenew(data, n))
+            return Fail("result image write failed");
+          m_newpos += n;
+          m_extralen -= n;
+          data += n;
+          len -= n;
+          }
+        if (m_extralen > 0)
+          break;
+        m_oldpos += m_seek;
+        m_state = DS_Control;
+        break;
+      default:
+        return Fail("unexpected patch data");
+      }
+    }
+  return true;
+  }
+
+/**
+ * Finish: check the patch has been applied completely
+ *  Note: the result digest needs to be checked by the caller.
+ */
+bool OvmsDeltaPatch::Finish()
+  {
+  if (m_state == DS_Error)
+    return false;
+  if (m_state != DS_End)
+    return Fail("patch incomplete");
+  if (m_newpos != m_header.newsize)
+    return Fail("result image size mismatch");
+  return true;
+  }
+
+#endif // CONFIG_OVMS_SC_ZIP
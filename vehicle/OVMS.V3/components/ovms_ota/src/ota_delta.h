@@ -0,0 +1,112 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __OTA_DELTA_H__
+#define __OTA_DELTA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <functional>
+#include "zlib.h"
+
+// Delta patch format (see support/ovmsdelta.py):
+#define OTA_DELTA_MAGIC         "OVMSDLT1"
+#define OTA_DELTA_HEADERSIZE    80
+#define OTA_DELTA_CHUNKSIZE     1024      // Inflate & old image read buffer size
+
+typedef struct
+  {
+  uint32_t oldsize;                       // Base image size
+  uint8_t oldsha[32];                     // Base image SHA-256
+  uint32_t newsize;                       // Result image size
+  uint8_t newsha[32];                     // Result image SHA-256
+  } ota_delta_header_t;
+
+// Old image reader: read len bytes at offset into buf, return false on error
+typedef std::function<bool(size_t offset, uint8_t* buf, size_t len)> OtaDeltaReadFn;
+// New image writer: consume len bytes, return false on error
+typedef std::function<bool(const uint8_t* buf, size_t len)> OtaDeltaWriteFn;
+
+/**
+ * OvmsDeltaPatch: streaming binary delta patch applier
+ *
+ *  Feed the patch file in arbitrary pieces as received. The result is produced
+ *  sequentially via the write callback, the base image is read on demand via
+ *  the read callback. RAM usage is bounded by the inflate window (~40 kB) plus
+ *  two chunk buffers, independent of the image size.
+ */
+class OvmsDeltaPatch
+  {
+  public:
+    OvmsDeltaPatch(OtaDeltaReadFn readold, OtaDeltaWriteFn writenew);
+    ~OvmsDeltaPatch();
+
+  public:
+    bool Feed(const uint8_t* data, size_t len);
+    bool Finish();
+    bool HaveHeader() { return m_state != DS_Header; }
+    const ota_delta_header_t& GetHeader() { return m_header; }
+    size_t GetWritten() { return m_newpos; }
+    const std::string& GetError() { return m_error; }
+
+  protected:
+    bool Fail(const char* error);
+    bool ParseHeader();
+    bool Process(const uint8_t* data, size_t len);
+
+  protected:
+    enum
+      {
+      DS_Header,
+      DS_Control,
+      DS_Diff,
+      DS_Extra,
+      DS_End,
+      DS_Error,
+      } m_state;
+    OtaDeltaReadFn m_readold;
+    OtaDeltaWriteFn m_writenew;
+    ota_delta_header_t m_header;
+    uint8_t m_buf[OTA_DELTA_HEADERSIZE]; // Header / control record collector
+    size_t m_buflen;
+    z_stream m_zs;
+    bool m_zinit;
+    uint8_t* m_out;                       // Inflate output buffer
+    uint8_t* m_old;                       // Old image read buffer
+    size_t m_difflen;                     // Remaining bytes of current record
+    size_t m_extralen;
+    int32_t m_seek;
+    int64_t m_oldpos;
+    size_t m_newpos;
+    std::string m_error;
+  };
+
+#endif //#ifndef __OTA_DELTA_H__
@@ -46,6 +46,7 @@ static const char *TAG = "ota";
 #endif
 #include "ovms_ota.h"
 #include "ovms_command.h"
+#include "ovms_status.h"
 #include "ovms_boot.h"
 #include "ovms_config.h"
 #include "ovms_metrics.h"
@@ -58,7 +59,15 @@ static const char *TAG = "ota";
 #include "ovms_netmanager.h"
 #include "ovms_version.h"
 #include "crypt_md5.h"
+#include "crypt_base64.h"
 #include "ovms_vfs.h"
+#include "ovms_utils.h"
+#include "freertos/queue.h"
+#include "mbedtls/sha256.h"
+#include <esp_timer.h>
+#ifdef CONFIG_OVMS_SC_ZIP
+#include "ota_delta.h"
+#endif
 
 OvmsOTA MyOTA __attribute__ ((init_priority (4400)));
 
@@ -90,6 +99,295 @@ int buildverscmp(std::string v1, std::string v2)
   return cmp;
   }
 
+////////////////////////////////////////////////////////////////////////////////
+// HTTP download pipeline
+//
+// The network reader (the calling task) fills large buffers while a writer
+// task hashes & flashes the previously filled buffer. Connection losses are
+// resumed by HTTP Range requests, the server image is validated to be the
+// same by ETag or Last-Modified. The SHA-256 digest of the image is verified
+// if the server provides one (Digest / X-Checksum-Sha256 header, or a
+// "<url>.sha256" file).
+
+#define OTA_PIPE_BUFSIZE        16384
+#define OTA_PIPE_BUFFERS        2
+#define OTA_PIPE_RXTIMEOUT      30        // Socket receive timeout [s]
+
+typedef struct
+  {
+  uint8_t* data;
+  size_t len;                             // 0 = end of stream
+  } ota_pipe_buf_t;
+
+class OvmsOTAPipeline
+  {
+  public:
+    OvmsOTAPipeline(esp_ota_handle_t otah, ota_download_stats& stats);
+    ~OvmsOTAPipeline();
+
+  public:
+    bool Start();
+    bool GetBuffer(ota_pipe_buf_t& buf);
+    void Submit(ota_pipe_buf_t& buf);
+    esp_err_t Finish(uint8_t* digest);
+
+  protected:
+    static void WriterTask(void *pvParameters);
+    void Writer();
+
+  public:
+    esp_err_t m_err;                      // Flash write result
+
+  protected:
+    esp_ota_handle_t m_otah;
+    ota_download_stats& m_stats;
+    uint8_t* m_mem;
+    QueueHandle_t m_full;
+    QueueHandle_t m_free;
+    TaskHandle_t m_task;
+    TaskHandle_t m_caller;
+    mbedtls_sha256_context m_sha;
+  };
+
+OvmsOTAPipeline::OvmsOTAPipeline(esp_ota_handle_t otah, ota_download_stats& stats)
+  : m_stats(stats)
+  {
+  m_err = ESP_OK;
+  m_otah = otah;
+  m_mem = NULL;
+  m_full = NULL;
+  m_free = NULL;
+  m_task = NULL;
+  m_caller = xTaskGetCurrentTaskHandle();
+  mbedtls_sha256_init(&m_sha);
+  }
+
+OvmsOTAPipeline::~OvmsOTAPipeline()
+  {
+  if (m_task)
+    Finish(NULL);
+  if (m_full) vQueueDelete(m_full);
+  if (m_free) vQueueDelete(m_free);
+  if (m_mem) free(m_mem);
+  mbedtls_sha256_free(&m_sha);
+  }
+
+bool OvmsOTAPipeline::Start()
+  {
+  m_mem = (uint8_t*) ExternalRamMalloc(OTA_PIPE_BUFSIZE * OTA_PIPE_BUFFERS);
+  m_full = xQueueCreate(OTA_PIPE_BUFFERS + 1, sizeof(ota_pipe_buf_t));
+  m_free = xQueueCreate(OTA_PIPE_BUFFERS, sizeof(ota_pipe_buf_t));
+  if (!m_mem || !m_full || !m_free)
+    return false;
+  for (int i = 0; i < OTA_PIPE_BUFFERS; i++)
+    {
+    ota_pipe_buf_t buf = { m_mem + i * OTA_PIPE_BUFSIZE, 0 };
+    xQueueSend(m_free, &buf, 0);
+    }
+#if ESP_IDF_VERSION_MAJOR >= 5
+  mbedtls_sha256_starts(&m_sha, 0);
+#else
+  mbedtls_sha256_starts_ret(&m_sha, 0);
+#endif
+  xTaskCreatePinnedToCore(WriterTask, "OVMS OTAWriter",
+    4096, (void*)this, uxTaskPriorityGet(NULL), &m_task, CORE(1));
+  return (m_task != NULL);
+  }
+
+// Get the next free buffer, waiting for the writer if necessary.
+// Returns false on flash write errors.
+bool OvmsOTAPipeline::GetBuffer(ota_pipe_buf_t& buf)
+  {
+  int64_t start = esp_timer_get_time();
+  xQueueReceive(m_free, &buf, portMAX_DELAY);
+  m_stats.flashwait_ms += (esp_timer_get_time() - start) / 1000;
+  buf.len = 0;
+  return (m_err == ESP_OK);
+  }
+
+void OvmsOTAPipeline::Submit(ota_pipe_buf_t& buf)
+  {
+  xQueueSend(m_full, &buf, portMAX_DELAY);
+  }
+
+// Terminate the writer, get the image digest (if digest != NULL)
+esp_err_t OvmsOTAPipeline::Finish(uint8_t* digest)
+  {
+  ota_pipe_buf_t end = { NULL, 0 };
+  xQueueSend(m_full, &end, portMAX_DELAY);
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  m_task = NULL;
+  if (digest)
+    {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    mbedtls_sha256_finish(&m_sha, digest);
+#else
+    mbedtls_sha256_finish_ret(&m_sha, digest);
+#endif
+    }
+  return m_err;
+  }
+
+void OvmsOTAPipeline::WriterTask(void *pvParameters)
+  {
+  OvmsOTAPipeline* me = (OvmsOTAPipeline*)pvParameters;
+  me->Writer();
+  vTaskDelete(NULL);
+  }
+
+void OvmsOTAPipeline::Writer()
+  {
+  ota_pipe_buf_t buf;
+  while (true)
+    {
+    int64_t start = esp_timer_get_time();
+    xQueueReceive(m_full, &buf, portMAX_DELAY);
+    m_stats.netwait_ms += (esp_timer_get_time() - start) / 1000;
+    if (buf.len == 0)
+      break;
+    if (m_err == ESP_OK)
+      {
+#if ESP_IDF_VERSION_MAJOR >= 5
+      mbedtls_sha256_update(&m_sha, buf.data, buf.len);
+#else
+      mbedtls_sha256_update_ret(&m_sha, buf.data, buf.len);
+#endif
+      m_err = esp_ota_write(m_otah, buf.data, buf.len);
+      if (m_err == ESP_OK)
+        m_stats.written += buf.len;
+      }
+    xQueueSend(m_free, &buf, portMAX_DELAY);
+    }
+  xTaskNotifyGive(m_caller);
+  }
+
+// Get the server provided image digest, returns false if none available
+static bool ota_get_digest(OvmsHttpClient& http, const std::string& url, uint8_t* digest)
+  {
+  std::string value, bin;
+
+  // RFC 3230 instance digest: "SHA-256=<base64>[,…]"
+  value = http.GetResponseHeader("Digest");
+  std::string::size_type p = str_tolower(value).find("sha-256=");
+  if (p != std::string::npos)
+    {
+    value = value.substr(p+8);
+    value = value.substr(0, value.find_first_of(", "));
+    bin = base64decode(value);
+    }
+
+  // Hex digest header or file:
+  if (bin.size() != 32)
+    {
+    value = http.GetResponseHeader("X-Checksum-Sha256");
+    if (value.empty())
+      {
+      OvmsHttpClient file(url + ".sha256");
+      if (file.IsOpen() && file.ResponseCode() == 200)
+        {
+        char rbuf[64];
+        size_t k;
+        while (value.size() < 64 && (k = file.BodyRead(rbuf, sizeof(rbuf))) > 0)
+          value.append(rbuf, k);
+        }
+      file.Disconnect();
+      }
+    if (value.size() >= 64 && value.find_first_not_of("0123456789abcdefABCDEF") >= 64)
+      bin = hexdecode(value.substr(0, 64));
+    }
+
+  if (bin.size() != 32)
+    return false;
+  memcpy(digest, bin.data(), 32);
+  return true;
+  }
+
+// Resume a download at offset:
+//  returns 1 = resumed, 0 = temporary failure (retry), -1 = image changed
+//  skip = number of bytes to discard (server does not support ranges)
+static int ota_resume(OvmsHttpClient& http, const std::string& url, size_t offset, size_t size,
+                      const char* validatorname, const std::string& validator, size_t& skip)
+  {
+  http.ClearRequestHeaders();
+  http.AddRequestHeader("Range", "bytes=" + std::to_string(offset) + "-");
+  if (!validator.empty())
+    http.AddRequestHeader("If-Range", validator);
+  if (!http.Request(url))
+    return 0;
+
+  struct timeval tv = { OTA_PIPE_RXTIMEOUT, 0 };
+  setsockopt(http.Socket(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  int code = http.ResponseCode();
+  if (code == 206)
+    {
+    unsigned long start = 0, total = 0;
+    std::string range = http.GetResponseHeader("Content-Range");
+    if (sscanf(range.c_str(), "bytes %lu-%*[0-9]/%lu", &start, &total) != 2
+        || start != offset || total != size)
+      {
+      ESP_LOGE(TAG, "Download: resume failed, invalid range '%s'", range.c_str());
+      http.Disconnect();
+      return -1;
+      }
+    skip = 0;
+    return 1;
+    }
+  else if (code == 200)
+    {
+    // Range ignored, or image changed (If-Range mismatch):
+    if (http.BodySize() != size
+        || (validatorname && http.GetResponseHeader(validatorname) != validator))
+      {
+      http.Disconnect();
+      return -1;
+      }
+    skip = offset;
+    return 1;
+    }
+  ESP_LOGW(TAG, "Download: resume request failed, response code %d", code);
+  http.Disconnect();
+  return 0;
+  }
+
+#ifdef CONFIG_OVMS_SC_ZIP
+// Calculate the SHA-256 digest of the first size bytes of a partition
+static bool ota_partition_sha256(const esp_partition_t* part, size_t size, uint8_t* digest)
+  {
+  if (size > part->size)
+    return false;
+  uint8_t* rbuf = (uint8_t*) ExternalRamMalloc(4096);
+  if (!rbuf)
+    return false;
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+#if ESP_IDF_VERSION_MAJOR >= 5
+  mbedtls_sha256_starts(&sha, 0);
+#else
+  mbedtls_sha256_starts_ret(&sha, 0);
+#endif
+  bool ok = true;
+  for (size_t pos = 0; ok && pos < size; pos += 4096)
+    {
+    size_t n = (size - pos < 4096) ? size - pos : 4096;
+    ok = (esp_partition_read(part, pos, rbuf, n) == ESP_OK);
+#if ESP_IDF_VERSION_MAJOR >= 5
+    if (ok) mbedtls_sha256_update(&sha, rbuf, n);
+#else
+    if (ok) mbedtls_sha256_update_ret(&sha, rbuf, n);
+#endif
+    }
+#if ESP_IDF_VERSION_MAJOR >= 5
+  mbedtls_sha256_finish(&sha, digest);
+#else
+  mbedtls_sha256_finish_ret(&sha, digest);
+#endif
+  mbedtls_sha256_free(&sha);
+  free(rbuf);
+  return ok;
+  }
+#endif // CONFIG_OVMS_SC_ZIP
+
 ////////////////////////////////////////////////////////////////////////////////
 // Commands
 
@@ -118,6 +416,19 @@ void ota_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, c
       len += writer->printf("Status:            %s\n", MyOTA.GetFlashStatus());
     }
 
+  const ota_download_stats& dl = MyOTA.m_dlstats;
+  if (dl.size > 0)
+    {
+    uint32_t elapsed = dl.running ? (esp_timer_get_time() - dl.started) / 1000 : dl.elapsed_ms;
+    len += writer->printf("Download:          %d of %d bytes%s, %.1f kB/s, %d resumed\n",
+      dl.received, dl.size, dl.running ? " (running)" : "",
+      elapsed ? (float)dl.received / elapsed : 0.0f, dl.resumes);
+    len += writer->printf("Stall time:        network %" PRIu32 " ms, flash %" PRIu32 " ms\n", dl.netwait_ms, dl.flashwait_ms);
+    if (dl.delta)
+      len += writer->printf("Delta patch:       %d image bytes written\n", dl.written);
+    len += writer->printf("SHA-256 digest:    %s\n", dl.digest);
+    }
+
   version = GetOVMSPartitionVersion(ESP_PARTITION_SUBTYPE_APP_FACTORY);
   if (version != "")
       len += writer->printf("Factory image:     %s\n", version.c_str());
@@ -313,92 +624,30 @@ void ota_flash_http(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int arg
     }
   writer->printf("Download firmware from %s to %s\n",url.c_str(),target->label);
 
-  // HTTP client request...
-  OvmsHttpClient http(url);
-  if (!http.IsOpen())
-    {
-    writer->puts("Error: Request failed");
-    return;
-    }
-
-  size_t expected = http.BodySize();
-  if (expected < 32)
-    {
-    writer->printf("Error: Expected download file size (%d) is invalid\n",expected);
-    return;
-    }
-
-  writer->printf("Expected file size is %d\n",expected);
-
-  MyOTA.SetFlashStatus("OTA Flash HTTP: Preparing flash partition...");
-  writer->puts(MyOTA.GetFlashStatus());
-  esp_ota_handle_t otah;
-  esp_err_t err = esp_ota_begin(target, expected, &otah);
-  if (err != ESP_OK)
+  std::string error;
+  bool done = false;
+#ifdef CONFIG_OVMS_SC_ZIP
+  if (MyConfig.GetParamValueBool("ota", "delta", true))
     {
-    MyOTA.ClearFlashStatus();
-    writer->printf("Error: ESP32 error #%d when starting OTA operation\n",err);
-    http.Disconnect();
-    return;
-    }
-
-  // Now, process the body
-  uint8_t rbuf[512];
-  size_t filesize = 0;
-  size_t sofar = 0;
-  MyOTA.SetFlashStatus("OTA Flash HTTP: Downloading OTA image...");
-  while (int k = http.BodyRead(rbuf,512))
-    {
-    filesize += k;
-    sofar += k;
-    MyOTA.SetFlashPerc((filesize*100)/expected);
-    if (sofar > 100000)
-      {
-      writer->printf("Downloading... (%d bytes so far)\n",filesize);
-      sofar = 0;
-      }
-    if (filesize > target->size)
-      {
-      MyOTA.ClearFlashStatus();
-      writer->printf("Error: Download firmware is bigger than available partition space - state is inconsistent\n");
-      esp_ota_end(otah);
-      http.Disconnect();
-      return;
-      }
-    err = esp_ota_write(otah, rbuf, k);
-    if (err != ESP_OK)
+    done = MyOTA.DeltaFlash(url, running, target, writer, false, error);
+    if (!done && !error.empty())
       {
-      MyOTA.ClearFlashStatus();
-      writer->printf("Error: ESP32 error #%d when writing to flash - state is inconsistent\n",err);
-      esp_ota_end(otah);
-      http.Disconnect();
-      return;
+      writer->printf("Delta update failed: %s\nFalling back to full image download\n", error.c_str());
+      error.clear();
       }
     }
-  http.Disconnect();
-  writer->printf("Download complete (at %d bytes)\n",filesize);
-
-  if (filesize != expected)
+#endif // CONFIG_OVMS_SC_ZIP
+  if (!done && !MyOTA.DownloadFlash(url, target, writer, false, error))
     {
     MyOTA.ClearFlashStatus();
-    writer->printf("Error: Download file size (%d) does not match expected (%d)\n",filesize,expected);
-    esp_ota_end(otah);
-    return;
-    }
-
-  MyOTA.SetFlashStatus("OTA Flash HTTP: Finalising flash write");
-  err = esp_ota_end(otah);
-  if (err != ESP_OK)
-    {
-    MyOTA.ClearFlashStatus();
-    writer->printf("Error: ESP32 error #%d finalising OTA operation - state is inconsistent\n",err);
+    writer->printf("Error: %s\n", error.c_str());
     return;
     }
 
   // All done
   MyOTA.SetFlashStatus("OTA Flash HTTP: Setting boot partition...");
   writer->puts(MyOTA.GetFlashStatus());
-  err = esp_ota_set_boot_partition(target);
+  esp_err_t err = esp_ota_set_boot_partition(target);
   MyOTA.ClearFlashStatus();
   if (err != ESP_OK)
     {
@@ -406,8 +655,8 @@ void ota_flash_http(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int arg
     return;
     }
 
-  writer->printf("OTA flash was successful\n  Flashed %d bytes from %s\n  Next boot will be from '%s'\n",
-                 http.BodySize(),url.c_str(),target->label);
+  writer->printf("OTA flash was successful\n  Flashed %d bytes from %s%s\n  Next boot will be from '%s'\n",
+                 MyOTA.m_dlstats.written,url.c_str(),MyOTA.m_dlstats.delta ? " (delta)" : "",target->label);
   MyConfig.SetParamValue("ota", "http.mru", url);
   }
 
@@ -763,6 +1012,7 @@ OvmsOTA::OvmsOTA()
   m_lastcheckday = -1;
   m_flashstatus = NULL;
   m_flashperc = 0;
+  memset(&m_dlstats, 0, sizeof(m_dlstats));
 
   MyConfig.RegisterParam("ota", "OTA setup and status", true, true);
 
@@ -778,7 +1028,8 @@ OvmsOTA::OvmsOTA()
   OvmsCommand* cmd_ota = MyCommandApp.RegisterCommand("ota","OTA framework", ota_status, "", 0, 0, false);
 
   OvmsCommand* cmd_otastatus = cmd_ota->RegisterCommand("status","Show OTA status",ota_status);
-  cmd_otastatus->RegisterCommand("nocheck","…skip check for available update",ota_status);
+  OvmsCommand* cmd_otastatus_nocheck = cmd_otastatus->RegisterCommand("nocheck","…skip check for available update",ota_status);
+  MyStatus.RegisterCommand("ota", TAG, 60000, cmd_otastatus_nocheck, "system.ota.");
 
   OvmsCommand* cmd_otaflash = cmd_ota->RegisterCommand("flash","OTA flash");
   cmd_otaflash->RegisterCommand("vfs","OTA flash vfs",ota_flash_vfs,"<file>",1,1, true, vfs_file_validate);
@@ -1058,93 +1309,475 @@ bool OvmsOTA::AutoFlash(bool force)
     url.c_str());
   MyNotify.NotifyStringf("info", "ota.update", "New OTA firmware %s is now being downloaded", info.version_server.c_str());
 
-  // HTTP client request...
+  std::string error;
+  bool done = false;
+#ifdef CONFIG_OVMS_SC_ZIP
+  if (MyConfig.GetParamValueBool("ota", "delta", true))
+    {
+    done = DeltaFlash(url, running, target, NULL, true, error);
+    if (!done && !error.empty())
+      {
+      ESP_LOGW(TAG, "AutoFlash: delta update failed (%s), falling back to full image", error.c_str());
+      error.clear();
+      }
+    }
+#endif // CONFIG_OVMS_SC_ZIP
+  if (!done && !DownloadFlash(url, target, NULL, true, error))
+    {
+    ClearFlashStatus();
+    ESP_LOGE(TAG, "AutoFlash: %s (%s)", error.c_str(), url.c_str());
+    m_lastcheckday = -1; // Allow to try again within the same day
+    return false;
+    }
+  ClearFlashStatus();
+
+  // All done
+  ESP_LOGI(TAG, "AutoFlash: Setting boot partition...");
+  esp_err_t err = esp_ota_set_boot_partition(target);
+  if (err != ESP_OK)
+    {
+    ESP_LOGE(TAG, "AutoFlash: ESP32 error #%d setting boot partition - check before rebooting", err);
+    return false;
+    }
+
+  ESP_LOGI(TAG, "AutoFlash: Success flash of %d bytes from %s%s", m_dlstats.written, url.c_str(),
+    m_dlstats.delta ? " (delta)" : "");
+  MyNotify.NotifyStringf("info", "ota.update", "OTA firmware %s has been updated (OVMS will restart)", info.version_server.c_str());
+  MyConfig.SetParamValue("ota", "http.mru", url);
+
+  return true;
+  }
+
+/**
+ * DownloadFlash: download firmware image via HTTP & write into target partition
+ *  The caller needs to hold the m_flashing lock. On success, the image has been
+ *  written & finalized, but the boot partition has not been changed.
+ *  writer: optional console for progress output (NULL = log only)
+ */
+bool OvmsOTA::DownloadFlash(const std::string& url, const esp_partition_t* target,
+                            OvmsWriter* writer, bool autoflash, std::string& error)
+  {
+  ota_download_stats& st = m_dlstats;
+  memset(&st, 0, sizeof(st));
+  st.digest = "unchecked";
+
   OvmsHttpClient http(url);
   if (!http.IsOpen())
     {
-    ESP_LOGE(TAG, "AutoFlash: http://%s request failed", url.c_str());
-    m_lastcheckday = -1; // Allow to try again within the same day
+    error = "Request failed";
+    return false;
+    }
+
+  if (http.ResponseCode() != 200)
+    {
+    error = "Request failed, server response code " + std::to_string(http.ResponseCode());
+    http.Disconnect();
     return false;
     }
 
   size_t expected = http.BodySize();
   if (expected < 32)
     {
-    ESP_LOGE(TAG, "AutoFlash: Expected download file size (%d) is invalid", expected);
-    m_lastcheckday = -1; // Allow to try again within the same day
+    error = "Expected download file size (" + std::to_string(expected) + ") is invalid";
+    http.Disconnect();
+    return false;
+    }
+  if (expected > target->size)
+    {
+    error = "Download firmware is bigger than available partition space";
+    http.Disconnect();
+    return false;
+    }
+  if (writer)
+    writer->printf("Expected file size is %d\n", expected);
+
+  // Remember the image identity for resumes (If-Range needs a strong validator):
+  const char* validatorname = "ETag";
+  std::string validator = http.GetResponseHeader(validatorname);
+  if (validator.empty() || startsWith(validator, "W/"))
+    {
+    validatorname = "Last-Modified";
+    validator = http.GetResponseHeader(validatorname);
+    if (validator.empty())
+      validatorname = NULL;
+    }
+
+  uint8_t digest_expected[32], digest[32];
+  bool have_digest = ota_get_digest(http, url, digest_expected);
+  if (!have_digest && MyConfig.GetParamValueBool("ota", "sha256.required", false))
+    {
+    error = "Server does not provide a SHA-256 digest (required by config)";
+    http.Disconnect();
     return false;
     }
+  st.digest = have_digest ? "pending" : "not provided";
 
-  SetFlashStatus("OTA Auto Flash: Preparing flash partition...",0,true);
+  struct timeval tv = { OTA_PIPE_RXTIMEOUT, 0 };
+  setsockopt(http.Socket(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  SetFlashStatus(autoflash
+    ? "OTA Auto Flash: Preparing flash partition..."
+    : "OTA Flash HTTP: Preparing flash partition...", 0, autoflash);
+  if (writer)
+    writer->puts(GetFlashStatus());
   esp_ota_handle_t otah;
   esp_err_t err = esp_ota_begin(target, expected, &otah);
   if (err != ESP_OK)
     {
-    ClearFlashStatus();
-    ESP_LOGE(TAG, "AutoFlash: ESP32 error #%d when starting OTA operation", err);
+    error = "ESP32 error #" + std::to_string(err) + " when starting OTA operation";
+    http.Disconnect();
+    return false;
+    }
+
+  OvmsOTAPipeline pipe(otah, st);
+  ota_pipe_buf_t buf;
+  if (!pipe.Start() || !pipe.GetBuffer(buf))
+    {
+    error = "Out of memory for download pipeline";
     http.Disconnect();
+    esp_ota_end(otah);
     return false;
     }
 
   // Now, process the body
-  SetFlashStatus("OTA Auto Flash: Downloading OTA image...");
-  uint8_t rbuf[512];
-  size_t filesize = 0;
-  while (int k = http.BodyRead(rbuf,512))
-    {
-    filesize += k;
-    SetFlashPerc((filesize*100)/expected);
-    if (filesize > target->size)
+  SetFlashStatus(autoflash
+    ? "OTA Auto Flash: Downloading OTA image..."
+    : "OTA Flash HTTP: Downloading OTA image...");
+  int retries = MyConfig.GetParamValueInt("ota", "http.retries", 5);
+  int failures = 0;
+  size_t skip = 0, sofar = 0;
+  st.size = expected;
+  st.started = esp_timer_get_time();
+  st.running = true;
+  while (st.received < expected)
+    {
+    if (!http.IsOpen())
       {
-      ClearFlashStatus();
-      ESP_LOGE(TAG, "AutoFlash: Download firmware is bigger than available partition space - state is inconsistent");
-      esp_ota_end(otah);
-      http.Disconnect();
-      return false;
+      if (++failures > retries)
+        {
+        error = "Connection lost at " + std::to_string(st.received) + " bytes, giving up";
+        break;
+        }
+      ESP_LOGW(TAG, "Download: connection lost at %d bytes, resuming in %d seconds (attempt %d/%d)",
+        st.received, failures*5, failures, retries);
+      if (writer)
+        writer->printf("Connection lost at %d bytes, resuming in %d seconds...\n", st.received, failures*5);
+      vTaskDelay(pdMS_TO_TICKS(failures*5000));
+      int res = ota_resume(http, url, st.received, expected, validatorname, validator, skip);
+      if (res < 0)
+        {
+        error = "Image changed on server, download aborted";
+        break;
+        }
+      if (res > 0)
+        st.resumes++;
+      continue;
       }
-    err = esp_ota_write(otah, rbuf, k);
-    if (err != ESP_OK)
+
+    uint8_t* dst = buf.data + buf.len;
+    size_t k = http.BodyRead(dst, OTA_PIPE_BUFSIZE - buf.len);
+    if (k == 0)
       {
-      ClearFlashStatus();
-      ESP_LOGE(TAG, "AutoFlash: ESP32 error #%d when writing to flash - state is inconsistent", err);
-      esp_ota_end(otah);
       http.Disconnect();
-      return false;
+      continue;
+      }
+    failures = 0;
+    if (skip > 0)
+      {
+      // Discard data already received (server does not support ranges):
+      size_t n = (k < skip) ? k : skip;
+      skip -= n;
+      k -= n;
+      memmove(dst, dst + n, k);
+      }
+    if (st.received + k > expected)
+      {
+      error = "Download exceeds the expected file size";
+      break;
+      }
+    buf.len += k;
+    st.received += k;
+    sofar += k;
+    SetFlashPerc((st.received*100)/expected);
+    if (writer && sofar > 100000)
+      {
+      writer->printf("Downloading... (%d bytes so far)\n", st.received);
+      sofar = 0;
+      }
+    if (buf.len == OTA_PIPE_BUFSIZE || st.received == expected)
+      {
+      pipe.Submit(buf);
+      if (st.received < expected && !pipe.GetBuffer(buf))
+        break;
       }
     }
   http.Disconnect();
-  ESP_LOGI(TAG, "AutoFlash:: Download complete (at %d bytes)", filesize);
 
-  if (filesize != expected)
+  err = pipe.Finish(digest);
+  st.running = false;
+  st.elapsed_ms = (esp_timer_get_time() - st.started) / 1000;
+  if (err != ESP_OK && error.empty())
+    error = "ESP32 error #" + std::to_string(err) + " when writing to flash - state is inconsistent";
+  if (!error.empty())
     {
-    ClearFlashStatus();
-    ESP_LOGE(TAG, "AutoFlash: Download file size (%d) does not match expected (%d)", filesize, expected);
     esp_ota_end(otah);
-    m_lastcheckday = -1; // Allow to try again within the same day
     return false;
     }
+  ESP_LOGI(TAG, "Download: complete (%d bytes in %" PRIu32 " ms, %d resumes, network wait %" PRIu32 " ms, flash wait %" PRIu32 " ms)",
+    st.received, st.elapsed_ms, st.resumes, st.netwait_ms, st.flashwait_ms);
+  if (writer)
+    writer->printf("Download complete (at %d bytes)\n", st.received);
+
+  if (have_digest)
+    {
+    if (memcmp(digest, digest_expected, sizeof(digest)) != 0)
+      {
+      st.digest = "MISMATCH";
+      error = "SHA-256 digest mismatch, image rejected";
+      esp_ota_end(otah);
+      return false;
+      }
+    st.digest = "verified";
+    if (writer)
+      writer->puts("SHA-256 digest verified");
+    }
 
-  SetFlashStatus("OTA Auto Flash: Finalising flash partition...");
+  SetFlashStatus(autoflash
+    ? "OTA Auto Flash: Finalising flash partition..."
+    : "OTA Flash HTTP: Finalising flash write");
   err = esp_ota_end(otah);
-  ClearFlashStatus();
   if (err != ESP_OK)
     {
-    ESP_LOGE(TAG, "AutoFlash: ESP32 error #%d finalising OTA operation - state is inconsistent", err);
+    error = "ESP32 error #" + std::to_string(err) + " finalising OTA operation - state is inconsistent";
     return false;
     }
+  return true;
+  }
 
-  // All done
-  ESP_LOGI(TAG, "AutoFlash: Setting boot partition...");
-  err = esp_ota_set_boot_partition(target);
+#ifdef CONFIG_OVMS_SC_ZIP
+/**
+ * DeltaFlash: build firmware image from a delta patch against the running image
+ *  Looks up a patch for the running image in the index "<url>.delta" (see
+ *  support/ovmsdelta.py), downloads & applies it into the target partition.
+ *  Returns false with an empty error if no matching patch is available, the
+ *  caller should fall back to DownloadFlash() on any failure.
+ *  The caller needs to hold the m_flashing lock.
+ */
+bool OvmsOTA::DeltaFlash(const std::string& url, const esp_partition_t* running, const esp_partition_t* target,
+                         OvmsWriter* writer, bool autoflash, std::string& error)
+  {
+  // Get patch index:
+  std::string index;
+    {
+    OvmsHttpClient http(url + ".delta");
+    if (!http.IsOpen() || http.ResponseCode() != 200)
+      {
+      http.Disconnect();
+      return false;
+      }
+    char rbuf[256];
+    size_t k;
+    while (index.size() < 4096 && (k = http.BodyRead(rbuf, sizeof(rbuf))) > 0)
+      index.append(rbuf, k);
+    http.Disconnect();
+    }
+
+  // Find patch for the running image:
+  //  <oldsize> <oldsha256> <newsize> <newsha256> <patchfile>
+  ota_delta_header_t hdr;
+  std::string patchname;
+  size_t hashsize = 0;
+  uint8_t runsha[32];
+  std::string::size_type pos = 0;
+  while (patchname.empty() && pos < index.size())
+    {
+    std::string::size_type eol = index.find('\n', pos);
+    if (eol == std::string::npos) eol = index.size();
+    std::string line = index.substr(pos, eol - pos);
+    pos = eol + 1;
+    unsigned long oldsize, newsize;
+    char oldsha[65], newsha[65], name[101];
+    if (sscanf(line.c_str(), "%lu %64s %lu %64s %100s", &oldsize, oldsha, &newsize, newsha, name) != 5)
+      continue;
+    std::string oldbin = hexdecode(oldsha), newbin = hexdecode(newsha);
+    if (oldbin.size() != 32 || newbin.size() != 32 || oldsize > running->size || newsize > target->size)
+      continue;
+    if (hashsize != oldsize)
+      {
+      if (!ota_partition_sha256(running, oldsize, runsha))
+        continue;
+      hashsize = oldsize;
+      }
+    if (memcmp(runsha, oldbin.data(), 32) != 0)
+      continue;
+    hdr.oldsize = oldsize;
+    memcpy(hdr.oldsha, oldbin.data(), 32);
+    hdr.newsize = newsize;
+    memcpy(hdr.newsha, newbin.data(), 32);
+    patchname = name;
+    }
+  if (patchname.empty())
+    {
+    ESP_LOGI(TAG, "Delta: no patch available for the running image");
+    return false;
+    }
+  std::string patchurl = url.substr(0, url.rfind('/') + 1) + patchname;
+  ESP_LOGI(TAG, "Delta: applying %s", patchurl.c_str());
+  if (writer)
+    writer->printf("Applying delta patch %s\n", patchurl.c_str());
+
+  // Download & apply patch:
+  ota_download_stats& st = m_dlstats;
+  memset(&st, 0, sizeof(st));
+  st.digest = "pending";
+  st.delta = true;
+
+  OvmsHttpClient http(patchurl);
+  if (!http.IsOpen() || http.ResponseCode() != 200)
+    {
+    error = "Patch request failed, server response code " + std::to_string(http.ResponseCode());
+    http.Disconnect();
+    return false;
+    }
+  size_t expected = http.BodySize();
+  if (expected <= OTA_DELTA_HEADERSIZE)
+    {
+    error = "Patch file size (" + std::to_string(expected) + ") is invalid";
+    http.Disconnect();
+    return false;
+    }
+  struct timeval tv = { OTA_PIPE_RXTIMEOUT, 0 };
+  setsockopt(http.Socket(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  SetFlashStatus(autoflash
+    ? "OTA Auto Flash: Preparing flash partition..."
+    : "OTA Flash HTTP: Preparing flash partition...", 0, autoflash);
+  if (writer)
+    writer->puts(GetFlashStatus());
+  esp_ota_handle_t otah;
+  esp_err_t err = esp_ota_begin(target, hdr.newsize, &otah);
   if (err != ESP_OK)
     {
-    ESP_LOGE(TAG, "AutoFlash: ESP32 error #%d setting boot partition - check before rebooting", err);
+    error = "ESP32 error #" + std::to_string(err) + " when starting OTA operation";
+    http.Disconnect();
     return false;
     }
 
-  ESP_LOGI(TAG, "AutoFlash: Success flash of %d bytes from %s", http.BodySize(), url.c_str());
-  MyNotify.NotifyStringf("info", "ota.update", "OTA firmware %s has been updated (OVMS will restart)", info.version_server.c_str());
-  MyConfig.SetParamValue("ota", "http.mru", url);
+  OvmsOTAPipeline pipe(otah, st);
+  ota_pipe_buf_t buf;
+  uint8_t* rbuf = (uint8_t*) ExternalRamMalloc(OTA_DELTA_CHUNKSIZE);
+  if (!rbuf || !pipe.Start() || !pipe.GetBuffer(buf))
+    {
+    if (rbuf) free(rbuf);
+    error = "Out of memory for delta pipeline";
+    http.Disconnect();
+    esp_ota_end(otah);
+    return false;
+    }
 
+  OvmsDeltaPatch patch(
+    [running](size_t offset, uint8_t* data, size_t len)
+      {
+      return (esp_partition_read(running, offset, data, len) == ESP_OK);
+      },
+    [&pipe, &buf](const uint8_t* data, size_t len)
+      {
+      while (len > 0)
+        {
+        size_t n = OTA_PIPE_BUFSIZE - buf.len;
+        if (n > len) n = len;
+        memcpy(buf.data + buf.len, data, n);
+        buf.len += n;
+        data += n;
+        len -= n;
+        if (buf.len == OTA_PIPE_BUFSIZE)
+          {
+          pipe.Submit(buf);
+          if (!pipe.GetBuffer(buf))
+            return false;
+          }
+        }
+      return true;
+      });
+
+  SetFlashStatus(autoflash
+    ? "OTA Auto Flash: Applying delta patch..."
+    : "OTA Flash HTTP: Applying delta patch...");
+  st.size = expected;
+  st.started = esp_timer_get_time();
+  st.running = true;
+  bool checked = false;
+  while (st.received < expected)
+    {
+    size_t k = http.BodyRead(rbuf, OTA_DELTA_CHUNKSIZE);
+    if (k == 0)
+      {
+      error = "Connection lost at " + std::to_string(st.received) + " bytes";
+      break;
+      }
+    if (st.received + k > expected)
+      {
+      error = "Download exceeds the expected file size";
+      break;
+      }
+    st.received += k;
+    if (!patch.Feed(rbuf, k))
+      {
+      error = "Patch failed: " + patch.GetError();
+      break;
+      }
+    if (!checked && patch.HaveHeader())
+      {
+      const ota_delta_header_t& ph = patch.GetHeader();
+      if (ph.oldsize != hdr.oldsize || ph.newsize != hdr.newsize
+          || memcmp(ph.oldsha, hdr.oldsha, 32) != 0 || memcmp(ph.newsha, hdr.newsha, 32) != 0)
+        {
+        error = "Patch does not match index";
+        break;
+        }
+      checked = true;
+      }
+    SetFlashPerc((patch.GetWritten()*100)/hdr.newsize);
+    }
+  http.Disconnect();
+  free(rbuf);
+
+  if (error.empty() && !patch.Finish())
+    error = "Patch failed: " + patch.GetError();
+  if (error.empty() && buf.len > 0)
+    pipe.Submit(buf);
+  uint8_t digest[32];
+  err = pipe.Finish(digest);
+  st.running = false;
+  st.elapsed_ms = (esp_timer_get_time() - st.started) / 1000;
+  if (err != ESP_OK && error.empty())
+    error = "ESP32 error #" + std::to_string(err) + " when writing to flash";
+  if (error.empty() && memcmp(digest, hdr.newsha, sizeof(digest)) != 0)
+    {
+    st.digest = "MISMATCH";
+    error = "SHA-256 digest mismatch, image rejected";
+    }
+  if (!error.empty())
+    {
+    esp_ota_end(otah);
+    return false;
+    }
+  st.digest = "verified";
+  ESP_LOGI(TAG, "Delta: complete (%d patch bytes, %d image bytes in %" PRIu32 " ms, flash wait %" PRIu32 " ms)",
+    st.received, st.written, st.elapsed_ms, st.flashwait_ms);
+  if (writer)
+    writer->printf("Delta patch applied (%d patch bytes, %d image bytes), SHA-256 digest verified\n",
+      st.received, st.written);
+
+  SetFlashStatus(autoflash
+    ? "OTA Auto Flash: Finalising flash partition..."
+    : "OTA Flash HTTP: Finalising flash write");
+  err = esp_ota_end(otah);
+  if (err != ESP_OK)
+    {
+    error = "ESP32 error #" + std::to_string(err) + " finalising OTA operation - state is inconsistent";
+    return false;
+    }
   return true;
   }
+#endif // CONFIG_OVMS_SC_ZIP
@@ -35,6 +35,7 @@
 #include "freertos/task.h"
 #include "ovms_events.h"
 #include "ovms_mutex.h"
+#include "esp_partition.h"
 
 struct ota_info
   {
@@ -55,6 +56,24 @@ typedef enum
   OTA_FlashCfg_FromSD           // perform update from SD card (/sd/ovms3.bin)
   } ota_flashcfg_t;
 
+// HTTP download statistics (current or last download):
+struct ota_download_stats
+  {
+  bool running;
+  size_t size;                  // Image size
+  size_t received;              // Bytes received
+  size_t written;               // Bytes written to flash
+  int64_t started;              // Start time [us]
+  uint32_t elapsed_ms;          // Duration of finished download
+  uint32_t netwait_ms;          // Flash writer waiting for network data
+  uint32_t flashwait_ms;        // Network reader waiting for flash writer
+  int resumes;                  // Connection losses resumed
+  const char* digest;           // SHA-256 verification result
+  bool delta;                   // Image built from delta patch
+  };
+
+class OvmsWriter;
+
 class OvmsOTA
   {
   public:
@@ -63,6 +82,12 @@ class OvmsOTA
 
   public:
     static void GetStatus(ota_info& info, bool check_update=true);
+    bool DownloadFlash(const std::string& url, const esp_partition_t* target,
+                       OvmsWriter* writer, bool autoflash, std::string& error);
+#ifdef CONFIG_OVMS_SC_ZIP
+    bool DeltaFlash(const std::string& url, const esp_partition_t* running, const esp_partition_t* target,
+                    OvmsWriter* writer, bool autoflash, std::string& error);
+#endif // CONFIG_OVMS_SC_ZIP
 
   public:
     void LaunchAutoFlash(ota_flashcfg_t cfg=OTA_FlashCfg_Default);
@@ -84,6 +109,7 @@ class OvmsOTA
     TaskHandle_t m_autotask;
     int m_lastcheckday;
     std::string m_lastnotifyversion;
+    ota_download_stats m_dlstats;
 
 #ifdef CONFIG_OVMS_COMP_SDCARD
   protected:
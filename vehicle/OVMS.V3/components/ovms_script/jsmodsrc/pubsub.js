@@ -25,6 +25,26 @@ function hasKeys(obj)
   return false;
   }
 
+/**
+ * Report topics having subscribers to the firmware, so events without
+ * subscribers don't need to be passed to the javascript engine
+ */
+function reportTopics()
+  {
+  var m, topics = [];
+  for (m in messages)
+    {
+    if ( Object.prototype.hasOwnProperty.call(messages, m) && hasKeys(messages[m]) )
+      {
+      topics.push(m);
+      }
+    }
+  if ( typeof _PubSubTopics === 'function' )
+    {
+    _PubSubTopics(topics);
+    }
+  }
+
 function callSubscriberWithImmediateExceptions( subscriber, message, data )
   {
   subscriber( message, data );
@@ -139,6 +159,7 @@ exports.subscribe = function( message, func )
   // and allow for easy use as key names for the 'messages' object
   var token = 'uid_' + String(++lastUid);
   messages[message][token] = func;
+  reportTopics();
 
   // return token for unsubscribing
   return token;
@@ -153,6 +174,7 @@ exports.subscribe = function( message, func )
 exports.clearAllSubscriptions = function clearAllSubscriptions()
   {
   messages = {};
+  reportTopics();
   };
 
 /**
@@ -171,6 +193,7 @@ exports.clearSubscriptions = function clearSubscriptions(topic)
       delete messages[m];
       }
     }
+  reportTopics();
   };
 
 /**
@@ -249,6 +272,7 @@ exports.unsubscribe = function(value)
       }
     }
 
+  reportTopics();
   return result;
   };
 
@@ -263,3 +287,5 @@ exports.data = function ()
   {
   return messages;
   };
+
+reportTopics();
@@ -37,6 +37,9 @@ static const char *TAG = "script";
 #include <string.h>
 #include <stdio.h>
 #include <dirent.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <set>
 #include <esp_task_wdt.h>
 #include "ovms_malloc.h"
 #include "ovms_module.h"
@@ -71,6 +74,16 @@ static void script_compact(int verbosity, OvmsWriter* writer, OvmsCommand* cmd,
   MyDuktape.DuktapeCompact();
   }
 
+static void script_cache_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyDuktape.BytecodeCacheStatus(writer);
+  }
+
+static void script_cache_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyDuktape.BytecodeCacheClear(writer);
+  }
+
 static void script_meminfo(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   MyDuktape.DuktapeEvalNoResult("JSON.print(meminfo())", writer);
@@ -175,7 +188,6 @@ void OvmsScripts::AllScripts(std::string path)
   {
   DIR *dir;
   struct dirent *dp;
-  FILE *sf;
   std::set<std::string> files;
 
   // read dir, sort scripts by name:
@@ -192,9 +204,15 @@ void OvmsScripts::AllScripts(std::string path)
     }
 
   // execute scripts:
+  RunScripts(std::vector<std::string>(files.begin(), files.end()));
+  }
+
+void OvmsScripts::RunScripts(const std::vector<std::string> &files)
+  {
+  FILE *sf;
   for (auto it = files.begin(); it != files.end(); it++)
     {
-    std::string fpath = *it;
+    const std::string &fpath = *it;
     sf = fopen(fpath.c_str(), "r");
     if (sf)
       {
@@ -207,40 +225,170 @@ void OvmsScripts::AllScripts(std::string path)
 
 void OvmsScripts::EventScript(std::string event, void* data)
   {
-  std::string path;
-
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
   MyDuktape.EventScript(event, data);
 #endif // #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
 
+  // Note: the index gets invalidated by the config.mounted, sd.(un)mounted &
+  //  system.vfs.file.changed event listeners, which run before us in the
+  //  event task context, so the rebuild sees all changes signalled so far.
+  if (!m_eventscripts_valid)
+    BuildEventScriptIndex();
+
+  std::vector<std::string> files;
+    {
+    OvmsMutexLock lock(&m_eventscripts_mutex);
+    auto it = m_eventscripts.find(event);
+    if (it == m_eventscripts.end())
+      return;
+    files = it->second;
+    }
+
+  // run event scripts (external storage first, then internal):
+  RunScripts(files);
+  }
+
+/**
+ * IndexEventScripts: add all event scripts found below basepath to the index
+ *  (index mutex must be held by the caller)
+ */
+void OvmsScripts::IndexEventScripts(const std::string &basepath)
+  {
+  DIR *dir, *edir;
+  struct dirent *dp, *ep;
+
+  if ((dir = opendir(basepath.c_str())) == NULL)
+    return;
+  while ((dp = readdir(dir)) != NULL)
+    {
+    if (dp->d_type != DT_DIR || dp->d_name[0] == '.')
+      continue;
+    std::string epath = basepath;
+    epath.append("/");
+    epath.append(dp->d_name);
+    if ((edir = opendir(epath.c_str())) == NULL)
+      continue;
+    std::set<std::string> files;
+    while ((ep = readdir(edir)) != NULL)
+      {
+      if (ep->d_type == DT_DIR)
+        continue;
+      std::string fpath = epath;
+      fpath.append("/");
+      fpath.append(ep->d_name);
+      files.insert(fpath);
+      }
+    closedir(edir);
+    if (!files.empty())
+      {
+      std::vector<std::string> &list = m_eventscripts[dp->d_name];
+      list.insert(list.end(), files.begin(), files.end());
+      }
+    }
+  closedir(dir);
+  }
+
+/**
+ * BuildEventScriptIndex: scan event script directories
+ */
+void OvmsScripts::BuildEventScriptIndex()
+  {
+  OvmsMutexLock lock(&m_eventscripts_mutex);
+  // Note: set valid before scanning, so an invalidation during the scan
+  //  will trigger another rebuild
+  m_eventscripts_valid = true;
+  m_eventscripts.clear();
 #ifdef CONFIG_OVMS_DEV_SDCARDSCRIPTS
-  // run event scripts on external storage:
-  path=std::string("/sd/events/");
-  path.append(event);
-  AllScripts(path);
+  IndexEventScripts("/sd/events");
 #endif // #ifdef CONFIG_OVMS_DEV_SDCARDSCRIPTS
+  IndexEventScripts("/store/events");
+  m_eventscripts_builds++;
+  ESP_LOGD(TAG, "Event script index built: %d events", m_eventscripts.size());
+  }
+
+static bool event_scripts_affected(const char* path)
+  {
+  // path is inside or a parent of an event script directory?
+  //  (compared with trailing '/', so i.e. "/store/eventsold" does not match)
+  static const char* const dirs[] = { "/store/events/", "/sd/events/" };
+  std::string dpath(path);
+  if (dpath.empty() || dpath.back() != '/')
+    dpath.append("/");
+  for (const char* dir : dirs)
+    {
+    size_t dlen = strlen(dir);
+    if (strncmp(dpath.c_str(), dir, std::min(dpath.size(), dlen)) == 0)
+      return true;
+    }
+  return false;
+  }
 
-  // run event scripts on internal storage:
-  path=std::string("/store/events/");
-  path.append(event);
-  AllScripts(path);
+void OvmsScripts::InvalidateEventScriptIndex(std::string event, void* data)
+  {
+  if (event == "system.vfs.file.changed" && (!data || !event_scripts_affected((const char*)data)))
+    return;
+  m_eventscripts_valid = false;
+  }
+
+void OvmsScripts::EventScriptIndexStatus(OvmsWriter* writer)
+  {
+  OvmsMutexLock lock(&m_eventscripts_mutex);
+  writer->printf("Event script index: %s, %" PRIu32 " builds\n",
+    m_eventscripts_valid ? "valid" : "invalid", m_eventscripts_builds);
+  for (auto it = m_eventscripts.begin(); it != m_eventscripts.end(); it++)
+    {
+    writer->printf("%s:\n", it->first.c_str());
+    for (auto &fpath : it->second)
+      writer->printf("  %s\n", fpath.c_str());
+    }
+  }
+
+static void script_events(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (argc > 0)
+    {
+    if (strcmp(argv[0], "-r") != 0)
+      {
+      cmd->PutUsage(writer);
+      return;
+      }
+    MyScripts.BuildEventScriptIndex();
+    }
+  MyScripts.EventScriptIndexStatus(writer);
   }
 
 OvmsScripts::OvmsScripts()
   {
   ESP_LOGI(TAG, "Initialising SCRIPTS (1600)");
 
+  m_eventscripts_valid = false;
+  m_eventscripts_builds = 0;
+
+  #undef bind  // Kludgy, but works
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  MyEvents.RegisterEvent(TAG, "config.mounted", std::bind(&OvmsScripts::InvalidateEventScriptIndex, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "sd.mounted", std::bind(&OvmsScripts::InvalidateEventScriptIndex, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "sd.unmounted", std::bind(&OvmsScripts::InvalidateEventScriptIndex, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "system.vfs.file.changed", std::bind(&OvmsScripts::InvalidateEventScriptIndex, this, _1, _2));
+
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_NONE
   ESP_LOGI(TAG, "No javascript engines enabled (command scripting only)");
 #endif //#ifdef CONFIG_OVMS_SC_JAVASCRIPT_NONE
 
   OvmsCommand* cmd_script = MyCommandApp.RegisterCommand("script","SCRIPT framework");
   cmd_script->RegisterCommand("run","Run a script",script_run,"<path>",1,1,true, vfs_file_validate);
+  cmd_script->RegisterCommand("events","Show event script index",script_events,
+    "[-r]\n"
+    "-r = rebuild index (needed after file changes not done via VFS commands or web UI)", 0, 1);
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
   cmd_script->RegisterCommand("reload","Reload javascript framework",script_reload);
   cmd_script->RegisterCommand("eval","Eval some javascript code",script_eval,"<code>",1,1);
   cmd_script->RegisterCommand("compact","Compact javascript heap",script_compact);
   cmd_script->RegisterCommand("meminfo","Show heap memory status",script_meminfo);
+  OvmsCommand* cmd_cache = cmd_script->RegisterCommand("cache","Module bytecode cache");
+  cmd_cache->RegisterCommand("status","Show module compile & cache load times",script_cache_status);
+  cmd_cache->RegisterCommand("clear","Clear bytecode cache",script_cache_clear);
 #endif // #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
   MyCommandApp.RegisterCommand(".","Run a script",script_run,"<path>",1,1, true, vfs_file_validate);
   }
@@ -31,8 +31,12 @@
 #ifndef __SCRIPT_H__
 #define __SCRIPT_H__
 
+#include <map>
+#include <vector>
+#include <string>
 #include "ovms_command.h"
 #include "ovms_utils.h"
+#include "ovms_mutex.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -51,6 +55,21 @@ class OvmsScripts
   public:
     void EventScript(std::string event, void* data);
     void AllScripts(std::string path);
+    void RunScripts(const std::vector<std::string> &files);
+
+  public:
+    // Event script index: event name → script paths (in execution order)
+    typedef std::map<std::string, std::vector<std::string>> EventScriptIndex;
+    void BuildEventScriptIndex();
+    void IndexEventScripts(const std::string &basepath);
+    void InvalidateEventScriptIndex(std::string event, void* data);
+    void EventScriptIndexStatus(OvmsWriter* writer);
+
+  protected:
+    EventScriptIndex m_eventscripts;
+    OvmsMutex m_eventscripts_mutex;
+    volatile bool m_eventscripts_valid;
+    uint32_t m_eventscripts_builds;
   };
 
 extern OvmsScripts MyScripts;
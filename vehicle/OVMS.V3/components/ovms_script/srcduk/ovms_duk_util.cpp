@@ -171,6 +171,11 @@ static duk_ret_t DukOvmsMemInfo(duk_context *ctx)
     dc.Push(heapinfo.total_blocks);               dc.PutProp(obj_idx, "sysTotalBlocks");
   #endif
 
+  // Event forwarding statistics:
+  dc.Push(MyDuktape.GetEventsForwarded());        dc.PutProp(obj_idx, "eventsForwarded");
+  dc.Push(MyDuktape.GetEventsFiltered());         dc.PutProp(obj_idx, "eventsFiltered");
+  dc.Push(MyDuktape.GetEventsCoalesced());        dc.PutProp(obj_idx, "eventsCoalesced");
+
   return 1;
   }
 
@@ -516,6 +516,7 @@ void DuktapeVFSSave::Save()
   else
     {
     m_error = "";
+    MyEvents.SignalEvent("system.vfs.file.changed", (void*)m_path.c_str(), m_path.size()+1);
     RequestCallback("done");
     }
   }
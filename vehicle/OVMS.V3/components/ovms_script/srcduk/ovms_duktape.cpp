@@ -37,7 +37,10 @@ static const char *TAG = "ovms-duktape";
 #include <string.h>
 #include <stdio.h>
 #include <dirent.h>
+#include <sys/stat.h>
+#include <inttypes.h>
 #include <esp_task_wdt.h>
+#include "esp_timer.h"
 #include "ovms_malloc.h"
 #include "ovms_module.h"
 #include "ovms_duktape.h"
@@ -179,11 +182,11 @@ static duk_ret_t duk__handle_require(duk_context *ctx)
 		duk_throw(ctx);  /* rethrow */
 	  }
 
-	if (duk_is_string(ctx, -1))
+	if (duk_is_string(ctx, -1) || duk_is_function(ctx, -1))
     {
 		duk_int_t ret;
 
-		/* [ ... module source ] */
+		/* [ ... module source|func ] */
 		ret = duk_safe_call(ctx, duk__eval_module_source, NULL, 2, 1);
 		if (ret != DUK_EXEC_SUCCESS)
       {
@@ -267,32 +270,56 @@ static void duk__push_module_object(duk_context *ctx, const char *id, duk_bool_t
 	duk_put_prop_string(ctx, -2, "require");
   }
 
-static duk_int_t duk__eval_module_source(duk_context *ctx, void *udata)
+/* Compile module source into the module wrapper function.
+ *  Stack: [ ... source filename ] => [ ... func ] / [ ... err ]
+ */
+static duk_int_t duk__compile_module_source(duk_context *ctx)
   {
 	const char *src;
 
-	/*
-	 *  Stack: [ ... module source ]
-	 */
-
-	(void) udata;
-
 	/* Wrap the module code in a function expression.  This is the simplest
 	 * way to implement CommonJS closure semantics and matches the behavior of
 	 * e.g. Node.js.
 	 */
 	duk_push_string(ctx, "(function(exports,require,module,__filename,__dirname){");
-	src = duk_require_string(ctx, -2);
+	src = duk_require_string(ctx, -3);
 	duk_push_string(ctx, (src[0] == '#' && src[1] == '!') ? "//" : "");  /* Shebang support. */
-	duk_dup(ctx, -3);  /* source */
+	duk_dup(ctx, -4);  /* source */
 	duk_push_string(ctx, "\n})");  /* Newline allows module last line to contain a // comment. */
 	duk_concat(ctx, 4);
 
-	/* [ ... module source func_src ] */
+	/* [ ... source filename func_src ] */
+
+	duk_swap_top(ctx, -2);
+	duk_remove(ctx, -3);
+
+	/* [ ... func_src filename ] */
 
-	(void) duk_get_prop_string(ctx, -3, "filename");
-	duk_compile(ctx, DUK_COMPILE_EVAL);
-	duk_call(ctx, 0);
+	if (duk_pcompile(ctx, DUK_COMPILE_EVAL) != 0)
+		return DUK_EXEC_ERROR;
+	return duk_pcall(ctx, 0);
+  }
+
+static duk_int_t duk__eval_module_source(duk_context *ctx, void *udata)
+  {
+	/*
+	 *  Stack: [ ... module source ] or [ ... module func ]
+	 *  (func = precompiled module wrapper function)
+	 */
+
+	(void) udata;
+
+	if (duk_is_function(ctx, -1))
+    {
+		duk_dup(ctx, -1);
+    }
+  else
+    {
+		duk_dup(ctx, -1);
+		(void) duk_get_prop_string(ctx, -3, "filename");
+		if (duk__compile_module_source(ctx) != DUK_EXEC_SUCCESS)
+			duk_throw(ctx);
+	  }
 
 	/* [ ... module source func ] */
 
@@ -469,6 +496,28 @@ void DukOvmsErrorHandler(duk_context *ctx, duk_idx_t err_idx, OvmsWriter *writer
     }
   }
 
+static duk_ret_t DukOvmsPubSubTopics(duk_context *ctx)
+  {
+  // Called by the PubSub module on subscription changes,
+  //  arg 0 = array of subscribed topics
+  std::vector<std::string> topics;
+  if (duk_is_array(ctx, 0))
+    {
+    for (int i=0; duk_get_prop_index(ctx, 0, i); i++)
+      {
+      topics.push_back(duk_to_string(ctx, -1));
+      duk_pop(ctx);
+      }
+    duk_pop(ctx);
+    MyDuktape.SetEventSubscriptions(topics);
+    }
+  else
+    {
+    MyDuktape.ClearEventSubscriptions();
+    }
+  return 0;
+  }
+
 static duk_ret_t DukOvmsResolveModule(duk_context *ctx)
   {
   const char *module_id;
@@ -541,20 +590,22 @@ static duk_ret_t DukOvmsLoadModule(duk_context *ctx)
     duk_error(ctx, DUK_ERR_TYPE_ERROR, "load_cb: cannot find module: %s", module_id);
     return 0;
     }
-  else
+  fclose(sf);
+
+  // Push module function (compiled or from bytecode cache):
+  int res = MyDuktape.PushModuleFunction(ctx, path, filename);
+  if (res < 0)
     {
-    fseek(sf,0,SEEK_END);
-    long slen = ftell(sf);
-    fseek(sf,0,SEEK_SET);
-    char *script = new char[slen+1];
-    memset(script,0,slen+1);
-    fread(script,1,slen,sf);
-    duk_push_string(ctx, script);
-    delete [] script;
-    fclose(sf);
-    ESP_LOGD(TAG,"load_cb: id:'%s' vfs provided %s (%lu bytes)", module_id, filename, slen);
-    MyDuktape.NotifyDuktapeModuleLoad(filename);
+    duk_error(ctx, DUK_ERR_TYPE_ERROR, "load_cb: cannot read module: %s", module_id);
+    return 0;
     }
+  else if (res > 0)
+    {
+    duk_throw(ctx);  // compile error
+    return 0;
+    }
+  ESP_LOGD(TAG,"load_cb: id:'%s' vfs provided %s", module_id, filename);
+  MyDuktape.NotifyDuktapeModuleLoad(filename);
 
   return 1;
   }
@@ -963,6 +1014,13 @@ OvmsDuktape::OvmsDuktape()
   m_dukctx = NULL;
   m_duktaskid = NULL;
   m_duktaskqueue = NULL;
+  m_bccache_enabled = true;
+  m_evsub_valid = false;
+  m_ev_forwarded = 0;
+  m_ev_filtered = 0;
+  m_ev_coalesced = 0;
+
+  RegisterDuktapeFunction(DukOvmsPubSubTopics, 1, "_PubSubTopics");
 
   // Register standard modules...
   extern const char mod_pubsub_js_start[]     asm("_binary_pubsub_js_start");
@@ -1061,27 +1119,48 @@ void OvmsDuktape::EventScript(std::string event, void* data)
   {
   if (!m_dukctx) return;
 
-  // dispatch event to PubSub component:
-  duktape_queue_t dmsg;
-  memset(&dmsg, 0, sizeof(dmsg));
-  dmsg.type = DUKTAPE_event;
-  dmsg.body.dt_event.name = strdup(event.c_str());
-  dmsg.body.dt_event.data = NULL; // data unused, may also be invalid in async script execution
-  if (!DuktapeDispatch(&dmsg, 0))
+  // check subscriptions & coalesce pending ticker events:
+  bool forward = true;
     {
-    ESP_LOGE(TAG, "EventScript: event '%s' lost (queue overflow)", event.c_str());
-    free((void*)dmsg.body.dt_event.name);
+    OvmsMutexLock lock(&m_evsub_mutex);
+    if (!IsEventSubscribed(event))
+      {
+      m_ev_filtered++;
+      forward = false;
+      }
+    else if (startsWith(event, "ticker.") && !m_evpending.insert(event).second)
+      {
+      m_ev_coalesced++;
+      forward = false;
+      }
+    }
+
+  if (forward)
+    {
+    // dispatch event to PubSub component:
+    duktape_queue_t dmsg;
+    memset(&dmsg, 0, sizeof(dmsg));
+    dmsg.type = DUKTAPE_event;
+    dmsg.body.dt_event.name = strdup(event.c_str());
+    dmsg.body.dt_event.data = NULL; // data unused, may also be invalid in async script execution
+    if (!DuktapeDispatch(&dmsg, 0))
+      {
+      ESP_LOGE(TAG, "EventScript: event '%s' lost (queue overflow)", event.c_str());
+      EventDelivered(dmsg.body.dt_event.name);
+      free((void*)dmsg.body.dt_event.name);
+      }
+    else
+      {
+      m_ev_forwarded++;
+      // event processing delayed?
+      int qwait = uxQueueMessagesWaiting(m_duktaskqueue);
+      if (qwait > 10)
+        {
+        ESP_LOGW(TAG, "EventScript: event '%s' delayed, queued at position %d/%d", event.c_str(),
+          qwait, CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE_QUEUE_SIZE);
+        }
+      }
     }
-  else
-   {
-   // event processing delayed?
-   int qwait = uxQueueMessagesWaiting(m_duktaskqueue);
-   if (qwait > 10)
-     {
-     ESP_LOGW(TAG, "EventScript: event '%s' delayed, queued at position %d/%d", event.c_str(),
-       qwait, CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE_QUEUE_SIZE);
-     }
-   }
 
   if (event == "ticker.60")
     {
@@ -1090,6 +1169,283 @@ void OvmsDuktape::EventScript(std::string event, void* data)
     }
   }
 
+/**
+ * IsEventSubscribed: check if any PubSub subscription covers the event
+ *  PubSub delivers hierarchically, i.e. topic "a.b" receives "a.b" and "a.b.*"
+ *  (m_evsub_mutex must be held by the caller)
+ */
+bool OvmsDuktape::IsEventSubscribed(const std::string &event)
+  {
+  if (!m_evsub_valid)
+    return true;
+  for (auto &topic : m_evsub)
+    {
+    if (event.compare(0, topic.size(), topic) == 0 &&
+        (event.size() == topic.size() || event[topic.size()] == '.'))
+      return true;
+    }
+  return false;
+  }
+
+/**
+ * EventDelivered: clear pending state of a ticker event
+ */
+void OvmsDuktape::EventDelivered(const char* event)
+  {
+  if (strncmp(event, "ticker.", 7) != 0)
+    return;
+  OvmsMutexLock lock(&m_evsub_mutex);
+  m_evpending.erase(event);
+  }
+
+void OvmsDuktape::SetEventSubscriptions(const std::vector<std::string> &topics)
+  {
+  OvmsMutexLock lock(&m_evsub_mutex);
+  m_evsub = topics;
+  m_evsub_valid = true;
+  }
+
+void OvmsDuktape::ClearEventSubscriptions()
+  {
+  OvmsMutexLock lock(&m_evsub_mutex);
+  m_evsub.clear();
+  m_evsub_valid = false;
+  }
+
+////////////////////////////////////////////////////////////////////////////////
+// Module bytecode cache
+//
+// Compiled module wrapper functions are dumped to DUKTAPE_BCCACHE_PATH, one
+// file per source path (named by the path hash). The cache entry is valid if
+// the source path, mtime, size and the Duktape version match.
+
+static uint32_t duk_bccache_hash(const void* data, size_t len, uint32_t hash = 2166136261UL)
+  {
+  const uint8_t* p = (const uint8_t*) data;
+  while (len--)
+    {
+    hash ^= *p++;
+    hash *= 16777619UL;
+    }
+  return hash;
+  }
+
+static std::string duk_bccache_file(const std::string &path)
+  {
+  char name[40];
+  snprintf(name, sizeof(name), DUKTAPE_BCCACHE_PATH "/%08" PRIx32 ".jsc",
+    duk_bccache_hash(path.data(), path.size()));
+  return std::string(name);
+  }
+
+static duk_ret_t duk_bccache_load_function(duk_context *ctx, void *udata)
+  {
+  duk_load_function(ctx);
+  return 1;
+  }
+
+static duk_ret_t duk_bccache_dump_function(duk_context *ctx, void *udata)
+  {
+  duk_dump_function(ctx);
+  return 1;
+  }
+
+/**
+ * PushModuleFunction: push the module wrapper function for a source file
+ *  Uses the bytecode cache if possible, compiles & updates the cache otherwise.
+ *  Returns 0 = ok (function pushed), 1 = compile error (error pushed),
+ *    -1 = file not readable (nothing pushed)
+ */
+int OvmsDuktape::PushModuleFunction(duk_context *ctx, const std::string &path, const char* filename)
+  {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return -1;
+
+  int64_t start = esp_timer_get_time();
+  if (m_bccache_enabled && BytecodeCacheLoad(ctx, path, st))
+    {
+    uint32_t load_us = esp_timer_get_time() - start;
+    ESP_LOGD(TAG, "Duktape: %s loaded from bytecode cache in %" PRIu32 " us", path.c_str(), load_us);
+    OvmsMutexLock lock(&m_modstats_mutex);
+    duktape_modstat_t &ms = m_modstats[path];
+    ms.size = st.st_size;
+    ms.load_us = load_us;
+    ms.hits++;
+    return 0;
+    }
+
+  // read & compile source:
+  FILE* sf = fopen(path.c_str(), "r");
+  if (!sf)
+    return -1;
+  long slen = st.st_size;
+  char *script = new char[slen+1];
+  memset(script,0,slen+1);
+  fread(script,1,slen,sf);
+  fclose(sf);
+  start = esp_timer_get_time();
+  duk_push_string(ctx, script);
+  delete [] script;
+  duk_push_string(ctx, filename);
+  if (duk_safe_call(ctx, [](duk_context *ctx, void *udata) -> duk_ret_t
+        {
+        if (duk__compile_module_source(ctx) != DUK_EXEC_SUCCESS)
+          duk_throw(ctx);
+        return 1;
+        }, NULL, 2, 1) != DUK_EXEC_SUCCESS)
+    {
+    return 1;
+    }
+  uint32_t compile_us = esp_timer_get_time() - start;
+  ESP_LOGD(TAG, "Duktape: %s compiled in %" PRIu32 " us", path.c_str(), compile_us);
+
+    {
+    OvmsMutexLock lock(&m_modstats_mutex);
+    duktape_modstat_t &ms = m_modstats[path];
+    ms.size = st.st_size;
+    ms.compile_us = compile_us;
+    ms.compiles++;
+    }
+
+  if (m_bccache_enabled)
+    BytecodeCacheSave(ctx, path, st);
+
+  return 0;
+  }
+
+/**
+ * BytecodeCacheLoad: push cached function for path
+ *  Returns false if no valid cache entry exists (nothing pushed)
+ */
+bool OvmsDuktape::BytecodeCacheLoad(duk_context *ctx, const std::string &path, const struct stat &st)
+  {
+  std::string cpath = duk_bccache_file(path);
+  FILE* cf = fopen(cpath.c_str(), "r");
+  if (!cf)
+    return false;
+
+  duktape_bccache_header_t hdr;
+  bool valid = (fread(&hdr, sizeof(hdr), 1, cf) == 1 &&
+                hdr.magic == DUKTAPE_BCCACHE_MAGIC &&
+                hdr.format == DUKTAPE_BCCACHE_FORMAT &&
+                hdr.version == DUK_VERSION &&
+                hdr.mtime == (uint32_t)st.st_mtime &&
+                hdr.size == (uint32_t)st.st_size &&
+                hdr.pathlen == path.size() &&
+                hdr.codesize > 0);
+  if (valid)
+    {
+    std::string cached(hdr.pathlen, '\0');
+    valid = (fread(&cached[0], hdr.pathlen, 1, cf) == 1 && cached == path);
+    }
+  if (!valid)
+    {
+    fclose(cf);
+    return false;
+    }
+
+  void* buf = duk_push_fixed_buffer(ctx, hdr.codesize);
+  valid = (fread(buf, hdr.codesize, 1, cf) == 1 &&
+           duk_bccache_hash(buf, hdr.codesize) == hdr.checksum);
+  fclose(cf);
+  if (!valid || duk_safe_call(ctx, duk_bccache_load_function, NULL, 1, 1) != DUK_EXEC_SUCCESS)
+    {
+    ESP_LOGW(TAG, "Duktape: discarding invalid bytecode cache entry %s for %s", cpath.c_str(), path.c_str());
+    duk_pop(ctx);
+    unlink(cpath.c_str());
+    return false;
+    }
+  return true;
+  }
+
+/**
+ * BytecodeCacheSave: dump function on stack top to the cache
+ *  Stack: unchanged
+ */
+void OvmsDuktape::BytecodeCacheSave(duk_context *ctx, const std::string &path, const struct stat &st)
+  {
+  if (!path_exists(DUKTAPE_BCCACHE_PATH) && mkpath(DUKTAPE_BCCACHE_PATH) != 0)
+    {
+    ESP_LOGW(TAG, "Duktape: cannot create bytecode cache directory %s", DUKTAPE_BCCACHE_PATH);
+    return;
+    }
+
+  duk_dup_top(ctx);
+  if (duk_safe_call(ctx, duk_bccache_dump_function, NULL, 1, 1) != DUK_EXEC_SUCCESS)
+    {
+    ESP_LOGW(TAG, "Duktape: cannot dump bytecode for %s: %s", path.c_str(), duk_safe_to_string(ctx, -1));
+    duk_pop(ctx);
+    return;
+    }
+
+  duk_size_t codesize;
+  void* code = duk_get_buffer(ctx, -1, &codesize);
+  duktape_bccache_header_t hdr;
+  hdr.magic = DUKTAPE_BCCACHE_MAGIC;
+  hdr.format = DUKTAPE_BCCACHE_FORMAT;
+  hdr.version = DUK_VERSION;
+  hdr.mtime = st.st_mtime;
+  hdr.size = st.st_size;
+  hdr.pathlen = path.size();
+  hdr.codesize = codesize;
+  hdr.checksum = duk_bccache_hash(code, codesize);
+
+  std::string cpath = duk_bccache_file(path);
+  FILE* cf = fopen(cpath.c_str(), "w");
+  bool ok = (cf != NULL);
+  if (ok)
+    {
+    ok = (fwrite(&hdr, sizeof(hdr), 1, cf) == 1 &&
+          fwrite(path.data(), path.size(), 1, cf) == 1 &&
+          fwrite(code, codesize, 1, cf) == 1);
+    ok = (fclose(cf) == 0) && ok;
+    }
+  if (!ok)
+    {
+    ESP_LOGW(TAG, "Duktape: cannot write bytecode cache entry %s", cpath.c_str());
+    unlink(cpath.c_str());
+    }
+  duk_pop(ctx);
+  }
+
+void OvmsDuktape::BytecodeCacheStatus(OvmsWriter* writer)
+  {
+  OvmsMutexLock lock(&m_modstats_mutex);
+  writer->printf("Bytecode cache %s (%s)\n", m_bccache_enabled ? "enabled" : "disabled", DUKTAPE_BCCACHE_PATH);
+  if (m_modstats.empty())
+    {
+    writer->puts("No modules loaded from VFS.");
+    return;
+    }
+  writer->printf("%-40s %8s %9s %9s %6s %6s\n", "Module", "Size", "Compile", "Cached", "#Comp", "#Hits");
+  uint32_t sum_compile = 0, sum_load = 0;
+  for (auto &it : m_modstats)
+    {
+    const duktape_modstat_t &ms = it.second;
+    writer->printf("%-40s %8" PRIu32 " %6" PRIu32 " ms %6" PRIu32 " ms %6" PRIu32 " %6" PRIu32 "\n",
+      it.first.c_str(), ms.size, ms.compile_us / 1000, ms.load_us / 1000, ms.compiles, ms.hits);
+    sum_compile += ms.compile_us;
+    sum_load += ms.load_us;
+    }
+  writer->printf("%-40s %8s %6" PRIu32 " ms %6" PRIu32 " ms\n", "Total", "", sum_compile / 1000, sum_load / 1000);
+  }
+
+void OvmsDuktape::BytecodeCacheClear(OvmsWriter* writer)
+  {
+  if (!path_exists(DUKTAPE_BCCACHE_PATH))
+    {
+    writer->puts("Bytecode cache is empty.");
+    return;
+    }
+  if (rmtree(DUKTAPE_BCCACHE_PATH) != 0)
+    writer->printf("Error: cannot remove %s\n", DUKTAPE_BCCACHE_PATH);
+  else
+    writer->puts("Bytecode cache cleared.");
+  OvmsMutexLock lock(&m_modstats_mutex);
+  m_modstats.clear();
+  }
+
 bool OvmsDuktape::DuktapeDispatch(duktape_queue_t* msg, TickType_t queuewait /*=portMAX_DELAY*/)
   {
   msg->waitcompletion = NULL;
@@ -1505,6 +1861,11 @@ void OvmsDuktape::DukTapeInit()
     this,
     DukOvmsFatalHandler);
 
+  // forward all events until PubSub reports its subscriptions:
+  ClearEventSubscriptions();
+
+  m_bccache_enabled = MyConfig.GetParamValueBool("module", "duktape.bccache", true);
+
   ESP_LOGI(TAG,"Duktape: Initialising module system");
   duk_push_object(m_dukctx);
   duk_push_c_function(m_dukctx, DukOvmsResolveModule, DUK_VARARGS);
@@ -1572,27 +1933,29 @@ void OvmsDuktape::DukTapeInit()
   #endif // #ifdef CONFIG_OVMS_COMP_PLUGINS
 
   // ovmsmain
-  FILE* sf = fopen("/store/scripts/ovmsmain.js", "r");
-  if (sf != NULL)
+  if (path_exists("/store/scripts/ovmsmain.js"))
     {
-    fseek(sf,0,SEEK_END);
-    long slen = ftell(sf);
-    fseek(sf,0,SEEK_SET);
-    char *script = new char[slen+1];
-    memset(script,0,slen+1);
-    fread(script,1,slen,sf);
-    duk_push_string(m_dukctx, script);
-    delete [] script;
-    fclose(sf);
-    ESP_LOGI(TAG,"Duktape: Executing ovmsmain.js");
-    NotifyDuktapeModuleLoad("ovmsmain.js");
-    duk_module_node_peval_main(m_dukctx, "ovmsmain.js");
-    NotifyDuktapeModuleUnload("ovmsmain.js");
+    int res = PushModuleFunction(m_dukctx, "/store/scripts/ovmsmain.js", "ovmsmain.js");
+    if (res == 0)
+      {
+      ESP_LOGI(TAG,"Duktape: Executing ovmsmain.js");
+      NotifyDuktapeModuleLoad("ovmsmain.js");
+      if (duk_module_node_peval_main(m_dukctx, "ovmsmain.js") != 0)
+        DukOvmsErrorHandler(m_dukctx, -1, NULL, "ovmsmain.js");
+      NotifyDuktapeModuleUnload("ovmsmain.js");
+      duk_pop_2(m_dukctx);
+      }
+    else if (res > 0)
+      {
+      DukOvmsErrorHandler(m_dukctx, -1, NULL, "ovmsmain.js");
+      duk_pop(m_dukctx);
+      }
     }
   }
 
 void OvmsDuktape::DukTapeTask()
   {
+  OvmsHeapTag heaptag(HEAPTAG_DUKTAPE);
   duktape_queue_t msg;
 
   ESP_LOGI(TAG,"Duktape: Scripting task is running");
@@ -1652,6 +2015,7 @@ void OvmsDuktape::ProcessJob(duktape_queue_t& msg)
     case DUKTAPE_event:
       {
       // Event
+      EventDelivered(msg.body.dt_event.name);
       if (m_dukctx != NULL)
         {
         // Deliver the event to DUKTAPE
@@ -38,9 +38,15 @@
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 
+#include <sys/stat.h>
 #include "duktape.h"
 #include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 #include <utility>
+#include "ovms_mutex.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // DukContext: C++ wrapper for duk_context
@@ -128,6 +134,36 @@ class DuktapeObjectRegistration;
 
 typedef std::map<const char *, DuktapeObjectRegistration*, CmpStrOp> DuktapeObjectMap;
 
+////////////////////////////////////////////////////////////////////////////////
+// Module bytecode cache
+
+#define DUKTAPE_BCCACHE_PATH      "/store/.jscache"
+#define DUKTAPE_BCCACHE_MAGIC     0x43534A4F      // 'OJSC'
+#define DUKTAPE_BCCACHE_FORMAT    1
+
+typedef struct
+  {
+  uint32_t magic;                 // DUKTAPE_BCCACHE_MAGIC
+  uint32_t format;                // DUKTAPE_BCCACHE_FORMAT
+  uint32_t version;               // DUK_VERSION
+  uint32_t mtime;                 // source file modification time
+  uint32_t size;                  // source file size
+  uint32_t pathlen;               // source path length (path follows header)
+  uint32_t codesize;              // bytecode size (bytecode follows path)
+  uint32_t checksum;              // bytecode FNV-1a hash
+  } duktape_bccache_header_t;
+
+typedef struct
+  {
+  uint32_t size;                  // source file size
+  uint32_t compile_us;            // last compile time [us]
+  uint32_t load_us;               // last cache load time [us]
+  uint32_t compiles;              // compile count
+  uint32_t hits;                  // cache hit count
+  } duktape_modstat_t;
+
+typedef std::map<std::string, duktape_modstat_t> DuktapeModuleStatMap;
+
 class DuktapeObjectRegistration
   {
   public:
@@ -354,6 +390,36 @@ class OvmsDuktape
     duk_context* DukTapeContext() { return m_dukctx; }
     void EventScript(std::string event, void* data);
 
+  public:
+    // Module loading & bytecode cache:
+    int PushModuleFunction(duk_context *ctx, const std::string &path, const char* filename);
+    void BytecodeCacheStatus(OvmsWriter* writer);
+    void BytecodeCacheClear(OvmsWriter* writer);
+  protected:
+    bool BytecodeCacheLoad(duk_context *ctx, const std::string &path, const struct stat &st);
+    void BytecodeCacheSave(duk_context *ctx, const std::string &path, const struct stat &st);
+    bool m_bccache_enabled;
+    OvmsMutex m_modstats_mutex;
+    DuktapeModuleStatMap m_modstats;
+
+  public:
+    // Event forwarding filter, fed by the PubSub module:
+    void SetEventSubscriptions(const std::vector<std::string> &topics);
+    void ClearEventSubscriptions();
+    uint32_t GetEventsForwarded() { return m_ev_forwarded; }
+    uint32_t GetEventsFiltered() { return m_ev_filtered; }
+    uint32_t GetEventsCoalesced() { return m_ev_coalesced; }
+  protected:
+    bool IsEventSubscribed(const std::string &event);
+    void EventDelivered(const char* event);
+    OvmsMutex m_evsub_mutex;
+    bool m_evsub_valid;                       // false = forward all events
+    std::vector<std::string> m_evsub;         // subscribed topics
+    std::set<std::string> m_evpending;        // ticker events queued
+    uint32_t m_ev_forwarded;
+    uint32_t m_ev_filtered;
+    uint32_t m_ev_coalesced;
+
   protected:
     duk_context* m_dukctx;
     TaskHandle_t m_duktaskid;
@@ -35,6 +35,7 @@ static const char *TAG = "ovms-server-v2";
 #include "buffered_shell.h"
 #include "ovms_peripherals.h"
 #include "ovms_command.h"
+#include "ovms_status.h"
 #include "ovms_config.h"
 #include "metrics_standard.h"
 #include "crypt_base64.h"
@@ -177,6 +178,8 @@ bool OvmsServerV2ReaderFilterCallback(OvmsNotifyType* type, const char* subtype)
 
 static void OvmsServerV2MongooseCallback(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsHeapTag heaptag(HEAPTAG_SERVERV2);
+  OvmsNetProfile prof(NETPROF_SERVERV2);
   switch (ev)
     {
     case MG_EV_CONNECT:
@@ -311,6 +314,14 @@ void OvmsServerV2::ProcessServerMsg()
       // Generate, and store, the digest for future use
       std::string modpass = MyConfig.GetParamValue("password","module");
       hmac_md5((uint8_t*) token, OVMS_PROTOCOL_V2_TOKENSIZE, (uint8_t*)modpass.c_str(), modpass.length(), m_pdigest);
+
+      // Prime the paranoid crypto state once, messages use a copy of it:
+      RC4_setup(&m_pcrypto1, &m_pcrypto2, m_pdigest, OVMS_MD5_SIZE);
+      for (int k=0;k<1024;k++)
+        {
+        uint8_t zero = 0;
+        RC4_crypt(&m_pcrypto1, &m_pcrypto2, &zero, 1);
+        }
       }
 
     m_pending_notify_info = true;
@@ -355,14 +366,8 @@ void OvmsServerV2::ProcessServerMsg()
     uint8_t *d = new uint8_t[line.length()-6];
     len = base64decode(line.c_str()+7,d+1);
 
-    RC4_CTX1* pm_crypto1 = new RC4_CTX1;
-    RC4_CTX2* pm_crypto2 = new RC4_CTX2;
-    RC4_setup(pm_crypto1, pm_crypto2, m_pdigest, OVMS_MD5_SIZE);
-    for (int k=0;k<1024;k++)
-      {
-      uint8_t zero = 0;
-      RC4_crypt(pm_crypto1, pm_crypto2, &zero, 1);
-      }
+    RC4_CTX1* pm_crypto1 = new RC4_CTX1(m_pcrypto1);
+    RC4_CTX2* pm_crypto2 = new RC4_CTX2(m_pcrypto2);
     RC4_crypt(pm_crypto1, pm_crypto2, d, len);
 
     line.erase(5);
@@ -450,7 +455,7 @@ void OvmsServerV2::ProcessCommand(const char* payload)
       for (k=0;k<32;k++)
         {
         *buffer << "MP-0 c1,0," << k << ",32," << (vehicle ? vehicle->GetFeature(k) : "0");
-        Transmit(buffer->str().c_str());
+        Transmit(buffer->str());
         buffer->str("");
         buffer->clear();
         }
@@ -487,7 +492,7 @@ void OvmsServerV2::ProcessCommand(const char* payload)
           {
           *buffer << MyConfig.GetParamValue(pmap[k].param, pmap[k].instance);
           }
-        Transmit(buffer->str().c_str());
+        Transmit(buffer->str());
         buffer->str("");
         buffer->clear();
         }
@@ -744,67 +749,98 @@ void OvmsServerV2::ProcessCommand(const char* payload)
       break;
     }
 
-  Transmit(buffer->str().c_str());
+  Transmit(buffer->str());
   delete buffer;
   }
 
-bool OvmsServerV2::Transmit(const std::string& message)
+bool OvmsServerV2::Transmit(const char* message, size_t len)
   {
   OvmsMutexLock mg(&m_mgconn_mutex);
   if (!m_mgconn)
     return false;
 
-  int len = message.length();
-  char* s = new char[(len*2)+4];
-  memcpy(s,message.c_str(),len);
-  ESP_LOGI(TAG, "Send %s",message.c_str());
+  ESP_LOGD(TAG, "Send %.*s", (int)len, message);
+
+  // Work in the transmit arena: plaintext at the start, paranoid payload
+  // behind it. The paranoid encoding needs less than len*2+4 bytes.
+  size_t worksize = (len*2)+4;
+  if (m_txarena.size() < worksize*2)
+    m_txarena.resize(worksize*2);
+  uint8_t* s = (uint8_t*)&m_txarena[0];
 
   if ((m_ptoken_ready)&&
-      (s[5] != 'E')&&
-      (s[5] != 'A')&&
-      (s[5] != 'a')&&
-      (s[5] != 'g')&&
-      (s[5] != 'P'))
+      (len >= 6)&&
+      (message[5] != 'E')&&
+      (message[5] != 'A')&&
+      (message[5] != 'a')&&
+      (message[5] != 'g')&&
+      (message[5] != 'P'))
     {
     // We must convert the message to a paranoid one...
     // The message is of the form MP-0 X...
     // Where X is the code and ... is the (optional) data
-    char code[2]; code[0] = s[5]; code[1] = 0;
-    uint8_t* d = new uint8_t[len-6];
-    memcpy(d,s+6,len-6);
+    uint8_t* d = s + worksize;
+    memcpy(d, message+6, len-6);
 
     // Paranoid encrypt the message part of the transaction
-    RC4_CTX1* pm_crypto1 = new RC4_CTX1;
-    RC4_CTX2* pm_crypto2 = new RC4_CTX2;
-    RC4_setup(pm_crypto1, pm_crypto2, m_pdigest, OVMS_MD5_SIZE);
-    for (int k=0;k<1024;k++)
-      {
-      uint8_t zero = 0;
-      RC4_crypt(pm_crypto1, pm_crypto2, &zero, 1);
-      }
-    RC4_crypt(pm_crypto1, pm_crypto2, d, len-6);
-
-    strcpy(s,"MP-0 EM");
-    strcat(s,code);
-    base64encode(d, len-6, (uint8_t*)s+8);
-    // The messdage is now in paranoid mode...
-    delete[] d;
-    delete pm_crypto1;
-    delete pm_crypto2;
+    RC4_CTX1 pm_crypto1 = m_pcrypto1;
+    RC4_CTX2 pm_crypto2 = m_pcrypto2;
+    RC4_crypt(&pm_crypto1, &pm_crypto2, d, len-6);
+
+    memcpy(s, "MP-0 EM", 7);
+    s[7] = message[5];
+    len = (uint8_t*)base64encode(d, len-6, s+8) - s;
+    // The message is now in paranoid mode...
     }
+  else
+    {
+    memcpy(s, message, len);
+    }
+
+  RC4_crypt(&m_crypto_tx1, &m_crypto_tx2, s, len);
 
-  RC4_crypt(&m_crypto_tx1, &m_crypto_tx2, (uint8_t*)s, len);
+  // Append the encoded line to the transmit queue:
+  size_t qlen = m_txqueue.size();
+  m_txqueue.resize(qlen + ((len+2)/3)*4 + 3);
+  char* e = base64encode(s, len, (uint8_t*)&m_txqueue[qlen]);
+  memcpy(e, "\r\n", 2);
+  m_txqueue.resize(e + 2 - &m_txqueue[0]);
 
-  char* buf = new char[(len*2)+4];
-  base64encode((uint8_t*)s, len, (uint8_t*)buf);
-  strcat(buf,"\r\n");
-  mg_send(m_mgconn, buf, strlen(buf));
+  if (m_txarena.size() > OVMS_PROTOCOL_V2_TXARENA_KEEP)
+    std::string().swap(m_txarena);
 
-  delete [] buf;
-  delete [] s;
+  if (m_txbatch == 0)
+    TransmitQueue();
   return true;
   }
 
+/**
+ * TransmitBatchStart/End: collect the messages transmitted in between,
+ *  and hand them to the socket with a single send
+ */
+void OvmsServerV2::TransmitBatchStart()
+  {
+  OvmsMutexLock mg(&m_mgconn_mutex);
+  m_txbatch++;
+  }
+
+void OvmsServerV2::TransmitBatchEnd()
+  {
+  OvmsMutexLock mg(&m_mgconn_mutex);
+  if (m_txbatch > 0 && --m_txbatch == 0)
+    TransmitQueue();
+  }
+
+/**
+ * TransmitQueue: send the queued lines (m_mgconn_mutex must be held)
+ */
+void OvmsServerV2::TransmitQueue()
+  {
+  if (m_mgconn && !m_txqueue.empty())
+    mg_send(m_mgconn, m_txqueue.data(), m_txqueue.size());
+  m_txqueue.clear();
+  }
+
 void OvmsServerV2::SetStatus(const char* status, bool fault, State newstate)
   {
   if (fault)
@@ -917,6 +953,7 @@ void OvmsServerV2::Disconnect()
     m_mgconn->flags |= MG_F_CLOSE_IMMEDIATELY;
     m_mgconn = NULL;
     }
+  m_txqueue.clear();
   m_buffer->EmptyAll();
   m_connretry = 0;
   StandardMetrics.ms_s_v2_connected->SetValue(false);
@@ -931,6 +968,7 @@ void OvmsServerV2::Reconnect(int connretry)
     m_mgconn->flags |= MG_F_CLOSE_IMMEDIATELY;
     m_mgconn = NULL;
     }
+  m_txqueue.clear();
   m_buffer->EmptyAll();
   m_connretry = connretry;
   StandardMetrics.ms_s_v2_connected->SetValue(false);
@@ -1112,7 +1150,7 @@ void OvmsServerV2::TransmitMsgStat(bool always)
     << StandardMetrics.ms_v_bat_range_speed->AsFloat(0, units_speed)
     ;
 
-  Transmit(buffer.str().c_str());
+  Transmit(buffer.str());
   }
 
 void OvmsServerV2::TransmitMsgGen(bool always)
@@ -1201,7 +1239,7 @@ void OvmsServerV2::TransmitMsgGen(bool always)
     << StandardMetrics.ms_v_gen_temp->AsFloat()
     ;
 
-  Transmit(buffer.str().c_str());
+  Transmit(buffer.str());
   }
 
 
@@ -1279,7 +1317,7 @@ void OvmsServerV2::TransmitMsgGPS(bool always)
     << StandardMetrics.ms_v_pos_gpssq->AsInt()
     ;
 
-  Transmit(buffer.str().c_str());
+  Transmit(buffer.str());
   }
 
 void OvmsServerV2::TransmitMsgTPMS(bool always)
@@ -1349,7 +1387,7 @@ void OvmsServerV2::TransmitMsgTPMS(bool always)
     << StandardMetrics.ms_v_tpms_alert->AsString("")
     << "," << defstale_alert
     ;
-  Transmit(buffer.str().c_str());
+  Transmit(buffer.str());
 
   // Transmit legacy "W" message (fixed four tyres, only pressures & temperatures):
 
@@ -1395,7 +1433,7 @@ void OvmsServerV2::TransmitMsgTPMS(bool always)
     << ","
     << defstale
     ;
-  Transmit(buffer.str().c_str());
+  Transmit(buffer.str());
   }
 
 void OvmsServerV2::TransmitMsgFirmware(bool always)
@@ -1447,7 +1485,7 @@ void OvmsServerV2::TransmitMsgFirmware(bool always)
     << mp_encode(StandardMetrics.ms_m_hardware->AsString(""))
     ;
 
-  Transmit(buffer.str().c_str());
+  Transmit(buffer.str());
   }
 
 uint8_t Doors1()
@@ -1613,7 +1651,7 @@ void OvmsServerV2::TransmitMsgEnvironment(bool always)
     << StandardMetrics.ms_v_env_cabintemp->AsString("0")
     ;
 
-  Transmit(buffer.str().c_str());
+  Transmit(buffer.str());
   }
 
 void OvmsServerV2::TransmitMsgCapabilities(bool always)
@@ -1644,7 +1682,7 @@ void OvmsServerV2::TransmitNotifyInfo()
     buffer
       << "MP-0 PI"
       << mp_encode(e->GetValue());
-    if (Transmit(buffer.str().c_str()))
+    if (Transmit(buffer.str()))
       {
       info->MarkRead(MyOvmsServerV2Reader, e);
       }
@@ -1674,7 +1712,7 @@ void OvmsServerV2::TransmitNotifyError()
     buffer
       << "MP-0 PE"
       << e->GetValue(); // no mp_encode; payload structure "<vehicletype>,<errorcode>,<errordata>"
-    if (Transmit(buffer.str().c_str()))
+    if (Transmit(buffer.str()))
       {
       alert->MarkRead(MyOvmsServerV2Reader, e);
       }
@@ -1704,7 +1742,7 @@ void OvmsServerV2::TransmitNotifyAlert()
     buffer
       << "MP-0 PA"
       << mp_encode(e->GetValue());
-    if (Transmit(buffer.str().c_str()))
+    if (Transmit(buffer.str()))
       {
       alert->MarkRead(MyOvmsServerV2Reader, e);
       }
@@ -1756,7 +1794,7 @@ void OvmsServerV2::TransmitNotifyData()
       << -((int)(now - e->m_created) / 1000)
       << ","
       << msg;
-    if (!Transmit(buffer.str().c_str()))
+    if (!Transmit(buffer.str()))
       {
       m_pending_notify_data = true;
       m_pending_notify_data_last = 0;
@@ -1891,7 +1929,7 @@ bool OvmsServerV2::IncomingNotification(OvmsNotifyType* type, OvmsNotifyEntry* e
     buffer
       << "MP-0 PI"
       << mp_encode(entry->GetValue());
-    return Transmit(buffer.str().c_str()); // Mark it as read if we've managed to send it
+    return Transmit(buffer.str()); // Mark it as read if we've managed to send it
     }
   else if (strcmp(type->m_name,"error")==0)
     {
@@ -1905,7 +1943,7 @@ bool OvmsServerV2::IncomingNotification(OvmsNotifyType* type, OvmsNotifyEntry* e
     buffer
       << "MP-0 PE"
       << entry->GetValue(); // no mp_encode; payload structure "<vehicletype>,<errorcode>,<errordata>"
-    return Transmit(buffer.str().c_str()); // Mark it as read if we've managed to send it
+    return Transmit(buffer.str()); // Mark it as read if we've managed to send it
     }
   else if (strcmp(type->m_name,"alert")==0)
     {
@@ -1919,7 +1957,7 @@ bool OvmsServerV2::IncomingNotification(OvmsNotifyType* type, OvmsNotifyEntry* e
     buffer
       << "MP-0 PA"
       << mp_encode(entry->GetValue());
-    return Transmit(buffer.str().c_str()); // Mark it as read if we've managed to send it
+    return Transmit(buffer.str()); // Mark it as read if we've managed to send it
     }
   else if (strcmp(type->m_name,"data")==0)
     {
@@ -2033,6 +2071,9 @@ void OvmsServerV2::Ticker1(std::string event, void* data)
       return;
       }
 
+    // Send all messages of this tick in one go:
+    TransmitBatchStart();
+
     // Periodic transmission of metrics
     bool caron = StandardMetrics.ms_v_env_on->AsBool();
     int now = StandardMetrics.ms_m_monotonic->AsInt();
@@ -2079,6 +2120,8 @@ void OvmsServerV2::Ticker1(std::string event, void* data)
       m_pending_notify_data_last = 0;
       TransmitNotifyData();
       }
+
+    TransmitBatchEnd();
     }
   }
 
@@ -2128,6 +2171,7 @@ OvmsServerV2::OvmsServerV2(const char* name)
   m_peers = 0;
   m_connretry = 0;
   m_mgconn = NULL;
+  m_txbatch = 0;
 
   m_pending_notify_info = false;
   m_pending_notify_error = false;
@@ -2303,6 +2347,7 @@ OvmsServerV2Init::OvmsServerV2Init()
   cmd_v2->RegisterCommand("start","Start an OVMS V2 Server Connection",ovmsv2_start);
   cmd_v2->RegisterCommand("stop","Stop an OVMS V2 Server Connection",ovmsv2_stop);
   cmd_v2->RegisterCommand("status","Show OVMS V2 Server connection status",ovmsv2_status);
+  MyStatus.RegisterCommand("server.v2", TAG, 5000, cmd_v2, "server.v2.");
 
   OvmsCommand* cmd_update = cmd_v2->RegisterCommand("update", "Request OVMS V2 Server data update", ovmsv2_update);
   cmd_update->RegisterCommand("all", "Transmit all metrics covered by v2 protocol", ovmsv2_update);
@@ -36,6 +36,7 @@
 #include <iostream>
 #include <iomanip>
 #include <sys/time.h>
+#include "ovms.h"
 #include "ovms_server.h"
 #include "ovms_netmanager.h"
 #include "ovms_buffer.h"
@@ -46,6 +47,7 @@
 #include "ovms_mutex.h"
 
 #define OVMS_PROTOCOL_V2_TOKENSIZE 22
+#define OVMS_PROTOCOL_V2_TXARENA_KEEP 2048  // Max transmit work buffer size kept between messages
 
 class OvmsServerV2 : public OvmsServer
   {
@@ -64,7 +66,12 @@ class OvmsServerV2 : public OvmsServer
   protected:
     void ProcessServerMsg();
     void ProcessCommand(const char* payload);
-    bool Transmit(const std::string& message);
+    bool Transmit(const char* message, size_t len);
+    bool Transmit(const std::string& message) { return Transmit(message.data(), message.size()); }
+    bool Transmit(const extram::string& message) { return Transmit(message.data(), message.size()); }
+    void TransmitBatchStart();
+    void TransmitBatchEnd();
+    void TransmitQueue();
 
   protected:
     void TransmitMsgStat(bool always = false);
@@ -136,9 +143,15 @@ class OvmsServerV2 : public OvmsServer
 
     bool m_paranoid;
     uint8_t m_pdigest[OVMS_MD5_SIZE];
+    RC4_CTX1 m_pcrypto1;                // Paranoid mode RC4 state after key setup & discard
+    RC4_CTX2 m_pcrypto2;
     std::string m_ptoken;
     bool m_ptoken_ready;
 
+    std::string m_txarena;              // Transmit work buffer (plaintext / paranoid encoding)
+    extram::string m_txqueue;           // Encoded lines pending for the socket
+    int m_txbatch;                      // Batch nesting level, >0 = queue lines until batch end
+
     bool m_now_stat;
     bool m_now_gen;
     bool m_now_gps;
@@ -9,7 +9,7 @@
 
 ifdef CONFIG_OVMS_COMP_SERVER
 ifdef CONFIG_OVMS_COMP_SERVER_V3
-COMPONENT_DEPENDS := mongoose
+COMPONENT_DEPENDS := mongoose zip
 COMPONENT_SRCDIRS := src
 COMPONENT_ADD_INCLUDEDIRS := src
 COMPONENT_ADD_LDFLAGS = -Wl,--whole-archive -l$(COMPONENT_NAME) -Wl,--no-whole-archive
@@ -33,14 +33,20 @@ static const char *TAG = "ovms-server-v3";
 
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include "ovms_server_v3.h"
 #include "buffered_shell.h"
 #include "ovms_command.h"
+#include "ovms_status.h"
 #include "ovms_metrics.h"
 #include "metrics_standard.h"
+#include "ovms_malloc.h"
 #if CONFIG_MG_ENABLE_SSL
 #include "ovms_tls.h"
 #endif
+#ifdef CONFIG_OVMS_SC_ZIP
+#include "zlib.h"
+#endif
 
 OvmsServerV3 *MyOvmsServerV3 = NULL;
 size_t MyOvmsServerV3Modifier = 0;
@@ -64,6 +70,8 @@ bool OvmsServerV3ReaderFilterCallback(OvmsNotifyType* type, const char* subtype)
 
 static void OvmsServerV3MongooseCallback(struct mg_connection *nc, int ev, void *p)
   {
+  OvmsHeapTag heaptag(HEAPTAG_SERVERV3);
+  OvmsNetProfile prof(NETPROF_SERVERV3);
   struct mg_mqtt_message *msg = (struct mg_mqtt_message *) p;
   switch (ev)
     {
@@ -215,6 +223,14 @@ OvmsServerV3::OvmsServerV3(const char* name)
   m_notify_data_waittype = NULL;
   m_notify_data_waitentry = NULL;
   m_connection_available = false;
+  m_batch = false;
+  m_batch_deflate = false;
+  m_batch_maxsize = 4096;
+  m_batch_count = 0;
+  m_batch_msgs = 0;
+  m_batch_metrics = 0;
+  m_batch_bytes_raw = 0;
+  m_batch_bytes_tx = 0;
 
   ESP_LOGI(TAG, "OVMS Server v3 running");
 
@@ -222,6 +238,7 @@ OvmsServerV3::OvmsServerV3(const char* name)
   using std::placeholders::_1;
   using std::placeholders::_2;
   MyMetrics.RegisterListener(TAG, "*", std::bind(&OvmsServerV3::MetricModified, this, _1));
+  MyMetrics.RegisterRemovalListener(TAG, std::bind(&OvmsServerV3::MetricRemoved, this, _1));
 
   if (MyOvmsServerV3Reader == 0)
     {
@@ -258,6 +275,7 @@ OvmsServerV3::OvmsServerV3(const char* name)
 OvmsServerV3::~OvmsServerV3()
   {
   MyMetrics.DeregisterListener(TAG);
+  MyMetrics.DeregisterRemovalListener(TAG);
   MyEvents.DeregisterEvent(TAG);
   MyNotify.ClearReader(MyOvmsServerV3Reader);
   Disconnect();
@@ -280,6 +298,7 @@ void OvmsServerV3::TransmitAllMetrics()
       }
     metric = metric->m_next;
     }
+  BatchFlush();
   }
 
 void OvmsServerV3::TransmitModifiedMetrics()
@@ -297,24 +316,130 @@ void OvmsServerV3::TransmitModifiedMetrics()
       }
     metric = metric->m_next;
     }
+  BatchFlush();
+  }
+
+/**
+ * GetMetricTopic: get the cached topic & filter result for a metric
+ *  The cache is keyed by the metric instance, the name pointer is checked to
+ *  detect a metric instance having been replaced. The cache is cleared on
+ *  topic prefix or filter changes, entries are removed on metric deregistration.
+ *  Call with m_metric_topics_mutex held.
+ */
+const OvmsServerV3MetricTopic& OvmsServerV3::GetMetricTopic(OvmsMetric* metric)
+  {
+  OvmsServerV3MetricTopic& entry = m_metric_topics[metric];
+  if (entry.name != metric->m_name)
+    {
+    std::string metric_name(metric->m_name);
+    entry.name = metric->m_name;
+    entry.included = m_metrics_filter.CheckFilter(metric_name);
+    entry.topic = m_topic_prefix;
+    entry.topic.append("metric/");
+    entry.topic.append(mqtt_topic(metric_name));
+    }
+  return entry;
+  }
+
+void OvmsServerV3::MetricRemoved(OvmsMetric* metric)
+  {
+  OvmsMutexLock lock(&m_metric_topics_mutex);
+  m_metric_topics.erase(metric);
   }
 
 void OvmsServerV3::TransmitMetric(OvmsMetric* metric)
   {
-  std::string metric_name(metric->m_name);
+  OvmsMutexLock lock(&m_metric_topics_mutex);
+  const OvmsServerV3MetricTopic& mt = GetMetricTopic(metric);
+  if (!mt.included)
+    return;
+
+  if (m_batch)
+    {
+    BatchMetric(metric);
+    return;
+    }
+
+  std::string val = metric->AsString();
+
+  mg_mqtt_publish(m_mgconn, mt.topic.c_str(), m_msgid++,
+    MG_MQTT_QOS(0) | MG_MQTT_RETAIN, val.c_str(), val.length());
+  ESP_LOGD(TAG,"Tx metric %s=%s",mt.topic.c_str(),val.c_str());
+  }
+
+/**
+ * BatchMetric: add a metric to the current batch
+ *  The batch payload is a JSON object mapping metric names to their JSON values.
+ *  If the payload would exceed the configured max size, the batch is sent first.
+ */
+void OvmsServerV3::BatchMetric(OvmsMetric* metric)
+  {
+  std::string val = metric->AsJSON("null");
+  size_t add = strlen(metric->m_name) + val.length() + 4;
+  if (m_batch_count > 0 && m_batch_buf.length() + add + 1 > m_batch_maxsize)
+    BatchFlush();
+  if (m_batch_count == 0)
+    {
+    m_batch_buf.reserve(m_batch_maxsize + 64);
+    m_batch_buf = "{";
+    }
+  else
+    m_batch_buf += ',';
+  m_batch_buf += '"';
+  m_batch_buf += metric->m_name;
+  m_batch_buf += "\":";
+  m_batch_buf += val;
+  m_batch_count++;
+  }
 
-  if (!m_metrics_filter.CheckFilter(metric_name))
+/**
+ * BatchFlush: send the current batch (if any)
+ *  Topic: <prefix>metrics (JSON) or <prefix>metrics/z (zlib compressed JSON)
+ */
+void OvmsServerV3::BatchFlush()
+  {
+  if (m_batch_count == 0)
     return;
+  m_batch_buf += '}';
 
   std::string topic(m_topic_prefix);
-  topic.append("metric/");
-  topic.append(mqtt_topic(metric_name));
+  topic.append("metrics");
+  const char* payload = m_batch_buf.data();
+  size_t payload_len = m_batch_buf.length();
 
-  std::string val = metric->AsString();
+#ifdef CONFIG_OVMS_SC_ZIP
+  uint8_t* zbuf = NULL;
+  if (m_batch_deflate)
+    {
+    uLongf zlen = compressBound(m_batch_buf.length());
+    zbuf = (uint8_t*) ExternalRamMalloc(zlen);
+    if (zbuf && compress2(zbuf, &zlen, (const Bytef*)m_batch_buf.data(), m_batch_buf.length(),
+                          Z_BEST_SPEED) == Z_OK)
+      {
+      topic.append("/z");
+      payload = (const char*) zbuf;
+      payload_len = zlen;
+      }
+    else
+      ESP_LOGW(TAG, "BatchFlush: compression failed, sending uncompressed");
+    }
+#endif
 
   mg_mqtt_publish(m_mgconn, topic.c_str(), m_msgid++,
-    MG_MQTT_QOS(0) | MG_MQTT_RETAIN, val.c_str(), val.length());
-  ESP_LOGD(TAG,"Tx metric %s=%s",topic.c_str(),val.c_str());
+    MG_MQTT_QOS(0), payload, payload_len);
+  ESP_LOGD(TAG,"Tx metrics batch %s: %d metrics, %u/%u bytes",
+    topic.c_str(), m_batch_count, payload_len, m_batch_buf.length());
+
+  m_batch_msgs++;
+  m_batch_metrics += m_batch_count;
+  m_batch_bytes_raw += m_batch_buf.length();
+  m_batch_bytes_tx += payload_len;
+
+#ifdef CONFIG_OVMS_SC_ZIP
+  if (zbuf) free(zbuf);
+#endif
+  m_batch_buf.clear();
+  m_batch_count = 0;
   }
 
 int OvmsServerV3::TransmitNotificationInfo(OvmsNotifyEntry* entry)
@@ -659,6 +784,11 @@ void OvmsServerV3::Connect()
       }
     }
 
+    {
+    OvmsMutexLock lock(&m_metric_topics_mutex);
+    m_metric_topics.clear();
+    }
+
   m_will_topic = std::string(m_topic_prefix);
   m_will_topic.append("metric/s/v3/connected");
 
@@ -843,6 +973,18 @@ void OvmsServerV3::ConfigChanged(OvmsConfigParam* param)
   m_updatetime_sendall = MyConfig.GetParamValueInt("server.v3", "updatetime.sendall", 0);
   m_metrics_filter.LoadFilters(MyConfig.GetParamValue("server.v3", "metrics.include"),
                                MyConfig.GetParamValue("server.v3", "metrics.exclude"));
+    {
+    OvmsMutexLock lock(&m_metric_topics_mutex);
+    m_metric_topics.clear();
+    }
+
+  m_batch = MyConfig.GetParamValueBool("server.v3", "metrics.batch", false);
+#ifdef CONFIG_OVMS_SC_ZIP
+  m_batch_deflate = MyConfig.GetParamValueBool("server.v3", "metrics.batch.deflate", false);
+#endif
+  m_batch_maxsize = MyConfig.GetParamValueInt("server.v3", "metrics.batch.maxsize", 4096);
+  if (m_batch_maxsize < 256)
+    m_batch_maxsize = 256;
   }
 
 void OvmsServerV3::NetUp(std::string event, void* data)
@@ -1077,6 +1219,13 @@ void ovmsv3_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc
         break;
       }
     writer->printf("       %s\n",MyOvmsServerV3->m_status.c_str());
+    if (MyOvmsServerV3->m_batch)
+      {
+      writer->printf("Metrics: batched%s, %" PRIu32 " messages, %" PRIu32 " metrics, %llu/%llu bytes sent/raw\n",
+        MyOvmsServerV3->m_batch_deflate ? " & deflated" : "",
+        MyOvmsServerV3->m_batch_msgs, MyOvmsServerV3->m_batch_metrics,
+        MyOvmsServerV3->m_batch_bytes_tx, MyOvmsServerV3->m_batch_bytes_raw);
+      }
     }
   }
 
@@ -1106,6 +1255,7 @@ OvmsServerV3Init::OvmsServerV3Init()
   cmd_v3->RegisterCommand("start","Start an OVMS V3 Server Connection",ovmsv3_start);
   cmd_v3->RegisterCommand("stop","Stop an OVMS V3 Server Connection",ovmsv3_stop);
   cmd_v3->RegisterCommand("status","Show OVMS V3 Server connection status",ovmsv3_status);
+  MyStatus.RegisterCommand("server.v3", TAG, 5000, cmd_v3, "server.v3.");
 
   OvmsCommand* cmd_update = cmd_v3->RegisterCommand("update", "Request OVMS V3 Server data update", ovmsv3_update);
   cmd_update->RegisterCommand("all", "Transmit all metrics", ovmsv3_update);
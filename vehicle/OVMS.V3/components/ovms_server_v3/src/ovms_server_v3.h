@@ -43,6 +43,15 @@
 
 typedef std::map<std::string, uint32_t> OvmsServerV3ClientMap;
 
+// Per metric cache for the topic string & filter result:
+struct OvmsServerV3MetricTopic
+  {
+  const char* name;                   // metric name pointer the entry was built for
+  bool included;                      // metric passes the include/exclude filter
+  std::string topic;                  // full topic (prefix + "metric/" + name)
+  };
+typedef std::map<const OvmsMetric*, OvmsServerV3MetricTopic> OvmsServerV3MetricTopicMap;
+
 #define MQTT_CONN_NTOPICS 2
 
 class OvmsServerV3 : public OvmsServer
@@ -119,6 +128,16 @@ class OvmsServerV3 : public OvmsServer
     OvmsNotifyEntry* m_notify_data_waitentry;
     OvmsServerV3ClientMap m_clients;
 
+    bool m_batch;                     // true = pack metrics into batch messages
+    bool m_batch_deflate;             // true = zlib compress batch payloads
+    int m_batch_maxsize;              // max uncompressed payload size per batch
+    std::string m_batch_buf;          // current batch payload
+    int m_batch_count;                // metrics in current batch
+    uint32_t m_batch_msgs;            // statistics: batch messages sent
+    uint32_t m_batch_metrics;         // statistics: metrics sent in batches
+    uint64_t m_batch_bytes_raw;       // statistics: uncompressed payload bytes
+    uint64_t m_batch_bytes_tx;        // statistics: transmitted payload bytes
+
   public:
     virtual void SetPowerMode(PowerMode powermode);
     void Connect();
@@ -143,8 +162,14 @@ class OvmsServerV3 : public OvmsServer
 
   private:
     void TransmitMetric(OvmsMetric* metric);
+    const OvmsServerV3MetricTopic& GetMetricTopic(OvmsMetric* metric);
+    void MetricRemoved(OvmsMetric* metric);
+    void BatchMetric(OvmsMetric* metric);
+    void BatchFlush();
 
     IdIncludeExcludeFilter m_metrics_filter;
+    OvmsServerV3MetricTopicMap m_metric_topics;
+    OvmsMutex m_metric_topics_mutex;
   };
 
 class OvmsServerV3Init
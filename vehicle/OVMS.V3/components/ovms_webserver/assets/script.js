@@ -828,6 +828,7 @@ $.fn.loadcmd = function(command, filter, timeout) {
 
 var monitorTimer, last_monotonic = 0;
 var ws, ws_inhibit = 0;
+var ws_dict = {};
 var metrics = {};
 var units = { metrics: {}, prefs: {} };
 
@@ -1023,12 +1024,33 @@ var shellhist = [""], shellhpos = 0;
 var loghist = [];
 const loghist_maxsize = 100;
 
+// Decode binary (CBOR) websocket frame into JSON message equivalent:
+//  { "d": { id: name, … }, "m": { id: value, … }, "u": { id: [native, code, label], … } }
+function decodeBinaryMsg(data){
+  var bin = CBOR.decode(data), msg = {}, id;
+  if (bin.d)
+    $.extend(ws_dict, bin.d);
+  if (bin.m) {
+    msg.metrics = {};
+    for (id in bin.m)
+      msg.metrics[ws_dict[id]] = bin.m[id];
+  }
+  if (bin.u) {
+    msg.units = { metrics: {} };
+    for (id in bin.u)
+      msg.units.metrics[ws_dict[id]] = { native: bin.u[id][0], code: bin.u[id][1], label: bin.u[id][2] };
+  }
+  return msg;
+}
+
 function initSocketConnection(){
   if (location.protocol == "https:") {
-    ws = new WebSocket('wss://' + location.host + '/msg');
+    ws = new WebSocket('wss://' + location.host + '/msg?proto=cbor');
   } else {
-    ws = new WebSocket('ws://' + location.host + '/msg');
+    ws = new WebSocket('ws://' + location.host + '/msg?proto=cbor');
   }
+  ws.binaryType = "arraybuffer";
+  ws_dict = {};
   ws.onopen = function(ev) {
     console.log("WebSocket OPENED", ev);
     $(".receiver").subscribe();
@@ -1039,7 +1061,10 @@ function initSocketConnection(){
   ws.onmessage = function(ev) {
     var msg;
     try {
-      msg = JSON.parse(ev.data);
+      if (typeof ev.data == "string")
+        msg = JSON.parse(ev.data);
+      else
+        msg = decodeBinaryMsg(ev.data);
     } catch (e) {
       console.error("WebSocket msg: " + e + ": " + ev.data);
       return;
@@ -1048,12 +1073,11 @@ function initSocketConnection(){
       if (msgtype == "event") {
         $(".receiver").trigger("msg:event", msg.event);
         $(".monitor[data-events]").each(function(){
-          var cmd = $(this).data("updcmd");
-          var js = $(this).data("updjs");
+          var args = monitorArgs($(this));
           var evf = $(this).data("events");
-          if ((cmd || js) && evf && msg.event.match(evf)) {
+          if (args && evf && msg.event.match(evf)) {
             $(this).data("updlast", now());
-            loadcmd({ command: js ? js : cmd, type: js ? "js" : "cmd" }, $(this));
+            loadcmd(args, $(this));
           }
         });
       }
@@ -1089,14 +1113,23 @@ function initSocketConnection(){
   };
 }
 
+function monitorArgs($el){
+  var st = $el.data("updstatus");
+  var js = $el.data("updjs");
+  var cmd = $el.data("updcmd");
+  if (st) return { command: st, type: "status" };
+  if (js) return { command: js, type: "js" };
+  if (cmd) return { command: cmd, type: "cmd" };
+  return null;
+}
+
 function monitorInit(force){
   $(".monitor").each(function(){
-    var cmd = $(this).data("updcmd");
-    var js = $(this).data("updjs");
+    var args = monitorArgs($(this));
     var txt = $(this).text();
-    if ((cmd || js) && (force || !txt)) {
+    if (args && (force || !txt)) {
       $(this).data("updlast", now());
-      loadcmd({ command: js ? js : cmd, type: js ? "js" : "cmd" }, $(this));
+      loadcmd(args, $(this));
     }
   });
 }
@@ -1117,13 +1150,12 @@ function monitorUpdate(){
     var cnt = $(this).data("updcnt");
     var int = $(this).data("updint");
     var last = $(this).data("updlast");
-    var cmd = $(this).data("updcmd");
-    var js = $(this).data("updjs");
-    if (!cnt || (!cmd && !js) || (now()-last) < int)
+    var args = monitorArgs($(this));
+    if (!cnt || !args || (now()-last) < int)
       return;
     $(this).data("updcnt", cnt-1);
     $(this).data("updlast", now());
-    loadcmd({ command: js ? js : cmd, type: js ? "js" : "cmd" }, $(this));
+    loadcmd(args, $(this));
   });
 }
 
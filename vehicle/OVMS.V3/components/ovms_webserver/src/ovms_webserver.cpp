@@ -38,9 +38,13 @@ static const char *TAG = "webserver";
 
 #include <string.h>
 #include <stdio.h>
+#include <inttypes.h>
+#include <sys/stat.h>
 #include <fstream>
 #include "ovms_webserver.h"
 #include "ovms_config.h"
+#include "ovms_command.h"
+#include "ovms_status.h"
 #include "ovms_metrics.h"
 #include "metrics_standard.h"
 #include "buffered_shell.h"
@@ -52,6 +56,18 @@ static const char *TAG = "webserver";
 
 OvmsWebServer MyWebServer __attribute__ ((init_priority (8200)));
 
+static void webserver_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+{
+  writer->printf("Webserver: %s, %d websocket client(s)\n",
+    MyWebServer.m_running ? "running" : "stopped", (int) MyWebServer.m_client_cnt);
+  uint32_t total = MyWebServer.m_cache_sent + MyWebServer.m_cache_notmod;
+  writer->printf("HTTP cache: %" PRIu32 " requests, %" PRIu32 " full (%" PRIu64 " bytes), %" PRIu32
+    " not modified (%" PRIu64 " bytes saved, %" PRIu32 "%%)\n",
+    total, MyWebServer.m_cache_sent, MyWebServer.m_cache_sent_bytes,
+    MyWebServer.m_cache_notmod, MyWebServer.m_cache_saved_bytes,
+    total ? MyWebServer.m_cache_notmod * 100 / total : 0);
+}
+
 OvmsWebServer::OvmsWebServer()
 {
   ESP_LOGI(TAG, "Initialising WEBSERVER (8200)");
@@ -60,6 +76,8 @@ OvmsWebServer::OvmsWebServer()
   m_configured = false;
   m_shutdown_countdown = 0;
   memset(m_sessions, 0, sizeof(m_sessions));
+  m_cache_sent = m_cache_notmod = 0;
+  m_cache_sent_bytes = m_cache_saved_bytes = 0;
 
 #if MG_ENABLE_FILESYSTEM
   m_file_enable = true;
@@ -83,6 +101,9 @@ OvmsWebServer::OvmsWebServer()
   MyEvents.RegisterEvent(TAG, "config.mounted", std::bind(&OvmsWebServer::ConfigChanged, this, _1, _2));
   MyEvents.RegisterEvent(TAG, "*", std::bind(&OvmsWebServer::EventListener, this, _1, _2));
 
+  OvmsCommand* cmd_webserver = MyCommandApp.RegisterCommand("webserver", "Webserver framework", webserver_status, "", 0, 0, false);
+  cmd_webserver->RegisterCommand("status", "Show webserver status & HTTP cache statistics", webserver_status);
+
   // register standard framework URIs:
   RegisterPage("/", "OVMS", HandleRoot);
   RegisterPage("/assets/style.css", "style.css", HandleAsset);
@@ -245,6 +266,8 @@ void OvmsWebServer::ConfigChanged(std::string event, void* data)
       strdup(MyConfig.GetParamValue("http.server", "auth.file", ".htpasswd").c_str());
     m_file_opts.global_auth_file =
       MyConfig.GetParamValueBool("http.server", "auth.global", true) ? OVMS_GLOBAL_AUTH_FILE : NULL;
+    // Files are served with validators (ETag = mtime & size), always revalidate:
+    m_file_opts.extra_headers = "Cache-Control: no-cache";
   }
 
   if (!param || param->GetName() == "password") {
@@ -331,6 +354,18 @@ const std::string OvmsWebServer::ExecuteCommand(const std::string command, int v
   return BufferedShell::ExecuteCommand(command, true, verbosity);
 }
 
+/**
+ * StatusText: cached status snapshot text, falls back to the command
+ *  if no status provider is registered for the name
+ */
+const std::string OvmsWebServer::StatusText(const char* name, const std::string command)
+{
+  OvmsStatusSnapshot snap;
+  if (MyStatus.Get(name, snap))
+    return snap.text;
+  return ExecuteCommand(command);
+}
+
 
 /**
  * RegisterPage: add a page to the URI handler map
@@ -386,6 +421,7 @@ void PagePluginContent::LoadContent()
     path = "/store/plugin/" + m_path;
     }
   std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+  m_etag.clear();
 
   ESP_LOGD(TAG,"Plugin LoadContent: %s = %s",m_path.c_str(),path.c_str());
 
@@ -406,6 +442,12 @@ void PagePluginContent::LoadContent()
       file.seekg(0);
       file.read(&m_content[0], size);
       ESP_LOGD(TAG, "Plugin file loaded: '%s', %u bytes", path.c_str(), (size_t)size);
+      struct stat st;
+      if (stat(path.c_str(), &st) == 0) {
+        char etag[40];
+        snprintf(etag, sizeof(etag), "\"p%lx.%lx\"", (unsigned long) st.st_mtime, (unsigned long) st.st_size);
+        m_etag = etag;
+      }
     }
   }
 }
@@ -496,7 +538,18 @@ void OvmsWebServer::PluginHandler(PageEntry_t& p, PageContext_t& c)
     return;
 
   extram::string& content = i->second.GetContent();
-  c.head(200);
+  const std::string& etag = i->second.m_etag;
+  if (etag.empty()) {
+    c.head(200);
+  } else {
+    if (c.not_modified(etag.c_str(), "private, no-cache", content.size()))
+      return;
+    std::string headers =
+      "Content-Type: text/html; charset=utf-8\r\n"
+      "Cache-Control: private, no-cache\r\n"
+      "Etag: " + etag;
+    c.head(200, headers.c_str());
+  }
   c.print(content);
   c.done();
 }
@@ -522,6 +575,8 @@ PageResult_t OvmsWebServer::PluginCallback(PageEntry_t& p, PageContext_t& c, con
  */
 void OvmsWebServer::EventHandler(mg_connection *nc, int ev, void *p)
 {
+  OvmsHeapTag heaptag(HEAPTAG_WEBSERVER);
+  OvmsNetProfile prof(NETPROF_WEBSERVER);
   PageContext_t c;
   MgHandler* handler = (MgHandler*) nc->user_data;
 
@@ -530,12 +585,24 @@ void OvmsWebServer::EventHandler(mg_connection *nc, int ev, void *p)
   //  ESP_EARLY_LOGV(TAG, "EventHandler: conn=%p handler=%p ev=%d p=%p rxbufsz=%d, txbufsz=%d", nc, nc->user_data, ev, p, nc->recv_mbuf.size, nc->send_mbuf.size);
 
   // call attached handler:
-  if (handler)
+  if (handler) {
+    OvmsNetProfile prof(NETPROF_MGHANDLER);
     ev = handler->HandleEvent(ev, p);
+  }
 
   // framework handling:
   switch (ev)
   {
+    case MG_EV_WEBSOCKET_HANDSHAKE_REQUEST: // websocket connection request
+      {
+        // Protocol negotiation: "/msg?proto=cbor" requests binary metrics updates
+        http_message* hm = (http_message*) p;
+        char proto[8];
+        if (mg_get_http_var(&hm->query_string, "proto", proto, sizeof(proto)) > 0 && strcmp(proto, "cbor") == 0)
+          nc->flags |= MG_F_WS_CBOR;
+      }
+      break;
+
     case MG_EV_WEBSOCKET_HANDSHAKE_DONE:    // new websocket connection
       {
         MyWebServer.CreateWebSocketHandler(nc);
@@ -731,8 +798,10 @@ void MgHandler::RequestPoll()
 void MgHandler::HandlePoll(mg_connection* nc, int ev, void* p)
 {
   MgHandler* origin = *((MgHandler**)p);
-  if (nc->user_data == origin)
+  if (nc->user_data == origin) {
+    OvmsNetProfile prof(NETPROF_MGHANDLER);
     origin->HandleEvent(MG_EV_POLL, NULL);
+  }
 }
 
 
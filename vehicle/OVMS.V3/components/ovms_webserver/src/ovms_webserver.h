@@ -152,6 +152,7 @@ struct PageContext : public ExternalRamAllocated
   // output:
   void error(int code, const char* text);
   void head(int code, const char* headers=NULL);
+  bool not_modified(const char* etag, const char* cachecontrol, size_t size);
   void print(const std::string text);
   void print(const extram::string text);
   void print(const char* text);
@@ -251,6 +252,7 @@ struct PagePluginContent
   bool              m_pluginstore;
   std::string       m_path;
   extram::string    m_content;
+  std::string       m_etag;             // file mtime & size, empty = no validator
 
   PagePluginContent(std::string path, bool pluginstore=false) {
     m_path = path;
@@ -356,8 +358,14 @@ class HttpStringSender : public MgHandler
  *
  * On creation it will do a full update of all metrics.
  * Later on, it receives TX jobs through the queue.
+ *
+ * Clients connecting with "/msg?proto=cbor" receive metrics & metric units
+ * updates as binary CBOR frames keyed by metric IDs (OvmsMetric::m_id), the
+ * ID dictionary is sent incrementally along with the first use of an ID.
  */
 
+#define MG_F_WS_CBOR            MG_F_USER_1     // client requested binary metrics protocol
+
 enum WebSocketTxJobType
 {
   WSTX_None = 0,
@@ -409,6 +417,10 @@ class WebSocketHandler : public MgHandler, public OvmsWriter
     int HandleEvent(int ev, void* p);
     void HandleIncomingMsg(std::string msg);
 
+  protected:
+    void CborAddDictEntry(std::string& dict, OvmsMetric* m);
+    void SendCborFrame(const char* key, const std::string& dict, const std::string& body);
+
   public:
     void Subscribe(std::string topic);
     void Unsubscribe(std::string topic);
@@ -435,6 +447,11 @@ class WebSocketHandler : public MgHandler, public OvmsWriter
     int                       m_sent = 0;
     int                       m_ack = 0;
     int                       m_last = 0;             // last entry sent up
+    uint32_t                  m_cursor = 0;           // metrics change log read position
+    uint32_t                  m_seqend = 0;           // metrics change log end for current job
+    bool                      m_scan = false;         // metrics job does a full scan
+    bool                      m_cbor = false;         // binary metrics protocol
+    std::vector<bool>         m_cbor_dict;            // metric IDs known by the client
     std::set<std::string>     m_subscriptions;
     bool                      m_units_subscribed;
     bool                      m_units_prefs_subscribed;
@@ -505,6 +522,7 @@ class OvmsWebServer : public ExternalRamAllocated
     void UpdateGlobalAuthFile();
     static const std::string MakeDigestAuth(const char* realm, const char* username, const char* password);
     static const std::string ExecuteCommand(const std::string command, int verbosity=COMMAND_RESULT_NORMAL);
+    static const std::string StatusText(const char* name, const std::string command);
     void EventListener(std::string event, void* data);
     static void UpdateTicker(TimerHandle_t timer);
     static bool NotificationFilter(int client, OvmsNotifyType* type, const char* subtype);
@@ -615,6 +633,12 @@ class OvmsWebServer : public ExternalRamAllocated
 
     int                       m_init_timeout;
     int                       m_shutdown_countdown;
+
+    // HTTP cache statistics (assets & plugin pages):
+    uint32_t                  m_cache_sent;                 // full responses
+    uint32_t                  m_cache_notmod;               // 304 responses
+    uint64_t                  m_cache_sent_bytes;           // content bytes sent
+    uint64_t                  m_cache_saved_bytes;          // content bytes saved by 304
 };
 
 extern OvmsWebServer MyWebServer;
@@ -35,6 +35,7 @@ static const char *TAG = "websocket";
 
 #include <string.h>
 #include <stdio.h>
+#include <algorithm>
 #include "ovms_webserver.h"
 #include "ovms_config.h"
 #include "ovms_metrics.h"
@@ -72,6 +73,9 @@ WebSocketHandler::WebSocketHandler(mg_connection* nc, size_t slot, size_t modifi
   m_jobqueue_overflow_dropcntref = 0;
   m_job.type = WSTX_None;
   m_sent = m_ack = m_last = 0;
+  m_cursor = m_seqend = MyMetrics.GetChangeSeq();
+  m_scan = false;
+  m_cbor = (nc->flags & MG_F_WS_CBOR) != 0;
   m_units_subscribed = false;
   m_units_prefs_subscribed = false;
 
@@ -121,44 +125,92 @@ void WebSocketHandler::ProcessTxJob()
     case WSTX_MetricsAll:
     case WSTX_MetricsUpdate:
     {
-      // Note: this loops over the metrics by index, keeping the last checked position
-      //  in m_last. It will not detect new metrics added between polls if they are
-      //  inserted before m_last, so new metrics may not be sent until first changed.
-      //  The Metrics set normally is static, so this should be no problem.
-      
-      // find start:
-      int i;
-      OvmsMetric* m;
-      for (i=0, m=MyMetrics.m_first; i < m_last && m != NULL; m=m->m_next, i++);
+      // Note: updates are read from the metrics change log using our sequence
+      //  cursor (m_cursor), sending only metrics modified since the last update.
+      //  A full scan over the metrics list is done for WSTX_MetricsAll and as a
+      //  fallback if the change log has been overrun since our last read. The scan
+      //  loops over the metrics by index, keeping the last checked position in m_last.
       
-      // build msg:
-      if (m) {
-        std::string msg;
-        msg.reserve(2*XFER_CHUNK_SIZE+128);
+      std::string msg, dict;
+      msg.reserve(2*XFER_CHUNK_SIZE+128);
+      if (!m_cbor)
         msg = "{\"metrics\":{";
-        for (i=0; m && msg.size() < XFER_CHUNK_SIZE; m=m->m_next) {
+      int i = 0;
+      bool done = false;
+      
+      if (!m_scan) {
+        // read change log (metrics are only valid within the reader callback):
+        auto reader = [&](OvmsMetric* m) {
+          if (m->IsModifiedAndClear(m_modifier)) {
+            if (m_cbor) {
+              CborAddDictEntry(dict, m);
+              cbor_put_uint(msg, m->m_id);
+              cbor_put_json(msg, m->AsJSON());
+            } else {
+              if (i) msg += ',';
+              msg += '\"';
+              msg += m->m_name;
+              msg += "\":";
+              msg += m->AsJSON();
+            }
+            i++;
+          }
+        };
+        while (msg.size() + dict.size() < XFER_CHUNK_SIZE && (int32_t)(m_seqend - m_cursor) > 0) {
+          if (MyMetrics.ReadChangeLog(m_cursor, std::min<uint32_t>(16, m_seqend - m_cursor), reader) < 0) {
+            // overrun: fall back to full scan
+            ESP_EARLY_LOGD(TAG, "WebSocketHandler[%p/%d]: ProcessTxJob change log overrun, rescanning", m_nc, m_modifier);
+            m_scan = true;
+            m_last = 0;
+            m_cursor = m_seqend = MyMetrics.GetChangeSeq();
+            break;
+          }
+        }
+        if (!m_scan && (int32_t)(m_seqend - m_cursor) <= 0)
+          done = true;
+      }
+      
+      if (m_scan) {
+        // find start:
+        OvmsMetric* m;
+        for (i=0, m=MyMetrics.m_first; i < m_last && m != NULL; m=m->m_next, i++);
+        
+        // build msg:
+        for (i=0; m && msg.size() + dict.size() < XFER_CHUNK_SIZE; m=m->m_next) {
           ++m_last;
           if (m->IsModifiedAndClear(m_modifier) || m_job.type == WSTX_MetricsAll) {
-            if (i) msg += ',';
-            msg += '\"';
-            msg += m->m_name;
-            msg += "\":";
-            msg += m->AsJSON();
+            if (m_cbor) {
+              CborAddDictEntry(dict, m);
+              cbor_put_uint(msg, m->m_id);
+              cbor_put_json(msg, m->AsJSON());
+            } else {
+              if (i) msg += ',';
+              msg += '\"';
+              msg += m->m_name;
+              msg += "\":";
+              msg += m->AsJSON();
+            }
             i++;
           }
         }
-
-        // send msg:
-        if (i) {
-          msg += "}}";
-          ESP_EARLY_LOGV(TAG, "WebSocket msg: %s", msg.c_str());
-          mg_send_websocket_frame(m_nc, WEBSOCKET_OP_TEXT, msg.data(), msg.size());
-          m_sent += i;
-        }
+        if (!m)
+          done = true;
+      }
+      
+      // send msg:
+      if (i && m_cbor) {
+        SendCborFrame("m", dict, msg);
+        m_sent += i;
+      }
+      else if (i) {
+        msg += "}}";
+        ESP_EARLY_LOGV(TAG, "WebSocket msg: %s", msg.c_str());
+        mg_send_websocket_frame(m_nc, WEBSOCKET_OP_TEXT, msg.data(), msg.size());
+        m_sent += i;
       }
 
       // done?
-      if (!m && m_ack == m_sent) {
+      if (done && m_ack == m_sent) {
         if (m_sent)
           ESP_EARLY_LOGV(TAG, "WebSocketHandler[%p]: ProcessTxJob type=%d done, sent=%d metrics", m_nc, m_job.type, m_sent);
         ClearTxJob(m_job);
@@ -182,16 +234,17 @@ void WebSocketHandler::ProcessTxJob()
       ESP_EARLY_LOGD(TAG, "WebSocketHandler[%p/%d]: ProcessTxJob MetricsUnitUpdate, i=%d", m_nc, m_modifier, i);
       if (m) { // Bypass this if we are on the 'just sent' leg.
         // build msg:
-        std::string msg;
+        std::string msg, dict;
         msg.reserve(2*XFER_CHUNK_SIZE+128);
-        msg = "{\"units\":{\"metrics\":{";
+        if (!m_cbor)
+          msg = "{\"units\":{\"metrics\":{";
 
         // Cache the user mappings for each group.
-        for (i=0; m && msg.size() < XFER_CHUNK_SIZE; m=m->m_next) {
+        for (i=0; m && msg.size() + dict.size() < XFER_CHUNK_SIZE; m=m->m_next) {
           ++m_last;
           bool send = m->IsUnitSendAndClear(m_modifier);
           if (send) {
-            if (i)
+            if (i && !m_cbor)
               msg += ',';
             metric_unit_t units = m->m_units;
             metric_unit_t user_units = MyUnitConfig.GetUserUnit(units);
@@ -206,16 +259,30 @@ void WebSocketHandler::ProcessTxJob()
             if (user_metricname == NULL)
               user_metricname = metricname;
 
-            std::string entry = string_format("\"%s\":{\"native\":\"%s\",\"code\":\"%s\",\"label\":\"%s\"}",
-               m->m_name, metricname, user_metricname, json_encode(unitlabel).c_str()
-               );
-            msg += entry;
+            if (m_cbor) {
+              // <id>: [ <native>, <code>, <label> ]
+              CborAddDictEntry(dict, m);
+              cbor_put_uint(msg, m->m_id);
+              cbor_put_head(msg, CBOR_MAJOR_ARRAY, 3);
+              cbor_put_text(msg, metricname);
+              cbor_put_text(msg, user_metricname);
+              cbor_put_text(msg, unitlabel);
+            } else {
+              std::string entry = string_format("\"%s\":{\"native\":\"%s\",\"code\":\"%s\",\"label\":\"%s\"}",
+                 m->m_name, metricname, user_metricname, json_encode(unitlabel).c_str()
+                 );
+              msg += entry;
+            }
             i++;
           }
         }
 
         // send msg:
-        if (i) {
+        if (i && m_cbor) {
+          SendCborFrame("u", dict, msg);
+          m_sent += i;
+        }
+        else if (i) {
           msg += "}}}";
           ESP_EARLY_LOGD(TAG, "WebSocket msg: %s", msg.c_str());
           mg_send_websocket_frame(m_nc, WEBSOCKET_OP_TEXT, msg.data(), msg.size());
@@ -297,10 +364,14 @@ void WebSocketHandler::ProcessTxJob()
 
     case WSTX_Notify:
     {
-      if (m_sent && m_ack == m_job.notification->GetValueSize()+1) {
-        // done:
-        ESP_EARLY_LOGV(TAG, "WebSocketHandler[%p]: ProcessTxJob type=%d done, sent %d bytes", m_nc, m_job.type, m_sent);
-        ClearTxJob(m_job);
+      // Note: the value may be dropped while sending (notification
+      //  superseded), m_last flags the final frame has been sent.
+      if (m_last) {
+        if (m_ack == m_sent) {
+          // done:
+          ESP_EARLY_LOGV(TAG, "WebSocketHandler[%p]: ProcessTxJob type=%d done, sent %d bytes", m_nc, m_job.type, m_sent);
+          ClearTxJob(m_job);
+        }
       } else {
         // build frame:
         std::string msg;
@@ -319,14 +390,17 @@ void WebSocketHandler::ProcessTxJob()
           op = WEBSOCKET_OP_CONTINUE;
         }
         
-        extram::string part = m_job.notification->GetValue().substr(m_sent-1, XFER_CHUNK_SIZE);
+        extram::string value = m_job.notification->GetValue();
+        size_t pos = std::min((size_t)(m_sent-1), value.size());
+        extram::string part = value.substr(pos, XFER_CHUNK_SIZE);
         msg += json_encode(part);
         m_sent += part.size();
         
-        if (m_sent < m_job.notification->GetValueSize()+1) {
+        if (pos + part.size() < value.size()) {
           op |= WEBSOCKET_DONT_FIN;
         } else {
           msg += "\"}}";
+          m_last = 1;
         }
         
         // send frame:
@@ -384,6 +458,52 @@ void WebSocketHandler::ProcessTxJob()
 }
 
 
+/**
+ * Binary metrics protocol (CBOR):
+ *  Frame = { ["d": { <id>: <name>, … },] <key>: { <id>: <data>, … } }
+ *  with key "m" = metrics values, "u" = metrics units.
+ *  The dictionary part holds the IDs not yet known by the client, the client
+ *  needs to keep the dictionary for the connection lifetime.
+ */
+
+void WebSocketHandler::CborAddDictEntry(std::string& dict, OvmsMetric* m)
+{
+  if (m->m_id >= m_cbor_dict.size())
+    m_cbor_dict.resize(m->m_id + 64, false);
+  if (!m_cbor_dict[m->m_id]) {
+    cbor_put_uint(dict, m->m_id);
+    cbor_put_text(dict, m->m_name);
+    m_cbor_dict[m->m_id] = true;
+  }
+}
+
+void WebSocketHandler::SendCborFrame(const char* key, const std::string& dict, const std::string& body)
+{
+  // Maps are sent with indefinite length, so the parts can be sent as built:
+  char head[8], mid[8];
+  size_t hlen = 0, mlen = 0;
+  head[hlen++] = dict.empty() ? '\xa1' : '\xa2';
+  if (!dict.empty()) {
+    head[hlen++] = '\x61';
+    head[hlen++] = 'd';
+    head[hlen++] = CBOR_MAP_INDEFINITE;
+    mid[mlen++] = CBOR_BREAK;
+  }
+  mid[mlen++] = '\x61';
+  mid[mlen++] = key[0];
+  mid[mlen++] = CBOR_MAP_INDEFINITE;
+  struct mg_str parts[5] = {
+    { head, hlen },
+    { dict.data(), dict.size() },
+    { mid, mlen },
+    { body.data(), body.size() },
+    { "\xff", 1 },
+  };
+  ESP_EARLY_LOGV(TAG, "WebSocket CBOR msg: %s, %d bytes", key, hlen + dict.size() + mlen + body.size() + 1);
+  mg_send_websocket_framev(m_nc, WEBSOCKET_OP_BINARY, parts, 5);
+}
+
+
 void WebSocketTxJob::clear(size_t client)
 {
   auto& slot = MyWebServer.m_client_slots[client];
@@ -437,6 +557,13 @@ bool WebSocketHandler::GetNextTxJob()
   if (xQueueReceive(m_jobqueue, &m_job, 0) == pdTRUE) {
     // init new job state:
     m_sent = m_ack = m_last = 0;
+    if (m_job.type == WSTX_MetricsAll || m_job.type == WSTX_MetricsUpdate) {
+      // read change log up to the current end, full scan for MetricsAll:
+      m_scan = (m_job.type == WSTX_MetricsAll);
+      m_seqend = MyMetrics.GetChangeSeq();
+      if (m_scan)
+        m_cursor = m_seqend;
+    }
     return true;
   } else {
     return false;
@@ -751,7 +878,8 @@ void OvmsWebServer::UpdateTicker(TimerHandle_t timer)
   unsigned long mask_all = MyMetrics.GetUnitSendAll();
   for (auto slot: MyWebServer.m_client_slots) {
     if (slot.handler) {
-      slot.handler->AddTxJob({ WSTX_MetricsUpdate, NULL });
+      if (slot.handler->m_cursor != MyMetrics.GetChangeSeq())
+        slot.handler->AddTxJob({ WSTX_MetricsUpdate, NULL });
       if (slot.handler->m_units_subscribed) {
         unsigned long bit = 1ul << slot.handler->m_modifier;
         bool addJob = (bit & mask_all) != 0;
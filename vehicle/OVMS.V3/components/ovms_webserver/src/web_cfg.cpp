@@ -45,6 +45,7 @@ static const char *TAG = "webserver";
 #include "ovms_housekeeping.h"
 #include "ovms_peripherals.h"
 #include "ovms_version.h"
+#include "ovms_status.h"
 
 #ifdef CONFIG_OVMS_COMP_OTA
 #include "ovms_ota.h"
@@ -147,10 +148,10 @@ void OvmsWebServer::HandleStatus(PageEntry_t& p, PageContext_t& c)
     "<div class=\"col-sm-6 col-lg-4\">");
 
   c.panel_start("primary", "Vehicle");
-  output = ExecuteCommand("stat");
-  c.printf("<samp class=\"monitor\" id=\"vehicle-status\" data-updcmd=\"stat\" data-events=\"vehicle.charge\">%s</samp>", _html(output));
-  output = ExecuteCommand("location status");
-  c.printf("<samp class=\"monitor\" data-updcmd=\"location status\" data-events=\"gps.lock|gps.sq|location\">%s</samp>", _html(output));
+  output = StatusText("stat", "stat");
+  c.printf("<samp class=\"monitor\" id=\"vehicle-status\" data-updstatus=\"stat\" data-events=\"vehicle.charge\">%s</samp>", _html(output));
+  output = StatusText("location", "location status");
+  c.printf("<samp class=\"monitor\" data-updstatus=\"location\" data-events=\"gps.lock|gps.sq|location\">%s</samp>", _html(output));
   c.panel_end(
     "<ul class=\"list-inline\">"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" data-target=\"#vehicle-cmdres\" data-cmd=\"charge start\">Start charge</button></li>"
@@ -163,12 +164,12 @@ void OvmsWebServer::HandleStatus(PageEntry_t& p, PageContext_t& c)
     "<div class=\"col-sm-6 col-lg-4\">");
 
   c.panel_start("primary", "Server");
-  output = ExecuteCommand("server v2 status");
+  output = StatusText("server.v2", "server v2 status");
   if (!startsWith(output, "Unrecognised"))
-    c.printf("<samp class=\"monitor\" id=\"server-v2\" data-updcmd=\"server v2 status\" data-events=\"server.v2\">%s</samp>", _html(output));
-  output = ExecuteCommand("server v3 status");
+    c.printf("<samp class=\"monitor\" id=\"server-v2\" data-updstatus=\"server.v2\" data-events=\"server.v2\">%s</samp>", _html(output));
+  output = StatusText("server.v3", "server v3 status");
   if (!startsWith(output, "Unrecognised"))
-    c.printf("<samp class=\"monitor\" id=\"server-v3\" data-updcmd=\"server v3 status\" data-events=\"server.v3\">%s</samp>", _html(output));
+    c.printf("<samp class=\"monitor\" id=\"server-v3\" data-updstatus=\"server.v3\" data-events=\"server.v3\">%s</samp>", _html(output));
   c.panel_end(
     "<ul class=\"list-inline\">"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" data-target=\"#server-cmdres\" data-cmd=\"server v2 start\">Start V2</button></li>"
@@ -183,8 +184,8 @@ void OvmsWebServer::HandleStatus(PageEntry_t& p, PageContext_t& c)
     "<div class=\"col-sm-6 col-lg-4\">");
 
   c.panel_start("primary", "SD Card");
-  output = ExecuteCommand("sd status");
-  c.printf("<samp class=\"monitor\" data-updcmd=\"sd status\" data-events=\"^sd\\.\">%s</samp>", _html(output));
+  output = StatusText("sd", "sd status");
+  c.printf("<samp class=\"monitor\" data-updstatus=\"sd\" data-events=\"^sd\\.\">%s</samp>", _html(output));
   c.panel_end(
     "<ul class=\"list-inline\">"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" data-target=\"#sd-cmdres\" data-cmd=\"sd mount\">Mount</button></li>"
@@ -197,15 +198,18 @@ void OvmsWebServer::HandleStatus(PageEntry_t& p, PageContext_t& c)
     "<div class=\"col-sm-6 col-lg-4\">");
 
   c.panel_start("primary", "Module");
-  output = ExecuteCommand("boot status");
+  output = StatusText("boot", "boot status");
   c.printf("<samp id=\"boot-status-cmdres\">%s</samp>", _html(output));
   c.print("<hr>");
-  output = ExecuteCommand("ota status nocheck");
+  output = StatusText("ota", "ota status nocheck");
   c.printf("<samp>%s</samp>", _html(output));
   c.panel_end(
     "<ul class=\"list-inline\">"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" name=\"action\" value=\"reboot\">Reboot</button></li>"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" data-target=\"#boot-status-cmdres\" data-cmd=\"boot clear\nboot status\">Clear counters</button></li>"
+#ifdef CONFIG_OVMS_SYS_CRASHLOG
+      "<li><button type=\"button\" class=\"btn btn-default btn-sm\" data-target=\"#boot-status-cmdres\" data-cmd=\"module crashlog\">Crash log</button></li>"
+#endif
     "</ul>");
 
   c.print(
@@ -213,8 +217,8 @@ void OvmsWebServer::HandleStatus(PageEntry_t& p, PageContext_t& c)
     "<div class=\"col-sm-6 col-lg-4\">");
 
   c.panel_start("primary", "Network");
-  output = ExecuteCommand("network status");
-  c.printf("<samp class=\"monitor\" data-updcmd=\"network status\" data-events=\"^network\">%s</samp>", _html(output));
+  output = StatusText("network", "network status");
+  c.printf("<samp class=\"monitor\" data-updstatus=\"network\" data-events=\"^network\">%s</samp>", _html(output));
   c.panel_end(
     "<ul class=\"list-inline\">"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" name=\"action\" value=\"network restart\">Restart network</button></li>"
@@ -225,8 +229,8 @@ void OvmsWebServer::HandleStatus(PageEntry_t& p, PageContext_t& c)
     "<div class=\"col-sm-6 col-lg-4\">");
 
   c.panel_start("primary", "Wifi");
-  output = ExecuteCommand("wifi status");
-  c.printf("<samp class=\"monitor\" data-updcmd=\"wifi status\" data-events=\"\\.wifi\\.\">%s</samp>", _html(output));
+  output = StatusText("wifi", "wifi status");
+  c.printf("<samp class=\"monitor\" data-updstatus=\"wifi\" data-events=\"\\.wifi\\.\">%s</samp>", _html(output));
   c.panel_end(
     "<ul class=\"list-inline\">"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" name=\"action\" value=\"wifi reconnect\">Reconnect Wifi</button></li>"
@@ -237,8 +241,8 @@ void OvmsWebServer::HandleStatus(PageEntry_t& p, PageContext_t& c)
     "<div class=\"col-sm-6 col-lg-4\">");
 
   c.panel_start("primary", "Cellular Modem");
-  output = ExecuteCommand("cellular status");
-  c.printf("<samp class=\"monitor\" data-updcmd=\"cellular status\" data-events=\"\\.modem\\.\">%s</samp>", _html(output));
+  output = StatusText("cellular", "cellular status");
+  c.printf("<samp class=\"monitor\" data-updstatus=\"cellular\" data-events=\"\\.modem\\.\">%s</samp>", _html(output));
   c.panel_end(
     "<ul class=\"list-inline\">"
       "<li><button type=\"button\" class=\"btn btn-default btn-sm\" data-target=\"#modem-cmdres\" data-cmd=\"power cellular on\">Start modem</button></li>"
@@ -325,6 +329,16 @@ void OvmsWebServer::HandleCommand(PageEntry_t& p, PageContext_t& c)
 
   if (command.empty())
     c.done();
+  else if (type == "status") {
+    OvmsStatusSnapshot snap;
+    if (!MyStatus.Get(command.c_str(), snap))
+      c.printf("ERROR: no status provider '%s'\n", command.c_str());
+    else if (output == "json")
+      c.print(snap.json);
+    else
+      c.print(snap.text);
+    c.done();
+  }
   else
     new HttpCommandStream(c.nc, command, javascript);
 }
@@ -1565,6 +1579,7 @@ void OvmsWebServer::HandleCfgServerV3(PageEntry_t& p, PageContext_t& c)
   std::string server, user, password, port, topic_prefix;
   std::string updatetime_connected, updatetime_idle, updatetime_on, updatetime_charging, updatetime_awake, updatetime_sendall;
   bool tls;
+  bool metrics_batch, metrics_batch_deflate;
 
   if (c.method == "POST") {
     // process form submission:
@@ -1580,6 +1595,8 @@ void OvmsWebServer::HandleCfgServerV3(PageEntry_t& p, PageContext_t& c)
     updatetime_charging = c.getvar("updatetime_charging");
     updatetime_awake = c.getvar("updatetime_awake");
     updatetime_sendall = c.getvar("updatetime_sendall");
+    metrics_batch = (c.getvar("metrics_batch") == "yes");
+    metrics_batch_deflate = (c.getvar("metrics_batch_deflate") == "yes");
 
     // validate:
     if (port != "") {
@@ -1646,6 +1663,8 @@ void OvmsWebServer::HandleCfgServerV3(PageEntry_t& p, PageContext_t& c)
         MyConfig.DeleteInstance("server.v3", "updatetime.sendall");
       else
         MyConfig.SetParamValue("server.v3", "updatetime.sendall", updatetime_sendall);
+      MyConfig.SetParamValueBool("server.v3", "metrics.batch", metrics_batch);
+      MyConfig.SetParamValueBool("server.v3", "metrics.batch.deflate", metrics_batch_deflate);
 
       c.head(200);
       c.alert("success", "<p class=\"lead\">Server V3 (MQTT) connection configured.</p>");
@@ -1673,6 +1692,8 @@ void OvmsWebServer::HandleCfgServerV3(PageEntry_t& p, PageContext_t& c)
     updatetime_charging = MyConfig.GetParamValue("server.v3", "updatetime.charging");
     updatetime_awake = MyConfig.GetParamValue("server.v3", "updatetime.awake");
     updatetime_sendall = MyConfig.GetParamValue("server.v3", "updatetime.sendall");
+    metrics_batch = MyConfig.GetParamValueBool("server.v3", "metrics.batch", false);
+    metrics_batch_deflate = MyConfig.GetParamValueBool("server.v3", "metrics.batch.deflate", false);
 
     // generate form:
     c.head(200);
@@ -1713,6 +1734,16 @@ void OvmsWebServer::HandleCfgServerV3(PageEntry_t& p, PageContext_t& c)
     "optional, in seconds, only used if set");
   c.fieldset_end();
 
+  c.fieldset_start("Metrics transmission");
+  c.input_checkbox("Batch mode", "metrics_batch", metrics_batch,
+    "<p>Send modified metrics as a single JSON object per update on topic <code>…/metrics</code>"
+    " instead of one retained message per metric. Note: your MQTT clients need to support this.</p>");
+#ifdef CONFIG_OVMS_SC_ZIP
+  c.input_checkbox("Compress batches", "metrics_batch_deflate", metrics_batch_deflate,
+    "<p>Send batches zlib compressed on topic <code>…/metrics/z</code>.</p>");
+#endif
+  c.fieldset_end();
+
   c.hr();
   c.input_button("default", "Save");
   c.form_end();
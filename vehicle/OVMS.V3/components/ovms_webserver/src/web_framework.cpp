@@ -186,6 +186,53 @@ void PageContext::head(int code, const char* headers /*=NULL*/) {
   mg_send_head(nc, code, -1, headers);
 }
 
+/**
+ * not_modified: conditional GET, send "304 Not Modified" if the client
+ *  validator (If-None-Match) matches etag. Returns true if done.
+ *  size: content size for the statistics
+ */
+static bool etag_match(const mg_str* list, const char* etag)
+{
+  size_t elen = strlen(etag);
+  const char *p = list->p, *end = list->p + list->len;
+  while (p < end) {
+    while (p < end && (*p == ' ' || *p == ','))
+      p++;
+    if (p < end && *p == '*')
+      return true;
+    if (end - p >= 2 && p[0] == 'W' && p[1] == '/')
+      p += 2;
+    const char* q = p;
+    while (q < end && *q != ',')
+      q++;
+    size_t len = q - p;
+    while (len > 0 && p[len-1] == ' ')
+      len--;
+    if (len == elen && memcmp(p, etag, elen) == 0)
+      return true;
+    p = q;
+  }
+  return false;
+}
+
+bool PageContext::not_modified(const char* etag, const char* cachecontrol, size_t size) {
+  struct mg_str* inm = mg_get_http_header(hm, "If-None-Match");
+  if (!inm || !etag_match(inm, etag)) {
+    MyWebServer.m_cache_sent++;
+    MyWebServer.m_cache_sent_bytes += size;
+    return false;
+  }
+  mg_send_response_line(nc, 304, NULL);
+  mg_printf(nc,
+    "Etag: %s\r\n"
+    "Cache-Control: %s\r\n"
+    "\r\n"
+    , etag, cachecontrol);
+  MyWebServer.m_cache_notmod++;
+  MyWebServer.m_cache_saved_bytes += size;
+  return true;
+}
+
 void PageContext::print(const std::string text) {
   mg_send_http_chunk(nc, text.data(), text.size());
 }
@@ -835,10 +882,20 @@ void OvmsWebServer::HandleAsset(PageEntry_t& p, PageContext_t& c)
     return;
   }
 
+  // The asset build time & size identify the content. Versioned URLs (framework
+  // references "?v=<mtime>") never change their content, so can be cached
+  // permanently, other requests need to revalidate:
   char etag[50], current_time[50], last_modified[50];
+  snprintf(etag, sizeof(etag), "\"%lx.%" PRId64 "\"", (unsigned long) mtime, (int64_t) size);
+  std::string version = c.getvar("v");
+  const char* cachecontrol = (!version.empty() && strtoul(version.c_str(), NULL, 10) == (unsigned long) mtime)
+    ? "public, max-age=31536000, immutable"
+    : "no-cache";
+  if (c.not_modified(etag, cachecontrol, size))
+    return;
+
   time_t t = (time_t) mg_time();
   struct tm timeinfo;
-  snprintf(etag, sizeof(etag), "\"%lx.%" PRId64 "\"", (unsigned long) mtime, (int64_t) size);
   strftime(current_time, sizeof(current_time), "%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&t, &timeinfo));
   strftime(last_modified, sizeof(last_modified), "%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&mtime, &timeinfo));
 
@@ -850,12 +907,14 @@ void OvmsWebServer::HandleAsset(PageEntry_t& p, PageContext_t& c)
     "%s"
     "Transfer-Encoding: chunked\r\n"
     "Etag: %s\r\n"
+    "Cache-Control: %s\r\n"
     "\r\n"
     , current_time
     , last_modified
     , type
     , gzip_encoded ? "Content-Encoding: gzip\r\n" : ""
-    , etag);
+    , etag
+    , cachecontrol);
 
   // start chunked transfer:
   new HttpDataSender(c.nc, data, size);
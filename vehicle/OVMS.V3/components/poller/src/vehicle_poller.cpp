@@ -1256,6 +1256,7 @@ OvmsPollers::poller_key_st::poller_key_st( const OvmsPoller::poll_queue_entry_t
 
 void OvmsPollers::PollerTask()
   {
+  OvmsHeapTag heaptag(HEAPTAG_POLLER);
   OvmsPoller::poll_queue_entry_t entry;
   while (true)
     {
@@ -43,6 +43,8 @@ static const char *TAG = "sdcard";
 #include "ovms_peripherals.h"
 #include "ovms_events.h"
 #include "ovms_boot.h"
+#include "ovms_status.h"
+#include "ovms_utils.h"
 
 static int insertcount = 0;
 static int mountcount = 0;
@@ -366,6 +368,33 @@ void sdcard_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc
     }
   }
 
+static void sdcard_status_json(std::string& json)
+  {
+  sdcard* sd = MyPeripherals->m_sdcard;
+  char buf[100];
+  snprintf(buf, sizeof(buf), "{\"inserted\":%s,\"mounted\":%s,\"available\":%s",
+    sd->isinserted() ? "true" : "false",
+    sd->ismounted() ? "true" : "false",
+    sd->isavailable() ? "true" : "false");
+  json = buf;
+  if (sd->ismounted())
+    {
+    FATFS *fs;
+    DWORD fre_clust;
+    json += ",\"name\":\"";
+    json += json_encode(std::string(sd->m_card->cid.name));
+    json += "\"";
+    if (f_getfree("1:", &fre_clust, &fs) == FR_OK)
+      {
+      snprintf(buf, sizeof(buf), ",\"size_mb\":%llu,\"free_mb\":%llu",
+        ((uint64_t) (fs->n_fatent - 2) * fs->csize) * sd->m_card->csd.sector_size / (1024 * 1024),
+        ((uint64_t) fre_clust * fs->csize) * sd->m_card->csd.sector_size / (1024 * 1024));
+      json += buf;
+      }
+    }
+  json += "}";
+  }
+
 class SDCardInit
   {
   public: SDCardInit();
@@ -381,4 +410,9 @@ SDCardInit::SDCardInit()
   cmd_sd->RegisterCommand("mount","Mount SD CARD",sdcard_mount);
   cmd_sd->RegisterCommand("unmount","Unmount SD CARD",sdcard_unmount,"[<maxwait_seconds>]",0,1);
   cmd_sd->RegisterCommand("status","Show SD CARD status",sdcard_status);
+  MyStatus.Register("sd", TAG, 30000, [](StringWriter& text, std::string& json)
+    {
+    sdcard_status(COMMAND_RESULT_NORMAL, &text, NULL, 0, NULL);
+    sdcard_status_json(json);
+    }, "sd.");
   }
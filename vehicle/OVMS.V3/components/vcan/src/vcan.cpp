@@ -0,0 +1,1050 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "vcan";
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <algorithm>
+#include "esp_timer.h"
+#include "vcan.h"
+#include "ovms_config.h"
+#include "ovms_events.h"
+#include "ovms_utils.h"
+
+#define VCAN_BATCH                128     // max frames per segment & round
+
+vcanmgr MyVCan __attribute__ ((init_priority (4590)));
+
+static const char* const vcan_names[4] = { "can1", "can2", "can3", "can4" };
+
+
+////////////////////////////////////////////////////////////////////////
+// Shell commands
+////////////////////////////////////////////////////////////////////////
+
+static vcan* vcan_find(OvmsWriter* writer, const char* name)
+  {
+  vcan* bus = MyVCan.Find(name);
+  if (!bus)
+    writer->printf("Error: %s is not a virtual CAN bus\n", name);
+  return bus;
+  }
+
+static void vcan_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyVCan.Status(verbosity, writer);
+  }
+
+static void vcan_create(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = MyVCan.Create(argv[0]);
+  if (bus)
+    writer->printf("Virtual CAN bus %s created\n", bus->GetName());
+  else
+    writer->printf("Error: cannot create %s (name invalid or in use)\n", argv[0]);
+  }
+
+static void vcan_connect(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* a = vcan_find(writer, argv[0]);
+  vcan* b = vcan_find(writer, argv[1]);
+  if (!a || !b) return;
+  MyVCan.Connect(a, b);
+  writer->printf("%s and %s connected\n", a->GetName(), b->GetName());
+  }
+
+static void vcan_disconnect(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+  MyVCan.Disconnect(bus);
+  writer->printf("%s disconnected\n", bus->GetName());
+  }
+
+static void vcan_loopback(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+  bus->m_loopback = (strcmp(argv[1], "on") == 0);
+  writer->printf("%s loopback %s\n", bus->GetName(), bus->m_loopback ? "on" : "off");
+  }
+
+static void vcan_timing(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+  if (strcmp(argv[1], "fast") != 0 && strcmp(argv[1], "realtime") != 0)
+    {
+    cmd->PutUsage(writer);
+    return;
+    }
+  OvmsRecMutexLock lock(&MyVCan.m_mutex);
+  vcan_segment* seg = bus->m_segment;
+  bool fast = (strcmp(argv[1], "fast") == 0);
+  if (fast != seg->m_fast)
+    {
+    // restart segment time:
+    seg->m_fast = fast;
+    seg->m_time = fast ? 0 : esp_timer_get_time();
+    for (vcan* m : seg->m_members)
+      {
+      for (auto& p : m->m_txfifo) p.queued = seg->m_time;
+      for (auto& g : m->m_gen) g.due = seg->m_time;
+      }
+    for (auto& kv : seg->m_remote) kv.second.queued = seg->m_time;
+    seg->ClearStats();
+    }
+  MyVCan.Wakeup();
+  writer->printf("%s segment timing: %s\n", bus->GetName(), fast ? "fast" : "realtime");
+  }
+
+static void vcan_fault_set(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+  int error = atoi(argv[1]), drop = atoi(argv[2]);
+  if (error < 0 || error > 1000 || drop < 0 || drop > 1000)
+    {
+    writer->puts("Error: probabilities must be given in permille (0-1000)");
+    return;
+    }
+  OvmsRecMutexLock lock(&MyVCan.m_mutex);
+  bus->m_fault_error = error;
+  bus->m_fault_drop = drop;
+  if (argc > 3)
+    {
+    bus->m_seed = strtoul(argv[3], NULL, 0);
+    if (bus->m_seed == 0) bus->m_seed = 1;
+    bus->m_rng = bus->m_seed;
+    }
+  writer->printf("%s faults: error frames %d‰, dropped frames %d‰, seed %" PRIu32 "\n",
+    bus->GetName(), error, drop, bus->m_seed);
+  }
+
+static void vcan_fault_busoff(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+  MyVCan.BusOff(bus);
+  writer->printf("%s is bus-off\n", bus->GetName());
+  }
+
+static void vcan_fault_recover(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+  OvmsRecMutexLock lock(&MyVCan.m_mutex);
+  bus->m_busoff = false;
+  bus->m_status.errors_tx = 0;
+  bus->m_status.errors_rx = 0;
+  bus->m_status.error_flags = 0;
+  writer->printf("%s recovered\n", bus->GetName());
+  }
+
+static void vcan_gen_start(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+
+  std::vector<vcan_genprofile_t> profiles;
+  uint32_t limit = 0;
+  bool tx = false;
+  for (int i = 1; i < argc; i++)
+    {
+    const char* arg = argv[i];
+    if (strcmp(arg, "-t") == 0)
+      {
+      tx = true;
+      continue;
+      }
+    if (strncmp(arg, "-n", 2) == 0)
+      {
+      limit = strtoul(arg+2, NULL, 10);
+      continue;
+      }
+    // <id>:<rate>[:<dlc>]
+    char* ep;
+    vcan_genprofile_t prof = {};
+    prof.id = strtoul(arg, &ep, 16);
+    float rate = (*ep == ':') ? strtof(ep+1, &ep) : 0;
+    int dlc = (*ep == ':') ? strtol(ep+1, &ep, 10) : 8;
+    if (*ep || rate <= 0 || rate > 100000 || dlc < 0 || dlc > 8 || prof.id > 0x1fffffff)
+      {
+      writer->printf("Error: invalid profile '%s'\n", arg);
+      cmd->PutUsage(writer);
+      return;
+      }
+    prof.ext = (prof.id > 0x7ff);
+    prof.dlc = dlc;
+    prof.interval = 1000000 / rate;
+    profiles.push_back(prof);
+    }
+  if (profiles.empty())
+    {
+    cmd->PutUsage(writer);
+    return;
+    }
+
+  MyVCan.GenStart(bus, profiles, limit, tx);
+  writer->printf("%s traffic generator started: %d profile(s)", bus->GetName(), (int)profiles.size());
+  if (limit)
+    writer->printf(", %" PRIu32 " frames", limit);
+  writer->puts(tx ? ", TX path" : "");
+  }
+
+static void vcan_gen_stop(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  vcan* bus = vcan_find(writer, argv[0]);
+  if (!bus) return;
+  MyVCan.GenStop(bus);
+  writer->printf("%s traffic generator stopped: %" PRIu32 " frames sent, %" PRIu32 " overruns\n",
+    bus->GetName(), bus->m_gen_sent, bus->m_gen_overruns);
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// vcan_segment: group of connected buses
+////////////////////////////////////////////////////////////////////////
+
+vcan_segment::vcan_segment()
+  {
+  m_fast = false;
+  m_time = esp_timer_get_time();
+  m_seq = 0;
+  ClearStats();
+  }
+
+void vcan_segment::ClearStats()
+  {
+  m_stats_start = m_time;
+  m_busy = 0;
+  m_frames = 0;
+  m_errorframes = 0;
+  m_arb_count = 0;
+  m_arb_sum = 0;
+  m_arb_max = 0;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// vcan: virtual CAN bus driver
+////////////////////////////////////////////////////////////////////////
+
+vcan::vcan(const char* name)
+  : canbus(name)
+  {
+  m_segment = NULL;
+  m_loopback = false;
+  m_busoff = false;
+  m_fault_error = 0;
+  m_fault_drop = 0;
+  m_seed = 1;
+  m_rng = m_seed;
+  m_dropped = 0;
+  m_gen_limit = 0;
+  m_gen_sent = 0;
+  m_gen_overruns = 0;
+  m_gen_tx = false;
+  m_mode = CAN_MODE_OFF;
+  pcp::SetPowerMode(Off);
+  }
+
+vcan::~vcan()
+  {
+  }
+
+esp_err_t vcan::Start(CAN_mode_t mode, CAN_speed_t speed)
+  {
+  OvmsRecMutexLock lock(&MyVCan.m_mutex);
+  MyVCan.Purge(this);
+  m_mode = mode;
+  m_speed = speed;
+  ClearStatus();
+  pcp::SetPowerMode(On);
+  return ESP_OK;
+  }
+
+esp_err_t vcan::Stop()
+  {
+  canbus::Stop();
+  OvmsRecMutexLock lock(&MyVCan.m_mutex);
+  MyVCan.Purge(this);
+  m_mode = CAN_MODE_OFF;
+  pcp::SetPowerMode(Off);
+  return ESP_OK;
+  }
+
+void vcan::ClearStatus()
+  {
+  canbus::ClearStatus();
+  m_busoff = false;
+  m_dropped = 0;
+  m_rng = m_seed;
+  }
+
+/**
+ * Write: queue a frame for transmission (API)
+ *  The frame is queued in the bus TX FIFO and transferred by the simulation
+ *  task; only the FIFO head takes part in the arbitration (like a single
+ *  hardware TX buffer). Returns ESP_OK, ESP_QUEUED or ESP_FAIL.
+ */
+esp_err_t vcan::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/)
+  {
+  if (m_powermode != On || m_mode != CAN_MODE_ACTIVE)
+    {
+    ESP_LOGW(TAG,"Cannot write %s when not in ACTIVE mode",m_name);
+    return ESP_FAIL;
+    }
+  if (m_busoff)
+    {
+    m_status.tx_fails++;
+    LogFrame(CAN_LogFrame_TX_Fail, p_frame);
+    return ESP_FAIL;
+    }
+
+  TickType_t start = xTaskGetTickCount();
+  MyVCan.m_mutex.Lock();
+  while (m_txfifo.size() >= CONFIG_OVMS_HW_CAN_TX_QUEUE_SIZE)
+    {
+    MyVCan.m_mutex.Unlock();
+    if (xTaskGetTickCount() - start >= maxqueuewait)
+      {
+      m_status.txbuf_overflow++;
+      LogFrame(CAN_LogFrame_TX_Fail, p_frame);
+      return ESP_FAIL;
+      }
+    vTaskDelay(1);
+    MyVCan.m_mutex.Lock();
+    }
+
+  vcan_pending_t pending;
+  pending.sender = this;
+  pending.frame = *p_frame;
+  pending.frame.origin = this;
+  bool queued = !m_txfifo.empty();
+  MyVCan.Submit(this, pending);
+  MyVCan.m_mutex.Unlock();
+
+  if (queued)
+    {
+    m_status.txbuf_delay++;
+    LogFrame(CAN_LogFrame_TX_Queue, p_frame);
+    return ESP_QUEUED;
+    }
+  canbus::Write(p_frame, maxqueuewait);
+  return ESP_OK;
+  }
+
+/**
+ * FrameBits: number of bits on the wire, including stuff bits & interframe space
+ */
+uint32_t vcan::FrameBits(const CAN_frame_t* p_frame)
+  {
+  uint8_t bits[128];
+  int n = 0;
+  auto put = [&bits, &n](uint32_t val, int cnt)
+    {
+    while (cnt--)
+      bits[n++] = (val >> cnt) & 1;
+    };
+
+  int dlc = p_frame->FIR.B.DLC;
+  int len = (p_frame->FIR.B.RTR == CAN_RTR) ? 0 : std::min(dlc, 8);
+  put(0, 1);                                      // SOF
+  if (p_frame->FIR.B.FF == CAN_frame_std)
+    {
+    put(p_frame->MsgID & 0x7ff, 11);
+    put(p_frame->FIR.B.RTR, 1);
+    put(0, 2);                                    // IDE, r0
+    }
+  else
+    {
+    put((p_frame->MsgID >> 18) & 0x7ff, 11);
+    put(3, 2);                                    // SRR, IDE
+    put(p_frame->MsgID & 0x3ffff, 18);
+    put(p_frame->FIR.B.RTR, 1);
+    put(0, 2);                                    // r1, r0
+    }
+  put(dlc, 4);
+  for (int i = 0; i < len; i++)
+    put(p_frame->data.u8[i], 8);
+
+  // CRC-15:
+  uint16_t crc = 0;
+  for (int i = 0; i < n; i++)
+    {
+    bool crcnxt = bits[i] ^ ((crc >> 14) & 1);
+    crc = (crc << 1) & 0x7fff;
+    if (crcnxt) crc ^= 0x4599;
+    }
+  put(crc, 15);
+
+  // Stuff bits (SOF … CRC):
+  int stuff = 0, run = 1;
+  uint8_t last = bits[0];
+  for (int i = 1; i < n; i++)
+    {
+    if (bits[i] == last)
+      run++;
+    else
+      {
+      last = bits[i];
+      run = 1;
+      }
+    if (run == 5)
+      {
+      stuff++;
+      last ^= 1;
+      run = 1;
+      }
+    }
+
+  // + CRC delimiter, ACK slot & delimiter, EOF, IFS:
+  return n + stuff + 1 + 2 + 7 + 3;
+  }
+
+/**
+ * ArbitrationKey: frame priority on the bus, lower value wins
+ *  Bit layout follows the arbitration field: base ID, RTR/SRR, IDE,
+ *  extended ID, RTR.
+ */
+uint32_t vcan::ArbitrationKey(const CAN_frame_t* p_frame)
+  {
+  uint32_t rtr = (p_frame->FIR.B.RTR == CAN_RTR) ? 1 : 0;
+  if (p_frame->FIR.B.FF == CAN_frame_std)
+    return ((p_frame->MsgID & 0x7ff) << 21) | (rtr << 20);
+  else
+    return (((p_frame->MsgID >> 18) & 0x7ff) << 21) | (1 << 20) | (1 << 19)
+      | ((p_frame->MsgID & 0x3ffff) << 1) | rtr;
+  }
+
+/**
+ * Random: xorshift32 PRNG for fault injection, reproducible by seed
+ */
+uint32_t vcan::Random()
+  {
+  m_rng ^= m_rng << 13;
+  m_rng ^= m_rng >> 17;
+  m_rng ^= m_rng << 5;
+  return m_rng;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// vcanmgr: virtual bus registry & simulation task
+////////////////////////////////////////////////////////////////////////
+
+vcanmgr::vcanmgr()
+  {
+  ESP_LOGI(TAG, "Initialising virtual CAN (4590)");
+
+  m_task = NULL;
+
+  OvmsCommand* cmd_vcan = MyCommandApp.RegisterCommand("vcan", "Virtual CAN framework", vcan_status, "", 0, 0, false);
+  cmd_vcan->RegisterCommand("status", "Show virtual CAN status", vcan_status);
+  cmd_vcan->RegisterCommand("create", "Create virtual CAN bus", vcan_create,
+    "<bus>\n"
+    "<bus> = can1 … can4, must not be in use by a hardware bus.\n"
+    "Start the bus as usual using 'can <bus> start …'.", 1, 1);
+  cmd_vcan->RegisterCommand("connect", "Connect virtual CAN buses to a segment", vcan_connect, "<bus> <bus>", 2, 2);
+  cmd_vcan->RegisterCommand("disconnect", "Detach virtual CAN bus from its segment", vcan_disconnect, "<bus>", 1, 1);
+  cmd_vcan->RegisterCommand("loopback", "Receive own TX frames", vcan_loopback, "<bus> <on|off>", 2, 2);
+  cmd_vcan->RegisterCommand("timing", "Set segment timing mode", vcan_timing,
+    "<bus> <realtime|fast>\n"
+    "realtime = segment time follows the system clock\n"
+    "fast = run as fast as the CAN framework consumes the frames", 2, 2);
+  OvmsCommand* cmd_fault = cmd_vcan->RegisterCommand("fault", "Virtual CAN fault injection");
+  cmd_fault->RegisterCommand("set", "Set fault probabilities", vcan_fault_set,
+    "<bus> <error> <drop> [<seed>]\n"
+    "<error> = probability of <bus> destroying a frame by an error frame [‰]\n"
+    "<drop> = probability of <bus> missing a frame [‰]\n"
+    "<seed> = PRNG seed for reproducible fault sequences", 3, 4);
+  cmd_fault->RegisterCommand("busoff", "Force bus-off state", vcan_fault_busoff, "<bus>", 1, 1);
+  cmd_fault->RegisterCommand("recover", "Recover from bus-off, clear error counters", vcan_fault_recover, "<bus>", 1, 1);
+  OvmsCommand* cmd_gen = cmd_vcan->RegisterCommand("gen", "Virtual CAN traffic generator");
+  cmd_gen->RegisterCommand("start", "Start traffic generator", vcan_gen_start,
+    "<bus> [-t] [-n<count>] <id>:<rate>[:<dlc>] […]\n"
+    "Simulates remote nodes sending frames with hex <id> at <rate> Hz on the segment of <bus>.\n"
+    "IDs > 7ff are sent as extended frames, <dlc> defaults to 8.\n"
+    "The payload is a little endian frame counter per profile.\n"
+    "-t = send the frames via the TX path of <bus> instead\n"
+    "-n = stop after <count> frames", 2, 20);
+  cmd_gen->RegisterCommand("stop", "Stop traffic generator", vcan_gen_stop, "<bus>", 1, 1);
+
+  MyConfig.RegisterParam("vcan", "Virtual CAN configuration", true, true);
+
+#ifdef bind
+  #undef bind  // Kludgy, but works
+#endif
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  MyEvents.RegisterEvent(TAG, "config.mounted", std::bind(&vcanmgr::ConfigMounted, this, _1, _2));
+  }
+
+vcanmgr::~vcanmgr()
+  {
+  }
+
+/**
+ * ConfigMounted: create the virtual buses configured in vcan/buses
+ */
+void vcanmgr::ConfigMounted(std::string event, void* data)
+  {
+  std::string buses = MyConfig.GetParamValue("vcan", "buses");
+  size_t pos = 0;
+  while ((pos = buses.find_first_not_of(" ,", pos)) != std::string::npos)
+    {
+    size_t end = buses.find_first_of(" ,", pos);
+    std::string name = buses.substr(pos, end == std::string::npos ? end : end - pos);
+    if (!Find(name.c_str()) && !Create(name.c_str()))
+      ESP_LOGE(TAG, "Cannot create virtual bus '%s' (name invalid or in use)", name.c_str());
+    pos = end;
+    }
+  }
+
+vcan* vcanmgr::Create(const char* name)
+  {
+  const char* busname = NULL;
+  for (int i = 0; i < 4; i++)
+    {
+    if (strcmp(name, vcan_names[i]) == 0)
+      busname = vcan_names[i];
+    }
+  if (!busname || MyPcpApp.FindDeviceByName(busname))
+    return NULL;
+
+  OvmsRecMutexLock lock(&m_mutex);
+  vcan* bus = new vcan(busname);
+  vcan_segment* seg = new vcan_segment();
+  seg->m_members.push_back(bus);
+  bus->m_segment = seg;
+  m_segments.push_back(seg);
+  m_buses.push_back(bus);
+
+  if (!m_task)
+    xTaskCreatePinnedToCore(Task, "OVMS vCAN", 4096, (void*)this, 5, &m_task, CORE(1));
+
+  ESP_LOGI(TAG, "Virtual CAN bus %s created", busname);
+  return bus;
+  }
+
+vcan* vcanmgr::Find(const char* name)
+  {
+  for (vcan* bus : m_buses)
+    {
+    if (strcmp(bus->GetName(), name) == 0)
+      return bus;
+    }
+  return NULL;
+  }
+
+void vcanmgr::RemoveSegment(vcan_segment* seg)
+  {
+  auto it = std::find(m_segments.begin(), m_segments.end(), seg);
+  if (it != m_segments.end())
+    m_segments.erase(it);
+  delete seg;
+  }
+
+/**
+ * Connect: merge the segments of two buses
+ */
+void vcanmgr::Connect(vcan* a, vcan* b)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  vcan_segment* seg = a->m_segment;
+  vcan_segment* old = b->m_segment;
+  if (seg == old)
+    return;
+  for (vcan* bus : old->m_members)
+    {
+    bus->m_segment = seg;
+    seg->m_members.push_back(bus);
+    for (auto& p : bus->m_txfifo)
+      p.queued = Now(seg);
+    for (auto& g : bus->m_gen)
+      g.due = Now(seg);
+    }
+  for (auto& kv : old->m_remote)
+    {
+    vcan_pending_t p = kv.second;
+    p.order = (p.order & 0xffffffff00000000ULL) | seg->m_seq++;
+    p.queued = Now(seg);
+    seg->m_remote[p.order] = p;
+    }
+  RemoveSegment(old);
+  Wakeup();
+  }
+
+/**
+ * Disconnect: move a bus into a segment of its own
+ */
+void vcanmgr::Disconnect(vcan* bus)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  vcan_segment* old = bus->m_segment;
+  if (old->m_members.size() < 2)
+    return;
+  old->m_members.erase(std::find(old->m_members.begin(), old->m_members.end(), bus));
+  vcan_segment* seg = new vcan_segment();
+  seg->m_fast = old->m_fast;
+  seg->m_time = old->m_time;
+  seg->ClearStats();
+  seg->m_members.push_back(bus);
+  bus->m_segment = seg;
+  m_segments.push_back(seg);
+  Wakeup();
+  }
+
+int64_t vcanmgr::Now(vcan_segment* seg)
+  {
+  return seg->m_fast ? seg->m_time : esp_timer_get_time();
+  }
+
+/**
+ * Submit: add a frame to the TX FIFO of a bus (call with mutex locked)
+ */
+void vcanmgr::Submit(vcan* bus, vcan_pending_t& pending)
+  {
+  vcan_segment* seg = bus->m_segment;
+  pending.queued = Now(seg);
+  pending.order = ((uint64_t)vcan::ArbitrationKey(&pending.frame) << 32) | seg->m_seq++;
+  bus->m_txfifo.push_back(pending);
+  Wakeup();
+  }
+
+/**
+ * Purge: discard the TX FIFO of a bus (call with mutex locked)
+ */
+void vcanmgr::Purge(vcan* bus)
+  {
+  bus->m_txfifo.clear();
+  }
+
+void vcanmgr::Wakeup()
+  {
+  if (m_task)
+    xTaskNotifyGive(m_task);
+  }
+
+/**
+ * BusOff: force bus into bus-off state, fail all pending TX frames
+ */
+void vcanmgr::BusOff(vcan* bus)
+  {
+  std::vector<CAN_queue_msg_t> out;
+  m_mutex.Lock();
+  bus->m_status.errors_tx = 256;
+  TxError(bus, out);
+  m_mutex.Unlock();
+  Post(out, false);
+  }
+
+/**
+ * TxError: transmission of FIFO head destroyed, update TEC, enter bus-off
+ *  if the limit is exceeded (call with mutex locked)
+ */
+void vcanmgr::TxError(vcan* bus, std::vector<CAN_queue_msg_t>& out)
+  {
+  CAN_errorstate_t state = bus->GetErrorState();
+  bus->m_status.errors_tx = std::min(bus->m_status.errors_tx + 8, 256);
+  bus->m_status.error_flags |= VCAN_ERRFLAG_ERRORFRAME;
+  if (bus->m_status.errors_tx > 255 && !bus->m_busoff)
+    {
+    ESP_LOGW(TAG, "%s: bus-off", bus->GetName());
+    bus->m_busoff = true;
+    bus->m_status.error_flags |= VCAN_ERRFLAG_BUSOFF;
+    CAN_queue_msg_t msg;
+    msg.type = CAN_txfailedcallback;
+    for (auto& p : bus->m_txfifo)
+      {
+      msg.body.frame = p.frame;
+      msg.body.bus = bus;
+      out.push_back(msg);
+      }
+    bus->m_txfifo.clear();
+    }
+  if (bus->GetErrorState() != state)
+    {
+    CAN_queue_msg_t msg;
+    msg.type = CAN_logerror;
+    msg.body.bus = bus;
+    out.push_back(msg);
+    }
+  }
+
+void vcanmgr::GenStart(vcan* bus, std::vector<vcan_genprofile_t>& profiles, uint32_t limit, bool tx)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  int64_t now = Now(bus->m_segment);
+  for (auto& prof : profiles)
+    {
+    prof.due = now;
+    prof.sent = 0;
+    }
+  bus->m_gen = profiles;
+  bus->m_gen_limit = limit;
+  bus->m_gen_sent = 0;
+  bus->m_gen_overruns = 0;
+  bus->m_gen_tx = tx;
+  Wakeup();
+  }
+
+void vcanmgr::GenStop(vcan* bus)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  bus->m_gen.clear();
+  }
+
+/**
+ * Generate: produce generator frames due up to segment time <until>
+ */
+void vcanmgr::Generate(vcan_segment* seg, int64_t until)
+  {
+  for (vcan* bus : seg->m_members)
+    {
+    for (auto& prof : bus->m_gen)
+      {
+      // skip ahead after long pauses:
+      if (prof.due < until - 1000000)
+        {
+        bus->m_gen_overruns += (until - prof.due) / prof.interval;
+        prof.due = until;
+        }
+      while (prof.due <= until)
+        {
+        if (bus->m_gen_limit && bus->m_gen_sent >= bus->m_gen_limit)
+          break;
+        vcan_pending_t p;
+        memset(&p, 0, sizeof(p));
+        p.frame.origin = bus;
+        p.frame.FIR.B.FF = prof.ext ? CAN_frame_ext : CAN_frame_std;
+        p.frame.FIR.B.DLC = prof.dlc;
+        p.frame.MsgID = prof.id;
+        p.frame.data.u64 = prof.sent;
+        if (bus->m_gen_tx)
+          {
+          if (bus->m_mode != CAN_MODE_ACTIVE || bus->m_busoff
+              || bus->m_txfifo.size() >= CONFIG_OVMS_HW_CAN_TX_QUEUE_SIZE)
+            bus->m_gen_overruns++;
+          else
+            {
+            p.sender = bus;
+            Submit(bus, p);
+            }
+          }
+        else
+          {
+          if (seg->m_remote.size() >= VCAN_REMOTE_MAXPENDING)
+            bus->m_gen_overruns++;
+          else
+            {
+            p.sender = NULL;
+            p.queued = prof.due;
+            p.order = ((uint64_t)vcan::ArbitrationKey(&p.frame) << 32) | seg->m_seq++;
+            seg->m_remote[p.order] = p;
+            }
+          }
+        prof.due += prof.interval;
+        prof.sent++;
+        bus->m_gen_sent++;
+        }
+      }
+    if (bus->m_gen_limit && bus->m_gen_sent >= bus->m_gen_limit)
+      bus->m_gen.clear();
+    }
+  }
+
+/**
+ * Transfer: put a frame on the segment, apply faults, collect deliveries
+ *  Returns false if the frame was destroyed by an error frame.
+ */
+bool vcanmgr::Transfer(vcan_segment* seg, vcan_pending_t& p, int64_t start, std::vector<CAN_queue_msg_t>& out)
+  {
+  canbus* origin = p.frame.origin;
+  int bps = MAP_CAN_SPEED(origin->m_speed);
+  int64_t duration = (int64_t)vcan::FrameBits(&p.frame) * 1000000 / bps;
+  CAN_queue_msg_t msg;
+
+  // Error frame injection: any active receiver may destroy the frame
+  //  (all receivers roll their dice to keep the PRNG sequences stable)
+  bool error = false;
+  for (vcan* rx : seg->m_members)
+    {
+    if (rx->m_mode != CAN_MODE_OFF && rx->m_fault_error && (rx->Random() % 1000) < rx->m_fault_error)
+      error = true;
+    }
+  if (error)
+    {
+    duration = duration / 2 + (int64_t)VCAN_ERRORFRAME_BITS * 1000000 / bps;
+    seg->m_time = start + duration;
+    seg->m_busy += duration;
+    seg->m_errorframes++;
+    for (vcan* rx : seg->m_members)
+      {
+      if (rx == p.sender || rx->m_mode == CAN_MODE_OFF || rx->m_busoff)
+        continue;
+      CAN_errorstate_t state = rx->GetErrorState();
+      if (rx->m_status.errors_rx < 255)
+        rx->m_status.errors_rx++;
+      rx->m_status.error_flags |= VCAN_ERRFLAG_ERRORFRAME;
+      if (rx->GetErrorState() != state)
+        {
+        msg.type = CAN_logerror;
+        msg.body.bus = rx;
+        out.push_back(msg);
+        }
+      }
+    if (p.sender)
+      TxError(p.sender, out);
+    return false;
+    }
+
+  seg->m_time = start + duration;
+  seg->m_busy += duration;
+  seg->m_frames++;
+
+  if (p.sender)
+    {
+    if (p.sender->m_status.errors_tx > 0)
+      p.sender->m_status.errors_tx--;
+    msg.type = CAN_txcallback;
+    msg.body.frame = p.frame;
+    msg.body.bus = p.sender;
+    out.push_back(msg);
+    }
+
+  for (vcan* rx : seg->m_members)
+    {
+    if (rx->m_mode == CAN_MODE_OFF || rx->GetPowerMode() != On || rx->m_busoff)
+      continue;
+    if (rx == p.sender && !rx->m_loopback)
+      continue;
+    if (rx->m_status.errors_rx > 0)
+      rx->m_status.errors_rx--;
+    if (MAP_CAN_SPEED(rx->m_speed) != bps)
+      {
+      rx->m_status.invalid_rx++;
+      rx->m_status.error_flags |= VCAN_ERRFLAG_BITRATE;
+      continue;
+      }
+    if (rx->m_fault_drop && (rx->Random() % 1000) < rx->m_fault_drop)
+      {
+      rx->m_dropped++;
+      continue;
+      }
+    rx->m_status.interrupts++;
+    msg.type = CAN_frame;
+    msg.body.frame = p.frame;
+    msg.body.frame.origin = rx;
+    msg.body.frame.callback = NULL;
+    out.push_back(msg);
+    }
+  return true;
+  }
+
+/**
+ * Process: run the segment simulation up to the current time (call with mutex locked)
+ *  Returns the ticks to wait for the next segment event.
+ */
+TickType_t vcanmgr::Process(vcan_segment* seg, std::vector<CAN_queue_msg_t>& out)
+  {
+  // In realtime mode, frames may start up to one tick ahead of the clock,
+  //  so the bus can be saturated despite the tick granularity:
+  const int64_t lookahead = portTICK_PERIOD_MS * 1000;
+  int64_t now = Now(seg);
+
+  for (int cnt = 0; cnt < VCAN_BATCH; cnt++)
+    {
+    Generate(seg, seg->m_fast ? seg->m_time : now);
+
+    // Arbitration among the remote nodes & bus TX FIFO heads:
+    vcan_pending_t* winner = NULL;
+    if (!seg->m_remote.empty())
+      winner = &seg->m_remote.begin()->second;
+    for (vcan* bus : seg->m_members)
+      {
+      if (!bus->m_txfifo.empty() && (!winner || bus->m_txfifo.front().order < winner->order))
+        winner = &bus->m_txfifo.front();
+      }
+
+    if (!winner)
+      {
+      // Bus idle; in fast mode advance to the next generator frame:
+      if (!seg->m_fast)
+        break;
+      int64_t due = INT64_MAX;
+      for (vcan* bus : seg->m_members)
+        for (auto& prof : bus->m_gen)
+          due = std::min(due, prof.due);
+      if (due == INT64_MAX)
+        break;
+      seg->m_time = std::max(seg->m_time, due);
+      continue;
+      }
+
+    int64_t start = std::max(seg->m_time, winner->queued);
+    if (!seg->m_fast && start > now + lookahead)
+      break;
+
+    // Fast mode: throttle by the CAN framework queue capacity:
+    if (seg->m_fast &&
+        uxQueueSpacesAvailable(MyCan.m_rxqueue) < out.size() + seg->m_members.size() + 1)
+      return 1;
+
+    vcan_pending_t p = *winner;
+    if (Transfer(seg, p, start, out))
+      {
+      // Frame done, remove from source:
+      if (p.sender)
+        p.sender->m_txfifo.pop_front();
+      else
+        seg->m_remote.erase(p.order);
+      uint32_t delay = start - p.queued;
+      if (delay > 0)
+        {
+        seg->m_arb_count++;
+        seg->m_arb_sum += delay;
+        if (delay > seg->m_arb_max) seg->m_arb_max = delay;
+        }
+      }
+    }
+
+  // Calculate time to next event:
+  bool pending = !seg->m_remote.empty();
+  int64_t next = INT64_MAX;
+  for (vcan* bus : seg->m_members)
+    {
+    pending |= !bus->m_txfifo.empty();
+    for (auto& prof : bus->m_gen)
+      next = std::min(next, prof.due);
+    }
+  if (pending)
+    next = std::min(next, seg->m_time);
+  if (next == INT64_MAX)
+    return portMAX_DELAY;
+  if (seg->m_fast)
+    return 1;
+  int64_t ticks = (next - now) / lookahead;
+  return LIMIT_MAX(LIMIT_MIN(ticks, 1), 1000);
+  }
+
+/**
+ * Post: deliver collected messages to the CAN framework (call without mutex)
+ */
+void vcanmgr::Post(std::vector<CAN_queue_msg_t>& out, bool fast)
+  {
+  for (auto& msg : out)
+    {
+    if (msg.type == CAN_frame && !fast)
+      {
+      if (xQueueSend(MyCan.m_rxqueue, &msg, 0) != pdTRUE)
+        msg.body.frame.origin->m_status.rxbuf_overflow++;
+      }
+    else
+      {
+      xQueueSend(MyCan.m_rxqueue, &msg, portMAX_DELAY);
+      }
+    }
+  out.clear();
+  }
+
+void vcanmgr::Task(void *pvParameters)
+  {
+  vcanmgr* me = (vcanmgr*)pvParameters;
+  me->Run();
+  }
+
+void vcanmgr::Run()
+  {
+  std::vector<CAN_queue_msg_t> out;
+  while (true)
+    {
+    TickType_t wait = portMAX_DELAY;
+    bool fast = false;
+    m_mutex.Lock();
+    for (vcan_segment* seg : m_segments)
+      {
+      wait = std::min(wait, Process(seg, out));
+      fast |= seg->m_fast;
+      }
+    m_mutex.Unlock();
+    Post(out, fast);
+    ulTaskNotifyTake(pdTRUE, wait);
+    }
+  }
+
+void vcanmgr::Status(int verbosity, OvmsWriter* writer)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  if (m_segments.empty())
+    {
+    writer->puts("No virtual CAN buses, create by: vcan create <bus>");
+    return;
+    }
+  int segno = 0;
+  for (vcan_segment* seg : m_segments)
+    {
+    int64_t elapsed = Now(seg) - seg->m_stats_start;
+    writer->printf("Segment %d: %s timing, %.1f s, %" PRIu32 " frames, %" PRIu32 " error frames, load %.1f%%\n",
+      ++segno, seg->m_fast ? "fast" : "realtime", (double)elapsed / 1000000,
+      seg->m_frames, seg->m_errorframes,
+      elapsed > 0 ? (double)seg->m_busy * 100 / elapsed : 0.0);
+    writer->printf("  Arbitration: %" PRIu32 " frames delayed, avg %.0f us, max %" PRIu32 " us\n",
+      seg->m_arb_count, seg->m_arb_count ? (double)seg->m_arb_sum / seg->m_arb_count : 0.0,
+      seg->m_arb_max);
+    for (vcan* bus : seg->m_members)
+      {
+      writer->printf("  %s: %s/%d loopback %s, state %s%s, TX fifo %d, RX dropped %" PRIu32 "\n",
+        bus->GetName(),
+        (bus->m_mode==CAN_MODE_OFF) ? "Off" : ((bus->m_mode==CAN_MODE_LISTEN) ? "Listen" : "Active"),
+        MAP_CAN_SPEED(bus->m_speed), bus->m_loopback ? "on" : "off",
+        bus->GetErrorStateName(), bus->m_busoff ? " (bus-off)" : "",
+        (int)bus->m_txfifo.size(), bus->m_dropped);
+      if (bus->m_fault_error || bus->m_fault_drop)
+        writer->printf("    Faults: error frames %d‰, dropped frames %d‰, seed %" PRIu32 "\n",
+          bus->m_fault_error, bus->m_fault_drop, bus->m_seed);
+      if (!bus->m_gen.empty() || bus->m_gen_sent)
+        {
+        writer->printf("    Generator: %s, %" PRIu32 " frames sent, %" PRIu32 " overruns\n",
+          bus->m_gen.empty() ? "stopped" : "running", bus->m_gen_sent, bus->m_gen_overruns);
+        if (verbosity > COMMAND_RESULT_MINIMAL)
+          {
+          for (auto& prof : bus->m_gen)
+            writer->printf("      %" PRIx32 ": %.1f Hz, DLC %d, %" PRIu32 " frames\n",
+              prof.id, 1000000.0 / prof.interval, prof.dlc, prof.sent);
+          }
+        }
+      }
+    }
+  }
@@ -0,0 +1,198 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __VCAN_H__
+#define __VCAN_H__
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "can.h"
+#include "ovms_mutex.h"
+#include "ovms_command.h"
+
+/**
+ * vcan: virtual CAN bus driver
+ *
+ *  A vcan bus behaves like a hardware bus to the framework (vehicle modules,
+ *  pollers, loggers), but transfers frames on a simulated medium:
+ *    - Buses can be connected to form a segment; frames sent by one member
+ *      are received by all other members (and by the sender on loopback).
+ *    - Frame timing is derived from the bit rate and the actual frame bit
+ *      count (incl. stuff bits), arbitration follows the CAN priority rules
+ *      among the head frames of all senders.
+ *    - Faults can be injected per receiving bus: error frames (destroying
+ *      the frame, causing retransmission & error counter changes), dropped
+ *      frames and bus-off.
+ *    - A traffic generator simulates remote nodes sending ID/rate profiles.
+ *
+ *  Segment time is virtual: in "realtime" mode it follows the system clock,
+ *  in "fast" mode it only advances by the bus time of the frames transferred,
+ *  so the segment runs as fast as the framework can consume the frames.
+ *  Fault decisions use a seeded PRNG, so runs are reproducible.
+ */
+
+#define VCAN_ERRFLAG_ERRORFRAME   BIT(0)  // error frame sent/received
+#define VCAN_ERRFLAG_BUSOFF       BIT(1)  // bus-off state entered
+#define VCAN_ERRFLAG_BITRATE      BIT(2)  // frame received at a different bit rate
+
+#define VCAN_ERRORFRAME_BITS      23      // error flag + delimiter + intermission
+#define VCAN_REMOTE_MAXPENDING    64      // generator frames pending per segment
+
+class vcan;
+
+typedef struct
+  {
+  uint64_t order;                       // arbitration key << 32 | sequence
+  vcan* sender;                         // NULL = simulated remote node
+  int64_t queued;                       // segment time of submission [us]
+  CAN_frame_t frame;
+  } vcan_pending_t;
+
+typedef struct
+  {
+  uint32_t id;
+  bool ext;
+  uint8_t dlc;
+  uint32_t interval;                    // [us]
+  int64_t due;                          // segment time of next frame [us]
+  uint32_t sent;
+  } vcan_genprofile_t;
+
+class vcan_segment
+  {
+  public:
+    vcan_segment();
+
+  public:
+    void ClearStats();
+
+  public:
+    std::vector<vcan*> m_members;
+    std::map<uint64_t, vcan_pending_t> m_remote;  // generator frames by priority
+    bool m_fast;                        // false = realtime
+    int64_t m_time;                     // segment time [us]
+    int64_t m_stats_start;              // segment time of stats reset [us]
+    int64_t m_busy;                     // bus time used [us]
+    uint32_t m_frames;                  // frames transferred
+    uint32_t m_errorframes;             // error frames (retransmissions)
+    uint32_t m_arb_count;               // frames delayed by a busy bus / arbitration
+    int64_t m_arb_sum;                  // … total delay [us]
+    uint32_t m_arb_max;                 // … max delay [us]
+    uint32_t m_seq;
+  };
+
+class vcan : public canbus
+  {
+  public:
+    vcan(const char* name);
+    ~vcan();
+
+  public:
+    esp_err_t Start(CAN_mode_t mode, CAN_speed_t speed);
+    esp_err_t Stop();
+    void ClearStatus();
+
+  public:
+    esp_err_t Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0);
+
+  public:
+    static uint32_t FrameBits(const CAN_frame_t* p_frame);
+    static uint32_t ArbitrationKey(const CAN_frame_t* p_frame);
+    uint32_t Random();
+
+  public:
+    vcan_segment* m_segment;
+    std::deque<vcan_pending_t> m_txfifo;
+    bool m_loopback;                    // receive own TX frames
+    bool m_busoff;
+    uint16_t m_fault_error;             // error frame probability [‰]
+    uint16_t m_fault_drop;              // frame loss probability [‰]
+    uint32_t m_seed;                    // PRNG seed (restored on ClearStatus)
+    uint32_t m_rng;
+    uint32_t m_dropped;                 // frames lost by fault injection
+
+  public:
+    std::vector<vcan_genprofile_t> m_gen;  // traffic generator profiles
+    uint32_t m_gen_limit;               // max frames to generate, 0 = unlimited
+    uint32_t m_gen_sent;
+    uint32_t m_gen_overruns;            // frames skipped due to bus overload
+    bool m_gen_tx;                      // generate via own TX path
+  };
+
+/**
+ * vcanmgr: virtual bus registry & simulation task
+ */
+class vcanmgr
+  {
+  public:
+    vcanmgr();
+    ~vcanmgr();
+
+  public:
+    vcan* Create(const char* name);
+    vcan* Find(const char* name);
+    void Connect(vcan* a, vcan* b);
+    void Disconnect(vcan* bus);
+    void Submit(vcan* bus, vcan_pending_t& pending);
+    void Purge(vcan* bus);
+    void Wakeup();
+    void BusOff(vcan* bus);
+
+  public:
+    void GenStart(vcan* bus, std::vector<vcan_genprofile_t>& profiles, uint32_t limit, bool tx);
+    void GenStop(vcan* bus);
+    void Status(int verbosity, OvmsWriter* writer);
+    void ConfigMounted(std::string event, void* data);
+    int64_t Now(vcan_segment* seg);
+
+  protected:
+    static void Task(void *pvParameters);
+    void Run();
+    TickType_t Process(vcan_segment* seg, std::vector<CAN_queue_msg_t>& out);
+    void Generate(vcan_segment* seg, int64_t until);
+    bool Transfer(vcan_segment* seg, vcan_pending_t& p, int64_t start, std::vector<CAN_queue_msg_t>& out);
+    void TxError(vcan* bus, std::vector<CAN_queue_msg_t>& out);
+    void Post(std::vector<CAN_queue_msg_t>& out, bool fast);
+    void RemoveSegment(vcan_segment* seg);
+
+  public:
+    OvmsRecMutex m_mutex;
+    std::vector<vcan*> m_buses;
+    std::vector<vcan_segment*> m_segments;
+    TaskHandle_t m_task;
+  };
+
+extern vcanmgr MyVCan;
+
+#endif //#ifndef __VCAN_H__
@@ -49,6 +49,7 @@ static const char *CHECK_SHUTDOWN_TAG = "vehicle-shutdown";
 #include <ovms_peripherals.h>
 #include <ovms_boot.h>
 #include <string_writer.h>
+#include <ovms_status.h>
 #include "vehicle.h"
 
 #ifdef bind
@@ -96,6 +97,7 @@ OvmsVehicleFactory::OvmsVehicleFactory()
 
   OvmsCommand* cmd_stat = MyCommandApp.RegisterCommand("stat","Show vehicle status",vehicle_stat);
   cmd_stat->RegisterCommand("trip","Show trip status",vehicle_stat_trip);
+  MyStatus.RegisterCommand("stat", TAG, 2000, cmd_stat, "vehicle.");
 
   OvmsCommand* cmd_bms = MyCommandApp.RegisterCommand("bms","BMS framework", bms_status, "", 0, 0, false);
   cmd_bms->RegisterCommand("status","Show BMS status",bms_status);
@@ -2566,6 +2568,7 @@ void OvmsVehicle::OvmsVehicleTask(void *pvParameters)
 
 void OvmsVehicle::VehicleTask()
   {
+  OvmsHeapTag heaptag(HEAPTAG_VEHICLE);
 
   CAN_frame_t entry;
   while (!m_is_shutdown)
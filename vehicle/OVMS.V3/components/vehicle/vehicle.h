@@ -531,11 +531,17 @@ class OvmsVehicle : public InternalRamAllocated
     void BmsSetCellLimitsVoltage(float min, float max);
     void BmsSetCellLimitsTemperature(float min, float max);
     void BmsSetCellVoltage(int index, float value);
+    void BmsSetCellVoltages(int start, int count, const float* values);
     void BmsResetCellVoltages(bool full = false);
     void BmsSetCellTemperature(int index, float value);
+    void BmsSetCellTemperatures(int start, int count, const float* values);
     void BmsResetCellTemperatures(bool full = false);
     void BmsRestartCellVoltages();
     void BmsRestartCellTemperatures();
+    bool BmsStoreCellVoltage(int index, float value);
+    bool BmsStoreCellTemperature(int index, float value);
+    void BmsProcessCellVoltages();
+    void BmsProcessCellTemperatures();
     void BmsTicker();
     virtual void NotifyBmsAlerts();
 
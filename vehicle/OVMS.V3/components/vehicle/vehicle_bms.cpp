@@ -32,6 +32,7 @@
 static const char *TAG = "vehicle";
 
 #include <stdio.h>
+#include <math.h>
 #include <algorithm>
 #include <ovms_command.h>
 #include <ovms_script.h>
@@ -274,11 +275,77 @@ void OvmsVehicle::BmsSetCellLimitsTemperature(float min, float max)
   m_bms_limit_tmax = max;
   }
 
-void OvmsVehicle::BmsSetCellVoltage(int index, float value)
+/**
+ * bms_cell_stats: single pass statistics over a complete cell series
+ *  Values are accumulated relative to the first cell, so single precision
+ *  suffices for the square sums (cell deviations are small compared to the
+ *  absolute values). Four independent accumulator lanes keep the FPU
+ *  pipeline busy. The gradient centre matches the previous implementation.
+ */
+typedef struct
+  {
+  float min, max, avg, stddev, grad;
+  } bms_cell_stats_t;
+
+static void bms_cell_stats(const float* v, int n, bms_cell_stats_t* st)
+  {
+  const float ref = v[0];
+  float s0=0, s1=0, s2=0, s3=0;         // sum of deltas
+  float q0=0, q1=0, q2=0, q3=0;         // sum of squared deltas
+  float w0=0, w1=0, w2=0, w3=0;         // sum of index weighted deltas
+  float min = ref, max = ref;
+  float fi = 0;
+  int i = 0;
+  for (; i+4 <= n; i += 4, fi += 4)
+    {
+    float d0 = v[i] - ref, d1 = v[i+1] - ref, d2 = v[i+2] - ref, d3 = v[i+3] - ref;
+    s0 += d0; s1 += d1; s2 += d2; s3 += d3;
+    q0 += d0*d0; q1 += d1*d1; q2 += d2*d2; q3 += d3*d3;
+    w0 += fi*d0; w1 += (fi+1)*d1; w2 += (fi+2)*d2; w3 += (fi+3)*d3;
+    float mn = std::min(std::min(v[i], v[i+1]), std::min(v[i+2], v[i+3]));
+    float mx = std::max(std::max(v[i], v[i+1]), std::max(v[i+2], v[i+3]));
+    if (mn < min) min = mn;
+    if (mx > max) max = mx;
+    }
+  for (; i < n; i++, fi++)
+    {
+    float d = v[i] - ref;
+    s0 += d; q0 += d*d; w0 += fi*d;
+    if (v[i] < min) min = v[i];
+    if (v[i] > max) max = v[i];
+    }
+  float sum = (s0+s1) + (s2+s3);
+  float sqrsum = (q0+q1) + (q2+q3);
+  float wsum = (w0+w1) + (w2+w3);
+
+  float davg = sum / n;
+  st->min = min;
+  st->max = max;
+  st->avg = ref + davg;
+  st->stddev = sqrtf(LIMIT_MIN(sqrsum / n - SQR(davg), 0));
+
+  // Gradient: sum((i-c)*(v[i]-avg)) / sum((i-c)^2) * n
+  float c = n / 2 - 0.5f;
+  float sumic = n * ((n-1) / 2.0f - c);
+  float sumn = wsum - c * sum - davg * sumic;
+  float sumd = n * (SQR((float)n) - 1) / 12 + n * SQR((n-1) / 2.0f - c);
+  st->grad = (sumn / sumd) * n;
+  }
+
+static inline float bms_roundprec(float val, float scale)
+  {
+  return roundf(val * scale) / scale;
+  }
+
+/**
+ * BmsStoreCellVoltage: store a cell voltage reading
+ *  Returns true if the reading completed the series.
+ */
+bool OvmsVehicle::BmsStoreCellVoltage(int index, float value)
   {
-  // ESP_LOGV(TAG,"BmsSetCellVoltage(%d,%f) c=%d", index, value, m_bms_bitset_cv);
-  if ((index<0)||(index>=m_bms_readings_v)) return;
-  if ((value<m_bms_limit_vmin)||(value>m_bms_limit_vmax)) return;
+  // ESP_LOGV(TAG,"BmsStoreCellVoltage(%d,%f) c=%d", index, value, m_bms_bitset_cv);
+  if ((index<0)||(index>=m_bms_readings_v)) return false;
+  if ((value<m_bms_limit_vmin)||(value>m_bms_limit_vmax)) return false;
   m_bms_voltages[index] = value;
 
   if (! m_bms_has_voltages)
@@ -291,116 +358,128 @@ void OvmsVehicle::BmsSetCellVoltage(int index, float value)
   else if (m_bms_vmaxs[index] < value)
     m_bms_vmaxs[index] = value;
 
-  if (m_bms_bitset_v[index] == false) m_bms_bitset_cv++;
-  if (m_bms_bitset_cv == m_bms_readings_v)
+  if (m_bms_bitset_v[index] == false)
     {
-    // Series complete, all cell voltages acquired
-    float thr_maxgrad  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.maxgrad",  m_bms_defthr_vmaxgrad);
-    float thr_maxsddev = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.maxsddev", m_bms_defthr_vmaxsddev);
-    float thr_warn     = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.warn",     m_bms_defthr_vwarn);
-    float thr_alert    = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.alert",    m_bms_defthr_valert);
+    m_bms_bitset_v[index] = true;
+    m_bms_bitset_cv++;
+    }
+  return (m_bms_bitset_cv == m_bms_readings_v);
+  }
 
-    // Get min, max, avg & standard deviation:
-    double sum=0, sqrsum=0, avg, stddev=0;
-    float min=0, max=0;
-    for (int i=0; i<m_bms_readings_v; i++)
-      {
-      sum += m_bms_voltages[i];
-      sqrsum += SQR(m_bms_voltages[i]);
-      if (min==0 || m_bms_voltages[i]<min)
-        min = m_bms_voltages[i];
-      if (max==0 || m_bms_voltages[i]>max)
-        max = m_bms_voltages[i];
-      }
-    avg = sum / m_bms_readings_v;
-    stddev = sqrt(LIMIT_MIN((sqrsum / m_bms_readings_v) - SQR(avg), 0));
+void OvmsVehicle::BmsSetCellVoltage(int index, float value)
+  {
+  if (BmsStoreCellVoltage(index, value))
+    BmsProcessCellVoltages();
+  }
 
-    // Get gradient:
-    double sumn = 0, sumd = 0;
-    for (int i=0; i<m_bms_readings_v; i++)
-      {
-      sumn += (i - (m_bms_readings_v / 2 - 0.5)) * (m_bms_voltages[i] - avg);
-      sumd += SQR(i - (m_bms_readings_v / 2 - 0.5));
-      }
-    float grad = (sumn / sumd) * m_bms_readings_v;
-
-    // …publish to metrics:
-    StandardMetrics.ms_v_bat_pack_vmin->SetValue(min);
-    StandardMetrics.ms_v_bat_pack_vmax->SetValue(max);
-    StandardMetrics.ms_v_bat_pack_vavg->SetValue(ROUNDPREC(avg, 5));
-    StandardMetrics.ms_v_bat_pack_vstddev->SetValue(ROUNDPREC(stddev, 5));
-    StandardMetrics.ms_v_bat_pack_vgrad->SetValue(ROUNDPREC(grad, 5));
-    StandardMetrics.ms_v_bat_cell_voltage->SetElemValues(0, m_bms_readings_v, m_bms_voltages);
-    StandardMetrics.ms_v_bat_cell_vmin->SetElemValues(0, m_bms_readings_v, m_bms_vmins);
-    StandardMetrics.ms_v_bat_cell_vmax->SetElemValues(0, m_bms_readings_v, m_bms_vmaxs);
-
-    // Voltages are very volatile and may respond to a load change within the sensor query loop.
-    // To detect an inconsistent series, we check for a too high gradient and/or a too high
-    // offset of the momentary stddev level from the previously observed average:
-    bool series_valid;
-    if (ABS(grad) > thr_maxgrad)
-      {
-      series_valid = false;
-      }
-    else if (m_bms_vstddev_cnt < VSTDDEV_SMOOTHCNT)
-      {
-      // skip the first VSTDDEV_SMOOTHCNT series to init the average:
-      m_bms_vstddev_cnt++;
-      m_bms_vstddev_avg = ((m_bms_vstddev_cnt-1) * m_bms_vstddev_avg + stddev) / m_bms_vstddev_cnt;
-      series_valid = false;
-      }
-    else if (stddev - m_bms_vstddev_avg > thr_maxsddev)
-      {
-      series_valid = false;
-      }
-    else
-      {
-      m_bms_vstddev_avg = ((VSTDDEV_SMOOTHCNT-1) * m_bms_vstddev_avg + stddev) / VSTDDEV_SMOOTHCNT;
-      series_valid = true;
-      }
+/**
+ * BmsSetCellVoltages: set <count> cell voltages starting at cell <start>
+ *  Use this if the vehicle receives a block of cells at once; the series
+ *  statistics are computed once when the series is complete.
+ */
+void OvmsVehicle::BmsSetCellVoltages(int start, int count, const float* values)
+  {
+  for (int i=0; i<count; i++)
+    {
+    if (BmsStoreCellVoltage(start+i, values[i]))
+      BmsProcessCellVoltages();
+    }
+  }
+
+/**
+ * BmsProcessCellVoltages: series complete, all cell voltages acquired
+ */
+void OvmsVehicle::BmsProcessCellVoltages()
+  {
+  float thr_maxgrad  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.maxgrad",  m_bms_defthr_vmaxgrad);
+  float thr_maxsddev = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.maxsddev", m_bms_defthr_vmaxsddev);
+  float thr_warn     = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.warn",     m_bms_defthr_vwarn);
+  float thr_alert    = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.alert",    m_bms_defthr_valert);
+
+  // Get min, max, avg, standard deviation & gradient:
+  bms_cell_stats_t st;
+  bms_cell_stats(m_bms_voltages, m_bms_readings_v, &st);
+  float stddev = st.stddev;
+
+  // Voltages are very volatile and may respond to a load change within the sensor query loop.
+  // To detect an inconsistent series, we check for a too high gradient and/or a too high
+  // offset of the momentary stddev level from the previously observed average:
+  bool series_valid;
+  if (ABS(st.grad) > thr_maxgrad)
+    {
+    series_valid = false;
+    }
+  else if (m_bms_vstddev_cnt < VSTDDEV_SMOOTHCNT)
+    {
+    // skip the first VSTDDEV_SMOOTHCNT series to init the average:
+    m_bms_vstddev_cnt++;
+    m_bms_vstddev_avg = ((m_bms_vstddev_cnt-1) * m_bms_vstddev_avg + stddev) / m_bms_vstddev_cnt;
+    series_valid = false;
+    }
+  else if (stddev - m_bms_vstddev_avg > thr_maxsddev)
+    {
+    series_valid = false;
+    }
+  else
+    {
+    m_bms_vstddev_avg = ((VSTDDEV_SMOOTHCNT-1) * m_bms_vstddev_avg + stddev) / VSTDDEV_SMOOTHCNT;
+    series_valid = true;
+    }
 
-    // Check cell deviations only if the series appears to be consistent:
-    if (series_valid)
+  // Check cell deviations only if the series appears to be consistent:
+  if (series_valid)
+    {
+    float dev;
+    float thr_a = stddev + thr_alert, thr_w = stddev + thr_warn;
+    for (int i=0; i<m_bms_readings_v; i++)
       {
-      float dev;
-      for (int i=0; i<m_bms_readings_v; i++)
+      dev = bms_roundprec(m_bms_voltages[i] - st.avg, 1e5f);
+      if (ABS(dev) > ABS(m_bms_vdevmaxs[i]))
+        m_bms_vdevmaxs[i] = dev;
+      if (ABS(dev) >= thr_a && m_bms_valerts[i] <= OvmsStatus::Warn)
         {
-        dev = ROUNDPREC(m_bms_voltages[i] - avg, 5);
-        if (ABS(dev) > ABS(m_bms_vdevmaxs[i]))
-          m_bms_vdevmaxs[i] = dev;
-        if (ABS(dev) >= stddev + thr_alert && m_bms_valerts[i] <= OvmsStatus::Warn)
-          {
-          m_bms_valerts[i] = OvmsStatus::Alert;
-          m_bms_valerts_new++; // trigger notification
-          }
-        else if (ABS(dev) >= stddev + thr_warn && m_bms_valerts[i] < OvmsStatus::Warn)
-          m_bms_valerts[i] = OvmsStatus::Warn;
+        m_bms_valerts[i] = OvmsStatus::Alert;
+        m_bms_valerts_new++; // trigger notification
         }
-
-      // Publish deviation maximums & alerts:
-      if (stddev > StandardMetrics.ms_v_bat_pack_vstddev_max->AsFloat())
-        StandardMetrics.ms_v_bat_pack_vstddev_max->SetValue(stddev);
-      StandardMetrics.ms_v_bat_cell_vdevmax->SetElemValues(0, m_bms_readings_v, m_bms_vdevmaxs);
-      StandardMetrics.ms_v_bat_cell_valert->SetElemValues(0, m_bms_readings_v, (short *)m_bms_valerts);
+      else if (ABS(dev) >= thr_w && m_bms_valerts[i] < OvmsStatus::Warn)
+        m_bms_valerts[i] = OvmsStatus::Warn;
       }
-
-    // complete:
-    m_bms_has_voltages = true;
-    m_bms_bitset_v.clear();
-    m_bms_bitset_v.resize(m_bms_readings_v);
-    m_bms_bitset_cv = 0;
     }
-  else
-    {
-    m_bms_bitset_v[index] = true;
+
+  // …publish to metrics, all cell vectors in one go:
+  StandardMetrics.ms_v_bat_pack_vmin->SetValue(st.min);
+  StandardMetrics.ms_v_bat_pack_vmax->SetValue(st.max);
+  StandardMetrics.ms_v_bat_pack_vavg->SetValue(bms_roundprec(st.avg, 1e5f));
+  StandardMetrics.ms_v_bat_pack_vstddev->SetValue(bms_roundprec(stddev, 1e5f));
+  StandardMetrics.ms_v_bat_pack_vgrad->SetValue(bms_roundprec(st.grad, 1e5f));
+  StandardMetrics.ms_v_bat_cell_voltage->SetElemValues(0, m_bms_readings_v, m_bms_voltages);
+  StandardMetrics.ms_v_bat_cell_vmin->SetElemValues(0, m_bms_readings_v, m_bms_vmins);
+  StandardMetrics.ms_v_bat_cell_vmax->SetElemValues(0, m_bms_readings_v, m_bms_vmaxs);
+  if (series_valid)
+    {
+    // Publish deviation maximums & alerts:
+    if (stddev > StandardMetrics.ms_v_bat_pack_vstddev_max->AsFloat())
+      StandardMetrics.ms_v_bat_pack_vstddev_max->SetValue(stddev);
+    StandardMetrics.ms_v_bat_cell_vdevmax->SetElemValues(0, m_bms_readings_v, m_bms_vdevmaxs);
+    StandardMetrics.ms_v_bat_cell_valert->SetElemValues(0, m_bms_readings_v, (short *)m_bms_valerts);
     }
+
+  // complete:
+  m_bms_has_voltages = true;
+  m_bms_bitset_v.clear();
+  m_bms_bitset_v.resize(m_bms_readings_v);
+  m_bms_bitset_cv = 0;
   }
 
-void OvmsVehicle::BmsSetCellTemperature(int index, float value)
+/**
+ * BmsStoreCellTemperature: store a cell temperature reading
+ *  Returns true if the reading completed the series.
+ */
+bool OvmsVehicle::BmsStoreCellTemperature(int index, float value)
   {
-  // ESP_LOGV(TAG,"BmsSetCellTemperature(%d,%f) c=%d", index, value, m_bms_bitset_ct);
-  if ((index<0)||(index>=m_bms_readings_t)) return;
-  if ((value<m_bms_limit_tmin)||(value>m_bms_limit_tmax)) return;
+  // ESP_LOGV(TAG,"BmsStoreCellTemperature(%d,%f) c=%d", index, value, m_bms_bitset_ct);
+  if ((index<0)||(index>=m_bms_readings_t)) return false;
+  if ((value<m_bms_limit_tmin)||(value>m_bms_limit_tmax)) return false;
   m_bms_temperatures[index] = value;
 
   if (! m_bms_has_temperatures)
@@ -413,69 +492,81 @@ void OvmsVehicle::BmsSetCellTemperature(int index, float value)
   else if (m_bms_tmaxs[index] < value)
     m_bms_tmaxs[index] = value;
 
-  if (m_bms_bitset_t[index] == false) m_bms_bitset_ct++;
-  if (m_bms_bitset_ct == m_bms_readings_t)
+  if (m_bms_bitset_t[index] == false)
     {
-    // Series complete, all cell temperatures acquired
-    float thr_warn  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.warn", m_bms_defthr_twarn);
-    float thr_alert = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.alert", m_bms_defthr_talert);
+    m_bms_bitset_t[index] = true;
+    m_bms_bitset_ct++;
+    }
+  return (m_bms_bitset_ct == m_bms_readings_t);
+  }
 
-    // get min, max, avg & standard deviation:
-    double sum=0, sqrsum=0, avg, stddev=0;
-    float min=0, max=0;
-    for (int i=0; i<m_bms_readings_t; i++)
-      {
-      sum += m_bms_temperatures[i];
-      sqrsum += SQR(m_bms_temperatures[i]);
-      if (min==0 || m_bms_temperatures[i]<min)
-        min = m_bms_temperatures[i];
-      if (max==0 || m_bms_temperatures[i]>max)
-        max = m_bms_temperatures[i];
-      }
-    avg = sum / m_bms_readings_t;
-    stddev = sqrt(LIMIT_MIN((sqrsum / m_bms_readings_t) - SQR(avg), 0));
+void OvmsVehicle::BmsSetCellTemperature(int index, float value)
+  {
+  if (BmsStoreCellTemperature(index, value))
+    BmsProcessCellTemperatures();
+  }
 
-    // check cell deviations:
-    float dev;
-    for (int i=0; i<m_bms_readings_t; i++)
+/**
+ * BmsSetCellTemperatures: set <count> cell temperatures starting at cell <start>
+ */
+void OvmsVehicle::BmsSetCellTemperatures(int start, int count, const float* values)
+  {
+  for (int i=0; i<count; i++)
+    {
+    if (BmsStoreCellTemperature(start+i, values[i]))
+      BmsProcessCellTemperatures();
+    }
+  }
+
+/**
+ * BmsProcessCellTemperatures: series complete, all cell temperatures acquired
+ */
+void OvmsVehicle::BmsProcessCellTemperatures()
+  {
+  float thr_warn  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.warn", m_bms_defthr_twarn);
+  float thr_alert = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.alert", m_bms_defthr_talert);
+
+  // get min, max, avg & standard deviation:
+  bms_cell_stats_t st;
+  bms_cell_stats(m_bms_temperatures, m_bms_readings_t, &st);
+
+  // check cell deviations:
+  float dev;
+  float thr_a = st.stddev + thr_alert, thr_w = st.stddev + thr_warn;
+  for (int i=0; i<m_bms_readings_t; i++)
+    {
+    dev = bms_roundprec(m_bms_temperatures[i] - st.avg, 1e2f);
+    if (ABS(dev) > ABS(m_bms_tdevmaxs[i]))
+      m_bms_tdevmaxs[i] = dev;
+    if (ABS(dev) >= thr_a && m_bms_talerts[i] < OvmsStatus::Alert)
       {
-      dev = ROUNDPREC(m_bms_temperatures[i] - avg, 2);
-      if (ABS(dev) > ABS(m_bms_tdevmaxs[i]))
-        m_bms_tdevmaxs[i] = dev;
-      if (ABS(dev) >= stddev + thr_alert && m_bms_talerts[i] < OvmsStatus::Alert)
-        {
-        m_bms_talerts[i] = OvmsStatus::Alert;
-        m_bms_talerts_new++; // trigger notification
-        }
-      else if (ABS(dev) >= stddev + thr_warn && m_bms_valerts[i] < OvmsStatus::Warn)
-        m_bms_talerts[i] = OvmsStatus::Warn;
+      m_bms_talerts[i] = OvmsStatus::Alert;
+      m_bms_talerts_new++; // trigger notification
       }
-
-    // publish to metrics:
-    avg = ROUNDPREC(avg, 2);
-    stddev = ROUNDPREC(stddev, 2);
-    StandardMetrics.ms_v_bat_pack_tmin->SetValue(min);
-    StandardMetrics.ms_v_bat_pack_tmax->SetValue(max);
-    StandardMetrics.ms_v_bat_pack_tavg->SetValue(avg);
-    StandardMetrics.ms_v_bat_pack_tstddev->SetValue(stddev);
-    if (stddev > StandardMetrics.ms_v_bat_pack_tstddev_max->AsFloat())
-      StandardMetrics.ms_v_bat_pack_tstddev_max->SetValue(stddev);
-    StandardMetrics.ms_v_bat_cell_temp->SetElemValues(0, m_bms_readings_t, m_bms_temperatures);
-    StandardMetrics.ms_v_bat_cell_tmin->SetElemValues(0, m_bms_readings_t, m_bms_tmins);
-    StandardMetrics.ms_v_bat_cell_tmax->SetElemValues(0, m_bms_readings_t, m_bms_tmaxs);
-    StandardMetrics.ms_v_bat_cell_tdevmax->SetElemValues(0, m_bms_readings_t, m_bms_tdevmaxs);
-    StandardMetrics.ms_v_bat_cell_talert->SetElemValues(0, m_bms_readings_t, (short *) m_bms_talerts);
-
-    // complete:
-    m_bms_has_temperatures = true;
-    m_bms_bitset_t.clear();
-    m_bms_bitset_t.resize(m_bms_readings_t);
-    m_bms_bitset_ct = 0;
-    }
-  else
-    {
-    m_bms_bitset_t[index] = true;
+    else if (ABS(dev) >= thr_w && m_bms_valerts[i] < OvmsStatus::Warn)
+      m_bms_talerts[i] = OvmsStatus::Warn;
     }
+
+  // publish to metrics, all cell vectors in one go:
+  float avg = bms_roundprec(st.avg, 1e2f);
+  float stddev = bms_roundprec(st.stddev, 1e2f);
+  StandardMetrics.ms_v_bat_pack_tmin->SetValue(st.min);
+  StandardMetrics.ms_v_bat_pack_tmax->SetValue(st.max);
+  StandardMetrics.ms_v_bat_pack_tavg->SetValue(avg);
+  StandardMetrics.ms_v_bat_pack_tstddev->SetValue(stddev);
+  if (stddev > StandardMetrics.ms_v_bat_pack_tstddev_max->AsFloat())
+    StandardMetrics.ms_v_bat_pack_tstddev_max->SetValue(stddev);
+  StandardMetrics.ms_v_bat_cell_temp->SetElemValues(0, m_bms_readings_t, m_bms_temperatures);
+  StandardMetrics.ms_v_bat_cell_tmin->SetElemValues(0, m_bms_readings_t, m_bms_tmins);
+  StandardMetrics.ms_v_bat_cell_tmax->SetElemValues(0, m_bms_readings_t, m_bms_tmaxs);
+  StandardMetrics.ms_v_bat_cell_tdevmax->SetElemValues(0, m_bms_readings_t, m_bms_tdevmaxs);
+  StandardMetrics.ms_v_bat_cell_talert->SetElemValues(0, m_bms_readings_t, (short *) m_bms_talerts);
+
+  // complete:
+  m_bms_has_temperatures = true;
+  m_bms_bitset_t.clear();
+  m_bms_bitset_t.resize(m_bms_readings_t);
+  m_bms_bitset_ct = 0;
   }
 
 void OvmsVehicle::BmsRestartCellVoltages()
@@ -618,9 +618,12 @@ void OvmsVehicleSmartED::PollReply_BMS_BattVolts(const char* reply_data, uint16_
     float min=0, max=0;
     int cmin=0, cmax=0;
     
+    float cells[CELLCOUNT];
+    float offset = mt_myBMS_ADCvoltsOffset->AsFloat() / 1000;
     for(int i = 0; i < CELLCOUNT; i++) {
-      BmsSetCellVoltage(i, m_bms_raw_voltages[i] - (mt_myBMS_ADCvoltsOffset->AsFloat()/1000));
+      cells[i] = m_bms_raw_voltages[i] - offset;
     }
+    BmsSetCellVoltages(0, CELLCOUNT, cells);
     for(int i = 0; i < StdMetrics.ms_v_bat_cell_voltage->GetSize(); i++) {
       if (min==0 || StdMetrics.ms_v_bat_cell_voltage->GetElemValue(i)<min) {
         min = StdMetrics.ms_v_bat_cell_voltage->GetElemValue(i);
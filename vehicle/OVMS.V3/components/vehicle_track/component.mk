@@ -8,6 +8,7 @@
 #
 
 ifdef CONFIG_OVMS_VEHICLE_TRACK
+COMPONENT_DEPENDS := zip
 COMPONENT_ADD_INCLUDEDIRS:=src
 COMPONENT_SRCDIRS:=src
 COMPONENT_ADD_LDFLAGS = -Wl,--whole-archive -l$(COMPONENT_NAME) -Wl,--no-whole-archive
@@ -0,0 +1,718 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "v-track";
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <math.h>
+#include <dirent.h>
+#include <time.h>
+#include <algorithm>
+#include "track_recorder.h"
+#include "metrics_standard.h"
+#include "ovms_malloc.h"
+#include "ovms_utils.h"
+#include "ovms_peripherals.h"
+
+#define TRACK_M_PER_UNIT    1.11195     // Meters per 1e-5 degrees latitude
+#define TRACK_MAX_RECORD    40          // Max encoded record size
+
+
+/**
+ * Varint & zigzag coding
+ */
+
+static inline uint32_t track_zigzag(int32_t v)
+  {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+  }
+
+static inline int32_t track_unzigzag(uint32_t v)
+  {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+  }
+
+static int track_put_varint(uint8_t* p, uint64_t v)
+  {
+  int n = 0;
+  while (v >= 0x80)
+    {
+    p[n++] = (v & 0x7f) | 0x80;
+    v >>= 7;
+    }
+  p[n++] = v;
+  return n;
+  }
+
+static bool track_get_varint(const uint8_t* &p, const uint8_t* end, uint64_t &v)
+  {
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+    uint8_t b = *p++;
+    v |= (uint64_t)(b & 0x7f) << shift;
+    if ((b & 0x80) == 0)
+      return true;
+    }
+  return false;
+  }
+
+/**
+ * track_encode: encode a record, deltas relative to base (NULL = absolute)
+ */
+static int track_encode(uint8_t* p, const track_point_t& pt, const track_point_t* base, bool newseg)
+  {
+  static const track_point_t zero = {};
+  if (!base) base = &zero;
+  int n = track_put_varint(p, ((uint64_t)(pt.time - base->time) << 1) | (newseg ? 1 : 0));
+  n += track_put_varint(p+n, track_zigzag(pt.lat - base->lat));
+  n += track_put_varint(p+n, track_zigzag(pt.lon - base->lon));
+  n += track_put_varint(p+n, track_zigzag(pt.alt - base->alt));
+  n += track_put_varint(p+n, track_zigzag(pt.speed - base->speed));
+  return n;
+  }
+
+/**
+ * track_decode: decode a record into pt (holding the base values)
+ */
+static bool track_decode(const uint8_t* &p, const uint8_t* end, track_point_t& pt, bool& newseg)
+  {
+  uint64_t head, v[4];
+  if (!track_get_varint(p, end, head)) return false;
+  for (int i = 0; i < 4; i++)
+    if (!track_get_varint(p, end, v[i])) return false;
+  pt.time += head >> 1;
+  pt.lat += track_unzigzag(v[0]);
+  pt.lon += track_unzigzag(v[1]);
+  pt.alt += track_unzigzag(v[2]);
+  pt.speed += track_unzigzag(v[3]);
+  newseg = head & 1;
+  return true;
+  }
+
+/**
+ * Equirectangular distance approximations in meters, sufficient for the
+ *  short distances involved in the simplification.
+ */
+static float track_distance(const track_point_t& a, const track_point_t& b)
+  {
+  float coslat = cosf(a.lat * (float)(M_PI / 180 / 1e5));
+  float dx = (b.lon - a.lon) * coslat * TRACK_M_PER_UNIT;
+  float dy = (b.lat - a.lat) * TRACK_M_PER_UNIT;
+  return sqrtf(dx*dx + dy*dy);
+  }
+
+// Distance of p from the segment a → b:
+static float track_xtd(const track_point_t& a, const track_point_t& b, const track_point_t& p)
+  {
+  float coslat = cosf(a.lat * (float)(M_PI / 180 / 1e5));
+  float bx = (b.lon - a.lon) * coslat * TRACK_M_PER_UNIT;
+  float by = (b.lat - a.lat) * TRACK_M_PER_UNIT;
+  float px = (p.lon - a.lon) * coslat * TRACK_M_PER_UNIT;
+  float py = (p.lat - a.lat) * TRACK_M_PER_UNIT;
+  float len2 = bx*bx + by*by;
+  float t = (len2 > 0) ? std::min(std::max((px*bx + py*by) / len2, 0.0f), 1.0f) : 0;
+  float dx = px - t*bx, dy = py - t*by;
+  return sqrtf(dx*dx + dy*dy);
+  }
+
+
+TrackRecorder::TrackRecorder()
+  {
+  m_path = "";
+  m_interval = 5;
+  m_tolerance = 10;
+  m_mindist = 5;
+  m_maxgap = 300;
+  m_seggap = 600;
+  m_flush_interval = 0;
+  m_chunks = NULL;
+  m_nchunks = 0;
+  m_chunkseq = 0;
+  m_samples = m_jitter = m_stored = m_overwritten = m_flushed = m_flush_errors = 0;
+  m_lastgpstime = 0;
+  m_window.reserve(TRACK_WINDOW_SIZE);
+  Clear();
+  }
+
+TrackRecorder::~TrackRecorder()
+  {
+  if (m_chunks)
+    free(m_chunks);
+  }
+
+void TrackRecorder::Configure(int ringsize_kb, int interval, float tolerance, float mindist,
+                              int maxgap, int seggap, const std::string& path, int flush_interval)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  m_interval = std::max(interval, 1);
+  m_tolerance = tolerance;
+  m_mindist = mindist;
+  m_maxgap = std::max(maxgap, m_interval);
+  m_seggap = std::max(seggap, m_interval);
+  m_path = path;
+  while (!m_path.empty() && m_path.back() == '/')
+    m_path.pop_back();
+  m_flush_interval = flush_interval;
+
+  int nchunks = std::max(ringsize_kb * 1024 / (int)sizeof(track_chunk_t), 2);
+  if (nchunks != m_nchunks)
+    {
+    if (m_used)
+      ESP_LOGW(TAG, "Ring size changed, discarding %d recorded chunks", m_used);
+    if (m_chunks)
+      free(m_chunks);
+    m_chunks = (track_chunk_t*) ExternalRamCalloc(nchunks, sizeof(track_chunk_t));
+    m_nchunks = m_chunks ? nchunks : 0;
+    if (!m_chunks)
+      ESP_LOGE(TAG, "Ring allocation failed (%d KB)", ringsize_kb);
+    Clear();
+    }
+  }
+
+void TrackRecorder::Ticker1(uint32_t ticker)
+  {
+  if ((ticker % m_interval) == 0)
+    Sample();
+  if (m_flush_interval > 0 && (ticker % m_flush_interval) == 0)
+    Flush();
+  }
+
+/**
+ * Sample: feed the current GPS position into the recorder
+ */
+void TrackRecorder::Sample()
+  {
+  if (!StdMetrics.ms_v_pos_gpslock->AsBool())
+    return;
+  int64_t gpstime = StdMetrics.ms_v_pos_gpstime->AsInt();
+  if (gpstime == m_lastgpstime)
+    return;
+  m_lastgpstime = gpstime;
+
+  track_point_t pt;
+  pt.time = gpstime ? gpstime : time(NULL);
+  pt.lat = lround(StdMetrics.ms_v_pos_latitude->AsFloat() * 1e5);
+  pt.lon = lround(StdMetrics.ms_v_pos_longitude->AsFloat() * 1e5);
+  pt.alt = lround(StdMetrics.ms_v_pos_altitude->AsFloat());
+  pt.speed = lround(StdMetrics.ms_v_pos_speed->AsFloat());
+  if (pt.lat == 0 && pt.lon == 0)
+    return;
+  AddSample(pt);
+  }
+
+/**
+ * AddSample: simplify using an opening window (streaming Douglas-Peucker):
+ *  points are kept pending as long as all of them are within the tolerance
+ *  of the line from the last stored point (anchor) to the new sample. On the
+ *  first deviation, the last pending point is stored & becomes the new anchor.
+ */
+void TrackRecorder::AddSample(const track_point_t& pt)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  if (!m_chunks)
+    return;
+  m_samples++;
+
+  if (m_lastsample && pt.time <= m_lastsample)
+    return;
+  if (m_lastsample && (int)(pt.time - m_lastsample) > m_seggap)
+    Finish();
+
+  if (m_anchor_valid)
+    {
+    const track_point_t& last = m_window.empty() ? m_anchor : m_window.back();
+    if (track_distance(last, pt) < m_mindist)
+      {
+      m_jitter++;
+      return;
+      }
+    }
+  m_lastsample = pt.time;
+
+  if (!m_anchor_valid)
+    {
+    Store(pt);
+    return;
+    }
+
+  for (const track_point_t& q : m_window)
+    {
+    if (track_xtd(m_anchor, pt, q) > m_tolerance)
+      {
+      Store(m_window.back());
+      m_window.clear();
+      break;
+      }
+    }
+
+  if (m_window.size() >= TRACK_WINDOW_SIZE || (int)(pt.time - m_anchor.time) >= m_maxgap)
+    {
+    Store(pt);
+    m_window.clear();
+    }
+  else
+    m_window.push_back(pt);
+  }
+
+/**
+ * Finish: end the current segment, storing the last pending point
+ */
+void TrackRecorder::Finish()
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  if (!m_window.empty())
+    Store(m_window.back());
+  m_window.clear();
+  m_anchor_valid = false;
+  m_newseg = true;
+  }
+
+track_chunk_t* TrackRecorder::NewChunk()
+  {
+  if (m_used == m_nchunks)
+    {
+    // Ring full: drop the oldest chunk
+    track_chunk_t* oldest = GetChunk(0);
+    if (!m_path.empty() && oldest->flushed_count < oldest->hdr.count)
+      m_overwritten += oldest->hdr.count - oldest->flushed_count;
+    m_first = (m_first + 1) % m_nchunks;
+    m_used--;
+    }
+  track_chunk_t* chunk = GetChunk(m_used++);
+  memset(chunk, 0, offsetof(track_chunk_t, data));
+  chunk->seq = ++m_chunkseq;
+  chunk->hdr.magic = TRACK_MAGIC;
+  chunk->hdr.version = TRACK_VERSION;
+  m_open = true;
+  return chunk;
+  }
+
+void TrackRecorder::Store(const track_point_t& pt)
+  {
+  uint8_t rec[TRACK_MAX_RECORD];
+  int len = 0;
+  track_chunk_t* chunk = NULL;
+
+  if (m_open)
+    {
+    chunk = GetChunk(m_used-1);
+    len = track_encode(rec, pt, &chunk->last, m_newseg);
+    if (chunk->hdr.length + len > TRACK_CHUNK_SIZE)
+      m_open = false;
+    }
+  if (!m_open)
+    {
+    chunk = NewChunk();
+    len = track_encode(rec, pt, NULL, m_newseg);
+    chunk->hdr.start = pt.time;
+    }
+
+  memcpy(chunk->data + chunk->hdr.length, rec, len);
+  chunk->hdr.length += len;
+  chunk->hdr.count++;
+  chunk->hdr.end = pt.time;
+  chunk->last = pt;
+
+  m_anchor = pt;
+  m_anchor_valid = true;
+  m_newseg = false;
+  m_stored++;
+  }
+
+/**
+ * Flush: append the unflushed points to the storage files (one per UTC day).
+ *  Partially flushed chunks are written as a new chunk with the first record
+ *  re-encoded as absolute, so every file chunk can be decoded on its own.
+ *  Returns the number of points written or -1 if the storage is unavailable.
+ */
+int TrackRecorder::Flush()
+  {
+  struct flushpos
+    {
+    uint32_t seq;
+    uint16_t length;
+    uint16_t count;
+    track_point_t base;
+    size_t file;
+    int points;
+    };
+  std::vector<std::pair<std::string,std::string>> files;
+  std::vector<flushpos> commits;
+
+  // The chunk flush positions are committed after the file writes succeeded,
+  //  so points are retried on the next flush on errors (i.e. SD card removed).
+  OvmsMutexLock flushlock(&m_flush_mutex);
+    {
+    OvmsRecMutexLock lock(&m_mutex);
+    if (m_path.empty() || !m_chunks)
+      return 0;
+    if (startsWith(m_path, "/sd") && (!MyPeripherals || !MyPeripherals->m_sdcard || !MyPeripherals->m_sdcard->isavailable()))
+      return -1;
+
+    for (int i = 0; i < m_used; i++)
+      {
+      track_chunk_t* chunk = GetChunk(i);
+      if (chunk->flushed_count >= chunk->hdr.count)
+        continue;
+
+      // Re-encode first unflushed record:
+      const uint8_t* p = chunk->data + chunk->flushed_length;
+      const uint8_t* end = chunk->data + chunk->hdr.length;
+      track_point_t pt = chunk->flushbase;
+      bool newseg;
+      if (!track_decode(p, end, pt, newseg))
+        {
+        ESP_LOGE(TAG, "Flush: chunk %d corrupted, skipped", i);
+        chunk->flushed_length = chunk->hdr.length;
+        chunk->flushed_count = chunk->hdr.count;
+        continue;
+        }
+      uint8_t rec[TRACK_MAX_RECORD];
+      int len = track_encode(rec, pt, NULL, newseg);
+
+      track_chunkhdr_t hdr = chunk->hdr;
+      hdr.length = len + (end - p);
+      hdr.count = chunk->hdr.count - chunk->flushed_count;
+      hdr.start = pt.time;
+
+      char name[20];
+      time_t t = pt.time;
+      struct tm tm;
+      gmtime_r(&t, &tm);
+      strftime(name, sizeof(name), "%Y%m%d.trk", &tm);
+      if (files.empty() || files.back().first != name)
+        files.push_back(std::make_pair(std::string(name), std::string()));
+      std::string& buf = files.back().second;
+      buf.append((const char*)&hdr, sizeof(hdr));
+      buf.append((const char*)rec, len);
+      buf.append((const char*)p, end - p);
+
+      commits.push_back({ chunk->seq, chunk->hdr.length, chunk->hdr.count, chunk->last, files.size()-1, hdr.count });
+      }
+    }
+
+  if (files.empty())
+    return 0;
+
+  mkpath(m_path);
+  std::vector<bool> written(files.size(), false);
+  for (size_t i = 0; i < files.size(); i++)
+    {
+    std::string path = m_path + "/" + files[i].first;
+    FILE* f = fopen(path.c_str(), "a");
+    if (!f || fwrite(files[i].second.data(), files[i].second.size(), 1, f) != 1)
+      {
+      ESP_LOGE(TAG, "Flush: error writing '%s': %s", path.c_str(), strerror(errno));
+      m_flush_errors++;
+      }
+    else
+      written[i] = true;
+    if (f && fclose(f) != 0 && written[i])
+      {
+      ESP_LOGE(TAG, "Flush: error closing '%s': %s", path.c_str(), strerror(errno));
+      m_flush_errors++;
+      written[i] = false;
+      }
+    }
+
+  // Commit the flush positions of the chunks written:
+  int count = 0;
+  OvmsRecMutexLock lock(&m_mutex);
+  for (auto& pos : commits)
+    {
+    if (!written[pos.file])
+      continue;
+    count += pos.points;
+    for (int i = 0; i < m_used; i++)
+      {
+      track_chunk_t* chunk = GetChunk(i);
+      if (chunk->seq != pos.seq)
+        continue;
+      if (chunk->flushed_count < pos.count)
+        {
+        chunk->flushed_length = pos.length;
+        chunk->flushed_count = pos.count;
+        chunk->flushbase = pos.base;
+        }
+      break;
+      }
+    }
+  m_flushed += count;
+  ESP_LOGD(TAG, "Flush: %d points written to %d file(s)", count, (int)files.size());
+  return count;
+  }
+
+void TrackRecorder::Clear()
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  m_first = 0;
+  m_used = 0;
+  m_open = false;
+  m_anchor_valid = false;
+  m_newseg = true;
+  m_window.clear();
+  m_lastsample = 0;
+  }
+
+/**
+ * Serialize: get the ring contents in storage format
+ */
+size_t TrackRecorder::Serialize(std::string& buf)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  size_t size = 0;
+  for (int i = 0; i < m_used; i++)
+    size += sizeof(track_chunkhdr_t) + GetChunk(i)->hdr.length;
+  buf.reserve(buf.size() + size);
+  for (int i = 0; i < m_used; i++)
+    {
+    track_chunk_t* chunk = GetChunk(i);
+    buf.append((const char*)&chunk->hdr, sizeof(track_chunkhdr_t));
+    buf.append((const char*)chunk->data, chunk->hdr.length);
+    }
+  return size;
+  }
+
+/**
+ * Decode: iterate over all points in a storage format buffer
+ *  Returns the number of points or -1 on format errors.
+ */
+int TrackRecorder::Decode(const uint8_t* data, size_t size, TrackPointCallback callback)
+  {
+  int points = 0;
+  size_t pos = 0;
+  while (pos + sizeof(track_chunkhdr_t) <= size)
+    {
+    track_chunkhdr_t hdr;
+    memcpy(&hdr, data + pos, sizeof(hdr));
+    pos += sizeof(hdr);
+    if (hdr.magic != TRACK_MAGIC || hdr.version != TRACK_VERSION || pos + hdr.length > size)
+      return -1;
+    const uint8_t* p = data + pos;
+    const uint8_t* end = p + hdr.length;
+    track_point_t pt = {};
+    bool newseg;
+    for (int i = 0; i < hdr.count; i++)
+      {
+      if (!track_decode(p, end, pt, newseg))
+        return -1;
+      callback(pt, newseg);
+      points++;
+      }
+    pos += hdr.length;
+    }
+  return points;
+  }
+
+/**
+ * Export: convert storage format to GPX or GeoJSON, segments become
+ *  GPX track segments / GeoJSON LineString features.
+ *  Returns the number of points or -1 on errors.
+ */
+int TrackRecorder::Export(const std::string& raw, const std::string& format, std::string& out)
+  {
+  bool gpx = (format == "gpx");
+  if (!gpx && format != "geojson")
+    return -1;
+
+  char buf[128];
+  int segments = 0;
+  std::string coords, times;
+  auto endfeature = [&]()
+    {
+    out.append("{\"type\":\"Feature\",\"properties\":{\"coordTimes\":[");
+    out.append(times);
+    out.append("]},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[");
+    out.append(coords);
+    out.append("]}}");
+    coords.clear();
+    times.clear();
+    };
+
+  // Reserve for the point count given by the chunk headers, at about
+  //  96 bytes per GPX point and 52 bytes per GeoJSON point:
+  size_t count = 0;
+  for (size_t pos = 0; pos + sizeof(track_chunkhdr_t) <= raw.size(); )
+    {
+    track_chunkhdr_t hdr;
+    memcpy(&hdr, raw.data() + pos, sizeof(hdr));
+    if (hdr.magic != TRACK_MAGIC)
+      break;
+    count += hdr.count;
+    pos += sizeof(hdr) + hdr.length;
+    }
+  out.reserve(out.size() + 256 + count * (gpx ? 96 : 52));
+  if (gpx)
+    out.append(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<gpx version=\"1.1\" creator=\"OVMS\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+      "<trk><name>OVMS track</name>\n");
+  else
+    out.append("{\"type\":\"FeatureCollection\",\"features\":[");
+
+  int points = Decode((const uint8_t*)raw.data(), raw.size(),
+    [&](const track_point_t& pt, bool newseg)
+    {
+    char ts[24];
+    time_t t = pt.time;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    bool start = (newseg || segments == 0);
+    if (gpx)
+      {
+      if (start)
+        {
+        out.append(segments ? "</trkseg>\n<trkseg>\n" : "<trkseg>\n");
+        segments++;
+        }
+      snprintf(buf, sizeof(buf), "<trkpt lat=\"%.5f\" lon=\"%.5f\"><ele>%d</ele><time>%s</time></trkpt>\n",
+        pt.lat / 1e5, pt.lon / 1e5, pt.alt, ts);
+      out.append(buf);
+      }
+    else
+      {
+      if (start)
+        {
+        if (segments)
+          {
+          endfeature();
+          out.append(1, ',');
+          }
+        segments++;
+        }
+      snprintf(buf, sizeof(buf), "%s[%.5f,%.5f,%d]", coords.empty() ? "" : ",",
+        pt.lon / 1e5, pt.lat / 1e5, pt.alt);
+      coords.append(buf);
+      snprintf(buf, sizeof(buf), "%s\"%s\"", times.empty() ? "" : ",", ts);
+      times.append(buf);
+      }
+    });
+
+  if (gpx)
+    out.append(segments ? "</trkseg>\n</trk>\n</gpx>\n" : "</trk>\n</gpx>\n");
+  else
+    {
+    if (segments)
+      endfeature();
+    out.append("]}\n");
+    }
+  return points;
+  }
+
+int TrackRecorder::LoadFile(const std::string& path, std::string& buf)
+  {
+  FILE* f = fopen(path.c_str(), "r");
+  if (!f)
+    return errno;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  buf.resize(size > 0 ? size : 0);
+  int err = 0;
+  if (size > 0 && fread(&buf[0], size, 1, f) != 1)
+    err = errno ? errno : EIO;
+  fclose(f);
+  return err;
+  }
+
+/**
+ * GetFilePath: map file name / day "YYYYMMDD" to storage path
+ */
+std::string TrackRecorder::GetFilePath(const std::string& name)
+  {
+  if (name.find('/') != std::string::npos)
+    return name;
+  std::string path = m_path + "/" + name;
+  if (!endsWith(name, ".trk"))
+    path.append(".trk");
+  return path;
+  }
+
+void TrackRecorder::ListFiles(std::vector<std::string>& names)
+  {
+  names.clear();
+  if (m_path.empty())
+    return;
+  DIR* dir = opendir(m_path.c_str());
+  if (!dir)
+    return;
+  struct dirent* dp;
+  while ((dp = readdir(dir)) != NULL)
+    {
+    if (endsWith(std::string(dp->d_name), ".trk"))
+      names.push_back(dp->d_name);
+    }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  }
+
+void TrackRecorder::Status(int verbosity, OvmsWriter* writer)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  size_t bytes = 0;
+  int points = 0, unflushed = 0;
+  for (int i = 0; i < m_used; i++)
+    {
+    track_chunk_t* chunk = GetChunk(i);
+    bytes += sizeof(track_chunkhdr_t) + chunk->hdr.length;
+    points += chunk->hdr.count;
+    unflushed += chunk->hdr.count - chunk->flushed_count;
+    }
+
+  writer->printf("Ring: %d of %d chunks used, %d points in %u bytes (%.1f bytes/point)\n",
+    m_used, m_nchunks, points, bytes, points ? (float)bytes / points : 0.0f);
+  if (m_used)
+    {
+    char t1[24], t2[24];
+    time_t t;
+    struct tm tm;
+    t = GetChunk(0)->hdr.start;
+    strftime(t1, sizeof(t1), "%Y-%m-%d %H:%M:%S", gmtime_r(&t, &tm));
+    t = GetChunk(m_used-1)->hdr.end;
+    strftime(t2, sizeof(t2), "%Y-%m-%d %H:%M:%S", gmtime_r(&t, &tm));
+    writer->printf("Period: %s - %s UTC\n", t1, t2);
+    }
+  writer->printf("Samples: %" PRIu32 " received, %" PRIu32 " stored, %" PRIu32 " stationary, %d pending\n",
+    m_samples, m_stored, m_jitter, (int)m_window.size());
+  writer->printf("Simplification: tolerance %.0fm, min distance %.0fm, max gap %ds, sampling every %ds\n",
+    m_tolerance, m_mindist, m_maxgap, m_interval);
+  if (m_path.empty())
+    writer->puts("Storage: disabled");
+  else
+    writer->printf("Storage: %s, %" PRIu32 " points flushed, %d unflushed, %" PRIu32 " overwritten, %" PRIu32 " errors\n",
+      m_path.c_str(), m_flushed, unflushed, m_overwritten, m_flush_errors);
+  }
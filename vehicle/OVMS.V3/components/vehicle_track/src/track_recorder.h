@@ -0,0 +1,152 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __TRACK_RECORDER_H__
+#define __TRACK_RECORDER_H__
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "ovms_mutex.h"
+#include "ovms_command.h"
+
+#define TRACK_CHUNK_SIZE      1024      // Encoded point data per ring chunk [bytes]
+#define TRACK_WINDOW_SIZE     32        // Max points pending in the simplification window
+#define TRACK_MAGIC           0x4b54    // "TK"
+#define TRACK_VERSION         1
+
+/**
+ * Track point: coordinates in 1e-5 degrees (~1.1 m), altitude in m, speed in kph
+ */
+typedef struct
+  {
+  uint32_t time;                        // UTC seconds
+  int32_t lat;
+  int32_t lon;
+  int32_t alt;
+  int32_t speed;
+  } track_point_t;
+
+/**
+ * Chunk header, used in the RAM ring & as the storage file / raw export format.
+ *  Each chunk is decodable on its own: the first record holds absolute values,
+ *  the following records zigzag varint deltas. Each record starts with the
+ *  varint (dt << 1 | newsegment), dt for the first record = absolute time.
+ */
+typedef struct __attribute__ ((packed))
+  {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t flags;
+  uint16_t length;                      // Encoded data bytes following the header
+  uint16_t count;                       // Number of points
+  uint32_t start;                       // Time of first point
+  uint32_t end;                         // Time of last point
+  } track_chunkhdr_t;
+
+typedef struct
+  {
+  track_chunkhdr_t hdr;
+  track_point_t last;                   // Delta base for the next record
+  track_point_t flushbase;              // Delta base for the first unflushed record
+  uint16_t flushed_length;              // Data bytes written to storage
+  uint16_t flushed_count;               // Points written to storage
+  uint32_t seq;                         // Chunk serial, identifies the chunk across ring changes
+  uint8_t data[TRACK_CHUNK_SIZE];
+  } track_chunk_t;
+
+typedef std::function<void(const track_point_t& pt, bool newsegment)> TrackPointCallback;
+
+class TrackRecorder
+  {
+  public:
+    TrackRecorder();
+    ~TrackRecorder();
+
+  public:
+    void Configure(int ringsize_kb, int interval, float tolerance, float mindist,
+                   int maxgap, int seggap, const std::string& path, int flush_interval);
+    void Ticker1(uint32_t ticker);
+    void Sample();
+    void AddSample(const track_point_t& pt);
+    void Finish();
+    int Flush();
+    void Clear();
+    size_t Serialize(std::string& buf);
+    void Status(int verbosity, OvmsWriter* writer);
+
+  public:
+    static int Decode(const uint8_t* data, size_t size, TrackPointCallback callback);
+    static int Export(const std::string& raw, const std::string& format, std::string& out);
+    static int LoadFile(const std::string& path, std::string& buf);
+    std::string GetFilePath(const std::string& name);
+    void ListFiles(std::vector<std::string>& names);
+
+  protected:
+    void Store(const track_point_t& pt);
+    track_chunk_t* NewChunk();
+    track_chunk_t* GetChunk(int index) { return &m_chunks[(m_first + index) % m_nchunks]; }
+
+  public:
+    OvmsRecMutex m_mutex;
+    OvmsMutex m_flush_mutex;            // Serializes Flush() file writes
+    std::string m_path;                 // Storage directory, empty = RAM only
+    int m_interval;                     // Sampling interval [s]
+    float m_tolerance;                  // Max cross track deviation [m]
+    float m_mindist;                    // Min distance to last sample [m]
+    int m_maxgap;                       // Max time between stored points [s]
+    int m_seggap;                       // Min sample gap starting a new segment [s]
+    int m_flush_interval;               // Storage flush interval [s], 0 = manual
+
+  protected:
+    track_chunk_t* m_chunks;            // SPIRAM ring
+    int m_nchunks;
+    int m_first;                        // Oldest chunk
+    int m_used;                         // Chunks in use
+    uint32_t m_chunkseq;                // Last chunk serial assigned
+    bool m_open;                        // Last used chunk open for appending
+
+    track_point_t m_anchor;             // Last stored point
+    bool m_anchor_valid;
+    bool m_newseg;                      // Next stored point starts a segment
+    std::vector<track_point_t> m_window;
+    uint32_t m_lastsample;              // Time of last accepted sample
+    int64_t m_lastgpstime;
+
+  public:
+    uint32_t m_samples;                 // Statistics
+    uint32_t m_jitter;
+    uint32_t m_stored;
+    uint32_t m_overwritten;
+    uint32_t m_flushed;
+    uint32_t m_flush_errors;
+  };
+
+#endif //#ifndef __TRACK_RECORDER_H__
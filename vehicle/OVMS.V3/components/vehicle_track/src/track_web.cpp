@@ -0,0 +1,308 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include <sdkconfig.h>
+#ifdef CONFIG_OVMS_COMP_WEBSERVER
+
+#include "ovms_log.h"
+static const char *TAG = "v-track";
+
+#include <stdio.h>
+#include <string>
+#include "ovms_webserver.h"
+#include "ovms_module.h"
+#include "zlib.h"
+
+#include "vehicle_track.h"
+
+#define _html(text) (c.encode_html(text).c_str())
+
+static OvmsVehicleTrack* GetInstance()
+{
+  if (strcmp(MyVehicleFactory.ActiveVehicleType(), "XX") != 0)
+    return NULL;
+  return (OvmsVehicleTrack*) MyVehicleFactory.ActiveVehicle();
+}
+
+
+/**
+ * WebInit: register pages
+ */
+void OvmsVehicleTrack::WebInit()
+{
+  MyWebServer.RegisterPage("/xtr/track", "Track recorder", WebTrack, PageMenu_Vehicle, PageAuth_Cookie);
+  MyWebServer.RegisterPage("/xtr/trackdata", "Track data", WebTrackData, PageMenu_None, PageAuth_Cookie);
+}
+
+void OvmsVehicleTrack::WebCleanup()
+{
+  MyWebServer.DeregisterPage("/xtr/track");
+  MyWebServer.DeregisterPage("/xtr/trackdata");
+}
+
+
+/**
+ * WebTrack: recorder status & downloads (URL /xtr/track)
+ */
+void OvmsVehicleTrack::WebTrack(PageEntry_t& p, PageContext_t& c)
+{
+  OvmsVehicleTrack* trk = GetInstance();
+  if (!trk) {
+    c.error(404, "TRACK vehicle module not loaded");
+    return;
+  }
+
+  std::vector<std::string> names;
+  trk->m_recorder.ListFiles(names);
+  names.insert(names.begin(), "ring");
+
+  c.head(200);
+  c.panel_start("primary", "Track recorder");
+  c.printf("<samp>%s</samp>", _html(MyWebServer.StatusText("xtr", "xtr status")));
+  c.print(
+    "<table class=\"table table-condensed\">"
+      "<thead><tr><th>Source</th><th>Download</th></tr></thead>"
+      "<tbody>");
+  for (auto it = names.rbegin(); it != names.rend(); ++it) {
+    std::string src = c.encode_html(*it);
+    c.printf(
+      "<tr><td>%s</td><td>"
+        "<a href=\"/xtr/trackdata?src=%s&format=gpx\" download>GPX</a> | "
+        "<a href=\"/xtr/trackdata?src=%s&format=geojson\" download>GeoJSON</a> | "
+        "<a href=\"/xtr/trackdata?src=%s&format=raw&z=1\" download>Raw (zlib)</a>"
+      "</td></tr>"
+      , src.c_str(), src.c_str(), src.c_str(), src.c_str());
+  }
+  c.print("</tbody></table>");
+  c.panel_end(
+    "<p>The ring holds the recent track in RAM, files hold the flushed points per UTC day.</p>"
+    "<p>Configure using <code>config set xtr track.…</code>, see user guide for details.</p>");
+  c.done();
+}
+
+
+/**
+ * WebTrackData: track download (URL /xtr/trackdata)
+ *  Parameters:
+ *    src     'ring' (default) or stored file / day (YYYYMMDD)
+ *    format  'gpx' (default), 'geojson' or 'raw'
+ *    z       '1' = zlib compress the result
+ *
+ *  The ring is copied here, loading files, the export & compression are
+ *  done by a TrackDataStream worker task to keep the network task free.
+ *  Note: this is a pull endpoint only, the module does not push the track
+ *  on reconnects, as neither server protocol has a track upload message.
+ */
+void OvmsVehicleTrack::WebTrackData(PageEntry_t& p, PageContext_t& c)
+{
+  OvmsVehicleTrack* trk = GetInstance();
+  if (!trk) {
+    c.error(404, "TRACK vehicle module not loaded");
+    return;
+  }
+
+  std::string src = c.getvar("src");
+  std::string format = c.getvar("format");
+  bool deflate = (c.getvar("z") == "1");
+  std::string* raw = NULL;
+  std::string path;
+
+  if (src.empty() || src == "ring") {
+    src = "ring";
+    raw = new std::string();
+    trk->m_recorder.Serialize(*raw);
+  }
+  else {
+    if (src.find_first_of("/\\") != std::string::npos || src.find("..") != std::string::npos) {
+      c.error(400, "Invalid source");
+      return;
+    }
+    path = trk->m_recorder.GetFilePath(src);
+    if (endsWith(src, ".trk"))
+      src.resize(src.size() - 4);
+  }
+
+  if (format != "raw" && format != "geojson")
+    format = "gpx";
+
+  new TrackDataStream(c.nc, raw, path, src, format, deflate);
+}
+
+
+/**
+ * TrackDataStream: export worker for WebTrackData
+ *  The worker task owns the instance: it deletes it after the result has
+ *  been handed over to a HttpStringSender or the connection has been closed.
+ */
+TrackDataStream::TrackDataStream(mg_connection* nc, std::string* raw, const std::string& path,
+    const std::string& src, const std::string& format, bool deflate)
+  : MgHandler(nc)
+{
+  m_raw = raw;
+  m_path = path;
+  m_src = src;
+  m_format = format;
+  m_deflate = deflate;
+
+  TaskHandle_t task = NULL;
+  if (xTaskCreatePinnedToCore(ExportTask, "OVMS TrackExport",
+      CONFIG_OVMS_SYS_COMMAND_STACK_SIZE, (void*)this,
+      CONFIG_OVMS_SYS_COMMAND_PRIORITY, &task, CORE(1)) != pdPASS) {
+    ESP_LOGE(TAG, "TrackDataStream: cannot create export task");
+    m_code = 503;
+    m_error = "Export task not available";
+    m_done = true;
+    return;
+  }
+  m_task = task;
+  AddTaskToMap(task);
+}
+
+TrackDataStream::~TrackDataStream()
+{
+  delete m_raw;
+  delete m_out;
+}
+
+void TrackDataStream::ExportTask(void* object)
+{
+  TrackDataStream* me = (TrackDataStream*) object;
+
+  me->Export();
+  me->m_done = true;
+  me->RequestPoll();
+
+  // wait for the network task to take over the result or detach:
+  while (me->m_nc)
+    vTaskDelay(10/portTICK_PERIOD_MS);
+  delete me;
+  vTaskDelete(NULL);
+}
+
+void TrackDataStream::Export()
+{
+  std::string raw;
+  if (m_raw) {
+    raw.swap(*m_raw);
+    delete m_raw;
+    m_raw = NULL;
+  }
+  else if (TrackRecorder::LoadFile(m_path, raw) != 0) {
+    m_code = 404;
+    m_error = "Track not found";
+    return;
+  }
+
+  m_out = new std::string();
+  if (m_format == "raw") {
+    m_out->swap(raw);
+    m_type = "application/octet-stream";
+    m_ext = "trk";
+  }
+  else {
+    if (m_format == "geojson") {
+      m_type = "application/geo+json";
+      m_ext = "geojson";
+    } else {
+      m_type = "application/gpx+xml";
+      m_ext = "gpx";
+    }
+    if (TrackRecorder::Export(raw, m_format, *m_out) < 0) {
+      m_code = 500;
+      m_error = "Invalid track data";
+      return;
+    }
+    raw.clear();
+    raw.shrink_to_fit();
+  }
+
+  if (m_deflate) {
+    uLongf zlen = compressBound(m_out->size());
+    std::string* zout = new std::string(zlen, '\0');
+    if (compress2((Bytef*)&(*zout)[0], &zlen, (const Bytef*)m_out->data(), m_out->size(), Z_DEFAULT_COMPRESSION) == Z_OK) {
+      zout->resize(zlen);
+      delete m_out;
+      m_out = zout;
+      m_type = "application/zlib";
+    } else {
+      delete zout;
+      m_deflate = false;
+    }
+  }
+
+  m_code = 200;
+}
+
+int TrackDataStream::HandleEvent(int ev, void* p)
+{
+  switch (ev)
+  {
+    case MG_EV_POLL:
+      if (m_done && m_nc) {
+        mg_connection* nc = m_nc;
+        if (m_code != 200) {
+          mg_http_send_error(nc, m_code, m_error);
+          nc->user_data = NULL;
+        }
+        else {
+          char shead[200];
+          snprintf(shead, sizeof(shead),
+            "Content-Type: %s\r\n"
+            "Content-Disposition: attachment; filename=\"track-%s.%s%s\"\r\n"
+            "Cache-Control: no-cache"
+            , m_type, m_src.c_str(), m_ext, m_deflate ? ".z" : "");
+          mg_send_head(nc, 200, -1, shead);
+          new HttpStringSender(nc, m_out);
+          m_out = NULL;
+        }
+        bool notask = (m_task == NULL);
+        m_nc = NULL;      // the task may delete us from here on
+        if (notask)
+          delete this;
+      }
+      break;
+
+    case MG_EV_CLOSE:
+      // connection closed before the result was ready: detach, the task
+      // deletes the instance when done (without task, the framework does)
+      m_nc->user_data = NULL;
+      m_nc = NULL;
+      if (m_task)
+        ev = 0;           // prevent deletion by main event handler
+      break;
+
+    default:
+      break;
+  }
+
+  return ev;
+}
+
+#endif //CONFIG_OVMS_COMP_WEBSERVER
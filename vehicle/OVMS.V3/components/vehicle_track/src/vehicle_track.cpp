@@ -32,16 +32,246 @@
 static const char *TAG = "v-track";
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "vehicle_track.h"
+#include "ovms_config.h"
+#include "ovms_events.h"
+#include "ovms_status.h"
+#include "metrics_standard.h"
+
+/**
+ * Shell commands
+ */
+
+static OvmsVehicleTrack* GetTrackVehicle(OvmsWriter* writer)
+  {
+  OvmsVehicleTrack* trk = (OvmsVehicleTrack*) MyVehicleFactory.ActiveVehicle();
+  if (!trk || strcmp(MyVehicleFactory.ActiveVehicleType(), "XX") != 0)
+    {
+    writer->puts("ERROR: TRACK vehicle module not loaded");
+    return NULL;
+    }
+  return trk;
+  }
+
+// Load the ring ("ring" or no source) or a storage file:
+static bool LoadTrack(OvmsWriter* writer, TrackRecorder& rec, const char* source, std::string& raw)
+  {
+  if (!source || strcmp(source, "ring") == 0)
+    {
+    rec.Serialize(raw);
+    return true;
+    }
+  std::string path = rec.GetFilePath(source);
+  int err = TrackRecorder::LoadFile(path, raw);
+  if (err)
+    {
+    writer->printf("ERROR: cannot read '%s': %s\n", path.c_str(), strerror(err));
+    return false;
+    }
+  return true;
+  }
+
+static void xtr_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  OvmsVehicleTrack* trk = GetTrackVehicle(writer);
+  if (!trk) return;
+  trk->m_recorder.Status(verbosity, writer);
+  }
+
+static void xtr_files(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  OvmsVehicleTrack* trk = GetTrackVehicle(writer);
+  if (!trk) return;
+  std::vector<std::string> names;
+  trk->m_recorder.ListFiles(names);
+  for (auto& name : names)
+    {
+    struct stat st;
+    std::string path = trk->m_recorder.GetFilePath(name);
+    writer->printf("%-16s %8ld\n", name.c_str(), (stat(path.c_str(), &st) == 0) ? (long)st.st_size : 0L);
+    }
+  writer->printf("%d file(s)\n", (int)names.size());
+  }
+
+static void xtr_flush(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  OvmsVehicleTrack* trk = GetTrackVehicle(writer);
+  if (!trk) return;
+  if (trk->m_recorder.m_path.empty())
+    {
+    writer->puts("ERROR: storage disabled (config xtr track.path)");
+    return;
+    }
+  trk->m_recorder.Finish();
+  int cnt = trk->m_recorder.Flush();
+  if (cnt < 0)
+    writer->printf("ERROR: storage %s not available\n", trk->m_recorder.m_path.c_str());
+  else
+    writer->printf("%d points written\n", cnt);
+  }
+
+static void xtr_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  OvmsVehicleTrack* trk = GetTrackVehicle(writer);
+  if (!trk) return;
+  trk->m_recorder.Clear();
+  writer->puts("Track ring cleared");
+  }
+
+static void xtr_export(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  OvmsVehicleTrack* trk = GetTrackVehicle(writer);
+  if (!trk) return;
+  std::string raw, out;
+  if (!LoadTrack(writer, trk->m_recorder, (argc > 0) ? argv[0] : NULL, raw))
+    return;
+  if (TrackRecorder::Export(raw, cmd->GetName(), out) < 0)
+    {
+    writer->puts("ERROR: invalid track data");
+    return;
+    }
+  writer->write(out.data(), out.size());
+  }
+
+static void xtr_save(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  OvmsVehicleTrack* trk = GetTrackVehicle(writer);
+  if (!trk) return;
+  std::string raw, out;
+  const char* format = cmd->GetName();
+  if (MyConfig.ProtectedPath(argv[0]))
+    {
+    writer->puts("ERROR: protected path");
+    return;
+    }
+  if (!LoadTrack(writer, trk->m_recorder, (argc > 1) ? argv[1] : NULL, raw))
+    return;
+  int cnt = -1;
+  if (strcmp(format, "raw") == 0)
+    cnt = TrackRecorder::Decode((const uint8_t*)raw.data(), raw.size(), [](const track_point_t& pt, bool newseg) {});
+  if (cnt >= 0)
+    out.swap(raw);
+  else
+    cnt = TrackRecorder::Export(raw, format, out);
+  if (cnt < 0)
+    {
+    writer->puts("ERROR: invalid track data");
+    return;
+    }
+  FILE* f = fopen(argv[0], "w");
+  if (!f || fwrite(out.data(), out.size(), 1, f) != 1)
+    writer->printf("ERROR: cannot write '%s': %s\n", argv[0], strerror(errno));
+  else
+    writer->printf("%d points saved to %s (%u bytes)\n", cnt, argv[0], out.size());
+  if (f)
+    fclose(f);
+  }
 
 OvmsVehicleTrack::OvmsVehicleTrack()
   {
   ESP_LOGI(TAG, "Generic TRACK vehicle module");
+
+  m_flush_pending = false;
+
+  MyConfig.RegisterParam("xtr", "TRACK vehicle", true, true);
+  ConfigChanged(NULL);
+
+  cmd_xtr = MyCommandApp.RegisterCommand("xtr", "TRACK vehicle");
+  OvmsCommand* cmd_status = cmd_xtr->RegisterCommand("status", "Show track recorder status", xtr_status);
+  cmd_xtr->RegisterCommand("files", "List stored track files", xtr_files);
+  cmd_xtr->RegisterCommand("flush", "End segment & write track to storage", xtr_flush);
+  cmd_xtr->RegisterCommand("clear", "Clear track ring", xtr_clear);
+  OvmsCommand* cmd_export = cmd_xtr->RegisterCommand("export", "Output track");
+  cmd_export->RegisterCommand("gpx", "Output track as GPX", xtr_export, "[<source>]\n"
+    "<source>: 'ring' (default) or stored file / day (YYYYMMDD)", 0, 1);
+  cmd_export->RegisterCommand("geojson", "Output track as GeoJSON", xtr_export, "[<source>]\n"
+    "<source>: 'ring' (default) or stored file / day (YYYYMMDD)", 0, 1);
+  OvmsCommand* cmd_save = cmd_xtr->RegisterCommand("save", "Save track to file");
+  cmd_save->RegisterCommand("gpx", "Save track as GPX", xtr_save, "<path> [<source>]", 1, 2);
+  cmd_save->RegisterCommand("geojson", "Save track as GeoJSON", xtr_save, "<path> [<source>]", 1, 2);
+  cmd_save->RegisterCommand("raw", "Save track in compact binary format", xtr_save, "<path> [<source>]", 1, 2);
+
+  MyStatus.RegisterCommand("xtr", TAG, 5000, cmd_status);
+
+  #undef bind  // Kludgy, but works
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  MyEvents.RegisterEvent(TAG, "sd.unmounting", std::bind(&OvmsVehicleTrack::EventListener, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "system.shuttingdown", std::bind(&OvmsVehicleTrack::EventListener, this, _1, _2));
+
+#ifdef CONFIG_OVMS_COMP_WEBSERVER
+  WebInit();
+#endif
   }
 
 OvmsVehicleTrack::~OvmsVehicleTrack()
   {
   ESP_LOGI(TAG, "Shutdown TRACK vehicle module");
+#ifdef CONFIG_OVMS_COMP_WEBSERVER
+  WebCleanup();
+#endif
+  MyEvents.DeregisterEvent(TAG);
+  MyStatus.Deregister(TAG);
+  MyCommandApp.UnregisterCommand("xtr");
+  m_recorder.Finish();
+  m_recorder.Flush();
+  }
+
+void OvmsVehicleTrack::ConfigChanged(OvmsConfigParam* param)
+  {
+  if (param && param->GetName() != "xtr")
+    return;
+
+  // Instances:
+  // xtr
+  //  track.interval        Sampling interval [s] (Default: 5)
+  //  track.tolerance       Max deviation from the simplified track [m] (Default: 10)
+  //  track.mindist         Min distance to the last sample [m] (Default: 5)
+  //  track.maxgap          Max time between stored points [s] (Default: 300)
+  //  track.seggap          Min sampling gap starting a new segment [s] (Default: 600)
+  //  track.ringsize        RAM ring size [KB] (Default: 64)
+  //  track.path            Storage directory, empty = RAM only (Default: /sd/track)
+  //  track.flush           Storage flush interval [s], 0 = manual (Default: 600)
+  m_recorder.Configure(
+    MyConfig.GetParamValueInt("xtr", "track.ringsize", 64),
+    MyConfig.GetParamValueInt("xtr", "track.interval", 5),
+    MyConfig.GetParamValueFloat("xtr", "track.tolerance", 10),
+    MyConfig.GetParamValueFloat("xtr", "track.mindist", 5),
+    MyConfig.GetParamValueInt("xtr", "track.maxgap", 300),
+    MyConfig.GetParamValueInt("xtr", "track.seggap", 600),
+    MyConfig.GetParamValue("xtr", "track.path", "/sd/track"),
+    MyConfig.GetParamValueInt("xtr", "track.flush", 600));
+  }
+
+void OvmsVehicleTrack::Ticker1(uint32_t ticker)
+  {
+  m_recorder.Ticker1(ticker);
+  if (m_flush_pending)
+    {
+    m_flush_pending = false;
+    m_recorder.Flush();
+    }
+  }
+
+void OvmsVehicleTrack::MetricModified(OvmsMetric* metric)
+  {
+  OvmsVehicle::MetricModified(metric);
+
+  // End the segment & flush when the vehicle is switched off:
+  if (metric == StandardMetrics.ms_v_env_on && !StandardMetrics.ms_v_env_on->AsBool())
+    {
+    m_recorder.Finish();
+    m_flush_pending = true;
+    }
+  }
+
+void OvmsVehicleTrack::EventListener(std::string event, void* data)
+  {
+  m_recorder.Finish();
+  m_recorder.Flush();
   }
 
 class OvmsVehicleTrackInit
@@ -32,14 +32,72 @@
 #define __VEHICLE_TRACK_H__
 
 #include "vehicle.h"
+#include "track_recorder.h"
+#ifdef CONFIG_OVMS_COMP_WEBSERVER
+#include "ovms_webserver.h"
+#endif
 
 using namespace std;
 
+#ifdef CONFIG_OVMS_COMP_WEBSERVER
+/**
+ * TrackDataStream: track download, loads, exports & compresses the
+ *  track in a worker task, then hands the result to a HttpStringSender.
+ */
+class TrackDataStream : public MgHandler
+  {
+  public:
+    TrackDataStream(mg_connection* nc, std::string* raw, const std::string& path,
+                    const std::string& src, const std::string& format, bool deflate);
+    ~TrackDataStream();
+
+  public:
+    int HandleEvent(int ev, void* p);
+    static void ExportTask(void* object);
+    void Export();
+
+  public:
+    std::string*              m_raw;          // ring data or NULL = load m_path
+    std::string               m_path;
+    std::string               m_src;
+    std::string               m_format;
+    bool                      m_deflate;
+    std::string*              m_out = NULL;
+    int                       m_code = 0;     // HTTP status, 0 = in progress
+    const char*               m_error = NULL;
+    const char*               m_type = NULL;
+    const char*               m_ext = NULL;
+    TaskHandle_t              m_task = NULL;
+    volatile bool             m_done = false;
+  };
+#endif //CONFIG_OVMS_COMP_WEBSERVER
+
 class OvmsVehicleTrack : public OvmsVehicle
   {
   public:
     OvmsVehicleTrack();
     ~OvmsVehicleTrack();
+
+  public:
+    void Ticker1(uint32_t ticker) override;
+    void ConfigChanged(OvmsConfigParam* param) override;
+    void MetricModified(OvmsMetric* metric) override;
+    void EventListener(std::string event, void* data);
+
+  public:
+    TrackRecorder m_recorder;
+
+  protected:
+    OvmsCommand* cmd_xtr;
+    bool m_flush_pending;
+
+#ifdef CONFIG_OVMS_COMP_WEBSERVER
+  public:
+    void WebInit();
+    void WebCleanup();
+    static void WebTrack(PageEntry_t& p, PageContext_t& c);
+    static void WebTrackData(PageEntry_t& p, PageContext_t& c);
+#endif //CONFIG_OVMS_COMP_WEBSERVER
   };
 
 #endif //#ifndef __VEHICLE_TRACK_H__
@@ -30,6 +30,7 @@
 
 #include "vfsedit.h"
 #include "openemacs.h"
+#include "ovms_events.h"
 
 size_t vfs_edit_write(struct editor_state* E, const char *buf, size_t nbyte)
   {
@@ -45,8 +46,11 @@ bool vfs_edit_insert(OvmsWriter* writer, void* ctx, char ch)
   editor_process_keypress(ed, ch);
   if (ed->editor_completed)
     {
+    std::string path = ed->filename ? ed->filename : "";
     editor_free(ed);
     free(ed);
+    if (!path.empty())
+      MyEvents.SignalEvent("system.vfs.file.changed", (void*)path.c_str(), path.size()+1);
     return false;
     }
   else
@@ -127,7 +127,7 @@ ssize_t BufferedShell::write(const void *buf, size_t nbyte)
     {
     if (m_left == 0)
       {
-      m_buffer = (char*)ExternalRamMalloc(BUFFER_SIZE);
+      m_buffer = (char*)MyPools.Alloc(BUFFER_SIZE);
       m_left = BUFFER_SIZE - 1;
       m_output->append(m_buffer);
       }
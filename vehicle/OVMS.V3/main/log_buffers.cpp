@@ -44,14 +44,14 @@ LogBuffers::~LogBuffers()
   // Free all the buffers in the list.
   for (iterator itr = begin(); itr != end(); ++itr)
     {
-    free(*itr);
+    MyPools.Free(*itr);
     }
   }
 
 int LogBuffers::append(const char* fmt, va_list args)
   {
   char *buffer;
-  int ret = vasprintf(&buffer, fmt, args);
+  int ret = MyPools.vasprintf(&buffer, fmt, args);
   if (ret >= 0)
     append(buffer);
   return ret;
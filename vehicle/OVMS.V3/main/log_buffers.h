@@ -33,8 +33,10 @@
 #include <forward_list>
 #include <map>
 #include <atomic>
+#include "ovms_pool.h"
 
-class LogBuffers : public std::forward_list<char*>
+// The text chunks are allocated from MyPools and owned by the LogBuffers
+class LogBuffers : public std::forward_list<char*>, public OvmsPoolAllocated
   {
   public:
     LogBuffers();
@@ -44,6 +44,16 @@ MetricsStandard::MetricsStandard()
   ms_m_freeram = new OvmsMetricInt(MS_M_FREERAM, SM_STALE_MID);
   ms_m_monotonic = new OvmsMetricInt(MS_M_MONOTONIC, SM_STALE_MIN, Seconds);
   ms_m_timeutc = new OvmsMetricInt64(MS_M_TIME_UTC, SM_STALE_MIN, DateUTC);
+  ms_m_task_names = new OvmsMetricString(MS_M_TASK_NAMES);
+  ms_m_task_cpu = new OvmsMetricVector<float>(MS_M_TASK_CPU, SM_STALE_NONE, Percentage);
+  ms_m_task_stack = new OvmsMetricVector<int>(MS_M_TASK_STACK);
+  ms_m_cpu_idle = new OvmsMetricVector<float>(MS_M_CPU_IDLE, SM_STALE_NONE, Percentage);
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+  ms_m_heap_tags = new OvmsMetricString(MS_M_HEAP_TAGS);
+  ms_m_heap_current = new OvmsMetricVector<int>(MS_M_HEAP_CURRENT, SM_STALE_MID);
+  ms_m_heap_peak = new OvmsMetricVector<int>(MS_M_HEAP_PEAK, SM_STALE_MID);
+  ms_m_heap_count = new OvmsMetricVector<int>(MS_M_HEAP_COUNT, SM_STALE_MID);
+#endif //CONFIG_OVMS_DEV_HEAPTAGS
 
   ms_m_net_type = new OvmsMetricString(MS_N_TYPE, SM_STALE_MAX);
   ms_m_net_sq = new OvmsMetricInt(MS_N_SQ, SM_STALE_MAX, dbm);
@@ -53,6 +63,12 @@ MetricsStandard::MetricsStandard()
   ms_m_net_good_sq = new OvmsMetricBool(MS_N_GOOD_SQ);
   ms_m_net_wifi_sq = new OvmsMetricFloat(MS_N_WIFI_SQ, SM_STALE_MAX, dbm);
   ms_m_net_wifi_network = new OvmsMetricString(MS_N_WIFI_NETWORK, SM_STALE_MAX);
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+  ms_m_net_prof_names = new OvmsMetricString(MS_N_PROF_NAMES);
+  ms_m_net_prof_count = new OvmsMetricVector<int>(MS_N_PROF_COUNT, SM_STALE_MID);
+  ms_m_net_prof_avg = new OvmsMetricVector<int>(MS_N_PROF_AVG, SM_STALE_MID);
+  ms_m_net_prof_max = new OvmsMetricVector<int>(MS_N_PROF_MAX, SM_STALE_MID);
+#endif //CONFIG_OVMS_DEV_NETMAN_PROFILE
   ms_m_net_mdm_sq = new OvmsMetricFloat(MS_N_MDM_SQ, SM_STALE_MAX, dbm);
   ms_m_net_mdm_netreg = new OvmsMetricString(MS_N_MDM_NETREG);
   ms_m_net_mdm_network = new OvmsMetricString(MS_N_MDM_NETWORK, SM_STALE_MAX);
@@ -47,6 +47,16 @@
 #define MS_M_FREERAM                "m.freeram"
 #define MS_M_MONOTONIC              "m.monotonic"
 #define MS_M_TIME_UTC               "m.time.utc"
+#define MS_M_TASK_NAMES             "m.task.names"
+#define MS_M_TASK_CPU               "m.task.cpu"
+#define MS_M_TASK_STACK             "m.task.stack"
+#define MS_M_CPU_IDLE               "m.cpu.idle"
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+#define MS_M_HEAP_TAGS              "m.heap.tags"
+#define MS_M_HEAP_CURRENT           "m.heap.current"
+#define MS_M_HEAP_PEAK              "m.heap.peak"
+#define MS_M_HEAP_COUNT             "m.heap.count"
+#endif //CONFIG_OVMS_DEV_HEAPTAGS
 
 #define MS_N_TYPE                   "m.net.type"
 #define MS_N_SQ                     "m.net.sq"
@@ -62,6 +72,12 @@
 #define MS_N_MDM_MODE               "m.net.mdm.mode"
 #define MS_N_WIFI_NETWORK           "m.net.wifi.network"
 #define MS_N_WIFI_SQ                "m.net.wifi.sq"
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+#define MS_N_PROF_NAMES             "m.net.prof.names"
+#define MS_N_PROF_COUNT             "m.net.prof.count"
+#define MS_N_PROF_AVG               "m.net.prof.avg"
+#define MS_N_PROF_MAX               "m.net.prof.max"
+#endif //CONFIG_OVMS_DEV_NETMAN_PROFILE
 
 #ifdef CONFIG_OVMS_COMP_MAX7317
 #define MS_M_EGPIO_INPUT            "m.egpio.input"
@@ -288,12 +304,28 @@ class MetricsStandard
     OvmsMetricInt*    ms_m_freeram;
     OvmsMetricInt*    ms_m_monotonic;
     OvmsMetricInt64*  ms_m_timeutc;
+    OvmsMetricString* ms_m_task_names;                    // Task names sampled (comma separated)
+    OvmsMetricVector<float>* ms_m_task_cpu;               // …CPU share per task [% of one core]
+    OvmsMetricVector<int>* ms_m_task_stack;               // …minimum free stack per task [bytes]
+    OvmsMetricVector<float>* ms_m_cpu_idle;               // Idle share per core [%]
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+    OvmsMetricString* ms_m_heap_tags;                     // Heap tag names (comma separated)
+    OvmsMetricVector<int>* ms_m_heap_current;             // …bytes allocated per tag
+    OvmsMetricVector<int>* ms_m_heap_peak;                // …peak bytes allocated per tag
+    OvmsMetricVector<int>* ms_m_heap_count;               // …blocks allocated per tag
+#endif //CONFIG_OVMS_DEV_HEAPTAGS
 
     OvmsMetricString* ms_m_net_type;                      // none, wifi, modem
     OvmsMetricInt*    ms_m_net_sq;                        // Network signal quality [dbm]
     OvmsMetricString* ms_m_net_provider;                  // Network provider name
     OvmsMetricString* ms_m_net_wifi_network;              // Wifi network SSID
     OvmsMetricFloat*  ms_m_net_wifi_sq;                   // Wifi network signal quality [dbm]
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+    OvmsMetricString* ms_m_net_prof_names;                // Mongoose task profile types (comma separated)
+    OvmsMetricVector<int>* ms_m_net_prof_count;           // …handler calls per type in last minute
+    OvmsMetricVector<int>* ms_m_net_prof_avg;             // …average handler time per type [us]
+    OvmsMetricVector<int>* ms_m_net_prof_max;             // …maximum handler time per type [us]
+#endif //CONFIG_OVMS_DEV_NETMAN_PROFILE
     OvmsMetricString* ms_m_net_mdm_netreg;                // Modem network registration state
     OvmsMetricString* ms_m_net_mdm_network;               // Modem network operator
     OvmsMetricFloat*  ms_m_net_mdm_sq;                    // Modem network signal quality [dbm]
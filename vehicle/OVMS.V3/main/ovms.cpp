@@ -49,12 +49,12 @@ void * operator new[](size_t size)
 
 static void* ExternalRamAllocated::operator new(std::size_t sz)
   {
-  return ExternalRamMalloc(sz);
+  return ExternalRamMallocTagged(sz, HEAPTAG_CURRENT);
   }
 
 static void* ExternalRamAllocated::operator new[](std::size_t sz)
   {
-  return ExternalRamMalloc(sz);
+  return ExternalRamMallocTagged(sz, HEAPTAG_CURRENT);
   }
 
 char* ExternalRamAllocated::strdup(const char* src)
@@ -111,12 +111,12 @@ int ExternalRamAllocated::vasprintf(char** strp, const char* fmt, va_list ap)
 
 static void* InternalRamAllocated::operator new(std::size_t sz)
   {
-  return InternalRamMalloc(sz);
+  return InternalRamMallocTagged(sz, HEAPTAG_CURRENT);
   }
 
 static void* InternalRamAllocated::operator new[](std::size_t sz)
   {
-  return InternalRamMalloc(sz);
+  return InternalRamMallocTagged(sz, HEAPTAG_CURRENT);
   }
 
 char* InternalRamAllocated::strdup(const char* src)
@@ -92,6 +92,10 @@ class ExternalRamAllocated
   public:
     static void* operator new(std::size_t sz);
     static void* operator new[](std::size_t sz);
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+    static void operator delete(void* p) { RamFreeTagged(p); }
+    static void operator delete[](void* p) { RamFreeTagged(p); }
+#endif
     static char* strdup(const char* src);
     static int asprintf(char** strp, const char* fmt, ...) __attribute__ ((format (printf, 2, 3)));
     static int vasprintf(char** strp, const char* fmt, va_list ap) __attribute__ ((format (printf, 2, 0)));
@@ -102,6 +106,10 @@ class InternalRamAllocated
   public:
     static void* operator new(std::size_t sz);
     static void* operator new[](std::size_t sz);
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+    static void operator delete(void* p) { RamFreeTagged(p); }
+    static void operator delete[](void* p) { RamFreeTagged(p); }
+#endif
     static char* strdup(const char* src);
     static int asprintf(char** strp, const char* fmt, ...) __attribute__ ((format (printf, 2, 3)));
     static int vasprintf(char** strp, const char* fmt, va_list ap) __attribute__ ((format (printf, 2, 0)));
@@ -116,10 +124,10 @@ struct ExtRamAllocator
   template <class U> constexpr ExtRamAllocator(const ExtRamAllocator<U>&) noexcept {}
   T* allocate(std::size_t n)
     {
-    auto p = static_cast<T*>(ExternalRamMalloc(n*sizeof(T)));
+    auto p = static_cast<T*>(ExternalRamMallocTagged(n*sizeof(T), HEAPTAG_CURRENT));
     return p;
     }
-  void deallocate(T* p, std::size_t) noexcept { std::free(p); }
+  void deallocate(T* p, std::size_t) noexcept { RamFreeTagged(p); }
   };
 template <class T, class U>
 bool operator==(const ExtRamAllocator<T>&, const ExtRamAllocator<U>&) { return true; }
@@ -54,6 +54,7 @@ static const char *TAG = "boot";
 #include "ovms.h"
 #include "ovms_boot.h"
 #include "ovms_command.h"
+#include "ovms_status.h"
 #include "ovms_metrics.h"
 #include "ovms_notify.h"
 #include "ovms_config.h"
@@ -434,6 +435,7 @@ Boot::Boot()
   OvmsCommand* cmd_boot = MyCommandApp.RegisterCommand("boot","BOOT framework",boot_status, "", 0, 0, false);
   cmd_boot->RegisterCommand("status","Show boot system status",boot_status,"", 0, 0, false);
   cmd_boot->RegisterCommand("clear","Clear/reset boot system status",boot_clear,"", 0, 0, false);
+  MyStatus.RegisterCommand("boot", TAG, 10000, cmd_boot);
   }
 
 Boot::~Boot()
@@ -51,6 +51,7 @@ static const char *TAG = "command";
 #include "ovms_script.h"
 #include "buffered_shell.h"
 #include "log_buffers.h"
+#include "ovms_crashlog.h"
 #include "ovms_semaphore.h"
 #include "ovms_vfs.h"
 
@@ -425,6 +426,7 @@ char ** OvmsCommand::Complete(OvmsWriter* writer, int argc, const char * const *
 
 void OvmsCommand::Execute(int verbosity, OvmsWriter* writer, int argc, const char * const * argv)
   {
+  OvmsHeapTag heaptag(HEAPTAG_COMMAND);
 //  if (argc>0)
 //    {
 //    printf("Execute(%s/%d) verbosity=%d argc=%d first=%s\n",m_title, m_children.size(), verbosity,argc,argv[0]);
@@ -1023,7 +1025,7 @@ int OvmsCommandApp::LogPartial(const char* fmt, ...)
 int OvmsCommandApp::LogBuffer(LogBuffers* lb, const char* fmt, va_list args)
   {
   char *buffer;
-  int ret = vasprintf(&buffer, fmt, args);
+  int ret = MyPools.vasprintf(&buffer, fmt, args);
   if (ret < 0) return ret;
 
   // Replace CR/LF except last by "|", but don't leave '|' at the end.
@@ -1048,6 +1050,9 @@ int OvmsCommandApp::LogBuffer(LogBuffers* lb, const char* fmt, va_list args)
       }
     }
 
+#ifdef CONFIG_OVMS_SYS_CRASHLOG
+  MyCrashLog.RecordLog(buffer);
+#endif
   lb->append(buffer);
   return ret;
   }
@@ -0,0 +1,358 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2026  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "crashlog";
+
+#include <string.h>
+#include <inttypes.h>
+#include "rom/rtc.h"
+#include "esp_attr.h"
+#include "ovms.h"
+#include "ovms_crashlog.h"
+#include "ovms_malloc.h"
+
+#ifdef CONFIG_OVMS_SYS_CRASHLOG
+
+#define CRASHLOG_MAXLINE          256     // max bytes recorded per log call
+
+RTC_NOINIT_ATTR crashlog_data_t   crashlog;   // persistent log tail container
+
+OvmsCrashLog MyCrashLog __attribute__ ((init_priority (1020)));
+
+static uint32_t crashlog_sum(const void* data, size_t len)
+  {
+  const uint8_t* p = (const uint8_t*) data;
+  uint32_t sum = 0;
+  while (len--)
+    sum += *p++;
+  return sum;
+  }
+
+static void crashlog_cmd_show(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyCrashLog.OutputPrevious(writer, verbosity);
+  }
+
+static void crashlog_cmd_current(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyCrashLog.OutputCurrent(writer, verbosity);
+  }
+
+static void crashlog_cmd_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyCrashLog.ClearPrevious();
+  writer->puts("Post-mortem crash log has been cleared.");
+  }
+
+static void crashlog_cmd_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyCrashLog.Status(writer);
+  }
+
+OvmsCrashLog::OvmsCrashLog()
+  {
+  ESP_LOGI(TAG, "Initialising CRASHLOG (1020)");
+
+  m_mux = portMUX_INITIALIZER_UNLOCKED;
+  m_invalid_reason = NULL;
+  m_prev_log = NULL;
+  m_prev_loglen = 0;
+  m_prev_events = NULL;
+  m_prev_evcount = 0;
+  m_prev_uptime = 0;
+
+  // Take a post-mortem copy of the previous session's log tail:
+  if (rtc_get_reset_reason(0) == POWERON_RESET)
+    m_invalid_reason = "power on";
+  else if (Validate())
+    {
+    m_prev_log = Linearize(&m_prev_loglen);
+    m_prev_evcount = crashlog.evcount;
+    m_prev_uptime = crashlog.uptime;
+    if (m_prev_evcount > 0)
+      {
+      m_prev_events = (crashlog_event_t*) ExternalRamMalloc(m_prev_evcount * sizeof(crashlog_event_t));
+      if (m_prev_events)
+        {
+        // copy oldest first:
+        int start = (crashlog.evpos + CRASHLOG_EVENTS - m_prev_evcount) % CRASHLOG_EVENTS;
+        for (int i = 0; i < m_prev_evcount; i++)
+          m_prev_events[i] = crashlog.events[(start + i) % CRASHLOG_EVENTS];
+        }
+      else
+        m_prev_evcount = 0;
+      }
+    }
+
+  if (m_invalid_reason)
+    ESP_LOGI(TAG, "No previous crash log available (%s)", m_invalid_reason);
+  else
+    ESP_LOGI(TAG, "Previous crash log: %u bytes, %d events", m_prev_loglen, m_prev_evcount);
+
+  Reset();
+  m_ready = true;
+
+  OvmsCommand* cmd_module = MyCommandApp.RegisterCommand("module","MODULE framework");
+  OvmsCommand* cmd_crashlog = cmd_module->RegisterCommand("crashlog","Show log tail of previous session",crashlog_cmd_show);
+  cmd_crashlog->RegisterCommand("show","Show log tail of previous session",crashlog_cmd_show);
+  cmd_crashlog->RegisterCommand("current","Show log tail of current session",crashlog_cmd_current);
+  cmd_crashlog->RegisterCommand("status","Show crash log status",crashlog_cmd_status);
+  cmd_crashlog->RegisterCommand("clear","Discard log tail of previous session",crashlog_cmd_clear);
+  }
+
+OvmsCrashLog::~OvmsCrashLog()
+  {
+  m_ready = false;
+  ClearPrevious();
+  }
+
+void OvmsCrashLog::Reset()
+  {
+  memset(&crashlog, 0, sizeof(crashlog));
+  crashlog.magic = CRASHLOG_MAGIC;
+  crashlog.version = CRASHLOG_VERSION;
+  crashlog.size = sizeof(crashlog);
+  crashlog.checksum = 0;
+  }
+
+bool OvmsCrashLog::Validate()
+  {
+  if (crashlog.magic != CRASHLOG_MAGIC)
+    m_invalid_reason = "bad magic";
+  else if (crashlog.version != CRASHLOG_VERSION)
+    m_invalid_reason = "bad version";
+  else if (crashlog.size != sizeof(crashlog))
+    m_invalid_reason = "bad size";
+  else if (crashlog.logpos >= CRASHLOG_LOGSIZE
+        || crashlog.evpos >= CRASHLOG_EVENTS
+        || crashlog.evcount > CRASHLOG_EVENTS)
+    m_invalid_reason = "out of range";
+  else if (crashlog.checksum != crashlog_sum(crashlog.log, sizeof(crashlog.log))
+                              + crashlog_sum(crashlog.events, sizeof(crashlog.events)))
+    m_invalid_reason = "bad checksum";
+  else if (crashlog.logpos == 0 && !crashlog.logwrapped && crashlog.evcount == 0)
+    m_invalid_reason = "empty";
+  else
+    m_invalid_reason = NULL;
+  return (m_invalid_reason == NULL);
+  }
+
+/**
+ * Linearize: copy the log ring into a new SPIRAM string buffer, oldest first.
+ *  If the ring has wrapped, the first (partial) line is skipped.
+ *  Caller needs to free() the result.
+ */
+char* OvmsCrashLog::Linearize(size_t* len)
+  {
+  char* buf = (char*) ExternalRamMalloc(CRASHLOG_LOGSIZE + 1);
+  if (!buf)
+    {
+    *len = 0;
+    return NULL;
+    }
+  size_t n;
+  if (crashlog.logwrapped)
+    {
+    size_t head = CRASHLOG_LOGSIZE - crashlog.logpos;
+    memcpy(buf, crashlog.log + crashlog.logpos, head);
+    memcpy(buf + head, crashlog.log, crashlog.logpos);
+    n = CRASHLOG_LOGSIZE;
+    char* nl = (char*) memchr(buf, '\n', n);
+    if (nl)
+      {
+      size_t skip = nl + 1 - buf;
+      memmove(buf, nl + 1, n - skip);
+      n -= skip;
+      }
+    }
+  else
+    {
+    memcpy(buf, crashlog.log, crashlog.logpos);
+    n = crashlog.logpos;
+    }
+  buf[n] = 0;
+  *len = n;
+  return buf;
+  }
+
+/**
+ * RecordLog: mirror a log text into the ring.
+ *  Called for every log line by OvmsCommandApp::LogBuffer(), so this needs to be fast.
+ *  ANSI color sequences are stripped, long texts are truncated to CRASHLOG_MAXLINE.
+ */
+void OvmsCrashLog::RecordLog(const char* text)
+  {
+  if (!m_ready || !text)
+    return;
+
+  portENTER_CRITICAL(&m_mux);
+  uint32_t pos = crashlog.logpos;
+  uint32_t sum = crashlog.checksum;
+  int cnt = 0;
+  for (const char* s = text; *s && cnt < CRASHLOG_MAXLINE; s++)
+    {
+    if (*s == '\033')
+      {
+      // skip "ESC [ … letter":
+      if (*(s+1) == '[')
+        {
+        s++;
+        while (*(s+1) && !((*(s+1) >= 'A' && *(s+1) <= 'Z') || (*(s+1) >= 'a' && *(s+1) <= 'z')))
+          s++;
+        if (*(s+1))
+          s++;
+        }
+      continue;
+      }
+    sum += (uint8_t)*s - (uint8_t)crashlog.log[pos];
+    crashlog.log[pos] = *s;
+    cnt++;
+    if (++pos == CRASHLOG_LOGSIZE)
+      {
+      pos = 0;
+      crashlog.logwrapped = 1;
+      }
+    }
+  crashlog.logpos = pos;
+  crashlog.checksum = sum;
+  crashlog.uptime = monotonictime;
+  portEXIT_CRITICAL(&m_mux);
+  }
+
+/**
+ * RecordEvent: store an event name in the event ring.
+ */
+void OvmsCrashLog::RecordEvent(const char* event)
+  {
+  if (!m_ready || !event)
+    return;
+
+  crashlog_event_t ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.time = monotonictime;
+  strncpy(ev.name, event, sizeof(ev.name)-1);
+
+  portENTER_CRITICAL(&m_mux);
+  crashlog_event_t* slot = &crashlog.events[crashlog.evpos];
+  crashlog.checksum += crashlog_sum(&ev, sizeof(ev)) - crashlog_sum(slot, sizeof(*slot));
+  *slot = ev;
+  crashlog.evpos = (crashlog.evpos + 1) % CRASHLOG_EVENTS;
+  if (crashlog.evcount < CRASHLOG_EVENTS)
+    crashlog.evcount++;
+  crashlog.uptime = monotonictime;
+  portEXIT_CRITICAL(&m_mux);
+  }
+
+void OvmsCrashLog::ClearPrevious()
+  {
+  if (m_prev_log)
+    {
+    free(m_prev_log);
+    m_prev_log = NULL;
+    }
+  if (m_prev_events)
+    {
+    free(m_prev_events);
+    m_prev_events = NULL;
+    }
+  m_prev_loglen = 0;
+  m_prev_evcount = 0;
+  m_invalid_reason = "cleared";
+  }
+
+void OvmsCrashLog::Output(OvmsWriter* writer, const char* log, size_t loglen,
+                          const crashlog_event_t* events, int evcount)
+  {
+  if (evcount > 0)
+    {
+    writer->puts("Last events:");
+    for (int i = 0; i < evcount; i++)
+      writer->printf("  %8" PRIu32 " %s\n", events[i].time, events[i].name);
+    }
+  if (loglen > 0)
+    {
+    writer->puts("Last log lines:");
+    writer->write(log, loglen);
+    if (log[loglen-1] != '\n')
+      writer->puts("");
+    }
+  }
+
+void OvmsCrashLog::OutputPrevious(OvmsWriter* writer, int verbosity)
+  {
+  if (!m_prev_log)
+    {
+    writer->printf("No crash log of previous session available (%s)\n",
+      m_invalid_reason ? m_invalid_reason : "out of memory");
+    return;
+    }
+  writer->printf("Crash log of previous session (uptime %" PRIu32 " sec):\n", m_prev_uptime);
+  Output(writer, m_prev_log, m_prev_loglen, m_prev_events, m_prev_evcount);
+  }
+
+void OvmsCrashLog::OutputCurrent(OvmsWriter* writer, int verbosity)
+  {
+  // take a consistent copy first, as output may log:
+  size_t loglen;
+  crashlog_event_t events[CRASHLOG_EVENTS];
+  int evcount;
+  char* log;
+  portENTER_CRITICAL(&m_mux);
+  evcount = crashlog.evcount;
+  int start = (crashlog.evpos + CRASHLOG_EVENTS - evcount) % CRASHLOG_EVENTS;
+  for (int i = 0; i < evcount; i++)
+    events[i] = crashlog.events[(start + i) % CRASHLOG_EVENTS];
+  portEXIT_CRITICAL(&m_mux);
+  // Note: the log ring may be written concurrently while linearizing, worst case
+  //  is a garbled line at the ring head, which is acceptable for a diagnostic view.
+  log = Linearize(&loglen);
+  writer->printf("Crash log of current session (uptime %" PRIu32 " sec):\n", monotonictime);
+  Output(writer, log, loglen, events, evcount);
+  if (log)
+    free(log);
+  }
+
+void OvmsCrashLog::Status(OvmsWriter* writer)
+  {
+  writer->printf("Crash log: %u bytes RTC memory (%u log + %u events)\n",
+    sizeof(crashlog), sizeof(crashlog.log), sizeof(crashlog.events));
+  writer->printf("  Current session: %" PRIu32 " bytes%s, %" PRIu32 " events\n",
+    crashlog.logwrapped ? (uint32_t)CRASHLOG_LOGSIZE : crashlog.logpos,
+    crashlog.logwrapped ? " (wrapped)" : "", crashlog.evcount);
+  if (m_prev_log)
+    writer->printf("  Previous session: %u bytes, %d events, uptime %" PRIu32 " sec\n",
+      m_prev_loglen, m_prev_evcount, m_prev_uptime);
+  else
+    writer->printf("  Previous session: not available (%s)\n",
+      m_invalid_reason ? m_invalid_reason : "out of memory");
+  }
+
+#endif // CONFIG_OVMS_SYS_CRASHLOG
@@ -0,0 +1,118 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2026  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __OVMS_CRASHLOG_H__
+#define __OVMS_CRASHLOG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "ovms_command.h"
+
+#ifdef CONFIG_OVMS_SYS_CRASHLOG
+
+#define CRASHLOG_MAGIC            (('O' << 24) | ('C' << 16) | ('L' << 8) | 'G')
+#define CRASHLOG_VERSION          1                       // increment when struct is changed
+#define CRASHLOG_LOGSIZE          CONFIG_OVMS_SYS_CRASHLOG_SIZE
+#define CRASHLOG_EVENTS           16
+#define CRASHLOG_EVENTNAMELEN     28
+
+typedef struct
+  {
+  uint32_t time;                    // monotonictime of event dispatch
+  char name[CRASHLOG_EVENTNAMELEN]; // event name (truncated)
+  } crashlog_event_t;
+
+/**
+ * crashlog_data_t: no-init RTC memory container for the log tail.
+ *
+ * The payload (log + events) is protected by a running byte sum, updated
+ * incrementally on each write, so the record can be validated at boot without
+ * paying for a full CRC on every log line.
+ */
+typedef struct
+  {
+  // header:
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t checksum;                // byte sum over log[] & events[]
+  uint32_t logpos;                  // next write position in log[]
+  uint32_t logwrapped;              // log[] has wrapped at least once
+  uint32_t evpos;                   // next write position in events[]
+  uint32_t evcount;                 // number of valid events
+  uint32_t uptime;                  // monotonictime of last record
+
+  // payload:
+  char log[CRASHLOG_LOGSIZE];
+  crashlog_event_t events[CRASHLOG_EVENTS];
+  } crashlog_data_t;
+
+class OvmsCrashLog
+  {
+  public:
+    OvmsCrashLog();
+    ~OvmsCrashLog();
+
+  public:
+    void RecordLog(const char* text);
+    void RecordEvent(const char* event);
+
+  public:
+    bool HasPrevious() { return m_prev_log != NULL; }
+    void OutputPrevious(OvmsWriter* writer, int verbosity);
+    void OutputCurrent(OvmsWriter* writer, int verbosity);
+    void ClearPrevious();
+    void Status(OvmsWriter* writer);
+
+  protected:
+    void Reset();
+    bool Validate();
+    char* Linearize(size_t* len);
+    void Output(OvmsWriter* writer, const char* log, size_t loglen,
+                const crashlog_event_t* events, int evcount);
+
+  protected:
+    portMUX_TYPE m_mux;
+    bool m_ready;
+    const char* m_invalid_reason;   // reason previous record was discarded
+    char* m_prev_log;               // post-mortem copy (linearized)
+    size_t m_prev_loglen;
+    crashlog_event_t* m_prev_events;
+    int m_prev_evcount;
+    uint32_t m_prev_uptime;
+  };
+
+extern OvmsCrashLog MyCrashLog;
+
+#endif // CONFIG_OVMS_SYS_CRASHLOG
+
+#endif //#ifndef __OVMS_CRASHLOG_H__
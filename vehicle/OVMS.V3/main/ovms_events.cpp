@@ -39,6 +39,8 @@ static const char *TAG = "events";
 #include "ovms_command.h"
 #include "ovms_script.h"
 #include "ovms_boot.h"
+#include "ovms_crashlog.h"
+#include "ovms_pool.h"
 #if ESP_IDF_VERSION_MAJOR >= 4
 #include <esp_netif_types.h>
 #include <esp_eth_com.h>
@@ -79,7 +81,7 @@ bool EventMap::GetCompletion(OvmsWriter* writer, const char* token) const
 
 void EventStdFree(const char* event, void* data)
   {
-  free(data);
+  MyPools.Free(data);
   }
 
 void EventLaunchTask(void *pvParameters)
@@ -245,6 +247,7 @@ OvmsEvents::~OvmsEvents()
 
 void OvmsEvents::EventTask()
   {
+  OvmsHeapTag heaptag(HEAPTAG_EVENTS);
   event_queue_t msg;
 
   esp_task_wdt_add(NULL); // WATCHDOG is active for this task
@@ -259,6 +262,10 @@ void OvmsEvents::EventTask()
           break;
         case EVENT_signal:
           m_current_event = msg.body.signal.event;
+#ifdef CONFIG_OVMS_SYS_CRASHLOG
+          if (!startsWith(m_current_event, "ticker.") && !startsWith(m_current_event, "clock."))
+            MyCrashLog.RecordEvent(msg.body.signal.event);
+#endif
           HandleQueueSignalEvent(&msg);
           esp_task_wdt_reset(); // Reset WATCHDOG timer for this task
           m_current_event.clear();
@@ -341,7 +348,7 @@ void OvmsEvents::FreeQueueSignalEvent(event_queue_t* msg)
     {
     msg->body.signal.donefn(msg->body.signal.event, msg->body.signal.data);
     }
-  free(msg->body.signal.event);
+  MyPools.Free(msg->body.signal.event);
   }
 
 void OvmsEvents::RegisterEvent(std::string caller, std::string event, EventCallback callback)
@@ -515,7 +522,7 @@ void OvmsEvents::SignalEvent(std::string event, void* data, event_signal_done_fn
   memset(&msg, 0, sizeof(msg));
 
   msg.type = EVENT_signal;
-  msg.body.signal.event = (char*)ExternalRamMalloc(event.size()+1);
+  msg.body.signal.event = (char*)MyPools.Alloc(event.size()+1);
   strcpy(msg.body.signal.event, event.c_str());
   msg.body.signal.data = data;
   msg.body.signal.donefn = callback;
@@ -545,11 +552,11 @@ void OvmsEvents::SignalEvent(std::string event, void* data, size_t length,
   memset(&msg, 0, sizeof(msg));
 
   msg.type = EVENT_signal;
-  msg.body.signal.event = (char*)ExternalRamMalloc(event.size()+1);
+  msg.body.signal.event = (char*)MyPools.Alloc(event.size()+1);
   strcpy(msg.body.signal.event, event.c_str());
   if (data != NULL)
     {
-    msg.body.signal.data = ExternalRamMalloc(length);
+    msg.body.signal.data = MyPools.Alloc(length);
     memcpy(msg.body.signal.data, data, length);
     msg.body.signal.donefn = EventStdFree;
     }
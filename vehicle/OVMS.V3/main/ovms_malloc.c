@@ -28,9 +28,12 @@
 ; THE SOFTWARE.
 */
 
+#include <string.h>
 #include <strings.h>
 #include "ovms_malloc.h"
 #include "esp_heap_caps.h"
+#include <assert.h>
+#include "freertos/FreeRTOS.h"
 
 void* ExternalRamMalloc(size_t sz)
   {
@@ -105,3 +108,121 @@ void* InternalRamRealloc(void *ptr, size_t size)
   else
     return realloc(ptr, size);
   }
+
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+
+#define HEAPTAG_MAGIC 0x4854  // "HT"
+
+typedef struct
+  {
+  uint32_t size;
+  uint16_t tag;
+  uint16_t magic;
+  } heaptag_hdr_t;
+
+static const char* const heaptag_names[HEAPTAG_COUNT] =
+  {
+  "other", "metrics", "events", "notify", "command", "can", "canlog", "poller",
+  "vehicle", "webserver", "serverv2", "serverv3", "http", "duktape", "cellular"
+  };
+
+static heaptag_stats_t heaptag_stats[HEAPTAG_COUNT];
+static portMUX_TYPE heaptag_mux = portMUX_INITIALIZER_UNLOCKED;
+static __thread int heaptag_current = HEAPTAG_OTHER;
+
+static void* HeapTagAlloc(size_t sz, int tag, uint32_t caps, int zero)
+  {
+  if (tag < 0 || tag >= HEAPTAG_COUNT)
+    tag = heaptag_current;
+  heaptag_hdr_t* hdr = (heaptag_hdr_t*) heap_caps_malloc(sizeof(heaptag_hdr_t) + sz, caps);
+  if (!hdr)
+    hdr = (heaptag_hdr_t*) malloc(sizeof(heaptag_hdr_t) + sz);
+  if (!hdr)
+    return NULL;
+  if (zero)
+    bzero(hdr+1, sz);
+  hdr->size = sz;
+  hdr->tag = tag;
+  hdr->magic = HEAPTAG_MAGIC;
+
+  heaptag_stats_t* st = &heaptag_stats[tag];
+  portENTER_CRITICAL(&heaptag_mux);
+  st->current += sz;
+  if (st->current > st->peak)
+    st->peak = st->current;
+  st->count++;
+  st->allocs++;
+  portEXIT_CRITICAL(&heaptag_mux);
+  return hdr+1;
+  }
+
+void* ExternalRamMallocTagged(size_t sz, int tag)
+  {
+  return HeapTagAlloc(sz, tag, MALLOC_CAP_SPIRAM, 0);
+  }
+
+void* ExternalRamCallocTagged(size_t count, size_t size, int tag)
+  {
+  return HeapTagAlloc(count*size, tag, MALLOC_CAP_SPIRAM, 1);
+  }
+
+void* InternalRamMallocTagged(size_t sz, int tag)
+  {
+  return HeapTagAlloc(sz, tag, MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT, 0);
+  }
+
+void* InternalRamCallocTagged(size_t count, size_t size, int tag)
+  {
+  return HeapTagAlloc(count*size, tag, MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT, 1);
+  }
+
+void RamFreeTagged(void* ptr)
+  {
+  if (!ptr)
+    return;
+  heaptag_hdr_t* hdr = ((heaptag_hdr_t*)ptr) - 1;
+  assert(hdr->magic == HEAPTAG_MAGIC && hdr->tag < HEAPTAG_COUNT);
+  hdr->magic = 0;
+
+  heaptag_stats_t* st = &heaptag_stats[hdr->tag];
+  portENTER_CRITICAL(&heaptag_mux);
+  st->current -= hdr->size;
+  st->count--;
+  portEXIT_CRITICAL(&heaptag_mux);
+  free(hdr);
+  }
+
+int HeapTagSet(int tag)
+  {
+  int prev = heaptag_current;
+  if (tag >= 0 && tag < HEAPTAG_COUNT)
+    heaptag_current = tag;
+  return prev;
+  }
+
+int HeapTagGet(void)
+  {
+  return heaptag_current;
+  }
+
+const char* HeapTagName(int tag)
+  {
+  return (tag >= 0 && tag < HEAPTAG_COUNT) ? heaptag_names[tag] : "?";
+  }
+
+void HeapTagGetStats(heaptag_stats_t* stats)
+  {
+  portENTER_CRITICAL(&heaptag_mux);
+  memcpy(stats, heaptag_stats, sizeof(heaptag_stats));
+  portEXIT_CRITICAL(&heaptag_mux);
+  }
+
+void HeapTagResetPeaks(void)
+  {
+  portENTER_CRITICAL(&heaptag_mux);
+  for (int i = 0; i < HEAPTAG_COUNT; i++)
+    heaptag_stats[i].peak = heaptag_stats[i].current;
+  portEXIT_CRITICAL(&heaptag_mux);
+  }
+
+#endif // CONFIG_OVMS_DEV_HEAPTAGS
@@ -32,6 +32,50 @@
 #define __OVMS_MALLOC_H__
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+
+/**
+ * Heap tags: per subsystem heap accounting (CONFIG_OVMS_DEV_HEAPTAGS)
+ *
+ *  Tagged allocations carry a small header recording tag & size, so the
+ *  accounting is exact regardless of the task freeing the block. Tagged
+ *  blocks must be freed by RamFreeTagged(). The ExternalRamAllocated /
+ *  InternalRamAllocated classes and ExtRamAllocator use the current tag
+ *  of the calling task (see OvmsHeapTag below).
+ *
+ *  Without CONFIG_OVMS_DEV_HEAPTAGS, the tagged API maps to the untagged
+ *  functions, so tagging is free.
+ */
+typedef enum
+  {
+  HEAPTAG_CURRENT = -1,               // use current tag of calling task
+  HEAPTAG_OTHER = 0,                  // untagged context
+  HEAPTAG_METRICS,
+  HEAPTAG_EVENTS,
+  HEAPTAG_NOTIFY,
+  HEAPTAG_COMMAND,
+  HEAPTAG_CAN,
+  HEAPTAG_CANLOG,
+  HEAPTAG_POLLER,
+  HEAPTAG_VEHICLE,
+  HEAPTAG_WEBSERVER,
+  HEAPTAG_SERVERV2,
+  HEAPTAG_SERVERV3,
+  HEAPTAG_HTTP,
+  HEAPTAG_DUKTAPE,
+  HEAPTAG_CELLULAR,
+  HEAPTAG_COUNT
+  } ovms_heaptag_t;
+
+typedef struct
+  {
+  size_t current;                     // bytes currently allocated
+  size_t peak;                        // max bytes allocated
+  uint32_t count;                     // blocks currently allocated
+  uint32_t allocs;                    // total allocations
+  } heaptag_stats_t;
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,8 +89,46 @@ void* InternalRamMalloc(size_t sz);
 void* InternalRamCalloc(size_t count, size_t size);
 void* InternalRamRealloc(void *ptr, size_t size);
 
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+void* ExternalRamMallocTagged(size_t sz, int tag);
+void* ExternalRamCallocTagged(size_t count, size_t size, int tag);
+void* InternalRamMallocTagged(size_t sz, int tag);
+void* InternalRamCallocTagged(size_t count, size_t size, int tag);
+void RamFreeTagged(void* ptr);
+
+int HeapTagSet(int tag);
+int HeapTagGet(void);
+const char* HeapTagName(int tag);
+void HeapTagGetStats(heaptag_stats_t* stats);
+void HeapTagResetPeaks(void);
+#else
+#define ExternalRamMallocTagged(sz, tag)            ExternalRamMalloc(sz)
+#define ExternalRamCallocTagged(count, size, tag)   ExternalRamCalloc(count, size)
+#define InternalRamMallocTagged(sz, tag)            InternalRamMalloc(sz)
+#define InternalRamCallocTagged(count, size, tag)   InternalRamCalloc(count, size)
+#define RamFreeTagged(ptr)                          free(ptr)
+#endif // CONFIG_OVMS_DEV_HEAPTAGS
+
 #ifdef __cplusplus
 }
+
+/**
+ * OvmsHeapTag: scoped heap tag for the calling task
+ *  Allocations via the OVMS allocators within the scope are accounted
+ *  to the tag, scopes may be nested.
+ */
+class OvmsHeapTag
+  {
+  public:
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+    OvmsHeapTag(int tag) { m_prev = HeapTagSet(tag); }
+    ~OvmsHeapTag() { HeapTagSet(m_prev); }
+  private:
+    int m_prev;
+#else
+    OvmsHeapTag(int tag) {}
+#endif
+  };
 #endif
 
 #endif //#ifndef __OVMS_MALLOC_H__
@@ -33,6 +33,9 @@ static const char *TAG = "metrics";
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <algorithm>
 #include <sstream>
 #include <functional>
 #include <map>
@@ -42,6 +45,8 @@ static const char *TAG = "metrics";
 #include "ovms_events.h"
 #include "ovms_script.h"
 #include "ovms_config.h"
+#include "glob_match.h"
+#include "ovms_malloc.h"
 #include "rom/rtc.h"
 #include "string.h"
 #include <iomanip>
@@ -577,19 +582,17 @@ void metrics_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc,
         }
       }
     }
-  for (OvmsMetric* m=MyMetrics.m_first; m != NULL; m=m->m_next)
+  auto show = [&](OvmsMetric* m)
     {
     if (only_persist && !m->m_persist)
-      continue;
+      return;
     const char *k = m->m_name;
-    if (show_only != NULL && strstr(k, show_only) == NULL)
-      continue;
     found = true;
     if (show_set)
       {
       if (m->IsDefined())
         writer->printf("metrics set %s %s\n", k, m->AsString().c_str());
-      continue;
+      return;
       }
 
     metric_unit_t use_unit = def_unit;
@@ -617,7 +620,7 @@ void metrics_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc,
     if (v.empty())
       {
       writer->printf("%s\n",k);
-      continue;
+      return;
       }
     // Apply (linux) "cat -t" semantics to strings
     const char *s;
@@ -626,6 +629,22 @@ void metrics_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc,
     else
       s = display_encode(v).c_str();
     writer->printf("%-40.40s %s\n", k, s);
+    };
+
+  if (show_only != NULL && strpbrk(show_only, "*?") != NULL)
+    {
+    // wildcard pattern:
+    MyMetrics.ForEachMatch(show_only, show);
+    }
+  else
+    {
+    // substring filter:
+    for (OvmsMetric* m=MyMetrics.m_first; m != NULL; m=m->m_next)
+      {
+      if (show_only != NULL && strstr(m->m_name, show_only) == NULL)
+        continue;
+      show(m);
+      }
     }
   if (show_only && !found)
     writer->puts("Unrecognised metric name");
@@ -844,6 +863,39 @@ void metrics_trace(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc
   writer->printf("Metric tracing is now %s\n",cmd->GetName());
   }
 
+void metrics_deadband(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  const char* show_only = (argc > 0) ? argv[0] : NULL;
+
+    {
+    OvmsRecMutexLock lock(&MyMetrics.m_deadband_mutex);
+    if (MyMetrics.m_deadband_rules.empty())
+      writer->puts("No deadband rules defined.");
+    else
+      {
+      writer->puts("Rules:");
+      for (auto& rule : MyMetrics.m_deadband_rules)
+        writer->printf("  %-30s abs=%g rel=%g%% interval=%" PRIu32 "ms\n",
+          rule.pattern.c_str(), rule.abs, rule.rel * 100, rule.interval);
+      }
+    }
+
+  int cnt = 0;
+  for (OvmsMetric* m = MyMetrics.m_first; m != NULL; m = m->m_next)
+    {
+    metric_deadband_t* db = m->m_deadband;
+    if (!db || (db->abs == 0 && db->rel == 0 && db->interval == 0 && db->suppressed == 0))
+      continue;
+    if (show_only && strstr(m->m_name, show_only) == NULL)
+      continue;
+    if (cnt++ == 0)
+      writer->puts("Metrics:");
+    writer->printf("  %-30s %8" PRIu32 " suppressed%s\n", m->m_name, db->suppressed,
+      db->pending ? ", pending" : "");
+    }
+  writer->printf("Total suppressed updates: %" PRIu32 "\n", MyMetrics.m_deadband_suppressed);
+  }
+
 void metrics_units(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   const char* show_only = NULL;
@@ -1051,13 +1103,21 @@ static duk_ret_t DukOvmsMetricGetValues(duk_context *ctx)
     }
   else
     {
-    // simple metric name substring filter:
     const char *filter = duk_opt_string(ctx, 0, "");
-    for (m = MyMetrics.m_first; m; m = m->m_next)
+    if (strpbrk(filter, "*?"))
       {
-      if (*filter && !strstr(m->m_name, filter))
-        continue;
-      set_metric(m);
+      // wildcard pattern:
+      MyMetrics.ForEachMatch(filter, set_metric);
+      }
+    else
+      {
+      // simple metric name substring filter:
+      for (m = MyMetrics.m_first; m; m = m->m_next)
+        {
+        if (*filter && !strstr(m->m_name, filter))
+          continue;
+        set_metric(m);
+        }
       }
     }
 
@@ -1076,13 +1136,278 @@ MetricCallbackEntry::~MetricCallbackEntry()
   {
   }
 
+OvmsMetricTrie::OvmsMetricTrie()
+  {
+  memset(&m_root, 0, sizeof(m_root));
+  m_nodecount = 0;
+  }
+
+OvmsMetricTrie::~OvmsMetricTrie()
+  {
+  FreeTree(m_root.child);
+  }
+
+OvmsMetricTrie::Node* OvmsMetricTrie::NewNode(const char* label, size_t len)
+  {
+  Node* node = (Node*) ExternalRamMallocTagged(std::max(sizeof(Node), offsetof(Node, label) + len), HEAPTAG_METRICS);
+  if (!node)
+    return NULL;
+  node->child = NULL;
+  node->next = NULL;
+  node->metric = NULL;
+  node->count = 0;
+  node->len = len;
+  if (label)
+    memcpy(node->label, label, len);
+  m_nodecount++;
+  return node;
+  }
+
+void OvmsMetricTrie::FreeNode(Node* node)
+  {
+  RamFreeTagged(node);
+  m_nodecount--;
+  }
+
+void OvmsMetricTrie::FreeTree(Node* node)
+  {
+  while (node)
+    {
+    Node* next = node->next;
+    FreeTree(node->child);
+    FreeNode(node);
+    node = next;
+    }
+  }
+
+/**
+ * Locate: find the node covering all names starting with prefix
+ *  Note: the prefix may end within the label of the node returned.
+ */
+const OvmsMetricTrie::Node* OvmsMetricTrie::Locate(const char* prefix) const
+  {
+  const Node* node = &m_root;
+  const char* p = prefix;
+  while (*p)
+    {
+    const Node* c = node->child;
+    while (c && (uint8_t)c->label[0] < (uint8_t)*p)
+      c = c->next;
+    if (!c || c->label[0] != *p)
+      return NULL;
+    size_t i = 1;
+    while (i < c->len && p[i] && c->label[i] == p[i])
+      i++;
+    if (i < c->len)
+      return (p[i] == 0) ? c : NULL;
+    node = c;
+    p += i;
+    }
+  return node;
+  }
+
+void OvmsMetricTrie::Insert(OvmsMetric* metric)
+  {
+  const char* name = metric->m_name;
+
+  // Replace a metric of the same name:
+  Node* node = (Node*) Locate(name);
+  if (node && node->metric && strcmp(node->metric->m_name, name) == 0)
+    {
+    node->metric = metric;
+    return;
+    }
+
+  node = &m_root;
+  const char* p = name;
+  for (;;)
+    {
+    node->count++;
+    if (*p == 0)
+      {
+      node->metric = metric;
+      return;
+      }
+    Node** link = &node->child;
+    while (*link && (uint8_t)(*link)->label[0] < (uint8_t)*p)
+      link = &(*link)->next;
+    Node* c = *link;
+    if (!c || c->label[0] != *p)
+      {
+      // New leaf:
+      Node* leaf = NewNode(p, strlen(p));
+      leaf->metric = metric;
+      leaf->count = 1;
+      leaf->next = c;
+      *link = leaf;
+      return;
+      }
+    size_t i = 1;
+    while (i < c->len && c->label[i] == p[i])
+      i++;
+    if (i < c->len)
+      {
+      // Split edge, the new node takes the common part of the label:
+      Node* split = NewNode(c->label, i);
+      split->count = c->count;
+      split->next = c->next;
+      split->child = c;
+      c->next = NULL;
+      c->len -= i;
+      memmove(c->label, c->label + i, c->len);
+      *link = split;
+      c = split;
+      }
+    node = c;
+    p += i;
+    }
+  }
+
+/**
+ * Compact: remove an empty node or merge a non-terminal node with its only child
+ */
+void OvmsMetricTrie::Compact(Node** link)
+  {
+  Node* node = *link;
+  if (node->count == 0)
+    {
+    *link = node->next;
+    FreeNode(node);
+    }
+  else if (!node->metric && node->child && !node->child->next)
+    {
+    Node* c = node->child;
+    Node* merged = NewNode(NULL, node->len + c->len);
+    if (!merged)
+      return;
+    memcpy(merged->label, node->label, node->len);
+    memcpy(merged->label + node->len, c->label, c->len);
+    merged->child = c->child;
+    merged->metric = c->metric;
+    merged->count = c->count;
+    merged->next = node->next;
+    *link = merged;
+    FreeNode(node);
+    FreeNode(c);
+    }
+  }
+
+void OvmsMetricTrie::Remove(OvmsMetric* metric)
+  {
+  Node* node = &m_root;
+  const char* p = metric->m_name;
+  std::vector<Node**> path;
+  while (*p)
+    {
+    Node** link = &node->child;
+    while (*link && (uint8_t)(*link)->label[0] < (uint8_t)*p)
+      link = &(*link)->next;
+    Node* c = *link;
+    if (!c || strncmp(c->label, p, c->len) != 0)
+      return;
+    path.push_back(link);
+    node = c;
+    p += c->len;
+    }
+  if (node->metric != metric)
+    return;
+
+  node->metric = NULL;
+  m_root.count--;
+  for (Node** link : path)
+    (*link)->count--;
+
+  // Only the node and its parent can have become non-compact:
+  size_t depth = path.size();
+  if (depth >= 1)
+    Compact(path[depth-1]);
+  if (depth >= 2)
+    Compact(path[depth-2]);
+  }
+
+OvmsMetric* OvmsMetricTrie::Find(const char* name) const
+  {
+  const Node* node = Locate(name);
+  if (node && node->metric && strcmp(node->metric->m_name, name) == 0)
+    return node->metric;
+  return NULL;
+  }
+
+/**
+ * FindUniquePrefix: get the metric matching the name exactly, or the
+ *  only metric starting with prefix
+ */
+OvmsMetric* OvmsMetricTrie::FindUniquePrefix(const char* prefix) const
+  {
+  const Node* node = Locate(prefix);
+  if (!node)
+    return NULL;
+  if (node->metric && strcmp(node->metric->m_name, prefix) == 0)
+    return node->metric;
+  if (node->count != 1)
+    return NULL;
+  while (!node->metric)
+    node = node->child;
+  return node->metric;
+  }
+
+int OvmsMetricTrie::Walk(const Node* node, MetricTrieCallback& callback, const char* pattern)
+  {
+  int cnt = 0;
+  if (node->metric && (!pattern || glob_match(pattern, node->metric->m_name)))
+    {
+    callback(node->metric);
+    cnt++;
+    }
+  for (const Node* c = node->child; c; c = c->next)
+    cnt += Walk(c, callback, pattern);
+  return cnt;
+  }
+
+/**
+ * ForEachPrefix: call callback for all metrics starting with prefix
+ *  Returns the number of metrics matched.
+ */
+int OvmsMetricTrie::ForEachPrefix(const char* prefix, MetricTrieCallback callback) const
+  {
+  const Node* node = Locate(prefix);
+  return node ? Walk(node, callback, NULL) : 0;
+  }
+
+/**
+ * ForEachMatch: call callback for all metrics matching the wildcard pattern
+ *  ('*' = any sequence, '?' = any char). Only the subtree of the literal
+ *  pattern prefix is scanned. Returns the number of metrics matched.
+ */
+int OvmsMetricTrie::ForEachMatch(const char* pattern, MetricTrieCallback callback) const
+  {
+  size_t len = strcspn(pattern, "*?");
+  if (pattern[len] == 0)
+    {
+    OvmsMetric* m = Find(pattern);
+    if (!m)
+      return 0;
+    callback(m);
+    return 1;
+    }
+  std::string prefix(pattern, len);
+  const Node* node = Locate(prefix.c_str());
+  return node ? Walk(node, callback, pattern) : 0;
+  }
+
 OvmsMetrics::OvmsMetrics()
   {
   ESP_LOGI(TAG, "Initialising METRICS (1810)");
 
   m_nextmodifier = 1;
+  m_nextid = 1;
   m_first = NULL;
   m_trace = false;
+  m_deadband_suppressed = 0;
+  m_listeners_all = NULL;
+  m_changelog = (OvmsMetric**) ExternalRamCalloc(METRICS_CHANGELOG_SIZE, sizeof(OvmsMetric*));
+  m_changelog_seq = 0;
+  m_changelog_mux = portMUX_INITIALIZER_UNLOCKED;
 
   // Register our commands
   OvmsCommand* cmd_metric = MyCommandApp.RegisterCommand("metrics","METRICS framework");
@@ -1095,7 +1420,8 @@ OvmsMetrics::OvmsMetrics()
       "-n = show metrics in native units\n"
       "-p = display only persistent metrics\n"
       "-s = show metric staleness\n"
-      "-t = display non-printing characters and tabs in string metrics" , 0, 2);
+      "-t = display non-printing characters and tabs in string metrics\n"
+      "<metric> = name substring, or pattern with wildcards '*' and '?'" , 0, 2);
   cmd_metric->RegisterCommand("persist","Show persistent metrics info", metrics_persist, "[-r]\n"
       "-r = reset persistent metrics", 0, 1);
   cmd_metric->RegisterCommand("set","Set the value of a metric",metrics_set, "<metric> <value> [<unit>]", 2, 3, true, metrics_set_validate);
@@ -1107,6 +1433,11 @@ OvmsMetrics::OvmsMetrics()
   cmd_metrictrace->RegisterCommand("on","Turn metric tracing ON",metrics_trace);
   cmd_metrictrace->RegisterCommand("off","Turn metric tracing OFF",metrics_trace);
 
+  cmd_metric->RegisterCommand("deadband","Show metric deadbands & suppressed updates",metrics_deadband,
+      "[<metric>]\n"
+      "Configure deadbands by: config set metrics.deadband <pattern> \"[<abs>] [<rel>%] [<interval>ms|s]\"\n"
+      "Example: config set metrics.deadband v.b.current \"0.5 2% 1s\"", 0, 1);
+
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
   ESP_LOGI(TAG, "Expanding DUKTAPE javascript engine");
   DuktapeObjectRegistration* dto = new DuktapeObjectRegistration("OvmsMetrics");
@@ -1135,6 +1466,14 @@ OvmsMetrics::OvmsMetrics()
   using std::placeholders::_2;
   MyEvents.RegisterEvent(TAG, "system.shutdown",
       std::bind(&OvmsMetrics::EventSystemShutDown, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "config.changed",
+      std::bind(&OvmsMetrics::DeadbandConfigListener, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "config.mounted",
+      std::bind(&OvmsMetrics::DeadbandConfigListener, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "ticker.1",
+      std::bind(&OvmsMetrics::DeadbandTicker, this, _1, _2));
+
+  MyConfig.RegisterParam("metrics.deadband", "Metric update deadbands", true, true);
 
   }
 
@@ -1150,6 +1489,21 @@ OvmsMetrics::~OvmsMetrics()
 
 void OvmsMetrics::RegisterMetric(OvmsMetric* metric)
   {
+  OvmsHeapTag heaptag(HEAPTAG_METRICS);
+  metric->m_id = m_nextid++;
+  if (m_nextid == 0)
+    m_nextid = 1;
+
+  // Resolve listeners registered by name before the metric:
+  if (!m_listeners.empty())
+    {
+    auto k = m_listeners.find(metric->m_name);
+    if (k != m_listeners.end())
+      metric->m_listeners = k->second;
+    }
+
+  m_trie.Insert(metric);
+
   // Quick simple check for if we are the first metric.
   if (m_first == NULL)
     {
@@ -1184,6 +1538,25 @@ void OvmsMetrics::RegisterMetric(OvmsMetric* metric)
 
 void OvmsMetrics::DeregisterMetric(OvmsMetric* metric)
   {
+  // Invalidate change log references, wait for readers still using them:
+  if (m_changelog)
+    {
+    OvmsMutexLock lock(&m_changelog_readers);
+    portENTER_CRITICAL(&m_changelog_mux);
+    for (int i=0; i<METRICS_CHANGELOG_SIZE; i++)
+      {
+      if (m_changelog[i] == metric)
+        m_changelog[i] = NULL;
+      }
+    portEXIT_CRITICAL(&m_changelog_mux);
+    }
+
+  // Let users drop their references (e.g. caches keyed by the metric):
+  for (MetricCallbackEntry* ec : m_removal_listeners)
+    ec->m_callback(metric);
+
+  m_trie.Remove(metric);
+
   if (m_first == metric)
     {
     m_first = metric->m_next;
@@ -1263,49 +1636,35 @@ bool OvmsMetrics::SetFloat(const char* metric, float value)
 
 OvmsMetric* OvmsMetrics::Find(const char* metric)
   {
-  for (OvmsMetric* m=m_first; m != NULL; m=m->m_next)
-    {
-    if (strcmp(m->m_name,metric)==0) return m;
-    }
-  return NULL;
+  return m_trie.Find(metric);
   }
 
 OvmsMetric* OvmsMetrics::FindUniquePrefix(const char* token) const
   {
-  size_t len = strlen(token);
-  OvmsMetric* found = NULL;
-  for (OvmsMetric* m=m_first; m != NULL; m=m->m_next)
-    {
-    if (strncmp(m->m_name, token, len) == 0)
-      {
-      if (len == strlen(m->m_name))
-        return m;
-      if (found)
-        return NULL;
-      else
-        found = m;
-      }
-    }
-  return found;
+  return m_trie.FindUniquePrefix(token);
   }
+
+/**
+ * ForEachMatch: call callback for all metrics matching the pattern
+ *  A pattern without wildcards ('*', '?') matches the exact name.
+ */
+int OvmsMetrics::ForEachMatch(const char* pattern, MetricTrieCallback callback) const
+  {
+  return m_trie.ForEachMatch(pattern, callback);
+  }
+
 bool OvmsMetrics::GetCompletion(OvmsWriter* writer, const char* token) const
   {
     unsigned int index = 0;
-    bool match = false;
     writer->SetCompletion(index, NULL);
     if (token)
       {
-      size_t len = strlen(token);
-      for (OvmsMetric* m=m_first; m != NULL; m=m->m_next)
-        {
-        if (strncmp(m->m_name, token, len) == 0)
+      m_trie.ForEachPrefix(token, [writer, &index](OvmsMetric* m)
         {
-          writer->SetCompletion(index++, m->m_name);
-          match = true;
-        }
+        writer->SetCompletion(index++, m->m_name);
+        });
       }
-    }
-    return match;
+    return (index > 0);
   }
 int OvmsMetrics::Validate(OvmsWriter* writer, int argc, const char* token, bool complete) const
   {
@@ -1378,6 +1737,23 @@ OvmsMetricString* OvmsMetrics::InitString(const char* metric, uint16_t autostale
   return m;
   }
 
+/**
+ * ResolveListeners: link a listener list to the metric(s) it applies to
+ *  NotifyModified() walks the resolved lists directly, so the name map
+ *  only needs to be consulted on (de)registration of listeners & metrics.
+ */
+void OvmsMetrics::ResolveListeners(const std::string& name, MetricCallbackList* ml)
+  {
+  if (name == "*")
+    {
+    m_listeners_all = ml;
+    return;
+    }
+  OvmsMetric* m = Find(name.c_str());
+  if (m)
+    m->m_listeners = ml;
+  }
+
 void OvmsMetrics::RegisterListener(std::string caller, std::string name, MetricCallback callback)
   {
   auto k = m_listeners.find(name);
@@ -1394,6 +1770,7 @@ void OvmsMetrics::RegisterListener(std::string caller, std::string name, MetricC
 
   MetricCallbackList *ml = k->second;
   ml->push_back(new MetricCallbackEntry(caller,callback));
+  ResolveListeners(name, ml);
   }
 
 void OvmsMetrics::DeregisterListener(std::string caller)
@@ -1418,6 +1795,7 @@ void OvmsMetrics::DeregisterListener(std::string caller)
       }
     if (ml->empty())
       {
+      ResolveListeners(itm->first, NULL);
       itm = m_listeners.erase(itm);
       delete ml;
       }
@@ -1428,6 +1806,29 @@ void OvmsMetrics::DeregisterListener(std::string caller)
     }
   }
 
+void OvmsMetrics::RegisterRemovalListener(std::string caller, MetricCallback callback)
+  {
+  m_removal_listeners.push_back(new MetricCallbackEntry(caller,callback));
+  }
+
+void OvmsMetrics::DeregisterRemovalListener(std::string caller)
+  {
+  MetricCallbackList::iterator itc=m_removal_listeners.begin();
+  while (itc!=m_removal_listeners.end())
+    {
+    MetricCallbackEntry* ec = *itc;
+    if (ec->m_caller == caller)
+      {
+      itc = m_removal_listeners.erase(itc);
+      delete ec;
+      }
+    else
+      {
+      ++itc;
+      }
+    }
+  }
+
 void OvmsMetrics::NotifyModified(OvmsMetric* metric)
   {
   if (m_trace &&
@@ -1441,23 +1842,194 @@ void OvmsMetrics::NotifyModified(OvmsMetric* metric)
       metric->m_name, metric->AsUnitString().c_str());
     }
 
-  auto k = m_listeners.find("*");
+  MetricCallbackList* ml = m_listeners_all;
   for (int x=0;x<2;x++)
     {
-    if (k != m_listeners.end())
+    if (ml)
       {
-      MetricCallbackList* ml = k->second;
-      if (ml)
+      for (MetricCallbackList::iterator itc=ml->begin(); itc!=ml->end(); ++itc)
         {
-        for (MetricCallbackList::iterator itc=ml->begin(); itc!=ml->end(); ++itc)
-          {
-          MetricCallbackEntry* ec = *itc;
-          ec->m_callback(metric);
-          }
+        MetricCallbackEntry* ec = *itc;
+        ec->m_callback(metric);
         }
       }
-    k = m_listeners.find(metric->m_name);
+    ml = metric->m_listeners;
+    }
+  }
+
+/**
+ * LoadDeadbands: read deadband rules from config "metrics.deadband"
+ *  Instance: metric name pattern (glob, i.e. "v.b.c*")
+ *  Value: space separated list of thresholds:
+ *    <number>          absolute deadband in native metric units
+ *    <number>%         relative deadband (percent of last signalled value)
+ *    <number>ms|s      minimum interval between signalled changes
+ */
+void OvmsMetrics::LoadDeadbands()
+  {
+  metric_deadband_rules_t rules;
+  ConfigParamMap map = MyConfig.GetParamMap("metrics.deadband");
+  for (auto& kv : map)
+    {
+    metric_deadband_rule_t rule;
+    rule.pattern = kv.first;
+    rule.abs = 0;
+    rule.rel = 0;
+    rule.interval = 0;
+    std::istringstream is(kv.second);
+    std::string tok;
+    while (is >> tok)
+      {
+      char* end;
+      float val = strtof(tok.c_str(), &end);
+      if (end == tok.c_str() || val < 0)
+        {
+        ESP_LOGW(TAG, "Deadband %s: invalid threshold '%s' ignored", kv.first.c_str(), tok.c_str());
+        continue;
+        }
+      if (strcmp(end, "%") == 0)
+        rule.rel = val / 100;
+      else if (strcmp(end, "ms") == 0)
+        rule.interval = val;
+      else if (strcmp(end, "s") == 0)
+        rule.interval = val * 1000;
+      else if (*end == 0)
+        rule.abs = val;
+      else
+        ESP_LOGW(TAG, "Deadband %s: invalid threshold '%s' ignored", kv.first.c_str(), tok.c_str());
+      }
+    rules.push_back(rule);
+    }
+  OvmsRecMutexLock lock(&m_deadband_mutex);
+  m_deadband_rules.swap(rules);
+  ESP_LOGI(TAG, "Loaded %d deadband rules", m_deadband_rules.size());
+
+  for (OvmsMetric* m = m_first; m != NULL; m = m->m_next)
+    ApplyDeadband(m);
+  }
+
+/**
+ * ApplyDeadband: attach/update/disable the deadband of a metric by the rules
+ *  Note: deadband objects are not freed while the metric exists, as SetValue()
+ *  may run concurrently; disabled deadbands just pass all changes.
+ */
+void OvmsMetrics::ApplyDeadband(OvmsMetric* metric)
+  {
+  OvmsRecMutexLock lock(&m_deadband_mutex);
+  if (m_deadband_rules.empty() && !metric->m_deadband)
+    return;
+  const metric_deadband_rule_t* match = NULL;
+  for (auto& rule : m_deadband_rules)
+    {
+    if (glob_match(rule.pattern.c_str(), metric->m_name))
+      {
+      match = &rule;
+      break;
+      }
+    }
+  metric_deadband_t* db = metric->m_deadband;
+  if (!match)
+    {
+    if (db)
+      {
+      db->abs = 0;
+      db->rel = 0;
+      db->interval = 0;
+      db->pending = false;
+      }
+    return;
+    }
+  if (!db)
+    {
+    db = (metric_deadband_t*) ExternalRamCalloc(1, sizeof(metric_deadband_t));
+    if (!db) return;
     }
+  db->abs = match->abs;
+  db->rel = match->rel;
+  db->interval = match->interval;
+  db->valid = false;
+  db->pending = false;
+  metric->m_deadband = db;
+  }
+
+void OvmsMetrics::DeadbandConfigListener(std::string event, void* data)
+  {
+  OvmsConfigParam* param = (OvmsConfigParam*) data;
+  if (event == "config.mounted" || (param && param->GetName() == "metrics.deadband"))
+    LoadDeadbands();
+  }
+
+/**
+ * DeadbandTicker: flush changes held back by the minimum interval
+ */
+void OvmsMetrics::DeadbandTicker(std::string event, void* data)
+  {
+  uint32_t now = esp_log_timestamp();
+  for (OvmsMetric* m = m_first; m != NULL; m = m->m_next)
+    {
+    metric_deadband_t* db = m->m_deadband;
+    if (db && db->pending && (now - db->signalled_time) >= db->interval)
+      {
+      db->pending = false;
+      db->signalled = m->AsFloat();
+      db->signalled_time = now;
+      db->valid = true;
+      m->SetModified(true);
+      }
+    }
+  }
+
+/**
+ * LogChange: append a metric modification to the change log
+ */
+void OvmsMetrics::LogChange(OvmsMetric* metric)
+  {
+  if (!m_changelog)
+    return;
+  portENTER_CRITICAL(&m_changelog_mux);
+  m_changelog[m_changelog_seq % METRICS_CHANGELOG_SIZE] = metric;
+  m_changelog_seq++;
+  portEXIT_CRITICAL(&m_changelog_mux);
+  }
+
+/**
+ * ReadChangeLog: fetch metrics modified since sequence number cursor
+ *  Passes up to maxcnt entries to the reader and advances the cursor accordingly.
+ *  Entries of deregistered metrics are skipped, a metric may occur multiple times.
+ *  The reader is called with the change log reader lock held, so the metric
+ *  cannot be deregistered while in use; do not keep the pointer beyond the call.
+ *  Returns the number of entries read, or -1 if the cursor has been overrun
+ *  (i.e. the reader needs to fall back to a full scan). The cursor is left
+ *  unchanged in the latter case.
+ */
+int OvmsMetrics::ReadChangeLog(uint32_t &cursor, int maxcnt, MetricCallback reader)
+  {
+  if (!m_changelog)
+    return -1;
+  OvmsMetric* buf[16];
+  int cnt = 0;
+  if (maxcnt > 16) maxcnt = 16;
+  OvmsMutexLock lock(&m_changelog_readers);
+  portENTER_CRITICAL(&m_changelog_mux);
+  uint32_t seq = m_changelog_seq;
+  if (seq - cursor > METRICS_CHANGELOG_SIZE)
+    {
+    cnt = -1;
+    }
+  else
+    {
+    while (cursor != seq && cnt < maxcnt)
+      {
+      OvmsMetric* m = m_changelog[cursor % METRICS_CHANGELOG_SIZE];
+      cursor++;
+      if (m)
+        buf[cnt++] = m;
+      }
+    }
+  portEXIT_CRITICAL(&m_changelog_mux);
+  for (int i = 0; i < cnt; i++)
+    reader(buf[i]);
+  return cnt;
   }
 
 size_t OvmsMetrics::RegisterModifier()
@@ -1508,12 +2080,21 @@ OvmsMetric::OvmsMetric(const char* name, uint16_t autostale, metric_unit_t units
   m_units = units;
   m_next = NULL;
   m_persist = false;          // only set by metrics supporting persistence
+  m_deadband = NULL;
+  m_listeners = NULL;
+  m_id = 0;
   MyMetrics.RegisterMetric(this);
+  MyMetrics.ApplyDeadband(this);
   }
 
 OvmsMetric::~OvmsMetric()
   {
   MyMetrics.DeregisterMetric(this);
+  if (m_deadband)
+    {
+    free(m_deadband);
+    m_deadband = NULL;
+    }
 
   // Warning: pointers to a deleted OvmsMetric can still be held locally in
   //  other modules. If you delete metrics, take care to inform all readers
@@ -1591,10 +2172,52 @@ void OvmsMetric::SetModified(bool changed)
   if (changed)
     {
     m_modified = ULONG_MAX;
+    MyMetrics.LogChange(this);
     MyMetrics.NotifyModified(this);
     }
   }
 
+/**
+ * DeadbandCheck: check if a numeric value change shall be signalled
+ *  Returns false if the change is suppressed by the deadband.
+ */
+bool OvmsMetric::DeadbandCheck(float value)
+  {
+  metric_deadband_t* db = m_deadband;
+  if (!db || (db->abs == 0 && db->rel == 0 && db->interval == 0))
+    return true;
+
+  uint32_t now = esp_log_timestamp();
+  if (db->valid)
+    {
+    float delta = fabsf(value - db->signalled);
+    if ((db->abs > 0 || db->rel > 0) &&
+        !(db->abs > 0 && delta >= db->abs) &&
+        !(db->rel > 0 && delta >= db->rel * fabsf(db->signalled)))
+      {
+      // within deadband:
+      db->pending = false;
+      db->suppressed++;
+      MyMetrics.m_deadband_suppressed++;
+      return false;
+      }
+    if (db->interval > 0 && (now - db->signalled_time) < db->interval)
+      {
+      // significant, but too early:
+      db->pending = true;
+      db->suppressed++;
+      MyMetrics.m_deadband_suppressed++;
+      return false;
+      }
+    }
+
+  db->signalled = value;
+  db->signalled_time = now;
+  db->valid = true;
+  db->pending = false;
+  return true;
+  }
+
 bool OvmsMetric::IsUnitSend(size_t modifier)
   {
     return m_sendunit & (1ul << modifier);
@@ -1879,7 +2502,7 @@ bool OvmsMetricInt::SetValue(int value, metric_unit_t units)
     m_value = nvalue;
     if (m_valuep)
       *m_valuep = m_value;
-    SetModified(true);
+    SetModified(DeadbandCheck(m_value));
     return true;
     }
   else
@@ -2296,7 +2919,7 @@ bool OvmsMetricFloat::SetValue(float value, metric_unit_t units)
     m_value = nvalue;
     if (m_valuep)
       *m_valuep = m_value;
-    SetModified(true);
+    SetModified(DeadbandCheck(m_value));
     return true;
     }
   else
@@ -53,6 +53,9 @@
 #define TAG ((const char*)"metric")
 
 #define METRICS_MAX_MODIFIERS 32
+#ifndef METRICS_CHANGELOG_SIZE
+#define METRICS_CHANGELOG_SIZE 512      // change log ring entries (power of 2)
+#endif
 
 using namespace std;
 
@@ -219,6 +222,37 @@ extern persistent_values *pmetrics_find(const std::string &name);
 extern persistent_values *pmetrics_register(const char *name);
 extern persistent_values *pmetrics_register(const std::string &name);
 
+/**
+ * metric_deadband_t: per metric change threshold state (see "metrics deadband")
+ *  A numeric value change is only signalled (modified flags & listeners) if it
+ *  exceeds the absolute or relative deadband relative to the last signalled value,
+ *  and the minimum interval since the last signal has passed. Changes held back
+ *  by the interval are flushed by the metrics ticker.
+ */
+class MetricCallbackEntry;
+typedef std::list<MetricCallbackEntry*> MetricCallbackList;
+
+struct metric_deadband_t
+  {
+  float abs;                        // absolute deadband (native units), 0 = off
+  float rel;                        // relative deadband (fraction of last value), 0 = off
+  uint32_t interval;                // minimum signal interval [ms], 0 = off
+  float signalled;                  // last signalled value
+  uint32_t signalled_time;          // esp_log_timestamp() of last signal
+  bool valid;                       // signalled value valid
+  bool pending;                     // change held back by interval
+  uint32_t suppressed;              // count of suppressed updates
+  };
+
+struct metric_deadband_rule_t
+  {
+  std::string pattern;              // metric name pattern (glob)
+  float abs;
+  float rel;
+  uint32_t interval;
+  };
+typedef std::vector<metric_deadband_rule_t> metric_deadband_rules_t;
+
 class OvmsMetric
   {
   public:
@@ -264,6 +298,7 @@ class OvmsMetric
     bool IsModifiedAndClear(size_t modifier);
     void ClearModified(size_t modifier);
     void SetModified(bool changed=true);
+    bool DeadbandCheck(float value);
 
     bool IsUnitSend(size_t modifier);
     bool IsUnitSendAndClear(size_t modifier);
@@ -281,6 +316,9 @@ class OvmsMetric
     metric_defined_t m_defined;
     bool m_stale;
     bool m_persist;
+    metric_deadband_t* m_deadband;
+    MetricCallbackList* m_listeners;  // resolved by OvmsMetrics, NULL = no name listeners
+    uint32_t m_id;                    // registration serial, not reused (binary transport key)
   };
 
 class OvmsMetricBool : public OvmsMetric
@@ -1162,9 +1200,54 @@ class UnitConfigMap
     void InitialiseSlot(size_t modifier);
   };
 
-typedef std::list<MetricCallbackEntry*> MetricCallbackList;
 typedef std::map<std::string, MetricCallbackList*> MetricCallbackMap;
 
+typedef std::function<void(OvmsMetric*)> MetricTrieCallback;
+
+/**
+ * OvmsMetricTrie: radix trie over the metric names
+ *  Used for exact, unique prefix, prefix & wildcard lookups, so these cost
+ *  O(name length + matches) instead of a full list scan. Nodes hold their
+ *  edge label inline and are allocated in SPIRAM. Siblings are kept in byte
+ *  order, so walks yield the metrics in the same order as the metrics list.
+ */
+class OvmsMetricTrie
+  {
+  public:
+    OvmsMetricTrie();
+    ~OvmsMetricTrie();
+
+  public:
+    void Insert(OvmsMetric* metric);
+    void Remove(OvmsMetric* metric);
+    OvmsMetric* Find(const char* name) const;
+    OvmsMetric* FindUniquePrefix(const char* prefix) const;
+    int ForEachPrefix(const char* prefix, MetricTrieCallback callback) const;
+    int ForEachMatch(const char* pattern, MetricTrieCallback callback) const;
+    int GetNodeCount() const { return m_nodecount; }
+
+  protected:
+    struct Node
+      {
+      Node* child;                        // first child
+      Node* next;                         // next sibling
+      OvmsMetric* metric;                 // metric ending at this node
+      uint16_t count;                     // metrics in this subtree
+      uint16_t len;                       // label length
+      char label[1];                      // edge label (not terminated)
+      };
+    Node* NewNode(const char* label, size_t len);
+    void FreeNode(Node* node);
+    void FreeTree(Node* node);
+    void Compact(Node** link);
+    const Node* Locate(const char* prefix) const;
+    static int Walk(const Node* node, MetricTrieCallback& callback, const char* pattern);
+
+  protected:
+    Node m_root;
+    int m_nodecount;
+  };
+
 class OvmsMetrics
   {
   public:
@@ -1184,6 +1267,7 @@ class OvmsMetrics
     OvmsMetric* Find(const char* metric);
 
     OvmsMetric* FindUniquePrefix(const char* token) const;
+    int ForEachMatch(const char* pattern, MetricTrieCallback callback) const;
     bool GetCompletion(OvmsWriter* writer, const char* token) const;
     int Validate(OvmsWriter* writer, int argc, const char* token, bool complete) const;
 
@@ -1229,21 +1313,49 @@ class OvmsMetrics
     void RegisterListener(std::string caller, std::string name, MetricCallback callback);
     void DeregisterListener(std::string caller);
     void NotifyModified(OvmsMetric* metric);
+    void RegisterRemovalListener(std::string caller, MetricCallback callback);
+    void DeregisterRemovalListener(std::string caller);
   protected:
+    void ResolveListeners(const std::string& name, MetricCallbackList* ml);
     MetricCallbackMap m_listeners;
+    MetricCallbackList* m_listeners_all;    // resolved "*" listeners
+    MetricCallbackList m_removal_listeners; // called by DeregisterMetric before deletion
 
   public:
     size_t RegisterModifier();
     void InitialiseSlot(size_t modifier);
 
+  public:
+    // Change log: global sequenced ring of metric modifications,
+    //  readers keep their own sequence cursor (see ReadChangeLog)
+    uint32_t GetChangeSeq() { return m_changelog_seq; }
+    int ReadChangeLog(uint32_t &cursor, int maxcnt, MetricCallback reader);
+    void LogChange(OvmsMetric* metric);
+  protected:
+    OvmsMetric** m_changelog;
+    volatile uint32_t m_changelog_seq;      // sequence number of next entry
+    portMUX_TYPE m_changelog_mux;
+    OvmsMutex m_changelog_readers;          // held while readers access entries
+
+  public:
+    void LoadDeadbands();
+    void ApplyDeadband(OvmsMetric* metric);
+    void DeadbandConfigListener(std::string event, void* data);
+    void DeadbandTicker(std::string event, void* data);
+    OvmsRecMutex m_deadband_mutex;          // protects m_deadband_rules
+    metric_deadband_rules_t m_deadband_rules;
+    uint32_t m_deadband_suppressed;
+
   public:
     void EventSystemShutDown(std::string event, void* data);
 
   protected:
     size_t m_nextmodifier;
+    uint32_t m_nextid;
 
   public:
     OvmsMetric* m_first;
+    OvmsMetricTrie m_trie;
     bool m_trace;
   };
 
@@ -33,6 +33,8 @@ static const char *TAG = "module";
 
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <algorithm>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/FreeRTOSConfig.h"
@@ -51,6 +53,7 @@ static const char *TAG = "module";
 #include "ovms_mutex.h"
 #include "ovms_notify.h"
 #include "string_writer.h"
+#include "ovms_pool.h"
 
 #define MAX_TASKS 30
 #define DUMPSIZE 1000
@@ -59,6 +62,55 @@ static const char *TAG = "module";
 #define TASKLIST 10
 #define NOT_FOUND (TaskHandle_t)0xFFFFFFFF
 
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+static void module_memory_tags(OvmsWriter* writer, bool reset)
+  {
+  heaptag_stats_t stats[HEAPTAG_COUNT];
+  HeapTagGetStats(stats);
+  writer->printf("Heap tag      Current     Peak   Blocks   Allocs\n");
+  for (int i = 0; i < HEAPTAG_COUNT; i++)
+    {
+    writer->printf("%-10s %10zu %8zu %8" PRIu32 " %8" PRIu32 "\n",
+      HeapTagName(i), stats[i].current, stats[i].peak, stats[i].count, stats[i].allocs);
+    }
+  if (reset)
+    {
+    HeapTagResetPeaks();
+    writer->puts("Peaks reset to current values.");
+    }
+  }
+
+static void module_heaptag_metrics()
+  {
+  heaptag_stats_t stats[HEAPTAG_COUNT];
+  HeapTagGetStats(stats);
+  std::string names;
+  std::vector<int> current(HEAPTAG_COUNT), peak(HEAPTAG_COUNT), count(HEAPTAG_COUNT);
+  for (int i = 0; i < HEAPTAG_COUNT; i++)
+    {
+    if (i) names += ',';
+    names += HeapTagName(i);
+    current[i] = stats[i].current;
+    peak[i] = stats[i].peak;
+    count[i] = stats[i].count;
+    }
+  StandardMetrics.ms_m_heap_tags->SetValue(names);
+  StandardMetrics.ms_m_heap_current->SetValue(current);
+  StandardMetrics.ms_m_heap_peak->SetValue(peak);
+  StandardMetrics.ms_m_heap_count->SetValue(count);
+  }
+#endif // CONFIG_OVMS_DEV_HEAPTAGS
+
+static void module_pools(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyPools.Status(writer);
+  if (argc > 0 && strcmp(argv[0], "reset") == 0)
+    {
+    MyPools.ResetPeaks();
+    writer->puts("Peaks, exhaustion & fallback counters reset.");
+    }
+  }
+
 #ifndef CONFIG_HEAP_TASK_TRACKING
 #define NOGO 1
 #endif
@@ -78,6 +130,13 @@ static void must(OvmsWriter* writer)
 
 static void module_memory(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+  if (argc > 0 && strcmp(argv[0], "tags") == 0)
+    {
+    module_memory_tags(writer, argc > 1 && strcmp(argv[1], "reset") == 0);
+    return;
+    }
+#endif
   size_t free_8bit = heap_caps_get_free_size(MALLOC_CAP_8BIT|MALLOC_CAP_INTERNAL);
   size_t free_32bit = heap_caps_get_free_size(MALLOC_CAP_32BIT|MALLOC_CAP_INTERNAL);
   size_t lgst_8bit = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT|MALLOC_CAP_INTERNAL);
@@ -577,6 +636,13 @@ static void get_memory(TaskHandle_t* tasks, size_t taskslen)
 
 static void module_memory(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+  if (argc > 0 && strcmp(argv[0], "tags") == 0)
+    {
+    module_memory_tags(writer, argc > 1 && strcmp(argv[1], "reset") == 0);
+    return;
+    }
+#endif
   OvmsMutexLock lock(&taskstatus_mutex);
   static const char* ctasks[] = {}; // { "tiT", "wifi"};
   const char* const* tasks = ctasks;
@@ -1159,6 +1225,12 @@ static void module_eventhandler(std::string event, void* data)
     if (MyConfig.GetParamValueBool("module", "debug.tasks", false))
       module_tasks_data(0, NULL, NULL, 0, NULL);
     }
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+  else if (event == "ticker.10")
+    {
+    module_heaptag_metrics();
+    }
+#endif
 
 #ifdef CONFIG_OVMS_COMP_SDCARD
   else if (event == "sd.mounted")
@@ -1212,6 +1284,126 @@ static void module_summary(int verbosity, OvmsWriter* writer, OvmsCommand* cmd,
   writer->puts("\nREPORT ENDS");
   }
 
+/**
+ * Task telemetry sampler:
+ *  Publishes per task CPU share & stack high water marks plus the idle share per core
+ *  as metrics every "module tasks.interval" seconds (0 = disabled, default).
+ *  CPU shares are calculated from the run time counter deltas since the last sample,
+ *  in percent of one core. Vector elements follow the task order of m.task.names
+ *  (sorted by task number).
+ */
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+
+static int tasksample_interval = 0;
+static TaskStatus_t* tasksample_cur = NULL;
+static TaskStatus_t* tasksample_last = NULL;
+static UBaseType_t tasksample_size = 0;
+static UBaseType_t tasksample_lastcnt = 0;
+static uint32_t tasksample_lastruntime = 0;
+
+static void module_tasksample()
+  {
+  // (re)allocate sample buffers on demand, with some headroom for new tasks:
+  UBaseType_t num = uxTaskGetNumberOfTasks();
+  if (num > tasksample_size)
+    {
+    free(tasksample_cur);
+    free(tasksample_last);
+    tasksample_size = num + 8;
+    tasksample_cur = (TaskStatus_t*)heap_caps_malloc(sizeof(TaskStatus_t)*tasksample_size, MALLOC_CAP_32BIT);
+    tasksample_last = (TaskStatus_t*)heap_caps_malloc(sizeof(TaskStatus_t)*tasksample_size, MALLOC_CAP_32BIT);
+    tasksample_lastcnt = 0;
+    if (!tasksample_cur || !tasksample_last)
+      {
+      ESP_LOGE(TAG, "Can't allocate storage for task telemetry");
+      free(tasksample_cur);
+      free(tasksample_last);
+      tasksample_cur = tasksample_last = NULL;
+      tasksample_size = 0;
+      return;
+      }
+    }
+
+  uint32_t totalruntime;
+  UBaseType_t cnt = uxTaskGetSystemState(tasksample_cur, tasksample_size, &totalruntime);
+  if (cnt == 0)
+    return;
+  std::sort(tasksample_cur, tasksample_cur + cnt,
+    [](const TaskStatus_t& a, const TaskStatus_t& b) { return a.xTaskNumber < b.xTaskNumber; });
+
+  // the first sample only provides the base for the CPU shares:
+  if (tasksample_lastcnt > 0)
+    {
+    uint32_t difftotal = totalruntime - tasksample_lastruntime;
+    std::string names;
+    std::vector<float> cpu(cnt);
+    std::vector<int> stack(cnt);
+    std::vector<float> idle(portNUM_PROCESSORS);
+    UBaseType_t j = 0;
+    for (UBaseType_t i = 0; i < cnt; i++)
+      {
+      const TaskStatus_t& ts = tasksample_cur[i];
+      // both lists are sorted by task number, new tasks start at zero runtime:
+      while (j < tasksample_lastcnt && tasksample_last[j].xTaskNumber < ts.xTaskNumber)
+        j++;
+      uint32_t runtime = ts.ulRunTimeCounter;
+      if (j < tasksample_lastcnt && tasksample_last[j].xTaskNumber == ts.xTaskNumber)
+        runtime -= tasksample_last[j].ulRunTimeCounter;
+      float share = difftotal ? roundf((float) runtime / difftotal * 1000) / 10 : 0;
+
+      if (i) names += ',';
+      names += ts.pcTaskName;
+      cpu[i] = share;
+      stack[i] = ts.usStackHighWaterMark;
+      for (int core = 0; core < portNUM_PROCESSORS; core++)
+        {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5,3,0)
+        if (ts.xHandle == xTaskGetIdleTaskHandleForCore(core))
+#else
+        if (ts.xHandle == xTaskGetIdleTaskHandleForCPU(core))
+#endif
+          idle[core] = share;
+        }
+      }
+    StandardMetrics.ms_m_task_names->SetValue(names);
+    StandardMetrics.ms_m_task_cpu->SetValue(cpu);
+    StandardMetrics.ms_m_task_stack->SetValue(stack);
+    StandardMetrics.ms_m_cpu_idle->SetValue(idle);
+    }
+
+  std::swap(tasksample_cur, tasksample_last);
+  tasksample_lastcnt = cnt;
+  tasksample_lastruntime = totalruntime;
+  }
+
+static void module_tasksample_eventhandler(std::string event, void* data)
+  {
+  if (event == "ticker.1")
+    {
+    if (tasksample_interval > 0 && (monotonictime % tasksample_interval) == 0)
+      module_tasksample();
+    }
+  else
+    {
+    // config.mounted / config.changed:
+    OvmsConfigParam* param = (OvmsConfigParam*) data;
+    if (event == "config.mounted" || (param && param->GetName() == "module"))
+      {
+      int interval = MyConfig.GetParamValueInt("module", "tasks.interval", 0);
+      if (interval != tasksample_interval)
+        {
+        // restart CPU share measurement on interval changes:
+        tasksample_interval = interval;
+        tasksample_lastcnt = 0;
+        if (interval > 0)
+          module_tasksample();
+        }
+      }
+    }
+  }
+
+#endif // configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+
 class OvmsModuleInit
   {
   public:
@@ -1227,9 +1419,19 @@ class OvmsModuleInit
     MyEvents.RegisterEvent(TAG, "ticker.1", module_eventhandler);
 #endif //CONFIG_OVMS_COMP_SDCARD
     MyEvents.RegisterEvent(TAG, "ticker.300", module_eventhandler);
+#ifdef CONFIG_OVMS_DEV_HEAPTAGS
+    MyEvents.RegisterEvent(TAG, "ticker.10", module_eventhandler);
+#endif
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    MyEvents.RegisterEvent(TAG, "ticker.1", module_tasksample_eventhandler);
+    MyEvents.RegisterEvent(TAG, "config.mounted", module_tasksample_eventhandler);
+    MyEvents.RegisterEvent(TAG, "config.changed", module_tasksample_eventhandler);
+#endif
 
     OvmsCommand* cmd_module = MyCommandApp.RegisterCommand("module","MODULE framework");
-    cmd_module->RegisterCommand("memory","Show module memory usage",module_memory,"[<task names or ids>|*|=]",0,TASKLIST);
+    cmd_module->RegisterCommand("memory","Show module memory usage",module_memory,
+      "[<task names or ids>|*|=|tags [reset]]\n"
+      "tags = show heap usage by subsystem (CONFIG_OVMS_DEV_HEAPTAGS)",0,TASKLIST);
     cmd_module->RegisterCommand("leaks","Show module memory changes",module_memory,"[<task names or ids>|*|=]",0,TASKLIST);
     OvmsCommand* cmd_tasks = cmd_module->RegisterCommand("tasks","Show module task usage",module_tasks);
     cmd_tasks->RegisterCommand("stack","Show module task usage with stack",module_tasks);
@@ -1252,6 +1454,7 @@ class OvmsModuleInit
       " - sleep until monday 6:30: module sleep monday 06:30\n"
       , 1, 2);
     cmd_module->RegisterCommand("check","Check heap integrity",module_check);
+    cmd_module->RegisterCommand("pools","Show object pool statistics",module_pools,"[reset]",0,1);
     cmd_module->RegisterCommand("summary","Show module summary",module_summary);
     OvmsCommand* cmd_factory = cmd_module->RegisterCommand("factory","MODULE FACTORY framework");
     cmd_factory->RegisterCommand("reset","Factory Reset module",module_factory_reset,"[-noconfirm]",0,1);
@@ -43,12 +43,14 @@ static const char *TAG = "netmanager";
 #include <sys/socket.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <esp_timer.h>
 #include "metrics_standard.h"
 #include "ovms_peripherals.h"
 #include "ovms_netmanager.h"
 #include "ovms_command.h"
 #include "ovms_config.h"
 #include "ovms_module.h"
+#include "ovms_status.h"
 #include "ovms_boot.h"
 #ifdef CONFIG_OVMS_DEV_NETMANAGER_PING
 #include "ping/ping_sock.h"
@@ -109,6 +111,50 @@ void network_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int arg
     }
   }
 
+static void network_status_json(std::string& json)
+  {
+  char buf[100];
+  struct netif *ni;
+  json = "{\"interfaces\":[";
+  for (ni = netif_list; ni; ni = ni->next)
+    {
+    if (ni->name[0]=='l' && ni->name[1]=='o')
+      continue;
+    if (json.back() == '}')
+      json += ',';
+    snprintf(buf, sizeof(buf), "{\"name\":\"%c%c%d\",\"up\":%s,\"link\":%s,",
+      ni->name[0], ni->name[1], ni->num,
+      (ni->flags & NETIF_FLAG_UP) ? "true" : "false",
+      (ni->flags & NETIF_FLAG_LINK_UP) ? "true" : "false");
+    json += buf;
+    snprintf(buf, sizeof(buf), "\"ip\":\"" IPSTR "\",\"netmask\":\"" IPSTR "\",\"gateway\":\"" IPSTR "\"}",
+      IP2STR(&ni->ip_addr.u_addr.ip4), IP2STR(&ni->netmask.u_addr.ip4), IP2STR(&ni->gw.u_addr.ip4));
+    json += buf;
+    }
+  json += "],\"dns\":[";
+  for (int k=0;k<DNS_MAX_SERVERS;k++)
+    {
+    const ip_addr_t* srv = dns_getserver(k);
+    if (ip_addr_isany(srv) || srv->type != IPADDR_TYPE_V4)
+      continue;
+    if (json.back() == '"')
+      json += ',';
+    snprintf(buf, sizeof(buf), "\"" IPSTR "\"", IP2STR(&srv->u_addr.ip4));
+    json += buf;
+    }
+  json += "],\"default\":";
+  if (netif_default)
+    {
+    snprintf(buf, sizeof(buf), "\"%c%c%d\"}",
+      netif_default->name[0], netif_default->name[1], netif_default->num);
+    json += buf;
+    }
+  else
+    {
+    json += "null}";
+    }
+  }
+
 void network_restart(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   writer->puts("Restarting network...");
@@ -339,6 +385,20 @@ void network_connections(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, in
     }
   }
 
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+
+void network_profile(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyNetManager.ProfileStatus(writer);
+  if (argc > 0 && strcmp(argv[0], "reset") == 0)
+    {
+    MyNetManager.ProfileReset();
+    writer->puts("Profile reset.");
+    }
+  }
+
+#endif // CONFIG_OVMS_DEV_NETMAN_PROFILE
+
 #endif // CONFIG_OVMS_SC_GPL_MONGOOSE
 
 OvmsNetManager::OvmsNetManager()
@@ -367,12 +427,24 @@ OvmsNetManager::OvmsNetManager()
   m_mongoose_task = 0;
   m_mongoose_running = false;
   m_jobqueue = xQueueCreate(CONFIG_OVMS_HW_NETMANAGER_QUEUE_SIZE, sizeof(netman_job_t*));
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+  m_prof_current = NULL;
+  m_prof_loop_us = 0;
+  m_prof_ticker = 0;
+  ProfileReset();
+  memset(m_prof_win, 0, sizeof(m_prof_win));
+#endif //CONFIG_OVMS_DEV_NETMAN_PROFILE
 #endif //#ifdef CONFIG_OVMS_SC_GPL_MONGOOSE
 
   // Register our commands
   OvmsCommand* cmd_network = MyCommandApp.RegisterCommand("network","NETWORK framework",network_status, "", 0, 0, false);
   cmd_network->RegisterCommand("status","Show network status",network_status, "", 0, 0, false);
   cmd_network->RegisterCommand("restart","Restart network",network_restart, "", 0, 0, false);
+  MyStatus.Register("network", TAG, 10000, [](StringWriter& text, std::string& json)
+    {
+    network_status(COMMAND_RESULT_NORMAL, &text, NULL, 0, NULL);
+    network_status_json(json);
+    }, "network.");
 #ifdef CONFIG_OVMS_DEV_NETMANAGER_PING
   cmd_network->RegisterCommand("ping", "Ping (ICMP) a hostname/IP address", network_ping, "<host or ip address>", 1, 1, false);
 #endif // CONFIG_OVMS_DEV_NETMANAGER_PING
@@ -380,6 +452,9 @@ OvmsNetManager::OvmsNetManager()
   cmd_network->RegisterCommand("list", "List network connections", network_connections);
   cmd_network->RegisterCommand("close", "Close network connection(s)", network_connections, "<id>\nUse ID from connection list / 0 to close all", 1, 1);
   cmd_network->RegisterCommand("cleanup", "Close orphaned network connections", network_connections);
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+  cmd_network->RegisterCommand("profile", "Show mongoose task profile", network_profile, "[reset]", 0, 1);
+#endif // CONFIG_OVMS_DEV_NETMAN_PROFILE
 #endif // CONFIG_OVMS_SC_GPL_MONGOOSE
 
   // Register our events
@@ -673,6 +748,14 @@ void OvmsNetManager::Ticker1(std::string event, void *data)
       m_not_connected_counter = 0;
       }
     }
+
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+  if (++m_prof_ticker >= 60)
+    {
+    m_prof_ticker = 0;
+    ProfileUpdateMetrics();
+    }
+#endif // CONFIG_OVMS_DEV_NETMAN_PROFILE
   }
 
 void OvmsNetManager::ModemUp(std::string event, void* data)
@@ -953,6 +1036,10 @@ void OvmsNetManager::MongooseTask()
   // Main event loop
   while (m_mongoose_running)
     {
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+    m_prof_loop_us = 0;
+#endif
+
     // poll interfaces:
     if (mg_mgr_poll(&m_mongoose_mgr, 250) == 0)
       {
@@ -963,6 +1050,11 @@ void OvmsNetManager::MongooseTask()
     // check for netmanager control jobs:
     ProcessJobs();
 
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+    if (m_prof_loop_us)
+      ProfileRecord(NETPROF_LOOP, m_prof_loop_us);
+#endif
+
     // Detect broken mutex priority inheritance:
     // (may be removed if solved by esp-idf commit 22d636b7b0d6006e06b5b3cfddfbf6e2cf69b4b8)
     if ((pri = uxTaskPriorityGet(NULL)) != lastpri)
@@ -1021,6 +1113,10 @@ void OvmsNetManager::ProcessJobs()
   while (xQueueReceive(m_jobqueue, &job, 0) == pdTRUE)
     {
     ESP_LOGD(TAG, "MongooseTask: got cmd %d from %p", job->cmd, job->caller);
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+    ProfileRecord(NETPROF_JOBWAIT, esp_timer_get_time() - job->queued);
+#endif
+    OvmsNetProfile prof(NETPROF_JOB);
     switch (job->cmd)
       {
       case nmc_none:
@@ -1055,6 +1151,9 @@ bool OvmsNetManager::ExecuteJob(netman_job_t* job, TickType_t timeout /*=portMAX
   else
     job->caller = 0;
   ESP_LOGD(TAG, "send cmd %d from %p", job->cmd, job->caller);
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+  job->queued = esp_timer_get_time();
+#endif
   if (xQueueSend(m_jobqueue, &job, timeout) != pdTRUE)
     {
     ESP_LOGW(TAG, "ExecuteJob: cmd %d: queue overflow", job->cmd);
@@ -1233,4 +1332,103 @@ bool OvmsNetManager::IsNetManagerTask()
   return (m_mongoose_task == pxCurrentTCB[xPortGetCoreID()]);
   }
 
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+
+// Note: statistics are only written by the mongoose task, readers in other
+//  tasks may see a partially updated record (acceptable for diagnostics).
+
+static const char* const netprof_names[NETPROF_COUNT] =
+  {
+  "loop", "jobwait", "job", "webserver", "mghandler",
+  "netclient", "serverv2", "serverv3", "canlog", "console"
+  };
+
+OvmsNetProfile::OvmsNetProfile(netman_prof_t type)
+  {
+  m_active = MyNetManager.IsNetManagerTask();
+  if (!m_active)
+    return;
+  m_type = type;
+  m_inner = 0;
+  m_outer = MyNetManager.m_prof_current;
+  MyNetManager.m_prof_current = this;
+  m_start = esp_timer_get_time();
+  }
+
+OvmsNetProfile::~OvmsNetProfile()
+  {
+  if (!m_active)
+    return;
+  int64_t total = esp_timer_get_time() - m_start;
+  MyNetManager.m_prof_current = m_outer;
+  if (m_outer)
+    m_outer->m_inner += total;
+  else
+    MyNetManager.m_prof_loop_us += total;
+  MyNetManager.ProfileRecord(m_type, total - m_inner);
+  }
+
+static void netprof_add(netman_prof_stats_t& s, uint32_t us)
+  {
+  int bucket = 0;
+  for (uint32_t limit = 100; bucket < NETPROF_BUCKETS-1 && us >= limit; limit *= 10)
+    bucket++;
+  s.cnt++;
+  s.total_us += us;
+  if (us > s.max_us)
+    s.max_us = us;
+  s.hist[bucket]++;
+  }
+
+void OvmsNetManager::ProfileRecord(netman_prof_t type, uint32_t us)
+  {
+  netprof_add(m_prof[type], us);
+  netprof_add(m_prof_win[type], us);
+  }
+
+void OvmsNetManager::ProfileReset()
+  {
+  memset(m_prof, 0, sizeof(m_prof));
+  m_prof_since = esp_timer_get_time();
+  }
+
+void OvmsNetManager::ProfileStatus(OvmsWriter* writer)
+  {
+  writer->printf("Mongoose task profile (last %d seconds):\n",
+    (int) ((esp_timer_get_time() - m_prof_since) / 1000000));
+  writer->printf("%-10s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+    "Type", "Count", "Avg/us", "Max/us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s");
+  for (int i = 0; i < NETPROF_COUNT; i++)
+    {
+    const netman_prof_stats_t& s = m_prof[i];
+    writer->printf("%-10s %8" PRIu32 " %8" PRIu32 " %8" PRIu32,
+      netprof_names[i], s.cnt, s.cnt ? (uint32_t) (s.total_us / s.cnt) : 0, s.max_us);
+    for (int b = 0; b < NETPROF_BUCKETS; b++)
+      writer->printf(" %8" PRIu32, s.hist[b]);
+    writer->puts("");
+    }
+  }
+
+void OvmsNetManager::ProfileUpdateMetrics()
+  {
+  std::string names;
+  std::vector<int> count(NETPROF_COUNT), avg(NETPROF_COUNT), max(NETPROF_COUNT);
+  for (int i = 0; i < NETPROF_COUNT; i++)
+    {
+    const netman_prof_stats_t& s = m_prof_win[i];
+    if (i) names += ',';
+    names += netprof_names[i];
+    count[i] = s.cnt;
+    avg[i] = s.cnt ? (int) (s.total_us / s.cnt) : 0;
+    max[i] = s.max_us;
+    }
+  memset(m_prof_win, 0, sizeof(m_prof_win));
+  StandardMetrics.ms_m_net_prof_names->SetValue(names);
+  StandardMetrics.ms_m_net_prof_count->SetValue(count);
+  StandardMetrics.ms_m_net_prof_avg->SetValue(avg);
+  StandardMetrics.ms_m_net_prof_max->SetValue(max);
+  }
+
+#endif // CONFIG_OVMS_DEV_NETMAN_PROFILE
+
 #endif //#ifdef CONFIG_OVMS_SC_GPL_MONGOOSE
@@ -85,8 +85,60 @@ typedef struct
       int cnt;
       } cleanup;
     };
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+  int64_t queued;                     // esp_timer time of queueing [us]
+#endif
   } netman_job_t;
 
+/**
+ * Mongoose task profiling:
+ *  OvmsNetProfile scopes measure the handler time spent in the mongoose task
+ *  by handler type. Nested scopes are accounted exclusively, i.e. the outer
+ *  handler time excludes the inner handler time. NETPROF_LOOP is the sum of
+ *  all handler & job times per poll loop (excluding the select() wait).
+ */
+typedef enum
+  {
+  NETPROF_LOOP = 0,                   // poll loop busy time
+  NETPROF_JOBWAIT,                    // job queue wait time
+  NETPROF_JOB,                        // job execution
+  NETPROF_WEBSERVER,                  // webserver framework (HTTP requests)
+  NETPROF_MGHANDLER,                  // webserver MgHandler (websockets, streams)
+  NETPROF_NETCLIENT,                  // OvmsNetTcpClient & HTTP clients
+  NETPROF_SERVERV2,
+  NETPROF_SERVERV3,
+  NETPROF_CANLOG,
+  NETPROF_CONSOLE,                    // telnet & ssh
+  NETPROF_COUNT
+  } netman_prof_t;
+
+#define NETPROF_BUCKETS 6             // <100us, <1ms, <10ms, <100ms, <1s, >=1s
+
+typedef struct
+  {
+  uint32_t cnt;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint32_t hist[NETPROF_BUCKETS];
+  } netman_prof_stats_t;
+
+class OvmsNetProfile
+  {
+  public:
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+    OvmsNetProfile(netman_prof_t type);
+    ~OvmsNetProfile();
+  private:
+    netman_prof_t m_type;
+    int64_t m_start;
+    int64_t m_inner;
+    OvmsNetProfile* m_outer;
+    bool m_active;
+#else
+    OvmsNetProfile(netman_prof_t type) {}
+#endif
+  };
+
 #endif //#ifdef CONFIG_OVMS_SC_GPL_MONGOOSE
 
 typedef struct
@@ -181,6 +233,22 @@ class OvmsNetManager
     int CleanupConnections();
     bool IsNetManagerTask();
 
+#ifdef CONFIG_OVMS_DEV_NETMAN_PROFILE
+  public:
+    void ProfileRecord(netman_prof_t type, uint32_t us);
+    void ProfileStatus(OvmsWriter* writer);
+    void ProfileReset();
+    void ProfileUpdateMetrics();
+
+  public:
+    OvmsNetProfile* m_prof_current;             // innermost active scope
+    uint32_t m_prof_loop_us;                    // busy time of current poll loop
+    netman_prof_stats_t m_prof[NETPROF_COUNT];  // since reset
+    netman_prof_stats_t m_prof_win[NETPROF_COUNT]; // since last metrics update
+    int64_t m_prof_since;
+    int m_prof_ticker;
+#endif //CONFIG_OVMS_DEV_NETMAN_PROFILE
+
 #endif //#ifdef CONFIG_OVMS_SC_GPL_MONGOOSE
   };
 
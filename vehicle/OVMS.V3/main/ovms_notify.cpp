@@ -33,7 +33,9 @@ static const char *TAG = "notify";
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <sstream>
+#include <algorithm>
 #include "ovms.h"
 #include "ovms_notify.h"
 #include "ovms_command.h"
@@ -44,6 +46,9 @@ static const char *TAG = "notify";
 #include "buffered_shell.h"
 #include "string.h"
 #include "ovms_mutex.h"
+#ifdef CONFIG_OVMS_COMP_SDCARD
+#include "ovms_peripherals.h"
+#endif // #ifdef CONFIG_OVMS_COMP_SDCARD
 
 using namespace std;
 
@@ -91,11 +96,18 @@ void notify_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc
       OvmsRecMutexLock lock(&mt->m_mutex);
       writer->printf("  %s: %d entries\n",
         mt->m_name, mt->m_entries.size());
+      if (verbosity > COMMAND_RESULT_MINIMAL)
+        {
+        writer->printf("    queue: %u bytes in RAM (quota %d entries / %u bytes), %d spilled (%u bytes)\n",
+          mt->m_ramsize, mt->m_maxentries, mt->m_maxsize, mt->m_spillcount, mt->m_spillfilesize);
+        writer->printf("    coalesced %" PRIu32 ", dropped %" PRIu32 ", spilled %" PRIu32 ", reloaded %" PRIu32 "\n",
+          mt->m_coalesced, mt->m_dropped, mt->m_spills, mt->m_reloads);
+        }
       for (NotifyEntryMap_t::iterator ite=mt->m_entries.begin(); ite!=mt->m_entries.end(); ++ite)
         {
         OvmsNotifyEntry* e = ite->second;
-        writer->printf("    %" PRId32 ": [%d pending] %s\n",
-          ite->first, e->CountPending(), e->GetValue().c_str());
+        writer->printf("    %" PRId32 ": [%d pending%s] %s\n",
+          ite->first, e->CountPending(), e->m_superseded ? ", superseded" : "", e->GetValue().c_str());
         }
       }
     }
@@ -172,12 +184,17 @@ OvmsNotifyEntry::OvmsNotifyEntry(const char* subtype)
   m_id = 0;
   m_created = esp_log_timestamp();
   m_type = NULL;
-  m_subtype = strdup(subtype);
+  m_subtype = MyPools.strdup(subtype);
+  m_priority = NOTIFY_PRIO_NORMAL;
+  m_spilled = false;
+  m_superseded = false;
+  m_spilloffset = 0;
+  m_spillsize = 0;
   }
 
 OvmsNotifyEntry::~OvmsNotifyEntry()
   {
-  if (m_subtype) free(m_subtype);
+  MyPools.Free(m_subtype);
   }
 
 bool OvmsNotifyEntry::IsRead(size_t reader)
@@ -228,6 +245,13 @@ OvmsNotifyEntryString::~OvmsNotifyEntryString()
 
 const extram::string OvmsNotifyEntryString::GetValue()
   {
+  if (!m_type)
+    return m_value;
+  OvmsRecMutexLock lock(&m_type->m_mutex);
+  if (m_superseded)
+    return extram::string();
+  if (m_spilled)
+    return m_type->LoadSpilled(this);
   return m_value;
   }
 
@@ -238,8 +262,7 @@ const extram::string OvmsNotifyEntryString::GetValue()
 OvmsNotifyEntryCommand::OvmsNotifyEntryCommand(const char* subtype, int verbosity, const char* cmd)
   : OvmsNotifyEntry(subtype)
   {
-  m_cmd = new char[strlen(cmd)+1];
-  strcpy(m_cmd,cmd);
+  m_cmd = MyPools.strdup(cmd);
 
   BufferedShell* bs = new BufferedShell(false, verbosity);
   // command notifications can only be raised by the system or "notify raise" in enabled mode,
@@ -255,13 +278,20 @@ OvmsNotifyEntryCommand::~OvmsNotifyEntryCommand()
   {
   if (m_cmd)
     {
-    delete [] m_cmd;
+    MyPools.Free(m_cmd);
     m_cmd = NULL;
     }
   }
 
 const extram::string OvmsNotifyEntryCommand::GetValue()
   {
+  if (!m_type)
+    return m_value;
+  OvmsRecMutexLock lock(&m_type->m_mutex);
+  if (m_superseded)
+    return extram::string();
+  if (m_spilled)
+    return m_type->LoadSpilled(this);
   return m_value;
   }
 
@@ -273,6 +303,15 @@ OvmsNotifyType::OvmsNotifyType(const char* name)
   {
   m_name = name;
   m_nextid = 1;
+  m_ramsize = 0;
+  m_spillcount = 0;
+  m_spillfilesize = 0;
+  m_retired = 0;
+  m_coalesced = 0;
+  m_dropped = 0;
+  m_spills = 0;
+  m_reloads = 0;
+  Configure();
   }
 
 OvmsNotifyType::~OvmsNotifyType()
@@ -286,7 +325,9 @@ uint32_t OvmsNotifyType::QueueEntry(OvmsNotifyEntry* entry)
 
   entry->m_id = id;
   entry->m_type = this;
+  entry->m_priority = MyNotify.GetPriority(this, entry->m_subtype);
   m_entries[id] = entry;
+  m_ramsize += entry->GetValueSize();
 
   if (strcmp(m_name, "data") != 0 &&
       strcmp(m_name, "stream") != 0)
@@ -301,8 +342,17 @@ uint32_t OvmsNotifyType::QueueEntry(OvmsNotifyEntry* entry)
   // Dispatch the callbacks...
   MyNotify.NotifyReaders(this, entry);
 
-  // Check if we can cleanup...
-  Cleanup(entry);
+  // Check if we can cleanup, else apply the queue policy:
+  if (entry->IsAllRead())
+    {
+    Cleanup(entry);
+    }
+  else
+    {
+    Coalesce(entry);
+    EnforceQuota();
+    TrimRetired();
+    }
 
   return id;
   }
@@ -329,14 +379,27 @@ void OvmsNotifyType::ClearReader(size_t reader)
     }
   }
 
+/**
+ * FirstUnreadEntry: get the next entry to process for a reader
+ *  The reader may hold the entry pointer until it calls MarkRead (or
+ *  the next FirstUnreadEntry), so superseded entries are only deleted
+ *  once every pending reader has passed them here or marked them read.
+ */
 OvmsNotifyEntry* OvmsNotifyType::FirstUnreadEntry(size_t reader, uint32_t floor)
   {
   OvmsRecMutexLock lock(&m_mutex);
-  for (NotifyEntryMap_t::iterator ite=m_entries.begin(); ite!=m_entries.end(); ++ite)
+  for (NotifyEntryMap_t::iterator ite=m_entries.begin(); ite!=m_entries.end(); )
     {
     OvmsNotifyEntry* e = ite->second;
+    ++ite;
     if ((!e->IsRead(reader))&&(e->m_id > floor))
-      return e;
+      {
+      if (!e->m_superseded)
+        return e;
+      // Skip & release superseded entry:
+      e->m_pendingreaders &= ~(1ul << reader);
+      Cleanup(e, &ite);
+      }
     }
   return NULL;
   }
@@ -371,8 +434,271 @@ void OvmsNotifyType::Cleanup(OvmsNotifyEntry* entry, NotifyEntryMap_t::iterator*
       }
     if (DO_TRACE(m_name))
       ESP_LOGD(TAG,"Cleanup type %s id %" PRId32,m_name,entry->m_id);
-    delete entry;
+    Remove(entry);
+    }
+  }
+
+/**
+ * Remove: queue accounting & deletion of an entry no longer in m_entries
+ */
+void OvmsNotifyType::Remove(OvmsNotifyEntry* entry)
+  {
+  if (entry->m_superseded)
+    {
+    m_retired--;
+    }
+  else if (entry->m_spilled)
+    {
+    ReleaseSpill(entry);
+    }
+  else
+    {
+    size_t size = entry->GetValueSize();
+    m_ramsize = (m_ramsize > size) ? m_ramsize - size : 0;
+    }
+  delete entry;
+  }
+
+/**
+ * ReleaseSpill: spill file accounting for an entry leaving the file
+ */
+void OvmsNotifyType::ReleaseSpill(OvmsNotifyEntry* entry)
+  {
+  entry->m_spilled = false;
+  if (--m_spillcount == 0)
+    {
+    // Last spilled entry gone, the file can be discarded:
+    unlink(GetSpillPath().c_str());
+    m_spillfilesize = 0;
+    }
+  }
+
+/**
+ * Retire: take a coalesced or dropped entry out of the queue
+ *  Readers may currently hold the entry (between FirstUnreadEntry and
+ *  MarkRead), so the entry shell stays in m_entries until all pending
+ *  readers have released it. The value is freed now, GetValue() returns
+ *  an empty string for superseded entries.
+ */
+void OvmsNotifyType::Retire(OvmsNotifyEntry* entry)
+  {
+  if (entry->m_spilled)
+    {
+    ReleaseSpill(entry);
+    }
+  else
+    {
+    size_t size = entry->GetValueSize();
+    m_ramsize = (m_ramsize > size) ? m_ramsize - size : 0;
+    }
+  entry->DropValue();
+  entry->m_superseded = true;
+  m_retired++;
+  }
+
+/**
+ * TrimRetired: limit the superseded entry shells kept for pending readers
+ *  (i.e. while a server is offline), removing the oldest first
+ */
+void OvmsNotifyType::TrimRetired()
+  {
+  for (NotifyEntryMap_t::iterator it=m_entries.begin(); it!=m_entries.end() && m_retired > NOTIFY_RETIRED_MAX; )
+    {
+    OvmsNotifyEntry* e = it->second;
+    if (e->m_superseded)
+      {
+      it = m_entries.erase(it);
+      Remove(e);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+  }
+
+/**
+ * Configure: read the queue quotas for this type
+ *  Defaults: data records may pile up while the server is offline, so
+ *  they get a larger queue, all other types are short lived.
+ */
+void OvmsNotifyType::Configure()
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  bool isdata = (strcmp(m_name, "data") == 0);
+  std::string prefix = std::string("queue.") + m_name;
+  m_maxentries = MyConfig.GetParamValueInt("notify", prefix + ".entries", isdata ? 500 : 100);
+  int size = MyConfig.GetParamValueInt("notify", prefix + ".size", isdata ? 256 : 32);
+  if (m_maxentries < 0) m_maxentries = 0;
+  m_maxsize = (size > 0) ? size * 1024 : 0;
+  }
+
+/**
+ * Coalesce: retire older entries of the same subtype superseded by the
+ *  new entry, i.e. not yet read by any reader the new entry is pending for
+ */
+void OvmsNotifyType::Coalesce(OvmsNotifyEntry* entry)
+  {
+  if (!MyNotify.IsCoalescing(entry->m_subtype))
+    return;
+  unsigned long pending = entry->m_pendingreaders;
+  for (NotifyEntryMap_t::iterator it=m_entries.begin(); it!=m_entries.end() && it->first < entry->m_id; ++it)
+    {
+    OvmsNotifyEntry* e = it->second;
+    if (!e->m_superseded && strcmp(e->m_subtype, entry->m_subtype) == 0 && (e->m_pendingreaders & ~pending) == 0)
+      {
+      if (DO_TRACE(m_name))
+        ESP_LOGD(TAG,"Coalesce type %s id %" PRId32 " superseded by %" PRId32, m_name, e->m_id, entry->m_id);
+      Retire(e);
+      m_coalesced++;
+      }
+    }
+  }
+
+/**
+ * EnforceQuota: spill or drop entries while the RAM quota is exceeded,
+ *  lowest priority first, oldest first within a priority class
+ */
+void OvmsNotifyType::EnforceQuota()
+  {
+  while (true)
+    {
+    int ramcount = m_entries.size() - m_spillcount - m_retired;
+    if (ramcount == 0)
+      break;
+    if ((m_maxentries == 0 || ramcount <= m_maxentries) &&
+        (m_maxsize == 0 || m_ramsize <= m_maxsize))
+      break;
+
+    NotifyEntryMap_t::iterator victim = m_entries.end();
+    for (NotifyEntryMap_t::iterator it=m_entries.begin(); it!=m_entries.end(); ++it)
+      {
+      OvmsNotifyEntry* e = it->second;
+      if (e->m_spilled || e->m_superseded)
+        continue;
+      if (victim == m_entries.end() || e->m_priority < victim->second->m_priority)
+        {
+        victim = it;
+        if (e->m_priority == NOTIFY_PRIO_LOW) break;
+        }
+      }
+
+    OvmsNotifyEntry* e = victim->second;
+    if (e->m_priority > NOTIFY_PRIO_LOW && Spill(e))
+      continue;
+
+    ESP_LOGW(TAG, "Queue quota exceeded: dropping type %s subtype %s id %" PRId32,
+      m_name, e->m_subtype, e->m_id);
+    Retire(e);
+    m_dropped++;
+    }
+  }
+
+std::string OvmsNotifyType::GetSpillPath()
+  {
+  std::string path = MyNotify.m_queue_spillpath;
+  path.append("/");
+  path.append(m_name);
+  path.append(".queue");
+  return path;
+  }
+
+/**
+ * Spill: move an entry value to the spill file, so only the entry
+ *  meta data remains in RAM. The value is reloaded on GetValue().
+ */
+bool OvmsNotifyType::Spill(OvmsNotifyEntry* entry)
+  {
+  if (MyNotify.m_queue_spillpath.empty() || !entry->CanSpill())
+    return false;
+  size_t size = entry->GetValueSize();
+  if (m_spillfilesize + size > MyNotify.m_queue_spillmax)
+    return false;
+
+#ifdef CONFIG_OVMS_COMP_SDCARD
+  if (startsWith(MyNotify.m_queue_spillpath, "/sd") &&
+      (!MyPeripherals || !MyPeripherals->m_sdcard || !MyPeripherals->m_sdcard->isavailable()))
+    return false;
+#endif // #ifdef CONFIG_OVMS_COMP_SDCARD
+
+  std::string path = GetSpillPath();
+  if (m_spillcount == 0)
+    {
+    // Start a new file:
+    m_spillfilesize = 0;
+    mkpath(MyNotify.m_queue_spillpath);
+    }
+  FILE* fp = fopen(path.c_str(), (m_spillcount == 0) ? "w" : "a");
+  if (!fp)
+    {
+    ESP_LOGW(TAG, "Spill: cannot open '%s'", path.c_str());
+    return false;
+    }
+  extram::string value = entry->GetValue();
+  bool ok = (fwrite(value.data(), 1, value.size(), fp) == value.size());
+  if (fclose(fp) != 0) ok = false;
+  if (!ok)
+    {
+    ESP_LOGW(TAG, "Spill: write error on '%s'", path.c_str());
+    return false;
+    }
+
+  entry->DropValue();
+  entry->m_spilloffset = m_spillfilesize;
+  entry->m_spillsize = size;
+  entry->m_spilled = true;
+  m_spillfilesize += size;
+  m_spillcount++;
+  m_ramsize = (m_ramsize > size) ? m_ramsize - size : 0;
+  m_spills++;
+  return true;
+  }
+
+/**
+ * ReloadSpilled: move all spilled entry values back into RAM and discard
+ *  the spill file (used before the spill location changes)
+ */
+void OvmsNotifyType::ReloadSpilled()
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  if (m_spillcount == 0)
+    return;
+  for (NotifyEntryMap_t::iterator ite=m_entries.begin(); ite!=m_entries.end(); ++ite)
+    {
+    OvmsNotifyEntry* e = ite->second;
+    if (!e->m_spilled)
+      continue;
+    e->RestoreValue(LoadSpilled(e));
+    e->m_spilled = false;
+    m_ramsize += e->GetValueSize();
     }
+  unlink(GetSpillPath().c_str());
+  m_spillcount = 0;
+  m_spillfilesize = 0;
+  }
+
+/**
+ * LoadSpilled: read a spilled entry value from the spill file
+ */
+extram::string OvmsNotifyType::LoadSpilled(OvmsNotifyEntry* entry)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  extram::string value;
+  std::string path = GetSpillPath();
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp)
+    {
+    value.resize(entry->m_spillsize);
+    if (fseek(fp, entry->m_spilloffset, SEEK_SET) != 0 ||
+        fread(&value[0], 1, value.size(), fp) != value.size())
+      value.clear();
+    fclose(fp);
+    }
+  if (value.empty() && entry->m_spillsize > 0)
+    ESP_LOGW(TAG, "LoadSpilled: cannot read type %s id %" PRId32 " from '%s'", m_name, entry->m_id, path.c_str());
+  else
+    m_reloads++;
+  return value;
   }
 
 ////////////////////////////////////////////////////////////////////////
@@ -469,6 +795,13 @@ OvmsNotify::OvmsNotify()
   RegisterType("data");     // payload: MP historical data record (tagged CSV, see MP documentation)
   RegisterType("stream");   // payload: subtype specific, use for high volume / short latency data streams
 
+  ReadQueueConfig();
+  #undef bind  // Kludgy, but works
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  MyEvents.RegisterEvent(TAG, "config.mounted", std::bind(&OvmsNotify::ConfigChanged, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "config.changed", std::bind(&OvmsNotify::ConfigChanged, this, _1, _2));
+
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
   ESP_LOGI(TAG, "Expanding DUKTAPE javascript engine");
   DuktapeObjectRegistration* dto = new DuktapeObjectRegistration("OvmsNotify");
@@ -577,6 +910,7 @@ void OvmsNotify::RegisterType(const char* type)
 
 uint32_t OvmsNotify::NotifyString(const char* type, const char* subtype, const char* value)
   {
+  OvmsHeapTag heaptag(HEAPTAG_NOTIFY);
   OvmsRecMutexLock lock(&m_mutex);
   OvmsNotifyType* mt = GetType(type);
   if (mt == NULL)
@@ -614,6 +948,7 @@ uint32_t OvmsNotify::NotifyString(const char* type, const char* subtype, const c
 
 uint32_t OvmsNotify::NotifyCommand(const char* type, const char* subtype, const char* cmd)
   {
+  OvmsHeapTag heaptag(HEAPTAG_NOTIFY);
   OvmsRecMutexLock lock(&m_mutex);
   OvmsNotifyType* mt = GetType(type);
   if (mt == NULL)
@@ -792,3 +1127,87 @@ void OvmsNotify::NotifyErrorCode(uint32_t code, uint32_t data, bool raised, bool
       data);
     }
   }
+
+void OvmsNotify::ConfigChanged(std::string event, void* data)
+  {
+  OvmsConfigParam* param = (OvmsConfigParam*) data;
+  if (event == "config.mounted" || (param && param->GetName() == "notify"))
+    ReadQueueConfig();
+  }
+
+/**
+ * ReadQueueConfig: read the queue policy from config param "notify":
+ *  queue.<type>.entries  -- max entries held in RAM (0 = unlimited)
+ *  queue.<type>.size     -- max value size held in RAM in kB (0 = unlimited)
+ *  queue.prio.high       -- subtypes to keep longest (default: alert & error types)
+ *  queue.prio.low        -- subtypes to drop first (default: stream type)
+ *  queue.coalesce        -- subtypes of which only the latest unread entry is kept
+ *  queue.spill.path      -- directory to spill excess entries to (default: disabled)
+ *  queue.spill.size      -- max spill file size per type in kB (default: 1024)
+ */
+void OvmsNotify::ReadQueueConfig()
+  {
+  auto readlist = [](const char* instance) -> std::string
+    {
+    std::string list = MyConfig.GetParamValue("notify", instance);
+    list.erase(std::remove(list.begin(), list.end(), ' '), list.end());
+    return "," + list + ",";
+    };
+
+  OvmsRecMutexLock lock(&m_mutex);
+    {
+    OvmsMutexLock qlock(&m_queue_mutex);
+    m_queue_prio_high = readlist("queue.prio.high");
+    m_queue_prio_low = readlist("queue.prio.low");
+    m_queue_coalesce = readlist("queue.coalesce");
+    }
+  std::string spillpath = MyConfig.GetParamValue("notify", "queue.spill.path");
+  while (spillpath.size() > 1 && spillpath.back() == '/')
+    spillpath.pop_back();
+  m_queue_spillmax = MyConfig.GetParamValueInt("notify", "queue.spill.size", 1024) * 1024;
+
+  for (OvmsNotifyTypeMap_t::iterator itm=m_types.begin(); itm!=m_types.end(); ++itm)
+    {
+    if (spillpath != m_queue_spillpath)
+      itm->second->ReloadSpilled();
+    }
+  m_queue_spillpath = spillpath;
+
+  for (OvmsNotifyTypeMap_t::iterator itm=m_types.begin(); itm!=m_types.end(); ++itm)
+    {
+    OvmsNotifyType* mt = itm->second;
+    mt->Configure();
+    OvmsRecMutexLock lock(&mt->m_mutex);
+    mt->EnforceQuota();
+    mt->TrimRetired();
+    }
+  }
+
+/**
+ * GetPriority: determine the queue priority class of a new entry
+ */
+uint8_t OvmsNotify::GetPriority(OvmsNotifyType* type, const char* subtype)
+  {
+  std::string key = std::string(",") + subtype + ",";
+    {
+    OvmsMutexLock qlock(&m_queue_mutex);
+    if (m_queue_prio_high.find(key) != std::string::npos)
+      return NOTIFY_PRIO_HIGH;
+    if (m_queue_prio_low.find(key) != std::string::npos)
+      return NOTIFY_PRIO_LOW;
+    }
+  if (strcmp(type->m_name, "alert") == 0 || strcmp(type->m_name, "error") == 0)
+    return NOTIFY_PRIO_HIGH;
+  if (strcmp(type->m_name, "stream") == 0)
+    return NOTIFY_PRIO_LOW;
+  return NOTIFY_PRIO_NORMAL;
+  }
+
+bool OvmsNotify::IsCoalescing(const char* subtype)
+  {
+  OvmsMutexLock qlock(&m_queue_mutex);
+  if (m_queue_coalesce.size() <= 2)
+    return false;
+  std::string key = std::string(",") + subtype + ",";
+  return (m_queue_coalesce.find(key) != std::string::npos);
+  }
@@ -41,15 +41,26 @@
 #include "ovms.h"
 #include "ovms_utils.h"
 #include "ovms_mutex.h"
+#include "ovms_pool.h"
 
 #define NOTIFY_MAX_READERS 32
 #define NOTIFY_ERROR_AUTOSUPPRESS 120 // Auto-suppress for 120 seconds
 
+// Queue priority classes: on quota overflow, entries are spilled/dropped
+//  lowest priority first, oldest first within a class
+#define NOTIFY_PRIO_LOW     0
+#define NOTIFY_PRIO_NORMAL  1
+#define NOTIFY_PRIO_HIGH    2
+
+// Max superseded (coalesced/dropped) entries kept per type for pending
+//  readers, beyond this the oldest are removed even if still unread
+#define NOTIFY_RETIRED_MAX  100
+
 using namespace std;
 
 class OvmsNotifyType;
 
-class OvmsNotifyEntry : public ExternalRamAllocated
+class OvmsNotifyEntry : public OvmsPoolAllocated
   {
   public:
     OvmsNotifyEntry(const char* subtype);
@@ -63,6 +74,9 @@ class OvmsNotifyEntry : public ExternalRamAllocated
     virtual bool IsAllRead();
     virtual OvmsNotifyType* GetType() { return m_type; }
     virtual const char* GetSubType();
+    virtual bool CanSpill() { return false; }
+    virtual void DropValue() {}
+    virtual void RestoreValue(const extram::string& value) {}
 
   public:
     std::atomic_ulong m_pendingreaders;
@@ -70,6 +84,11 @@ class OvmsNotifyEntry : public ExternalRamAllocated
     uint32_t m_created;
     OvmsNotifyType* m_type;
     char* m_subtype;
+    uint8_t m_priority;
+    bool m_spilled;                     // Value moved to the spill file
+    bool m_superseded;                  // Coalesced/dropped, value freed, deleted when all readers let go
+    uint32_t m_spilloffset;
+    uint32_t m_spillsize;
   };
 
 class OvmsNotifyEntryString : public OvmsNotifyEntry
@@ -80,7 +99,10 @@ class OvmsNotifyEntryString : public OvmsNotifyEntry
 
   public:
     virtual const extram::string GetValue();
-    virtual size_t GetValueSize() { return m_value.size(); }
+    virtual size_t GetValueSize() { return m_spilled ? m_spillsize : m_value.size(); }
+    virtual bool CanSpill() { return true; }
+    virtual void DropValue() { extram::string().swap(m_value); }
+    virtual void RestoreValue(const extram::string& value) { m_value = value; }
 
   public:
      extram::string m_value;
@@ -94,7 +116,10 @@ class OvmsNotifyEntryCommand : public OvmsNotifyEntry
 
   public:
     virtual const extram::string GetValue();
-    virtual size_t GetValueSize() { return m_value.size(); }
+    virtual size_t GetValueSize() { return m_spilled ? m_spillsize : m_value.size(); }
+    virtual bool CanSpill() { return true; }
+    virtual void DropValue() { extram::string().swap(m_value); }
+    virtual void RestoreValue(const extram::string& value) { m_value = value; }
 
   public:
      char* m_cmd;
@@ -117,15 +142,38 @@ class OvmsNotifyType
     OvmsNotifyEntry* FirstUnreadEntry(size_t reader, uint32_t floor);
     OvmsNotifyEntry* FindEntry(uint32_t id);
     void MarkRead(size_t reader, OvmsNotifyEntry* entry);
+    void Configure();
+    extram::string LoadSpilled(OvmsNotifyEntry* entry);
+    void ReloadSpilled();
+    void EnforceQuota();
+    void TrimRetired();
 
   protected:
     void Cleanup(OvmsNotifyEntry* entry, NotifyEntryMap_t::iterator* next=NULL);
+    void Remove(OvmsNotifyEntry* entry);
+    void Retire(OvmsNotifyEntry* entry);
+    void ReleaseSpill(OvmsNotifyEntry* entry);
+    void Coalesce(OvmsNotifyEntry* entry);
+    bool Spill(OvmsNotifyEntry* entry);
+    std::string GetSpillPath();
 
   public:
     const char* m_name;
     uint32_t m_nextid;
     NotifyEntryMap_t m_entries;
     OvmsRecMutex m_mutex;
+
+  public:
+    int m_maxentries;                   // Queue quota: entries held in RAM, 0 = unlimited
+    size_t m_maxsize;                   // Queue quota: value bytes held in RAM, 0 = unlimited
+    size_t m_ramsize;                   // Value bytes currently held in RAM
+    int m_spillcount;                   // Entries currently spilled to the file
+    int m_retired;                      // Superseded entries (shells without value)
+    size_t m_spillfilesize;
+    uint32_t m_coalesced;               // Statistics
+    uint32_t m_dropped;
+    uint32_t m_spills;
+    uint32_t m_reloads;
   };
 
 typedef std::function<bool(OvmsNotifyType*,OvmsNotifyEntry*)> OvmsNotifyCallback_t;
@@ -189,6 +237,12 @@ class OvmsNotify : public ExternalRamAllocated
     uint32_t NotifyCommandf(const char* type, const char* subtype, const char* fmt, ...) __attribute__ ((format (printf, 4, 5)));
     void NotifyErrorCode(uint32_t code, uint32_t data, bool raised, bool force=false);
 
+  public:
+    void ConfigChanged(std::string event, void* data);
+    void ReadQueueConfig();
+    uint8_t GetPriority(OvmsNotifyType* type, const char* subtype);
+    bool IsCoalescing(const char* subtype);
+
   public:
     OvmsNotifyCallbackMap_t m_readers;
     OvmsRecMutex m_mutex;
@@ -200,6 +254,14 @@ class OvmsNotify : public ExternalRamAllocated
     OvmsNotifyTypeMap_t m_types;
     OvmsNotifyErrorCodeMap_t m_errorcodes;
     int m_trace;
+
+  public:
+    OvmsMutex m_queue_mutex;            // Protects the subtype lists
+    std::string m_queue_prio_high;      // Subtype lists, ',' delimited & enclosed
+    std::string m_queue_prio_low;
+    std::string m_queue_coalesce;
+    std::string m_queue_spillpath;      // Spill directory, empty = disabled
+    size_t m_queue_spillmax;            // Max spill file size per type
   };
 
 extern OvmsNotify MyNotify;
@@ -0,0 +1,255 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+// static const char *TAG = "pool";
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "ovms_malloc.h"
+#include "ovms_command.h"
+#include "ovms_pool.h"
+
+// Note: the atomic control words (state, head, counters) are members of the
+// pool objects and so reside in internal RAM. The ESP32 cannot do atomic
+// compare & set on SPIRAM, the block region only holds plain data.
+
+#define POOL_EMPTY      0xffff
+
+bool OvmsPool::Init()
+  {
+  uint32_t state = 0;
+  if (!__atomic_compare_exchange_n(&m_state, &state, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    return (state == 2);
+
+  size_t size = m_blocksize * m_count;
+  uint8_t* base = (uint8_t*) (m_spiram ? ExternalRamMalloc(size) : InternalRamMalloc(size));
+  if (!base)
+    {
+    __atomic_store_n(&m_state, 3, __ATOMIC_RELEASE);
+    return false;
+    }
+
+  // Link all blocks into the free list:
+  for (unsigned int i = 0; i < m_count; i++)
+    *(uint16_t*)(base + i * m_blocksize) = (i + 1 < m_count) ? i + 1 : POOL_EMPTY;
+
+  m_base = base;
+  __atomic_store_n(&m_head, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&m_state, 2, __ATOMIC_RELEASE);
+  return true;
+  }
+
+void* OvmsPool::Alloc()
+  {
+  if (__atomic_load_n(&m_state, __ATOMIC_ACQUIRE) != 2 && !Init())
+    return NULL;
+
+  uint32_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+  uint32_t next;
+  uint8_t* block;
+  do
+    {
+    uint32_t index = head & 0xffff;
+    if (index == POOL_EMPTY)
+      {
+      __atomic_add_fetch(&m_exhausted, 1, __ATOMIC_RELAXED);
+      return NULL;
+      }
+    block = m_base + index * m_blocksize;
+    // The link may be stale if another task popped the block meanwhile,
+    // the change counter lets the exchange fail in that case:
+    next = ((head + 0x10000) & 0xffff0000) | *(volatile uint16_t*)block;
+    } while (!__atomic_compare_exchange_n(&m_head, &head, next, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+  uint32_t used = __atomic_add_fetch(&m_used, 1, __ATOMIC_RELAXED);
+  uint32_t peak = __atomic_load_n(&m_peak, __ATOMIC_RELAXED);
+  while (used > peak &&
+    !__atomic_compare_exchange_n(&m_peak, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  __atomic_add_fetch(&m_allocs, 1, __ATOMIC_RELAXED);
+  return block;
+  }
+
+bool OvmsPool::Free(void* ptr)
+  {
+  if (!Owns(ptr))
+    return false;
+
+  uint32_t index = ((uint8_t*)ptr - m_base) / m_blocksize;
+  uint32_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+  uint32_t next;
+  do
+    {
+    *(volatile uint16_t*)ptr = head & 0xffff;
+    next = ((head + 0x10000) & 0xffff0000) | index;
+    } while (!__atomic_compare_exchange_n(&m_head, &head, next, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+  __atomic_sub_fetch(&m_used, 1, __ATOMIC_RELAXED);
+  return true;
+  }
+
+void OvmsPool::ResetPeak()
+  {
+  __atomic_store_n(&m_peak, __atomic_load_n(&m_used, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+  __atomic_store_n(&m_exhausted, 0, __ATOMIC_RELAXED);
+  }
+
+void OvmsPool::Status(OvmsWriter* writer)
+  {
+  const char* state;
+  switch (__atomic_load_n(&m_state, __ATOMIC_ACQUIRE))
+    {
+    case 0:   state = "unused"; break;
+    case 2:   state = (m_spiram && (uintptr_t)m_base >= 0x3f800000 && (uintptr_t)m_base < 0x3fc00000)
+                ? "spiram" : "internal"; break;
+    case 3:   state = "failed"; break;
+    default:  state = "init"; break;
+    }
+  writer->printf("%-10s %5u %6u %6" PRIu32 " %6" PRIu32 " %10" PRIu32 " %9" PRIu32 "  %s\n",
+    m_name, (unsigned)m_blocksize, m_count, m_used, m_peak, m_allocs, m_exhausted, state);
+  }
+
+
+void* OvmsPoolSet::Alloc(size_t size)
+  {
+#ifdef CONFIG_OVMS_SYS_POOLS
+  // Use the smallest fitting pool, spill over to the next larger ones:
+  for (int i = 0; i < m_count; i++)
+    {
+    if (size <= m_pools[i].GetBlockSize())
+      {
+      void* ptr = m_pools[i].Alloc();
+      if (ptr)
+        return ptr;
+      }
+    }
+#endif // CONFIG_OVMS_SYS_POOLS
+  __atomic_add_fetch(&m_fallbacks, 1, __ATOMIC_RELAXED);
+  return ExternalRamMalloc(size);
+  }
+
+void OvmsPoolSet::Free(void* ptr)
+  {
+  if (!ptr)
+    return;
+#ifdef CONFIG_OVMS_SYS_POOLS
+  for (int i = 0; i < m_count; i++)
+    {
+    if (m_pools[i].Free(ptr))
+      return;
+    }
+#endif // CONFIG_OVMS_SYS_POOLS
+  free(ptr);
+  }
+
+char* OvmsPoolSet::strdup(const char* src)
+  {
+  if (!src)
+    return NULL;
+  size_t size = strlen(src) + 1;
+  char* dupe = (char*)Alloc(size);
+  if (dupe)
+    memcpy(dupe, src, size);
+  return dupe;
+  }
+
+int OvmsPoolSet::vasprintf(char** strp, const char* fmt, va_list args)
+  {
+  // Format into a stack buffer first, so the common short case only needs
+  // one formatting pass:
+  char tmp[128];
+  va_list args2;
+  va_copy(args2, args);
+  int len = vsnprintf(tmp, sizeof(tmp), fmt, args);
+  if (len < 0)
+    {
+    va_end(args2);
+    *strp = NULL;
+    return len;
+    }
+  *strp = (char*)Alloc(len+1);
+  if (!*strp)
+    len = -1;
+  else if (len < (int)sizeof(tmp))
+    memcpy(*strp, tmp, len+1);
+  else
+    vsnprintf(*strp, len+1, fmt, args2);
+  va_end(args2);
+  return len;
+  }
+
+int OvmsPoolSet::asprintf(char** strp, const char* fmt, ...)
+  {
+  va_list args;
+  va_start(args, fmt);
+  int len = vasprintf(strp, fmt, args);
+  va_end(args);
+  return len;
+  }
+
+void OvmsPoolSet::Status(OvmsWriter* writer)
+  {
+#ifndef CONFIG_OVMS_SYS_POOLS
+  writer->puts("Note: pools disabled by build configuration, all requests use the heap");
+#endif
+  writer->printf("%-10s %5s %6s %6s %6s %10s %9s\n",
+    "Pool", "Size", "Blocks", "Used", "Peak", "Allocs", "Exhausted");
+  for (int i = 0; i < m_count; i++)
+    m_pools[i].Status(writer);
+  writer->printf("Heap fallbacks: %" PRIu32 "\n", m_fallbacks);
+  }
+
+void OvmsPoolSet::ResetPeaks()
+  {
+  for (int i = 0; i < m_count; i++)
+    m_pools[i].ResetPeak();
+  __atomic_store_n(&m_fallbacks, 0, __ATOMIC_RELAXED);
+  }
+
+
+#ifdef CONFIG_OVMS_SYS_POOLS_SPIRAM
+#define POOL_SPIRAM   true
+#else
+#define POOL_SPIRAM   false
+#endif
+
+// The pools are constant initialized & allocate their regions on first use,
+// so they are available to all static initializers:
+static OvmsPool MyPoolClasses[] =
+  {
+  OvmsPool("pool.32",   32, 256, POOL_SPIRAM),   // event names, CAN callbacks, short texts
+  OvmsPool("pool.64",   64, 384, POOL_SPIRAM),   // notify entries, shell output chunks, log lines
+  OvmsPool("pool.128", 128, 128, POOL_SPIRAM),   // command notify entries, CAN log texts
+  OvmsPool("pool.256", 256,  48, POOL_SPIRAM),   // long log lines
+  };
+
+OvmsPoolSet MyPools("system", MyPoolClasses, sizeof(MyPoolClasses) / sizeof(MyPoolClasses[0]));
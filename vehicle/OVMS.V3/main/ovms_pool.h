@@ -0,0 +1,150 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __OVMS_POOL_H__
+#define __OVMS_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include "sdkconfig.h"
+
+class OvmsWriter;
+
+/**
+ * OvmsPool: lock-free fixed-block pool
+ *
+ *  Serves blocks of a fixed size from a region allocated on first use. Free
+ *  blocks are kept in a LIFO list indexed by block number, the list head
+ *  combines the first free index with a change counter to avoid ABA issues
+ *  on concurrent pop/push. Alloc & Free are safe from any task or core and
+ *  never block, Alloc returns NULL if the pool is exhausted (or not yet
+ *  initialized by a concurrent first use).
+ *
+ *  Pools are constant initialized, so they can be used during static init.
+ */
+class OvmsPool
+  {
+  public:
+    constexpr OvmsPool(const char* name, size_t blocksize, unsigned int count, bool spiram=true)
+      : m_name(name),
+        m_blocksize((blocksize < 8) ? 8 : ((blocksize + 7) & ~7)),
+        m_count((count > 0xfffe) ? 0xfffe : count),
+        m_spiram(spiram),
+        m_state(0), m_base(NULL), m_head(0xffff),
+        m_used(0), m_peak(0), m_allocs(0), m_exhausted(0)
+      {}
+
+  public:
+    void* Alloc();
+    bool Free(void* ptr);
+    bool Owns(const void* ptr) const
+      {
+      return m_base && (const uint8_t*)ptr >= m_base
+        && (const uint8_t*)ptr < m_base + m_blocksize * m_count;
+      }
+    size_t GetBlockSize() const { return m_blocksize; }
+    unsigned int GetCount() const { return m_count; }
+    const char* GetName() const { return m_name; }
+    void ResetPeak();
+    void Status(OvmsWriter* writer);
+
+  protected:
+    bool Init();
+
+  protected:
+    const char* m_name;
+    size_t m_blocksize;
+    unsigned int m_count;
+    bool m_spiram;
+    uint32_t m_state;                   // 0=new, 1=initializing, 2=ready, 3=failed
+    uint8_t* m_base;                    // Block region
+    uint32_t m_head;                    // Free list: change counter << 16 | first index
+
+  public:
+    uint32_t m_used;                    // Blocks in use
+    uint32_t m_peak;                    // Max blocks in use
+    uint32_t m_allocs;                  // Total allocations
+    uint32_t m_exhausted;               // Allocations failed due to pool exhaustion
+  };
+
+/**
+ * OvmsPoolSet: size class pools with heap fallback
+ *
+ *  Alloc() serves a request from the smallest pool fitting, or from the heap
+ *  if none fits or all fitting pools are exhausted. Free() accepts any pointer
+ *  returned by Alloc() (or NULL), heap blocks are freed by free(), so buffers
+ *  can change their origin without affecting their users.
+ *
+ *  The pools must be given in ascending block size order.
+ */
+class OvmsPoolSet
+  {
+  public:
+    constexpr OvmsPoolSet(const char* name, OvmsPool* pools, int count)
+      : m_name(name), m_pools(pools), m_count(count), m_fallbacks(0)
+      {}
+
+  public:
+    void* Alloc(size_t size);
+    void Free(void* ptr);
+    char* strdup(const char* src);
+    int vasprintf(char** strp, const char* fmt, va_list args) __attribute__ ((format (printf, 3, 0)));
+    int asprintf(char** strp, const char* fmt, ...) __attribute__ ((format (printf, 3, 4)));
+    void Status(OvmsWriter* writer);
+    void ResetPeaks();
+
+  protected:
+    const char* m_name;
+    OvmsPool* m_pools;
+    int m_count;
+
+  public:
+    uint32_t m_fallbacks;               // Heap allocations
+  };
+
+/**
+ * MyPools: the system pool set for small hot path objects & strings.
+ *  Without CONFIG_OVMS_SYS_POOLS, all requests are served by the heap.
+ */
+extern OvmsPoolSet MyPools;
+
+/**
+ * OvmsPoolAllocated: base class for objects to be allocated from MyPools
+ *  (same usage as ExternalRamAllocated)
+ */
+class OvmsPoolAllocated
+  {
+  public:
+    static void* operator new(size_t sz) { return MyPools.Alloc(sz); }
+    static void operator delete(void* p) { MyPools.Free(p); }
+  };
+
+#endif //#ifndef __OVMS_POOL_H__
@@ -0,0 +1,316 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "status";
+
+#include <string.h>
+#include <inttypes.h>
+#include <vector>
+#include "esp_timer.h"
+#include "ovms_status.h"
+#include "ovms_command.h"
+#include "ovms_events.h"
+#include "ovms_utils.h"
+
+// Snapshots read within this time are kept fresh by the events task:
+#define STATUS_INUSE_TIME     60000000LL      // [us]
+
+OvmsStatus MyStatus __attribute__ ((init_priority (1050)));
+
+OvmsStatus::OvmsStatus()
+  {
+  ESP_LOGI(TAG, "Initialising STATUS (1050)");
+  }
+
+OvmsStatus::~OvmsStatus()
+  {
+  }
+
+void OvmsStatus::Register(const char* name, const char* caller, uint32_t ttl_ms,
+                          OvmsStatusProducer producer, const char* events /*=NULL*/)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  Provider& p = m_providers[name];
+  p.caller = caller;
+  p.ttl_ms = ttl_ms;
+  p.producer = producer;
+  p.events = events ? events : "";
+  p.snapshot = OvmsStatusSnapshot();
+  p.valid = false;
+  p.lastuse = 0;
+  p.gets = p.runs = 0;
+  p.generation++;
+  }
+
+void OvmsStatus::RegisterCommand(const char* name, const char* caller, uint32_t ttl_ms,
+                                 OvmsCommand* cmd, const char* events /*=NULL*/)
+  {
+  Register(name, caller, ttl_ms, [cmd](StringWriter& text, std::string& json)
+    {
+    // The snapshot consumers (web UI, module status) are authorized:
+    text.SetSecure(true);
+    cmd->Execute(COMMAND_RESULT_NORMAL, &text, 0, NULL);
+    }, events);
+  }
+
+void OvmsStatus::Deregister(const char* caller)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  for (auto it = m_providers.begin(); it != m_providers.end(); )
+    {
+    if (it->second.caller == caller)
+      it = m_providers.erase(it);
+    else
+      ++it;
+    }
+  }
+
+bool OvmsStatus::IsRegistered(const char* name)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  return (m_providers.find(name) != m_providers.end());
+  }
+
+bool OvmsStatus::IsOutdated(const Provider& p, int64_t now)
+  {
+  return (!p.valid || now - p.snapshot.time > (int64_t)p.ttl_ms * 1000);
+  }
+
+/**
+ * Produce: run the producer and store the new snapshot
+ *  The producer runs without holding the registry lock. The result is
+ *  stored unless a newer snapshot has been stored meanwhile; it is only
+ *  marked valid if the provider has not been invalidated while producing.
+ *  Returns false if the provider has been deregistered.
+ */
+bool OvmsStatus::Produce(const std::string& name)
+  {
+  OvmsStatusProducer producer;
+  uint32_t generation;
+    {
+    OvmsRecMutexLock lock(&m_mutex);
+    auto it = m_providers.find(name);
+    if (it == m_providers.end())
+      return false;
+    producer = it->second.producer;
+    generation = it->second.generation;
+    }
+
+  OvmsStatusSnapshot snap;
+  snap.time = esp_timer_get_time();
+  StringWriter text(512);
+  std::string json;
+  producer(text, json);
+  if (json.empty())
+    {
+    json = "{\"text\":\"";
+    json.append(json_encode(static_cast<const std::string&>(text)));
+    json.append("\"}");
+    }
+  snap.text = std::move(text);
+  snap.json = std::move(json);
+  ESP_LOGV(TAG, "Produced '%s': %u bytes text, %u bytes json", name.c_str(),
+    snap.text.size(), snap.json.size());
+
+  OvmsRecMutexLock lock(&m_mutex);
+  auto it = m_providers.find(name);
+  if (it == m_providers.end())
+    return false;
+  Provider& p = it->second;
+  p.runs++;
+  if (snap.time >= p.snapshot.time)
+    {
+    p.snapshot = std::move(snap);
+    p.valid = (p.generation == generation);
+    }
+  return true;
+  }
+
+/**
+ * Get: copy the snapshot, produce if outdated or refresh requested
+ *  Returns false if no producer is registered for the name.
+ */
+bool OvmsStatus::Get(const char* name, OvmsStatusSnapshot& dst, bool refresh /*=false*/)
+  {
+  std::string key(name);
+    {
+    OvmsRecMutexLock lock(&m_mutex);
+    auto it = m_providers.find(key);
+    if (it == m_providers.end())
+      return false;
+    Provider& p = it->second;
+    int64_t now = esp_timer_get_time();
+    p.lastuse = now;
+    p.gets++;
+    if (!refresh && !IsOutdated(p, now))
+      {
+      dst = p.snapshot;
+      return true;
+      }
+    }
+
+  if (!Produce(key))
+    return false;
+
+  OvmsRecMutexLock lock(&m_mutex);
+  auto it = m_providers.find(key);
+  if (it == m_providers.end())
+    return false;
+  dst = it->second.snapshot;
+  return true;
+  }
+
+std::string OvmsStatus::GetText(const char* name)
+  {
+  OvmsStatusSnapshot snap;
+  Get(name, snap);
+  return snap.text;
+  }
+
+std::string OvmsStatus::GetJson(const char* name)
+  {
+  OvmsStatusSnapshot snap;
+  if (!Get(name, snap))
+    return "null";
+  return snap.json;
+  }
+
+void OvmsStatus::Invalidate(const char* name)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  auto it = m_providers.find(name);
+  if (it != m_providers.end())
+    {
+    it->second.valid = false;
+    it->second.generation++;
+    }
+  }
+
+bool OvmsStatus::MatchEvents(const std::string& events, const std::string& event)
+  {
+  size_t pos = 0;
+  while (pos < events.size())
+    {
+    size_t end = events.find('|', pos);
+    if (end == std::string::npos)
+      end = events.size();
+    if (end > pos && event.compare(0, end - pos, events, pos, end - pos) == 0)
+      return true;
+    pos = end + 1;
+    }
+  return false;
+  }
+
+void OvmsStatus::EventListener(std::string event, void* data)
+  {
+  if (event == "ticker.1")
+    {
+    // Refresh outdated snapshots in use:
+    std::vector<std::string> outdated;
+      {
+      OvmsRecMutexLock lock(&m_mutex);
+      int64_t now = esp_timer_get_time();
+      for (auto& it : m_providers)
+        {
+        Provider& p = it.second;
+        if (p.lastuse && now - p.lastuse < STATUS_INUSE_TIME && IsOutdated(p, now))
+          outdated.push_back(it.first);
+        }
+      }
+    for (auto& name : outdated)
+      Produce(name);
+    }
+  else if (!startsWith(event, "ticker.") && !startsWith(event, "clock."))
+    {
+    OvmsRecMutexLock lock(&m_mutex);
+    for (auto& it : m_providers)
+      {
+      if (!it.second.events.empty() && MatchEvents(it.second.events, event))
+        {
+        it.second.valid = false;
+        it.second.generation++;
+        }
+      }
+    }
+  }
+
+void OvmsStatus::Status(OvmsWriter* writer)
+  {
+  OvmsRecMutexLock lock(&m_mutex);
+  int64_t now = esp_timer_get_time();
+  writer->printf("%-12s %-16s %7s %7s %7s %7s\n", "Name", "Provider", "TTL/ms", "Age/ms", "Gets", "Runs");
+  for (auto& it : m_providers)
+    {
+    Provider& p = it.second;
+    char age[16] = "-";
+    if (p.valid)
+      snprintf(age, sizeof(age), "%d", (int) ((now - p.snapshot.time) / 1000));
+    writer->printf("%-12s %-16s %7" PRIu32 " %7s %7" PRIu32 " %7" PRIu32 "\n", it.first.c_str(), p.caller.c_str(),
+      p.ttl_ms, age, p.gets, p.runs);
+    }
+  }
+
+static void status_cmd(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (argc == 0)
+    {
+    MyStatus.Status(writer);
+    return;
+    }
+  OvmsStatusSnapshot snap;
+  if (!MyStatus.Get(argv[0], snap, (argc > 1 && strcmp(argv[1], "refresh") == 0)))
+    {
+    writer->printf("Error: no status provider '%s'\n", argv[0]);
+    return;
+    }
+  if (argc > 1 && strcmp(argv[1], "json") == 0)
+    writer->puts(snap.json.c_str());
+  else
+    writer->write(snap.text.data(), snap.text.size());
+  }
+
+class OvmsStatusInit
+  {
+  public: OvmsStatusInit();
+  } MyOvmsStatusInit __attribute__ ((init_priority (5110)));
+
+OvmsStatusInit::OvmsStatusInit()
+  {
+  OvmsCommand* cmd_module = MyCommandApp.FindCommand("module");
+  if (cmd_module)
+    cmd_module->RegisterCommand("status", "Show cached status snapshots", status_cmd,
+      "[<name> [text|json|refresh]]", 0, 2);
+
+  #undef bind  // Kludgy, but works
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  MyEvents.RegisterEvent(TAG, "*", std::bind(&OvmsStatus::EventListener, &MyStatus, _1, _2));
+  }
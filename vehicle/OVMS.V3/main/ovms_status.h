@@ -0,0 +1,120 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          19th October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011       Michael Stegen / Stegen Electronics
+;    (C) 2011-2017  Mark Webb-Johnson
+;    (C) 2011        Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __OVMS_STATUS_H__
+#define __OVMS_STATUS_H__
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <functional>
+#include "ovms_mutex.h"
+#include "string_writer.h"
+
+/**
+ * OvmsStatus: cached status snapshots
+ *
+ *  Components register status producers by name. A producer renders the
+ *  component status into a human readable text (as shown by the shell
+ *  "… status" commands) and a JSON object. If the producer leaves the JSON
+ *  empty, the snapshot JSON is { "text": "<text>" }.
+ *
+ *  Snapshots are cached for the producer TTL and invalidated by events
+ *  matching the producer event prefixes ('|' separated). Snapshots in use
+ *  (read within the last minute) are refreshed by the events task, so
+ *  readers in the network task (web UI, servers) normally get the cached
+ *  snapshot without running the producer.
+ *
+ *  Producers run outside the registry lock, so a slow producer does not
+ *  block readers of other snapshots. Producers must not call back into
+ *  the registry for their own name.
+ */
+
+typedef std::function<void(StringWriter& text, std::string& json)> OvmsStatusProducer;
+
+struct OvmsStatusSnapshot
+  {
+  std::string     text;
+  std::string     json;
+  int64_t         time = 0;     // esp_timer time of creation [us]
+  };
+
+class OvmsStatus
+  {
+  public:
+    OvmsStatus();
+    ~OvmsStatus();
+
+  public:
+    void Register(const char* name, const char* caller, uint32_t ttl_ms,
+                  OvmsStatusProducer producer, const char* events=NULL);
+    void RegisterCommand(const char* name, const char* caller, uint32_t ttl_ms,
+                         OvmsCommand* cmd, const char* events=NULL);
+    void Deregister(const char* caller);
+    bool IsRegistered(const char* name);
+
+  public:
+    bool Get(const char* name, OvmsStatusSnapshot& dst, bool refresh=false);
+    std::string GetText(const char* name);
+    std::string GetJson(const char* name);
+    void Invalidate(const char* name);
+
+  public:
+    void EventListener(std::string event, void* data);
+    void Status(OvmsWriter* writer);
+
+  protected:
+    struct Provider
+      {
+      std::string         caller;
+      uint32_t            ttl_ms;
+      OvmsStatusProducer  producer;
+      std::string         events;
+      OvmsStatusSnapshot  snapshot;
+      bool                valid;
+      int64_t             lastuse;
+      uint32_t            gets;
+      uint32_t            runs;
+      uint32_t            generation;   // incremented on (re-)registration & invalidation
+      };
+    typedef std::map<std::string, Provider> ProviderMap;
+
+    bool Produce(const std::string& name);
+    bool IsOutdated(const Provider& p, int64_t now);
+    bool MatchEvents(const std::string& events, const std::string& event);
+
+  protected:
+    OvmsRecMutex    m_mutex;
+    ProviderMap     m_providers;
+  };
+
+extern OvmsStatus MyStatus;
+
+#endif //#ifndef __OVMS_STATUS_H__
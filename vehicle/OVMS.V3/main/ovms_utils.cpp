@@ -555,6 +555,258 @@ int save_file(const std::string &path, extram::string &content)
   }
 
 
+/**
+ * CBOR encoding
+ */
+void cbor_put_head(std::string& buf, uint8_t major, uint64_t value)
+  {
+  major <<= 5;
+  if (value < 24)
+    {
+    buf += (char)(major | value);
+    }
+  else if (value <= 0xff)
+    {
+    buf += (char)(major | 24);
+    buf += (char)value;
+    }
+  else if (value <= 0xffff)
+    {
+    buf += (char)(major | 25);
+    buf += (char)(value >> 8);
+    buf += (char)value;
+    }
+  else if (value <= 0xffffffff)
+    {
+    buf += (char)(major | 26);
+    for (int shift = 24; shift >= 0; shift -= 8)
+      buf += (char)(value >> shift);
+    }
+  else
+    {
+    buf += (char)(major | 27);
+    for (int shift = 56; shift >= 0; shift -= 8)
+      buf += (char)(value >> shift);
+    }
+  }
+
+void cbor_put_int(std::string& buf, int64_t value)
+  {
+  if (value >= 0)
+    cbor_put_head(buf, CBOR_MAJOR_UINT, value);
+  else
+    cbor_put_head(buf, CBOR_MAJOR_NINT, -1 - value);
+  }
+
+void cbor_put_text(std::string& buf, const char* text, size_t len)
+  {
+  cbor_put_head(buf, CBOR_MAJOR_TEXT, len);
+  buf.append(text, len);
+  }
+
+static void cbor_put_double(std::string& buf, double value)
+  {
+  float fvalue = value;
+  if (fvalue == value || value != value)
+    {
+    // Exact (or NaN) in single precision:
+    uint32_t bits;
+    memcpy(&bits, &fvalue, 4);
+    buf += '\xfa';
+    for (int shift = 24; shift >= 0; shift -= 8)
+      buf += (char)(bits >> shift);
+    }
+  else
+    {
+    uint64_t bits;
+    memcpy(&bits, &value, 8);
+    buf += '\xfb';
+    for (int shift = 56; shift >= 0; shift -= 8)
+      buf += (char)(bits >> shift);
+    }
+  }
+
+static void utf8_put(std::string& buf, uint32_t cp)
+  {
+  if (cp < 0x80)
+    buf += (char)cp;
+  else if (cp < 0x800)
+    {
+    buf += (char)(0xc0 | (cp >> 6));
+    buf += (char)(0x80 | (cp & 0x3f));
+    }
+  else if (cp < 0x10000)
+    {
+    buf += (char)(0xe0 | (cp >> 12));
+    buf += (char)(0x80 | ((cp >> 6) & 0x3f));
+    buf += (char)(0x80 | (cp & 0x3f));
+    }
+  else
+    {
+    buf += (char)(0xf0 | (cp >> 18));
+    buf += (char)(0x80 | ((cp >> 12) & 0x3f));
+    buf += (char)(0x80 | ((cp >> 6) & 0x3f));
+    buf += (char)(0x80 | (cp & 0x3f));
+    }
+  }
+
+static bool json_get_hex4(const char*& p, uint32_t& cp)
+  {
+  cp = 0;
+  for (int i = 0; i < 4; i++, p++)
+    {
+    int d;
+    if (*p >= '0' && *p <= '9')       d = *p - '0';
+    else if (*p >= 'a' && *p <= 'f')  d = *p - 'a' + 10;
+    else if (*p >= 'A' && *p <= 'F')  d = *p - 'A' + 10;
+    else return false;
+    cp = (cp << 4) | d;
+    }
+  return true;
+  }
+
+static bool cbor_put_json_string(std::string& buf, const char*& p)
+  {
+  std::string text;
+  for (p++; *p != '"'; p++)
+    {
+    if (*p == 0)
+      return false;
+    if (*p != '\\')
+      {
+      text += *p;
+      continue;
+      }
+    switch (*++p)
+      {
+      case '"':   text += '"'; break;
+      case '\\':  text += '\\'; break;
+      case '/':   text += '/'; break;
+      case 'b':   text += '\b'; break;
+      case 'f':   text += '\f'; break;
+      case 'n':   text += '\n'; break;
+      case 'r':   text += '\r'; break;
+      case 't':   text += '\t'; break;
+      case 'u':
+        {
+        uint32_t cp, lo;
+        p++;
+        if (!json_get_hex4(p, cp))
+          return false;
+        if (cp >= 0xd800 && cp < 0xdc00 && p[0] == '\\' && p[1] == 'u')
+          {
+          p += 2;
+          if (!json_get_hex4(p, lo) || lo < 0xdc00 || lo > 0xdfff)
+            return false;
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+          }
+        utf8_put(text, cp);
+        p--;
+        break;
+        }
+      default:
+        return false;
+      }
+    }
+  p++;
+  cbor_put_text(buf, text);
+  return true;
+  }
+
+static bool cbor_put_json_value(std::string& buf, const char*& p, int depth)
+  {
+  while (isspace((unsigned char)*p)) p++;
+  switch (*p)
+    {
+    case '"':
+      return cbor_put_json_string(buf, p);
+    case '[':
+    case '{':
+      {
+      bool map = (*p == '{');
+      char end = map ? '}' : ']';
+      if (depth > 8)
+        return false;
+      buf += map ? '\xbf' : '\x9f';
+      p++;
+      while (isspace((unsigned char)*p)) p++;
+      if (*p == end)
+        {
+        p++;
+        buf += CBOR_BREAK;
+        return true;
+        }
+      while (true)
+        {
+        if (map)
+          {
+          while (isspace((unsigned char)*p)) p++;
+          if (*p != '"' || !cbor_put_json_string(buf, p))
+            return false;
+          while (isspace((unsigned char)*p)) p++;
+          if (*p++ != ':')
+            return false;
+          }
+        if (!cbor_put_json_value(buf, p, depth+1))
+          return false;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == ',')
+          p++;
+        else if (*p == end)
+          break;
+        else
+          return false;
+        }
+      p++;
+      buf += CBOR_BREAK;
+      return true;
+      }
+    case 't':
+      if (strncmp(p, "true", 4) != 0) return false;
+      buf += '\xf5';
+      p += 4;
+      return true;
+    case 'f':
+      if (strncmp(p, "false", 5) != 0) return false;
+      buf += '\xf4';
+      p += 5;
+      return true;
+    case 'n':
+      if (strncmp(p, "null", 4) != 0) return false;
+      buf += '\xf6';
+      p += 4;
+      return true;
+    default:
+      {
+      char* end;
+      double value = strtod(p, &end);
+      if (end == p)
+        return false;
+      if (strcspn(p, ".eEnNiI") >= (size_t)(end - p) && value >= -9.2e18 && value <= 9.2e18)
+        cbor_put_int(buf, strtoll(p, NULL, 10));
+      else
+        cbor_put_double(buf, value);
+      p = end;
+      return true;
+      }
+    }
+  }
+
+void cbor_put_json(std::string& buf, const std::string& json)
+  {
+  size_t start = buf.size();
+  const char* p = json.c_str();
+  if (cbor_put_json_value(buf, p, 0))
+    {
+    while (isspace((unsigned char)*p)) p++;
+    if (*p == 0)
+      return;
+    }
+  buf.resize(start);
+  cbor_put_text(buf, json);
+  }
+
+
 /**
  * mqtt_topic: convert dotted string (e.g. notification subtype) to MQTT topic
  *  - replace '.' by '/'
@@ -236,6 +236,38 @@ std::string json_encode(const src_string text)
   return buf;
   }
 
+/**
+ * CBOR encoding (RFC 8949) for binary transports:
+ *  cbor_put_head: append major type & argument
+ *  cbor_put_uint/int/text: append a single item
+ *  cbor_put_json: convert a JSON value (i.e. from OvmsMetric::AsJSON()),
+ *    falls back to a text string if the JSON cannot be parsed
+ */
+#define CBOR_MAJOR_UINT         0
+#define CBOR_MAJOR_NINT         1
+#define CBOR_MAJOR_TEXT         3
+#define CBOR_MAJOR_ARRAY        4
+#define CBOR_MAJOR_MAP          5
+#define CBOR_MAP_INDEFINITE     '\xbf'
+#define CBOR_BREAK              '\xff'
+
+void cbor_put_head(std::string& buf, uint8_t major, uint64_t value);
+inline void cbor_put_uint(std::string& buf, uint64_t value)
+  {
+  cbor_put_head(buf, CBOR_MAJOR_UINT, value);
+  }
+void cbor_put_int(std::string& buf, int64_t value);
+void cbor_put_text(std::string& buf, const char* text, size_t len);
+inline void cbor_put_text(std::string& buf, const char* text)
+  {
+  cbor_put_text(buf, text, strlen(text));
+  }
+inline void cbor_put_text(std::string& buf, const std::string& text)
+  {
+  cbor_put_text(buf, text.data(), text.size());
+  }
+void cbor_put_json(std::string& buf, const std::string& json);
+
 /**
  * display_encode: encode string displaying unprintablel characters
  * Emulates (linux) "cat -t" semantics
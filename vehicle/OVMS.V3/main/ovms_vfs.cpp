@@ -44,6 +44,7 @@ static const char *TAG = "vfs";
 #include "ovms_vfs.h"
 #include "ovms_config.h"
 #include "ovms_command.h"
+#include "ovms_events.h"
 #include "ovms_peripherals.h"
 #include "crypt_md5.h"
 #include "glob_match.h"
@@ -458,6 +459,11 @@ void vfs_stat(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, con
   fclose(f);
   }
 
+static void vfs_changed(const std::string &path)
+  {
+  MyEvents.SignalEvent("system.vfs.file.changed", (void*)path.c_str(), path.size()+1);
+  }
+
 void vfs_rm(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   std::string filename(argv[0]);
@@ -469,7 +475,10 @@ void vfs_rm(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const
       return;
       }
     if (unlink(filename.c_str()) == 0)
-      { writer->puts("VFS File deleted"); }
+      {
+      writer->puts("VFS File deleted");
+      vfs_changed(filename);
+      }
     else
       { writer->puts("Error: Could not delete VFS file"); }
     }
@@ -497,7 +506,10 @@ void vfs_rm(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const
       {
       const std::string &path = it->path();
       if (unlink(path.c_str()) == 0)
+        {
         ++delcount;
+        vfs_changed(path);
+        }
       else
         writer->printf("Error: Could not delete VFS file '%s'", path.c_str());
       }
@@ -520,7 +532,11 @@ void vfs_mv(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const
     return;
     }
   if (rename(argv[0],argv[1]) == 0)
-    { writer->puts("VFS File renamed"); }
+    {
+    writer->puts("VFS File renamed");
+    vfs_changed(argv[0]);
+    vfs_changed(argv[1]);
+    }
   else
     { writer->puts("Error: Could not rename VFS file"); }
   }
@@ -552,7 +568,10 @@ void vfs_mkdir(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, co
   int res = (parents) ? mkpath(dirpath,0) : mkdir(dirpath,0);
 
   if (res == 0)
-    { writer->puts("VFS directory created"); }
+    {
+    writer->puts("VFS directory created");
+    vfs_changed(dirpath);
+    }
   else
     { writer->puts("Error: Could not create VFS directory"); }
   }
@@ -584,7 +603,10 @@ void vfs_rmdir(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, co
   int res = (recursive) ? rmtree(dirpath) : rmdir(dirpath);
 
   if (res == 0)
-    { writer->puts("VFS directory removed"); }
+    {
+    writer->puts("VFS directory removed");
+    vfs_changed(dirpath);
+    }
   else
     { writer->puts("Error: Could not remove VFS directory"); }
   }
@@ -625,6 +647,7 @@ void vfs_cp(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const
   fclose(w);
   fclose(f);
   writer->puts("VFS copy complete");
+  vfs_changed(argv[1]);
   }
 
 void vfs_append(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
@@ -646,6 +669,7 @@ void vfs_append(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, c
   fwrite(argv[0], len, 1, w);
   fwrite("\n", 1, 1, w);
   fclose(w);
+  vfs_changed(argv[1]);
   }
 
 
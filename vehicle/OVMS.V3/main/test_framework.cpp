@@ -34,6 +34,7 @@ static const char *TAG = "test";
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <esp_timer.h>
 #include "esp_system.h"
 #include "esp_event.h"
@@ -45,6 +46,8 @@ static const char *TAG = "test";
 #include "metrics_standard.h"
 #include "ovms_config.h"
 #include "can.h"
+#include "ovms_pool.h"
+#include "ovms_malloc.h"
 #if ESP_IDF_VERSION_MAJOR < 4
 #include "strverscmp.h"
 #endif
@@ -380,6 +383,154 @@ void test_string(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc,
     (int)((esp_timer_get_time() - time_start_us) / 1000));
   }
 
+// Measure metric SetValue() throughput with 0, 1 and 5 listeners:
+//  (named listeners only, "*" listeners would be called for all metrics
+//  changed by other tasks while the benchmark runs)
+void test_metrics(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  int loops = (argc > 0) ? atoi(argv[0]) : 10000;
+  if (loops < 1) loops = 1;
+  static volatile uint32_t callcnt;
+
+  OvmsMetricFloat* m = new OvmsMetricFloat("test.bench.setvalue");
+  const int listenercnt[] = { 0, 1, 5 };
+  int registered = 0;
+
+  for (int t = 0; t < (int)(sizeof(listenercnt)/sizeof(listenercnt[0])); t++)
+    {
+    while (registered < listenercnt[t])
+      {
+      MyMetrics.RegisterListener("test.bench", "test.bench.setvalue",
+        [](OvmsMetric* metric) { callcnt++; });
+      registered++;
+      }
+    callcnt = 0;
+    int64_t time_start_us = esp_timer_get_time();
+    for (int j = 1; j <= loops; j++)
+      m->SetValue((float)j);
+    int64_t elapsed = esp_timer_get_time() - time_start_us;
+    writer->printf("%d listeners: %d SetValue calls in %lld us = %.2f us/call, %" PRIu32 " callbacks\n",
+      registered, loops, elapsed, (float)elapsed / loops, callcnt);
+    }
+
+  MyMetrics.DeregisterListener("test.bench");
+  MyMetrics.DeregisterMetric(m);
+  }
+
+/**
+ * test_pools: heap fragmentation benchmark, heap vs. MyPools
+ *
+ *  Replays a compressed week of synthetic hot path traffic (CAN log texts,
+ *  event names & data, notification entries, log lines, CAN callbacks) with
+ *  random lifetimes, interleaved with long lived allocations as done by other
+ *  subsystems. The same pseudo random sequence is run against the heap and
+ *  against the pools, the free size and largest free block of the heap the
+ *  pools live in (SPIRAM or internal, see CONFIG_OVMS_SYS_POOLS_SPIRAM) are
+ *  compared while the long lived set is still held.
+ */
+#define POOLTEST_LIVE     256         // short lived objects in flight
+#define POOLTEST_KEEP     64          // long lived objects held
+#define POOLTEST_HOUR     2000        // operations per simulated hour
+
+#ifdef CONFIG_OVMS_SYS_POOLS_SPIRAM
+#define POOLTEST_CAPS     (MALLOC_CAP_8BIT|MALLOC_CAP_SPIRAM)
+#define POOLTEST_MALLOC   ExternalRamMalloc
+#else
+#define POOLTEST_CAPS     (MALLOC_CAP_8BIT|MALLOC_CAP_INTERNAL)
+#define POOLTEST_MALLOC   InternalRamMalloc
+#endif
+
+static uint32_t pooltest_rand(uint32_t& state)
+  {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+  }
+
+static size_t pooltest_size(uint32_t r)
+  {
+  switch (r % 8)
+    {
+    case 0:   return 12 + (r >> 8) % 28;      // event name
+    case 1:   return 4 + (r >> 8) % 16;       // event data
+    case 2:   return 20;                      // CAN callback entry
+    case 3:   return 64;                      // shell output chunk
+    case 4:   return 40 + (r >> 8) % 28;      // notification entry
+    case 5:   return 20 + (r >> 8) % 100;     // CAN log text
+    default:  return 30 + (r >> 8) % 200;     // log line
+    }
+  }
+
+static void test_pools_run(OvmsWriter* writer, bool pool, int hours)
+  {
+  void* live[POOLTEST_LIVE] = {};
+  void* keep[POOLTEST_KEEP] = {};
+  uint32_t state = 0x4f564d53;
+  int ops = hours * POOLTEST_HOUR;
+  size_t minblock = heap_caps_get_largest_free_block(POOLTEST_CAPS);
+  size_t free_start = heap_caps_get_free_size(POOLTEST_CAPS);
+  uint32_t fallbacks = MyPools.m_fallbacks;
+  int kept = 0;
+
+  int64_t start = esp_timer_get_time();
+  for (int i = 0; i < ops; i++)
+    {
+    uint32_t r = pooltest_rand(state);
+    void*& slot = live[r % POOLTEST_LIVE];
+    if (pool)
+      MyPools.Free(slot);
+    else
+      free(slot);
+    size_t size = pooltest_size(r >> 8);
+    slot = pool ? MyPools.Alloc(size) : POOLTEST_MALLOC(size);
+
+    // About every 64th operation replaces a long lived allocation:
+    if ((r & 0x3f000000) == 0)
+      {
+      void*& k = keep[kept++ % POOLTEST_KEEP];
+      free(k);
+      k = POOLTEST_MALLOC(100 + (r & 0x1ff));
+      }
+
+    if ((i % POOLTEST_HOUR) == 0)
+      {
+      size_t block = heap_caps_get_largest_free_block(POOLTEST_CAPS);
+      if (block < minblock) minblock = block;
+      vTaskDelay(1);
+      }
+    }
+  int64_t elapsed = esp_timer_get_time() - start;
+
+  // Measure with the long lived set still held:
+  for (int i = 0; i < POOLTEST_LIVE; i++)
+    {
+    if (pool)
+      MyPools.Free(live[i]);
+    else
+      free(live[i]);
+    }
+  size_t free_end = heap_caps_get_free_size(POOLTEST_CAPS);
+  size_t block_end = heap_caps_get_largest_free_block(POOLTEST_CAPS);
+  for (int i = 0; i < POOLTEST_KEEP; i++)
+    free(keep[i]);
+
+  writer->printf("%-5s %8d ops %6.2f us/op | free %zu -> %zu | largest block min %zu end %zu",
+    pool ? "pool" : "heap", ops, (float)elapsed / ops, free_start, free_end, minblock, block_end);
+  if (pool)
+    writer->printf(" | %u fallbacks", MyPools.m_fallbacks - fallbacks);
+  writer->puts("");
+  }
+
+void test_pools(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  int hours = (argc > 0) ? atoi(argv[0]) : 168;
+  if (hours < 1) hours = 1;
+  writer->printf("Simulating %d hours of hot path traffic (%d ops/hour)...\n", hours, POOLTEST_HOUR);
+  test_pools_run(writer, false, hours);
+  test_pools_run(writer, true, hours);
+  }
+
 void test_command(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   MyCommandApp.Display(writer);
@@ -413,4 +564,6 @@ TestFrameworkInit::TestFrameworkInit()
   cmd_test->RegisterCommand("string", "Test std::string memory corruption", test_string, "<loopcnt> <mode>\n"
     "mode: 1=m.AsJSON, 2=m.AsString, 3=m.name, 4=const cfg string, 5=const local cstr, 6=const local string", 2, 2);
   cmd_test->RegisterCommand("commands", "List command tree", test_command);
+  cmd_test->RegisterCommand("metrics", "Test metric SetValue throughput with 0/1/5 listeners", test_metrics, "[<loops>]", 0, 1);
+  cmd_test->RegisterCommand("pools", "Heap fragmentation benchmark, heap vs. object pools", test_pools, "[<hours>]", 0, 1);
   }
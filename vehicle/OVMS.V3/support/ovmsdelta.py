@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+#
+# ovmsdelta.py: create & apply OVMS binary delta firmware patches
+#
+# A delta patch transforms a released firmware image (as running on the module)
+# into a new image. The module applies the patch while streaming it, reading the
+# running partition and writing the update partition (see ovms_ota/src/ota_delta.h).
+#
+# Patch file format (all integers little endian):
+#
+#   Header:   "OVMSDLT1"                  8 bytes magic
+#             old image size              uint32
+#             old image SHA-256           32 bytes
+#             new image size              uint32
+#             new image SHA-256           32 bytes
+#   Body:     zlib stream of records:
+#             diff length                 uint32
+#             extra length                uint32
+#             old position adjustment     int32
+#             diff bytes                  diff length bytes, added to old image bytes
+#             extra bytes                 extra length bytes, copied literally
+#
+# The old image position starts at 0 and advances by the diff length, then by the
+# adjustment, after each record (bsdiff style control/diff/extra sequence).
+#
+# The module looks for "<image url>.delta", an index listing the patches for that
+# image, one per line:
+#
+#   <old size> <old sha256> <new size> <new sha256> <patch file name>
+#
+# Patch file names are relative to the index location.
+#
+# Usage:
+#   ovmsdelta.py create OLD.bin NEW.bin PATCH.ovd [--index ovms3.bin.delta]
+#   ovmsdelta.py apply OLD.bin PATCH.ovd OUT.bin
+#   ovmsdelta.py info PATCH.ovd
+#   ovmsdelta.py selftest
+#
+
+import argparse
+import hashlib
+import os
+import random
+import struct
+import sys
+import zlib
+
+MAGIC = b"OVMSDLT1"
+HEADER = struct.Struct("<8sI32sI32s")
+CONTROL = struct.Struct("<IIi")
+
+SEED_LEN = 8            # Minimum exact match to start a diff region
+SEED_STEP = 4           # Old image index granularity
+
+
+def _index(old):
+  index = {}
+  for pos in range(0, len(old) - SEED_LEN + 1, SEED_STEP):
+    index.setdefault(old[pos:pos+SEED_LEN], pos)
+  return index
+
+
+def _extend_forward(old, opos, new, npos):
+  # bsdiff style approximate extension: keep the length with the best
+  # score of matches minus mismatches
+  n = min(len(old) - opos, len(new) - npos)
+  score = best = length = 0
+  for i in range(n):
+    if old[opos+i] == new[npos+i]:
+      score += 1
+    else:
+      score -= 1
+    if score > best:
+      best = score
+      length = i + 1
+    elif score < best - 32:
+      break
+  return length
+
+
+def _extend_backward(old, opos, new, npos, limit):
+  n = min(opos, npos - limit)
+  length = 0
+  while length < n and old[opos-length-1] == new[npos-length-1]:
+    length += 1
+  return length
+
+
+def _matches(old, new):
+  index = _index(old)
+  matches = []
+  last_end = 0
+  lastoff = 0
+  npos = 0
+  while npos <= len(new) - SEED_LEN:
+    # Prefer continuing at the previous offset (typical for shifted code):
+    opos = npos + lastoff
+    if not (0 <= opos <= len(old) - SEED_LEN and old[opos:opos+SEED_LEN] == new[npos:npos+SEED_LEN]):
+      opos = index.get(new[npos:npos+SEED_LEN])
+      if opos is None:
+        npos += 1
+        continue
+    back = _extend_backward(old, opos, new, npos, last_end)
+    ostart, nstart = opos - back, npos - back
+    length = _extend_forward(old, ostart, new, nstart)
+    if length < SEED_LEN:
+      npos += 1
+      continue
+    matches.append((ostart, nstart, length))
+    lastoff = ostart - nstart
+    last_end = nstart + length
+    npos = last_end
+  return matches
+
+
+def _record(body, old, new, dstart, nstart, dlen, extra_end, seek):
+  body += CONTROL.pack(dlen, extra_end - (nstart + dlen), seek)
+  body += bytes((new[nstart+i] - old[dstart+i]) & 0xff for i in range(dlen))
+  body += new[nstart+dlen:extra_end]
+
+
+def make_patch(old, new):
+  matches = _matches(old, new)
+  body = bytearray()
+  # Regions: (old start, new start, diff length), the extra data runs
+  # up to the new start of the following region
+  regions = [(0, 0, 0)] + matches
+  for i, (ostart, nstart, dlen) in enumerate(regions):
+    if i + 1 < len(regions):
+      nextold, nextnew = regions[i+1][0], regions[i+1][1]
+    else:
+      nextold, nextnew = ostart + dlen, len(new)
+    _record(body, old, new, ostart, nstart, dlen, nextnew, nextold - (ostart + dlen))
+  header = HEADER.pack(MAGIC,
+    len(old), hashlib.sha256(old).digest(),
+    len(new), hashlib.sha256(new).digest())
+  return header + zlib.compress(bytes(body), 9)
+
+
+def parse_header(patch):
+  if len(patch) < HEADER.size:
+    raise ValueError("patch too short")
+  magic, oldsize, oldsha, newsize, newsha = HEADER.unpack_from(patch)
+  if magic != MAGIC:
+    raise ValueError("not an OVMS delta patch")
+  return oldsize, oldsha, newsize, newsha
+
+
+def apply_patch(old, patch):
+  oldsize, oldsha, newsize, newsha = parse_header(patch)
+  if len(old) < oldsize or hashlib.sha256(old[:oldsize]).digest() != oldsha:
+    raise ValueError("old image does not match the patch base")
+  old = old[:oldsize]
+  body = zlib.decompress(patch[HEADER.size:])
+  new = bytearray()
+  pos = 0
+  oldpos = 0
+  while pos < len(body):
+    dlen, elen, seek = CONTROL.unpack_from(body, pos)
+    pos += CONTROL.size
+    if oldpos < 0 or oldpos + dlen > len(old):
+      raise ValueError("diff exceeds old image")
+    new += bytes((body[pos+i] + old[oldpos+i]) & 0xff for i in range(dlen))
+    pos += dlen
+    new += body[pos:pos+elen]
+    pos += elen
+    oldpos += dlen + seek
+  if len(new) != newsize or hashlib.sha256(new).digest() != newsha:
+    raise ValueError("result does not match the patch target")
+  return bytes(new)
+
+
+def update_index(indexfile, patchfile, patch):
+  oldsize, oldsha, newsize, newsha = parse_header(patch)
+  line = "%d %s %d %s %s" % (oldsize, oldsha.hex(), newsize, newsha.hex(), os.path.basename(patchfile))
+  lines = []
+  if os.path.exists(indexfile):
+    with open(indexfile) as f:
+      for l in f.read().splitlines():
+        fields = l.split()
+        # Drop entries for other targets & the same base:
+        if len(fields) == 5 and fields[3] == newsha.hex() and fields[1] != oldsha.hex():
+          lines.append(l)
+  lines.append(line)
+  with open(indexfile, "w") as f:
+    f.write("\n".join(lines) + "\n")
+
+
+def _sample_images(rnd, size):
+  # Synthetic "firmware": code-like words with relative pointers, strings & tables
+  old = bytearray()
+  while len(old) < size:
+    kind = rnd.random()
+    if kind < 0.6:
+      base = rnd.randrange(0x400d0000, 0x40200000)
+      for _ in range(rnd.randrange(8, 64)):
+        old += struct.pack("<I", base + rnd.randrange(0, 4096) * 4)
+    elif kind < 0.8:
+      old += bytes(rnd.choice(b"abcdefghijklmnopqrstuvwxyz :%/") for _ in range(rnd.randrange(8, 80))) + b"\0"
+    else:
+      old += bytes(rnd.randrange(256) for _ in range(rnd.randrange(16, 256)))
+  old = bytes(old[:size])
+
+  # New version: relocation (pointer shifts), insertions, deletions, patches
+  new = bytearray(old)
+  for _ in range(20):
+    pos = rnd.randrange(len(new) + 1)
+    op = rnd.random()
+    if op < 0.3:
+      new[pos:pos] = bytes(rnd.randrange(256) for _ in range(rnd.randrange(1, 2000)))
+    elif op < 0.5:
+      del new[pos:pos+rnd.randrange(1, 2000)]
+    else:
+      for i in range(pos - pos % 4, min(len(new) - 4, pos + 4000), 4):
+        (w,) = struct.unpack_from("<I", new, i)
+        if 0x400d0000 <= w < 0x40200000:
+          struct.pack_into("<I", new, i, w + 0x40)
+  return old, bytes(new)
+
+
+def selftest():
+  rnd = random.Random(4711)
+  ok = True
+  for n, size in enumerate([0, 1, 100, 50000, 300000]):
+    old, new = _sample_images(rnd, size)
+    patch = make_patch(old, new)
+    try:
+      result = apply_patch(old, patch)
+      good = (hashlib.sha256(result).digest() == hashlib.sha256(new).digest())
+    except ValueError as e:
+      print("  sample %d: %s" % (n, e))
+      good = False
+    print("sample %d: old %d, new %d, patch %d bytes (%.1f%%): %s" % (
+      n, len(old), len(new), len(patch), 100.0 * len(patch) / max(len(new), 1), "OK" if good else "FAILED"))
+    ok = ok and good
+  # Unrelated base must be rejected:
+  try:
+    apply_patch(b"x" * 1000, make_patch(b"y" * 1000, b"z" * 1000))
+    print("base check: FAILED")
+    ok = False
+  except ValueError:
+    print("base check: OK")
+  return ok
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Create & apply OVMS delta firmware patches")
+  sub = parser.add_subparsers(dest="cmd", required=True)
+  p = sub.add_parser("create", help="create patch from OLD to NEW image")
+  p.add_argument("old")
+  p.add_argument("new")
+  p.add_argument("patch")
+  p.add_argument("--index", help="add patch to this index file (e.g. ovms3.bin.delta)")
+  p = sub.add_parser("apply", help="apply PATCH to OLD image")
+  p.add_argument("old")
+  p.add_argument("patch")
+  p.add_argument("out")
+  p = sub.add_parser("info", help="show patch header")
+  p.add_argument("patch")
+  sub.add_parser("selftest", help="create & apply patches on sample images, verify hashes")
+  args = parser.parse_args()
+
+  if args.cmd == "create":
+    old = open(args.old, "rb").read()
+    new = open(args.new, "rb").read()
+    patch = make_patch(old, new)
+    with open(args.patch, "wb") as f:
+      f.write(patch)
+    apply_patch(old, patch)
+    print("%s: %d bytes (%.1f%% of %d)" % (args.patch, len(patch), 100.0 * len(patch) / max(len(new), 1), len(new)))
+    if args.index:
+      update_index(args.index, args.patch, patch)
+  elif args.cmd == "apply":
+    new = apply_patch(open(args.old, "rb").read(), open(args.patch, "rb").read())
+    with open(args.out, "wb") as f:
+      f.write(new)
+    print("%s: %d bytes, SHA-256 %s" % (args.out, len(new), hashlib.sha256(new).hexdigest()))
+  elif args.cmd == "info":
+    oldsize, oldsha, newsize, newsha = parse_header(open(args.patch, "rb").read())
+    print("old: %d bytes, SHA-256 %s" % (oldsize, oldsha.hex()))
+    print("new: %d bytes, SHA-256 %s" % (newsize, newsha.hex()))
+  elif args.cmd == "selftest":
+    return 0 if selftest() else 1
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())